@@ -8,6 +8,7 @@
 #include "Event.h"
 #include "Picking.h"
 #include "Lighting.h"
+#include "Platform.h"
 
 struct _BlockLists Blocks;
 
@@ -346,23 +347,18 @@ static cc_bool Block_MightCull(BlockID block, BlockID other) {
 	return (bType == COLLIDE_SOLID && oType == COLLIDE_SOLID) || bType != COLLIDE_SOLID;
 }
 
-static void Block_CalcCulling(BlockID block, BlockID other) {
+/* Calculates which faces of 'block' are hidden by the neighbouring 'other' block */
+static int Block_CalcHiddenFaces(BlockID block, BlockID other) {
 	Vec3 bMin, bMax, oMin, oMax;
 	cc_bool occludedX, occludedY, occludedZ, bothLiquid;
 	int f;
 
 	/* Fast path: Full opaque neighbouring blocks will always have all shared faces hidden */
-	if (Blocks.FullOpaque[block] && Blocks.FullOpaque[other]) {
-		Blocks.Hidden[(block * BLOCK_COUNT) + other] = 0x3F;
-		return;
-	}
+	if (Blocks.FullOpaque[block] && Blocks.FullOpaque[other]) return 0x3F;
 
 	/* Some blocks may not cull 'other' block, in which case just skip detailed check */
 	/* e.g. sprite blocks, default leaves, will not cull any other blocks */
-	if (!Block_MightCull(block, other)) {	
-		Blocks.Hidden[(block * BLOCK_COUNT) + other] = 0;
-		return;
-	}
+	if (!Block_MightCull(block, other)) return 0;
 
 	bMin = Blocks.MinBB[block]; bMax = Blocks.MaxBB[block];
 	oMin = Blocks.MinBB[other]; oMax = Blocks.MaxBB[other];
@@ -386,29 +382,85 @@ static void Block_CalcCulling(BlockID block, BlockID other) {
 	f |= occludedZ && oMin.z == 0.0f && bMax.z == 1.0f ? FACE_BIT_ZMAX : 0;
 	f |= occludedY && (bothLiquid || (oMax.y == 1.0f && bMin.y == 0.0f)) ? FACE_BIT_YMIN : 0;
 	f |= occludedY && (bothLiquid || (oMin.y == 0.0f && bMax.y == 1.0f)) ? FACE_BIT_YMAX : 0;
-	Blocks.Hidden[(block * BLOCK_COUNT) + other] = f;
+	return f;
+}
+
+static void Block_CalcCulling(BlockID block, BlockID other) {
+	int face, faces = Block_CalcHiddenFaces(block, other);
+	cc_uint32 bit   = 1u << (other & 31);
+	cc_uint32* row;
+	Blocks.Hidden[(block * BLOCK_COUNT) + other] = faces;
+
+	for (face = 0; face < FACE_COUNT; face++) 
+	{
+		row = Block_HiddenRow(block, face) + (other >> 5);
+		if (faces & (1 << face)) { *row |= bit; } else { *row &= ~bit; }
+	}
+}
+
+/* Recalculates which neighbouring blocks hide each face of this block */
+static void Block_CalcCullingRow(BlockID block, const cc_uint32* fullOpaque) {
+	cc_uint32* rows = Block_HiddenRow(block, 0);
+	int i, other;
+
+	/* Sprite blocks never have any faces hidden */
+	if (Blocks.Draw[block] == DRAW_SPRITE) {
+		Mem_Set(rows, 0, FACE_COUNT * BLOCK_HIDDEN_WORDS * sizeof(cc_uint32));
+		Mem_Set(&Blocks.Hidden[block * BLOCK_COUNT], 0, BLOCK_COUNT);
+		return;
+	}
+
+	/* Fast path: Every face of a full opaque block is hidden by all full opaque neighbours */
+	if (Blocks.FullOpaque[block]) {
+		for (i = 0; i < FACE_COUNT; i++) 
+		{
+			Mem_Copy(rows + i * BLOCK_HIDDEN_WORDS, fullOpaque, BLOCK_HIDDEN_WORDS * sizeof(cc_uint32));
+		}
+	}
+
+	for (other = BLOCK_AIR; other < BLOCK_COUNT; other++) 
+	{
+		if (Blocks.FullOpaque[block] && Blocks.FullOpaque[other]) {
+			Blocks.Hidden[(block * BLOCK_COUNT) + other] = 0x3F;
+			continue;
+		}
+		Block_CalcCulling(block, (BlockID)other);
+	}
+}
+
+/* Calculates the bitset of which blocks are full opaque */
+static void Block_CalcFullOpaqueBits(cc_uint32* bits) {
+	int block;
+	Mem_Set(bits, 0, BLOCK_HIDDEN_WORDS * sizeof(cc_uint32));
+
+	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) 
+	{
+		if (Blocks.FullOpaque[block]) bits[block >> 5] |= 1u << (block & 31);
+	}
 }
 
 /* Updates culling data of all blocks */
 static void Block_UpdateAllCulling(void) {
-	int block, neighbour;
+	cc_uint32 fullOpaque[BLOCK_HIDDEN_WORDS];
+	int block;
+	Block_CalcFullOpaqueBits(fullOpaque);
 
 	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
 		Block_CalcStretch((BlockID)block);
-		for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) {
-			Block_CalcCulling((BlockID)block, (BlockID)neighbour);
-		}
+		Block_CalcCullingRow((BlockID)block, fullOpaque);
 	}
 }
 
 /* Updates culling data just for this block */
 /* (e.g. whether block can be stretched, visibility with other blocks) */
 static void Block_UpdateCulling(BlockID block) {
+	cc_uint32 fullOpaque[BLOCK_HIDDEN_WORDS];
 	int neighbour;
 	Block_CalcStretch(block);
+	Block_CalcFullOpaqueBits(fullOpaque);
+	Block_CalcCullingRow(block, fullOpaque);
 	
 	for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) {
-		Block_CalcCulling(block, (BlockID)neighbour);
 		Block_CalcCulling((BlockID)neighbour, block);
 	}
 }
@@ -449,6 +501,7 @@ void Block_DefineCustom(BlockID block, cc_bool checkSprite) {
 
 	Inventory_AddDefault(block);
 	Block_SetCustomDefined(block, true);
+	Event_RaiseInt(&BlockEvents.BlockDefUpdated, block);
 	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
 
 	if (!checkSprite) return; /* TODO eliminate this */
@@ -464,6 +517,7 @@ void Block_UndefineCustom(BlockID block) {
 	if (block <= BLOCK_MAX_CPE) { Inventory_AddDefault(block); }
 
 	Block_SetCustomDefined(block, false);
+	Event_RaiseInt(&BlockEvents.BlockDefUpdated, block);
 	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
 
 	/* Update sprite BoundingBox if necessary */
@@ -42,6 +42,9 @@ enum CollideType {
 	COLLIDE_CLIMB         /* Rope/Ladder style climbing interaction when player collides. */
 };
 
+/* Number of 32 bit words needed to store one bit for every block */
+#define BLOCK_HIDDEN_WORDS ((BLOCK_COUNT + 31) >> 5)
+
 CC_VAR extern struct _BlockLists {
 	/* Whether this block is a liquid. (Like water/lava) */
 	cc_bool IsLiquid[BLOCK_COUNT];
@@ -104,6 +107,9 @@ CC_VAR extern struct _BlockLists {
 	cc_uint8 CanStretch[BLOCK_COUNT];
 	/* Gravity of particles spawned when this block is broken */
 	float ParticleGravity[BLOCK_COUNT];
+	/* Bitsets of which neighbouring blocks hide each face of this block. */
+	/* Laid out as [block][face][neighbour bit], see Block_HiddenRow */
+	cc_uint32 HiddenBits[BLOCK_COUNT * FACE_COUNT * BLOCK_HIDDEN_WORDS];
 } Blocks;
 
 #define Block_Tint(col, block)\
@@ -143,8 +149,10 @@ void Block_SetSide(TextureLoc texLoc, BlockID blockId);
 /* The texture for the given face of the given block */
 #define Block_Tex(block, face) Blocks.Textures[(block) * FACE_COUNT + (face)]
 
-/* Whether the given face of this block is occluded/hidden */
-#define Block_IsFaceHidden(block, other, face) (Blocks.Hidden[((block) * BLOCK_COUNT) + (other)] & (1 << (face)))
+/* Bitset of which neighbouring blocks hide the given face of this block */
+#define Block_HiddenRow(block, face) (&Blocks.HiddenBits[((block) * FACE_COUNT + (face)) * BLOCK_HIDDEN_WORDS])
+/* Whether the given face of this block is occluded/hidden (1 if so, 0 if not) */
+#define Block_IsFaceHidden(block, other, face) ((Block_HiddenRow(block, face)[(other) >> 5] >> ((other) & 31)) & 1)
 
 /* Whether blocks can be automatically rotated */
 extern cc_bool AutoRotate_Enabled;
@@ -150,6 +150,8 @@ void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
 		Game_UpdateBlock(x, y, z, BLOCK_STILL_WATER);
 	}
 	index = World_Pack(x, y, z);
+	/* e.g. sponges and TNT may change many blocks at once */
+	Game_BeginBlockBatch();
 
 	/* User can place/delete blocks over ID 256 */
 	if (now == BLOCK_AIR) {
@@ -160,6 +162,7 @@ void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
 		if (handler) handler(index, now);
 	}
 	Physics_ActivateNeighbours(x, y, z, index);
+	Game_EndBlockBatch();
 }
 
 static void Physics_TickRandomBlocks(void) {
@@ -564,10 +567,12 @@ void Physics_Free(void) {
 void Physics_Tick(void) {
 	if (!Physics.Enabled || !World.Blocks) return;
 
+	Game_BeginBlockBatch();
 	/*if ((tickCount % 5) == 0) {*/
 	Physics_TickLava();
 	Physics_TickWater();
 	/*}*/
 	physics_tickCount++;
 	Physics_TickRandomBlocks();
+	Game_EndBlockBatch();
 }
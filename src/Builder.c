@@ -20,23 +20,8 @@ int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 18x18x18 chunk array. Coordinates range from -1 to 16. */
 #define Builder_PackChunk(xx, yy, zz) (((yy) + 1) * EXTCHUNK_SIZE_2 + ((zz) + 1) * EXTCHUNK_SIZE + ((xx) + 1))
 
-static BlockID* Builder_Chunk;
-static cc_uint8* Builder_Counts;
-static int* Builder_BitFlags;
-static int Builder_X, Builder_Y, Builder_Z;
-static BlockID Builder_Block;
-static int Builder_ChunkIndex;
-static cc_bool Builder_FullBright;
-static int Builder_ChunkEndX, Builder_ChunkEndZ;
 static int Builder_Offsets[FACE_COUNT] = { -1,1, -EXTCHUNK_SIZE,EXTCHUNK_SIZE, -EXTCHUNK_SIZE_2,EXTCHUNK_SIZE_2 };
 
-static int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
-static int (*Builder_StretchX)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
-static int (*Builder_StretchZ)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
-static void (*Builder_RenderBlock)(int countsIndex, int x, int y, int z);
-static void (*Builder_PrePrepareChunk)(void);
-static void (*Builder_PostPrepareChunk)(void);
-
 /* Contains state for vertices for a portion of a chunk mesh (vertices that are in a 1D atlas) */
 struct Builder1DPart {
 	/* Union to save on memory, since chunk building is divided into counting then building phases */
@@ -47,10 +32,50 @@ struct Builder1DPart {
 	int sCount, sOffset;
 };
 
-/* Part builder data, for both normal and translucent parts.
-The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
-static struct Builder1DPart Builder_Parts[ATLAS1D_MAX_ATLASES * 2];
-static struct VertexTextured* Builder_Vertices;
+/* Contains all the state needed while building the mesh of a single chunk. */
+/* Each mesh builder thread has its own context, so chunks can be built in parallel. */
+struct BuilderContext {
+	BlockID* chunk;
+	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT];
+#ifdef CC_BUILD_TINYSTACK
+	int bitFlags[1];
+#else
+	int bitFlags[EXTCHUNK_SIZE_3];
+#endif
+	int curX, curY, curZ;
+	BlockID block;
+	int chunkIndex;
+	cc_bool fullBright;
+	int chunkEndX, chunkEndY, chunkEndZ;
+	/* Number of rows merged into each face by greedy meshing */
+	cc_uint8 rows[CHUNK_SIZE_3 * FACE_COUNT];
+	/* Scratch data for calculating which faces of the chunk are connected */
+	cc_uint8  floodVisited[CHUNK_SIZE_3];
+	cc_uint16 floodStack[CHUNK_SIZE_3];
+
+	/* Part builder data, for both normal and translucent parts.
+	The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
+	struct Builder1DPart parts[ATLAS1D_MAX_ATLASES * 2];
+	struct VertexTextured* vertices;
+	struct _DrawerData drawer;
+	RNGState spriteRng;
+#ifdef CC_BUILD_ADVLIGHTING
+	struct {
+		Vec3 minBB, maxBB;
+		int initBitFlags, baseOffset;
+		float x1, y1, z1, x2, y2, z2;
+		PackedCol lerp[5], lerpX[5], lerpZ[5], lerpY[5];
+		cc_bool tinted;
+	} adv;
+#endif
+};
+
+static int (*Builder_StretchXLiquid)(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
+static int (*Builder_StretchX)(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+static int (*Builder_StretchZ)(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face);
+static void (*Builder_RenderBlock)(struct BuilderContext* ctx, int countsIndex, int x, int y, int z);
+static void (*Builder_PrePrepareChunk)(struct BuilderContext* ctx);
+static void (*Builder_PostPrepareChunk)(struct BuilderContext* ctx);
 
 static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	int i, count = part->sCount;
@@ -58,7 +83,7 @@ static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	return count;
 }
 
-static int Builder1DPart_CalcOffsets(struct Builder1DPart* part, int offset) {
+static int Builder1DPart_CalcOffsets(struct BuilderContext* ctx, struct Builder1DPart* part, int offset) {
 	int i, counts[FACE_COUNT];
 	part->sOffset = offset;
 
@@ -71,16 +96,16 @@ static int Builder1DPart_CalcOffsets(struct Builder1DPart* part, int offset) {
 	offset += part->sCount;
 	for (i = 0; i < FACE_COUNT; i++) 
 	{
-		part->faces.vertices[i] = &Builder_Vertices[offset];
+		part->faces.vertices[i] = &ctx->vertices[offset];
 		offset += counts[i];
 	}
 	return offset;
 }
 
-static int Builder_TotalVerticesCount(void) {
+static int Builder_TotalVerticesCount(struct BuilderContext* ctx) {
 	int i, count = 0;
 	for (i = 0; i < ATLAS1D_MAX_ATLASES * 2; i++) {
-		count += Builder1DPart_VerticesCount(&Builder_Parts[i]);
+		count += Builder1DPart_VerticesCount(&ctx->parts[i]);
 	}
 	return count;
 }
@@ -89,28 +114,28 @@ static int Builder_TotalVerticesCount(void) {
 /*########################################################################################################################*
 *----------------------------------------------------Base mesh builder----------------------------------------------------*
 *#########################################################################################################################*/
-static void AddSpriteVertices(BlockID block) {
+static void AddSpriteVertices(struct BuilderContext* ctx, BlockID block) {
 	int i = Atlas1D_Index(Block_Tex(block, FACE_XMAX));
-	struct Builder1DPart* part = &Builder_Parts[i];
+	struct Builder1DPart* part = &ctx->parts[i];
 	part->sCount += 4 * 4;
 }
 
-static void AddVertices(BlockID block, Face face) {
+static void AddVertices(struct BuilderContext* ctx, BlockID block, Face face) {
 	int baseOffset = (Blocks.Draw[block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
 	int i = Atlas1D_Index(Block_Tex(block, face));
-	struct Builder1DPart* part = &Builder_Parts[baseOffset + i];
+	struct Builder1DPart* part = &ctx->parts[baseOffset + i];
 	part->faces.count[face] += 4;
 }
 
 #ifdef CC_BUILD_GL11
-static void BuildPartVbs(struct ChunkPartInfo* info) {
+static void BuildPartVbs(struct VertexTextured* vertices, struct ChunkPartInfo* info) {
 	/* Sprites vertices are stored before chunk face sides */
 	int i, count, offset = info->offset + info->spriteCount;
 	for (i = 0; i < FACE_COUNT; i++) {
 		count = info->counts[i];
 
 		if (count) {
-			info->vbs[i] = Gfx_CreateVb2(&Builder_Vertices[offset], VERTEX_FORMAT_TEXTURED, count);
+			info->vbs[i] = Gfx_CreateVb2(&vertices[offset], VERTEX_FORMAT_TEXTURED, count);
 			offset += count;
 		} else {
 			info->vbs[i] = 0;
@@ -120,7 +145,7 @@ static void BuildPartVbs(struct ChunkPartInfo* info) {
 	count  = info->spriteCount;
 	offset = info->offset;
 	if (count) {
-		info->vbs[i] = Gfx_CreateVb2(&Builder_Vertices[offset], VERTEX_FORMAT_TEXTURED, count);
+		info->vbs[i] = Gfx_CreateVb2(&vertices[offset], VERTEX_FORMAT_TEXTURED, count);
 	} else {
 		info->vbs[i] = 0;
 	}
@@ -146,98 +171,166 @@ static cc_bool SetPartInfo(struct Builder1DPart* part, int* offset, struct Chunk
 }
 
 
-static void PrepareChunk(int x1, int y1, int z1) {
+/* Whether the given face of the block is hidden by the block at the given offset in the chunk array */
+#define Row_HiddenBit(face, offset) Block_IsFaceHidden(b, row[x + (offset)], face)
+
+/* Calculates bit masks of which blocks in each row of the extended chunk are full opaque or gas */
+/* Bit (x + 1) of a row's mask is for the block at x, so the neighbours at x = -1 and x = 16 are included */
+static void Builder_CalcRowMasks(const BlockID* chunk, cc_uint32* opaque, cc_uint32* gas) {
+	cc_uint32 o, g;
+	BlockID b;
+	int i, x;
+
+	for (i = 0; i < EXTCHUNK_SIZE_2; i++, chunk += EXTCHUNK_SIZE) 
+	{
+		o = 0; g = 0;
+		for (x = 0; x < EXTCHUNK_SIZE; x++) 
+		{
+			b  = chunk[x];
+			o |= (cc_uint32)Blocks.FullOpaque[b]         << x;
+			g |= (cc_uint32)(Blocks.Draw[b] == DRAW_GAS) << x;
+		}
+		opaque[i] = o; gas[i] = g;
+	}
+}
+
+/* Calculates bit masks of which faces of each block in a row of the chunk are hidden by its neighbours */
+/* Bit x of hidden[face] is set when the face of the xth block in the row is hidden */
+/* Returns a bit mask of which blocks in the row are drawn (i.e. not gas) */
+static cc_uint32 Builder_CalcRowHidden(const BlockID* row, int len, const cc_uint32* opaque, const cc_uint32* gas, cc_uint32* hidden) {
+	cc_uint32 mask  = (1u << len) - 1;
+	cc_uint32 self  = (opaque[0] >> 1) & mask;
+	cc_uint32 drawn = ~(gas[0] >> 1) & mask;
+	cc_uint32 slow;
+	BlockID b;
+	int x;
+
+	/* Fast path: Faces of full opaque blocks are always hidden by full opaque neighbours */
+	hidden[FACE_XMIN] = self &  opaque[0];
+	hidden[FACE_XMAX] = self & (opaque[0] >> 2);
+	hidden[FACE_ZMIN] = self & (opaque[-1] >> 1);
+	hidden[FACE_ZMAX] = self & (opaque[ 1] >> 1);
+	hidden[FACE_YMIN] = self & (opaque[-EXTCHUNK_SIZE] >> 1);
+	hidden[FACE_YMAX] = self & (opaque[ EXTCHUNK_SIZE] >> 1);
+
+	/* Only the other drawn blocks need to look up the culling table */
+	slow = drawn & ~(hidden[FACE_XMIN] & hidden[FACE_XMAX] & hidden[FACE_ZMIN] &
+					 hidden[FACE_ZMAX] & hidden[FACE_YMIN] & hidden[FACE_YMAX]);
+
+	for (x = 0; slow; x++, slow >>= 1) 
+	{
+		if (!(slow & 1)) continue;
+		b = row[x];
+
+		hidden[FACE_XMIN] |= Row_HiddenBit(FACE_XMIN, -1)                << x;
+		hidden[FACE_XMAX] |= Row_HiddenBit(FACE_XMAX,  1)                << x;
+		hidden[FACE_ZMIN] |= Row_HiddenBit(FACE_ZMIN, -EXTCHUNK_SIZE)    << x;
+		hidden[FACE_ZMAX] |= Row_HiddenBit(FACE_ZMAX,  EXTCHUNK_SIZE)    << x;
+		hidden[FACE_YMIN] |= Row_HiddenBit(FACE_YMIN, -EXTCHUNK_SIZE_2)  << x;
+		hidden[FACE_YMAX] |= Row_HiddenBit(FACE_YMAX,  EXTCHUNK_SIZE_2)  << x;
+	}
+	return drawn;
+}
+
+static void PrepareChunk(struct BuilderContext* ctx, int x1, int y1, int z1) {
 	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
 	int yMax = min(World.Height, y1 + CHUNK_SIZE);
 	int zMax = min(World.Length, z1 + CHUNK_SIZE);
 
-	int cIndex, index, tileIdx;
+	cc_uint32 opaque[EXTCHUNK_SIZE_2], gas[EXTCHUNK_SIZE_2];
+	cc_uint32 hidden[FACE_COUNT], drawn, allHidden, edges;
+	int cIndex, index, rIndex;
 	BlockID b;
 	int x, y, z, xx, yy, zz;
 
-#ifdef OCCLUSION
-	int flags = ComputeOcclusion();
-#endif
-#ifdef DEBUG_OCCLUSION
-	FastColour col = new FastColour(60, 60, 60, 255);
-	if (flags & 1) col.R = 255; /* x */
-	if (flags & 4) col.G = 255; /* y */
-	if (flags & 2) col.B = 255; /* z */
-	map.Sunlight = map.Shadowlight = col;
-	map.SunlightXSide = map.ShadowlightXSide = col;
-	map.SunlightZSide = map.ShadowlightZSide = col;
-	map.SunlightYBottom = map.ShadowlightYBottom = col;
-#endif
-	
+	/* Faces on the edges of the world are never hidden by neighbours */
+	edges = 0;
+	if (x1 == 0)             edges |= 1u;
+	if (xMax == World.Width) edges |= 1u << (xMax - 1 - x1);
+	Builder_CalcRowMasks(ctx->chunk, opaque, gas);
+
 	for (y = y1, yy = 0; y < yMax; y++, yy++) {
 		for (z = z1, zz = 0; z < zMax; z++, zz++) {
 			cIndex = Builder_PackChunk(0, yy, zz);
+			rIndex = (yy + 1) * EXTCHUNK_SIZE + (zz + 1);
+			drawn  = Builder_CalcRowHidden(&ctx->chunk[cIndex], xMax - x1, &opaque[rIndex], &gas[rIndex], hidden);
+			if (!drawn) continue;
+
+			/* Blocks with all of their faces hidden can be skipped entirely */
+			allHidden = hidden[FACE_XMIN] & hidden[FACE_XMAX] & hidden[FACE_ZMIN] &
+						hidden[FACE_ZMAX] & hidden[FACE_YMIN] & hidden[FACE_YMAX];
+			if (z == 0 || z == World.MaxZ) allHidden = 0;
+			allHidden &= ~edges;
 
 			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				b = Builder_Chunk[cIndex];
-				if (Blocks.Draw[b] == DRAW_GAS) continue;
+				if (!(drawn & (1u << xx))) continue;
+				b     = ctx->chunk[cIndex];
 				index = Builder_PackCount(xx, yy, zz);
 
 				/* Sprites can't be stretched, nor can then be they hidden by other blocks. */
 				/* Note sprites are drawn using DrawSprite and not with any of the DrawXFace. */
-				if (Blocks.Draw[b] == DRAW_SPRITE) { AddSpriteVertices(b); continue; }
+				if (Blocks.Draw[b] == DRAW_SPRITE) { AddSpriteVertices(ctx, b); continue; }
+
+				if (allHidden & (1u << xx)) {
+					Mem_Set(&ctx->counts[index], 0, FACE_COUNT);
+					continue;
+				}
 
-				Builder_X = x; Builder_Y = y; Builder_Z = z;
-				Builder_FullBright = Blocks.Brightness[b];
-				tileIdx = b * BLOCK_COUNT;
+				ctx->curX = x; ctx->curY = y; ctx->curZ = z;
+				ctx->fullBright = Blocks.Brightness[b];
 				/* All of these function calls are inlined as they can be called tens of millions to hundreds of millions of times. */
 
-				if (Builder_Counts[index] == 0 ||
+				if (ctx->counts[index] == 0 ||
 					(x == 0 && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(x != 0 && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - 1]] & FACE_BIT_XMIN) != 0)) {
-					Builder_Counts[index] = 0;
+					(x != 0 && (hidden[FACE_XMIN] & (1u << xx)) != 0)) {
+					ctx->counts[index] = 0;
 				} else {
-					Builder_Counts[index] = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMIN);
+					ctx->counts[index] = Builder_StretchZ(ctx, index, x, y, z, cIndex, b, FACE_XMIN);
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 ||
+				if (ctx->counts[index] == 0 ||
 					(x == World.MaxX && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(x != World.MaxX && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + 1]] & FACE_BIT_XMAX) != 0)) {
-					Builder_Counts[index] = 0;
+					(x != World.MaxX && (hidden[FACE_XMAX] & (1u << xx)) != 0)) {
+					ctx->counts[index] = 0;
 				} else {
-					Builder_Counts[index] = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMAX);
+					ctx->counts[index] = Builder_StretchZ(ctx, index, x, y, z, cIndex, b, FACE_XMAX);
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 ||
+				if (ctx->counts[index] == 0 ||
 					(z == 0 && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(z != 0 && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - EXTCHUNK_SIZE]] & FACE_BIT_ZMIN) != 0)) {
-					Builder_Counts[index] = 0;
+					(z != 0 && (hidden[FACE_ZMIN] & (1u << xx)) != 0)) {
+					ctx->counts[index] = 0;
 				} else {
-					Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_ZMIN);
+					ctx->counts[index] = Builder_StretchX(ctx, index, x, y, z, cIndex, b, FACE_ZMIN);
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 ||
+				if (ctx->counts[index] == 0 ||
 					(z == World.MaxZ && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(z != World.MaxZ && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + EXTCHUNK_SIZE]] & FACE_BIT_ZMAX) != 0)) {
-					Builder_Counts[index] = 0;
+					(z != World.MaxZ && (hidden[FACE_ZMAX] & (1u << xx)) != 0)) {
+					ctx->counts[index] = 0;
 				} else {
-					Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_ZMAX);
+					ctx->counts[index] = Builder_StretchX(ctx, index, x, y, z, cIndex, b, FACE_ZMAX);
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 || y == 0 ||
-					(Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - EXTCHUNK_SIZE_2]] & FACE_BIT_YMIN) != 0) {
-					Builder_Counts[index] = 0;
+				if (ctx->counts[index] == 0 || y == 0 ||
+					(hidden[FACE_YMIN] & (1u << xx)) != 0) {
+					ctx->counts[index] = 0;
 				} else {
-					Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMIN);
+					ctx->counts[index] = Builder_StretchX(ctx, index, x, y, z, cIndex, b, FACE_YMIN);
 				}
 
 				index++;
-				if (Builder_Counts[index] == 0 ||
-					(Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + EXTCHUNK_SIZE_2]] & FACE_BIT_YMAX) != 0) {
-					Builder_Counts[index] = 0;
+				if (ctx->counts[index] == 0 ||
+					(hidden[FACE_YMAX] & (1u << xx)) != 0) {
+					ctx->counts[index] = 0;
 				} else if (b < BLOCK_WATER || b > BLOCK_STILL_LAVA) {
-					Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMAX);
+					ctx->counts[index] = Builder_StretchX(ctx, index, x, y, z, cIndex, b, FACE_YMAX);
 				} else {
-					Builder_Counts[index] = Builder_StretchXLiquid(index, x, y, z, cIndex, b);
+					ctx->counts[index] = Builder_StretchXLiquid(ctx, index, x, y, z, cIndex, b);
 				}
 			}
 		}
@@ -256,12 +349,13 @@ for (yy = -1; yy < 17; ++yy) {\
 			block    = get_block;\
 			allAir   = allAir   && Blocks.Draw[block] == DRAW_GAS;\
 			allSolid = allSolid && Blocks.FullOpaque[block];\
-			Builder_Chunk[cIndex] = block;\
+			ChunkInfo_AddBlock(present, block);\
+			chunk[cIndex] = block;\
 		}\
 	}\
 }
 
-static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+static cc_bool ReadChunkData(BlockID* chunk, int x1, int y1, int z1, cc_bool* outAllAir, cc_uint32* present) {
 	BlockRaw* blocks = World.Blocks;
 	BlockRaw* blocks2;
 	cc_bool allAir = true, allSolid = true;
@@ -303,14 +397,15 @@ for (yy = -1; yy < 17; ++yy) {\
 			if (x < 0) continue;\
 			if (x >= World.Width) break;\
 \
-			block  = get_block;\
-			allAir = allAir && Blocks.Draw[block] == DRAW_GAS;\
-			Builder_Chunk[cIndex] = block;\
+			block   = get_block;\
+			allAir  = allAir && Blocks.Draw[block] == DRAW_GAS;\
+			ChunkInfo_AddBlock(present, block);\
+			chunk[cIndex] = block;\
 		}\
 	}\
 }
 
-static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+static cc_bool ReadBorderChunkData(BlockID* chunk, int x1, int y1, int z1, cc_bool* outAllAir, cc_uint32* present) {
 	BlockRaw* blocks = World.Blocks;
 	BlockRaw* blocks2;
 	cc_bool allAir = true;
@@ -333,7 +428,7 @@ static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 	return false;
 }
 
-static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
+static void OutputChunkPartsMeta(struct BuilderContext* ctx, int x, int y, int z, struct ChunkInfo* info) {
 	cc_bool hasNorm, hasTran;
 	int partsIndex;
 	int i, j, curIdx, offset;
@@ -347,8 +442,8 @@ static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
 		j = i + ATLAS1D_MAX_ATLASES;
 		curIdx = partsIndex + i * World.ChunksCount;
 
-		hasNorm |= SetPartInfo(&Builder_Parts[i], &offset, &MapRenderer_PartsNormal[curIdx]);
-		hasTran |= SetPartInfo(&Builder_Parts[j], &offset, &MapRenderer_PartsTranslucent[curIdx]);
+		hasNorm |= SetPartInfo(&ctx->parts[i], &offset, &MapRenderer_PartsNormal[curIdx]);
+		hasTran |= SetPartInfo(&ctx->parts[j], &offset, &MapRenderer_PartsTranslucent[curIdx]);
 	}
 
 	if (hasNorm) {
@@ -359,130 +454,440 @@ static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
 	}
 }
 
-void Builder_MakeChunk(struct ChunkInfo* info) {
-#ifdef CC_BUILD_TINYSTACK
-	/* The Saturn build only has 16 kb stack, not large enough */
-	static BlockID chunk[EXTCHUNK_SIZE_3]; 
-	static cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
-	static int bitFlags[1];
-#else
-	BlockID chunk[EXTCHUNK_SIZE_3]; 
-	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
-	int bitFlags[EXTCHUNK_SIZE_3];
-#endif
+#define FACE_ALL_BITS (FACE_BIT_XMIN | FACE_BIT_XMAX | FACE_BIT_ZMIN | FACE_BIT_ZMAX | FACE_BIT_YMIN | FACE_BIT_YMAX)
+/* Adds the neighbouring cell to the flood fill, or the chunk face if the cell is on the edge of the chunk */
+#define FloodFill_Visit(onEdge, faceBit, next)\
+if (onEdge) { faces |= faceBit; } else if (!visited[next]) { visited[next] = true; stack[top++] = (cc_uint16)(next); }
 
-	cc_bool allAir, allSolid, onBorder;
-	int xMax, yMax, zMax, totalVerts;
-	int cIndex, index;
-	int x, y, z, xx, yy, zz;
-	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+/* Calculates which faces of the chunk are connected to each other through non-opaque blocks */
+/* The map renderer uses this to skip drawing chunks that can't be seen from the camera's chunk */
+static void Builder_CalcFaceLinks(struct BuilderContext* ctx, struct ChunkInfo* info) {
+	cc_uint8*  visited = ctx->floodVisited;
+	cc_uint16* stack   = ctx->floodStack;
+	int i, f, x, y, z, cell, top, faces, opaque = 0;
+
+	/* Cells are packed as (y << 8) | (z << 4) | x */
+	for (i = 0; i < CHUNK_SIZE_3; i++) 
+	{
+		x = i & CHUNK_MASK; z = (i >> 4) & CHUNK_MASK; y = i >> 8;
+		visited[i] = Blocks.FullOpaque[ctx->chunk[Builder_PackChunk(x, y, z)]];
+		opaque    += visited[i];
+	}
+
+	Mem_Set(info->faceLinks, opaque ? 0 : FACE_ALL_BITS, FACE_COUNT);
+	if (!opaque) return;
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) 
+	{
+		if (visited[i]) continue;
+		visited[i] = true;
+		stack[0]   = (cc_uint16)i;
+		top = 1; faces = 0;
+
+		while (top) {
+			cell = stack[--top];
+			x = cell & CHUNK_MASK; z = (cell >> 4) & CHUNK_MASK; y = cell >> 8;
+
+			FloodFill_Visit(x == 0,         FACE_BIT_XMIN, cell - 1);
+			FloodFill_Visit(x == CHUNK_MAX, FACE_BIT_XMAX, cell + 1);
+			FloodFill_Visit(z == 0,         FACE_BIT_ZMIN, cell - CHUNK_SIZE);
+			FloodFill_Visit(z == CHUNK_MAX, FACE_BIT_ZMAX, cell + CHUNK_SIZE);
+			FloodFill_Visit(y == 0,         FACE_BIT_YMIN, cell - CHUNK_SIZE_2);
+			FloodFill_Visit(y == CHUNK_MAX, FACE_BIT_YMAX, cell + CHUNK_SIZE_2);
+		}
+
+		/* Every face touched by this open region can see every other face it touches */
+		for (f = 0; f < FACE_COUNT; f++) 
+		{
+			if (faces & (1 << f)) info->faceLinks[f] |= faces;
+		}
+	}
+}
 
-	Builder_Chunk  = chunk;
-	Builder_Counts = counts;
-	Builder_BitFlags = bitFlags;
-	Builder_PrePrepareChunk();
+/* Describes a chunk whose mesh is being built */
+struct BuilderJob {
+	struct ChunkInfo* info;
+	BlockID chunk[EXTCHUNK_SIZE_3];
+	/* Vertices of the mesh, before they are uploaded to the GPU */
+	struct VertexTextured* vertices;
+	int verticesCapacity, totalVerts;
+};
+
+/* Reads the blocks in and around the chunk, then returns whether its mesh needs to be built */
+/* NOTE: Must be called on the main thread, since this also calculates lighting for the chunk */
+static cc_bool Builder_ReadChunk(struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+	cc_bool allAir, allSolid, onBorder;
 	
 	onBorder = 
 		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
 		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
 
+	Mem_Set(info->blocksPresent, 0, CHUNK_BLOCKS_WORDS * 4);
 	if (onBorder) {
 		/* less optimal case here */
-		Mem_Set(chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
-		allSolid = ReadBorderChunkData(x1, y1, z1, &allAir);
+		Mem_Set(job->chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
+		/* Blocks outside the map are treated as air */
+		ChunkInfo_AddBlock(info->blocksPresent, BLOCK_AIR);
+		allSolid = ReadBorderChunkData(job->chunk, x1, y1, z1, &allAir, info->blocksPresent);
 	} else {
-		allSolid = ReadChunkData(x1, y1, z1, &allAir);
+		allSolid = ReadChunkData(job->chunk, x1, y1, z1, &allAir, info->blocksPresent);
 	}
 
 	info->allAir = allAir;
-	if (allAir || allSolid) return;
+	if (allAir || allSolid) {
+		/* Every face can see every other face through an all air chunk, but no faces through an all solid chunk */
+		Mem_Set(info->faceLinks, allAir ? FACE_ALL_BITS : 0, FACE_COUNT);
+		return false;
+	}
+
 	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
+	return true;
+}
+
+/* Calculates which faces in the chunk are visible, then returns the number of vertices in its mesh */
+static int Builder_CountVertices(struct BuilderContext* ctx, struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+	int totalVerts;
+
+	ctx->chunk = job->chunk;
+	Lighting.LightHint_Worker(x1 - 1, y1 - 1, z1 - 1);
+	Builder_CalcFaceLinks(ctx, info);
+	Builder_PrePrepareChunk(ctx);
+
+	Mem_Set(ctx->counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
+	if (Builder_GreedyMeshing) Mem_Set(ctx->rows, 1, CHUNK_SIZE_3 * FACE_COUNT);
+	ctx->chunkEndX = min(World.Width,  x1 + CHUNK_SIZE);
+	ctx->chunkEndY = min(World.Height, y1 + CHUNK_SIZE);
+	ctx->chunkEndZ = min(World.Length, z1 + CHUNK_SIZE);
+	PrepareChunk(ctx, x1, y1, z1);
+
+	totalVerts = Builder_TotalVerticesCount(ctx);
+	if (!totalVerts) return 0;
+	
+	OutputChunkPartsMeta(ctx, x1, y1, z1, info);
+	return totalVerts;
+}
+
+/* Outputs the vertices of the chunk's mesh into ctx->vertices */
+static void Builder_RenderChunk(struct BuilderContext* ctx, struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+	int xMax, yMax, zMax;
+	int cIndex, index;
+	int x, y, z, xx, yy, zz;
 
-	Mem_Set(counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
 	xMax = min(World.Width,  x1 + CHUNK_SIZE);
 	yMax = min(World.Height, y1 + CHUNK_SIZE);
 	zMax = min(World.Length, z1 + CHUNK_SIZE);
+	Builder_PostPrepareChunk(ctx);
 
-	Builder_ChunkEndX = xMax; Builder_ChunkEndZ = zMax;
-	PrepareChunk(x1, y1, z1);
+	for (y = y1, yy = 0; y < yMax; y++, yy++) {
+		for (z = z1, zz = 0; z < zMax; z++, zz++) {
+			cIndex = Builder_PackChunk(0, yy, zz);
 
-	totalVerts = Builder_TotalVerticesCount();
-	if (!totalVerts) return;
-	
-	OutputChunkPartsMeta(x1, y1, z1, info);
-#ifdef OCCLUSION
-	if (info.NormalParts != null || info.TranslucentParts != null)
-		info.occlusionFlags = (cc_uint8)ComputeOcclusion();
+			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
+				ctx->block = ctx->chunk[cIndex];
+				if (Blocks.Draw[ctx->block] == DRAW_GAS) continue;
+
+				index = Builder_PackCount(xx, yy, zz);
+				ctx->chunkIndex = cIndex;
+				Builder_RenderBlock(ctx, index, x, y, z);
+			}
+		}
+	}
+}
+
+#ifdef CC_BUILD_GL11
+static void BuildChunkVbs(struct VertexTextured* vertices, struct ChunkInfo* info) {
+	int i, curIdx, partsIndex;
+	partsIndex = World_ChunkPack(info->centreX >> CHUNK_SHIFT, info->centreY >> CHUNK_SHIFT, info->centreZ >> CHUNK_SHIFT);
+
+	for (i = 0; i < MapRenderer_1DUsedCount; i++) {
+		curIdx = partsIndex + i * World.ChunksCount;
+
+		BuildPartVbs(vertices, &MapRenderer_PartsNormal[curIdx]);
+		BuildPartVbs(vertices, &MapRenderer_PartsTranslucent[curIdx]);
+	}
+}
 #endif
 
+/* Builds the mesh of the chunk, writing the vertices directly into its vertex buffer */
+static void Builder_MakeChunkDirect(struct BuilderContext* ctx, struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	int totalVerts = Builder_CountVertices(ctx, job);
+	if (!totalVerts) return;
+
 #ifndef CC_BUILD_GL11
 	/* add an extra element to fix crashing on some GPUs */
-	Builder_Vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
+	ctx->vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
 													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
 #else
 	/* NOTE: Relies on assumption vb is ignored by GL11 Gfx_LockVb implementation */
-	Builder_Vertices = (struct VertexTextured*)Gfx_LockVb(0, 
+	ctx->vertices = (struct VertexTextured*)Gfx_LockVb(0, 
 													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
 #endif
-	Builder_PostPrepareChunk();
-	/* now render the chunk */
+	Builder_RenderChunk(ctx, job);
 
-	for (y = y1, yy = 0; y < yMax; y++, yy++) {
-		for (z = z1, zz = 0; z < zMax; z++, zz++) {
-			cIndex = Builder_PackChunk(0, yy, zz);
+#ifdef CC_BUILD_GL11
+	BuildChunkVbs(ctx->vertices, info);
+#else
+	Gfx_UnlockVb(info->vb);
+#endif
+}
 
-			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				Builder_Block = chunk[cIndex];
-				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
+static struct BuilderContext mainCtx;
+static struct BuilderJob mainJob;
 
-				index = Builder_PackCount(xx, yy, zz);
-				Builder_ChunkIndex = cIndex;
-				Builder_RenderBlock(index, x, y, z);
-			}
+static void Builder_MakeChunksDirect(struct ChunkInfo** chunks, int count) {
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		mainJob.info = chunks[i];
+		if (!Builder_ReadChunk(&mainJob)) continue;
+		Builder_MakeChunkDirect(&mainCtx, &mainJob);
+	}
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Mesh builder threads---------------------------------------------------*
+*#########################################################################################################################*/
+/* On systems with preemptive multitasking, chunk meshes can be built on several threads at once: */
+/*   1) The main thread reads the blocks of each chunk and calculates lighting for it */
+/*   2) Worker threads (and the main thread) then finish calculating lighting for each chunk */
+/*       (see Lighting.LightHint_Worker), and build the vertices of each mesh into system memory */
+/*   3) Once every mesh has been built, the main thread uploads the vertices to the GPU */
+/* Since the main thread always waits for step 2 to finish, worker threads never run */
+/*  at the same time as the main thread modifies the world or block definitions */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_LOWMEM
+#define BUILDER_MAX_WORKERS 16
+#define BUILDER_MAX_JOBS    64
+
+static struct BuilderWorker {
+	void* thread;
+	void* wakeup;
+	struct BuilderContext* ctx;
+} workers[BUILDER_MAX_WORKERS];
+static int workersCount, workersStarted;
+static volatile cc_bool workersStopping;
+
+static struct BuilderJob* jobs;
+static void* jobsMutex;
+static void* jobsDone;
+static int jobsCount, nextJob, jobsLeft;
+static cc_bool jobsWaiting;
+
+static void Builder_MeshJob(struct BuilderContext* ctx, struct BuilderJob* job) {
+	job->totalVerts = Builder_CountVertices(ctx, job);
+	if (!job->totalVerts) return;
+
+	if (job->totalVerts > job->verticesCapacity) {
+		Mem_Free(job->vertices);
+		job->vertices = (struct VertexTextured*)Mem_Alloc(job->totalVerts, SIZEOF_VERTEX_TEXTURED, "chunk vertices");
+		job->verticesCapacity = job->totalVerts;
+	}
+
+	ctx->vertices = job->vertices;
+	Builder_RenderChunk(ctx, job);
+}
+
+static void Builder_UploadJob(struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	void* data;
+	if (!job->totalVerts) return;
+
+#ifndef CC_BUILD_GL11
+	/* add an extra element to fix crashing on some GPUs */
+	data = Gfx_RecreateAndLockVb(&info->vb, VERTEX_FORMAT_TEXTURED, job->totalVerts + 1);
+	Mem_Copy(data, job->vertices, job->totalVerts * SIZEOF_VERTEX_TEXTURED);
+	Gfx_UnlockVb(info->vb);
+#else
+	BuildChunkVbs(job->vertices, info);
+#endif
+}
+
+static struct BuilderJob* Builder_NextJob(void) {
+	struct BuilderJob* job = NULL;
+
+	Mutex_Lock(jobsMutex);
+	if (nextJob < jobsCount) job = &jobs[nextJob++];
+	Mutex_Unlock(jobsMutex);
+	return job;
+}
+
+static void Builder_FinishJob(void) {
+	Mutex_Lock(jobsMutex);
+	jobsLeft--;
+	if (!jobsLeft && jobsWaiting) {
+		jobsWaiting = false;
+		Waitable_Signal(jobsDone);
+	}
+	Mutex_Unlock(jobsMutex);
+}
+
+static void Builder_RunJobs(struct BuilderContext* ctx) {
+	struct BuilderJob* job;
+	while ((job = Builder_NextJob()))
+	{
+		Builder_MeshJob(ctx, job);
+		Builder_FinishJob();
+	}
+}
+
+static void WorkerLoop(void) {
+	struct BuilderWorker* worker;
+
+	Mutex_Lock(jobsMutex);
+	worker = &workers[workersStarted++];
+	Mutex_Unlock(jobsMutex);
+
+	for (;;)
+	{
+		Waitable_Wait(worker->wakeup);
+		if (workersStopping) return;
+		Builder_RunJobs(worker->ctx);
+	}
+}
+
+static void Builder_MakeChunksThreaded(struct ChunkInfo** chunks, int count) {
+	struct BuilderJob* job;
+	int i = 0, j, total;
+	cc_bool waiting;
+
+	while (i < count) 
+	{
+		/* Read chunks until enough chunks have been found that need a mesh */
+		for (total = 0; i < count && total < BUILDER_MAX_JOBS; i++) 
+		{
+			job = &jobs[total];
+			job->info = chunks[i];
+			if (Builder_ReadChunk(job)) total++;
 		}
+		if (!total) return;
+
+		Mutex_Lock(jobsMutex);
+		{
+			jobsCount = total;
+			nextJob   = 0;
+			jobsLeft  = total;
+		}
+		Mutex_Unlock(jobsMutex);
+
+		for (j = 0; j < workersCount; j++) 
+		{
+			Waitable_Signal(workers[j].wakeup);
+		}
+		Builder_RunJobs(&mainCtx);
+
+		/* Wait for worker threads to finish building any remaining meshes */
+		Mutex_Lock(jobsMutex);
+		jobsWaiting = jobsLeft > 0;
+		waiting     = jobsWaiting;
+		Mutex_Unlock(jobsMutex);
+		if (waiting) Waitable_Wait(jobsDone);
+
+		for (j = 0; j < total; j++) 
+		{
+			Builder_UploadJob(&jobs[j]);
+		}
+	}
+}
+
+static void Builder_StartWorkers(void) {
+	int i, count = Options_GetInt(OPT_BUILDER_THREADS, 0, BUILDER_MAX_WORKERS, 3);
+	if (!count) return;
+
+	jobs      = (struct BuilderJob*)Mem_AllocCleared(BUILDER_MAX_JOBS, sizeof(struct BuilderJob), "chunk jobs");
+	jobsMutex = Mutex_Create("Builder jobs");
+	jobsDone  = Waitable_Create("Builder jobs done");
+
+	for (i = 0; i < count; i++) 
+	{
+		workers[i].wakeup = Waitable_Create("Builder worker");
+		workers[i].ctx    = (struct BuilderContext*)Mem_Alloc(1, sizeof(struct BuilderContext), "builder context");
 	}
 
-#ifdef CC_BUILD_GL11
-	cIndex = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
+	workersCount    = count;
+	workersStopping = false;
+	for (i = 0; i < count; i++) 
+	{
+		Thread_Run(&workers[i].thread, WorkerLoop, 128 * 1024, "Chunk builder");
+	}
+}
+
+static void Builder_StopWorkers(void) {
+	int i;
+	if (!workersCount) return;
+	workersStopping = true;
 
-	for (index = 0; index < MapRenderer_1DUsedCount; index++) {
-		int curIdx = cIndex + index * World.ChunksCount;
+	for (i = 0; i < workersCount; i++) 
+	{
+		Waitable_Signal(workers[i].wakeup);
+		Thread_Join(workers[i].thread);
 
-		BuildPartVbs(&MapRenderer_PartsNormal[curIdx]);
-		BuildPartVbs(&MapRenderer_PartsTranslucent[curIdx]);
+		Waitable_Free(workers[i].wakeup);
+		Mem_Free(workers[i].ctx);
 	}
+
+	for (i = 0; i < BUILDER_MAX_JOBS; i++) 
+	{
+		Mem_Free(jobs[i].vertices);
+	}
+	Mem_Free(jobs);
+	Mutex_Free(jobsMutex);
+	Waitable_Free(jobsDone);
+
+	jobs           = NULL;
+	workersCount   = 0;
+	workersStarted = 0;
+}
+
+void Builder_MakeChunks(struct ChunkInfo** chunks, int count) {
+	if (workersCount) {
+		Builder_MakeChunksThreaded(chunks, count);
+	} else {
+		Builder_MakeChunksDirect(chunks, count);
+	}
+}
 #else
-	Gfx_UnlockVb(info->vb);
-#endif
+static void Builder_StartWorkers(void) { }
+static void Builder_StopWorkers(void)  { }
+
+void Builder_MakeChunks(struct ChunkInfo** chunks, int count) {
+	Builder_MakeChunksDirect(chunks, count);
 }
+#endif
+
 
-static cc_bool Builder_OccludedLiquid(int chunkIndex) {
+static cc_bool Builder_OccludedLiquid(struct BuilderContext* ctx, int chunkIndex) {
 	chunkIndex += EXTCHUNK_SIZE_2; /* Checking y above */
 	return
-		Blocks.FullOpaque[Builder_Chunk[chunkIndex]]
-		&& Blocks.Draw[Builder_Chunk[chunkIndex - EXTCHUNK_SIZE]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex - 1]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex + 1]] != DRAW_GAS
-		&& Blocks.Draw[Builder_Chunk[chunkIndex + EXTCHUNK_SIZE]] != DRAW_GAS;
+		Blocks.FullOpaque[ctx->chunk[chunkIndex]]
+		&& Blocks.Draw[ctx->chunk[chunkIndex - EXTCHUNK_SIZE]] != DRAW_GAS
+		&& Blocks.Draw[ctx->chunk[chunkIndex - 1]] != DRAW_GAS
+		&& Blocks.Draw[ctx->chunk[chunkIndex + 1]] != DRAW_GAS
+		&& Blocks.Draw[ctx->chunk[chunkIndex + EXTCHUNK_SIZE]] != DRAW_GAS;
 }
 
-static void DefaultPrePrepateChunk(void) {
-	Mem_Set(Builder_Parts, 0, sizeof(Builder_Parts));
+static void DefaultPrePrepateChunk(struct BuilderContext* ctx) {
+	Mem_Set(ctx->parts, 0, sizeof(ctx->parts));
 }
 
-static void DefaultPostStretchChunk(void) {
+static void DefaultPostStretchChunk(struct BuilderContext* ctx) {
 	int i, j, offset;
 	offset = 0;
 	for (i = 0; i < ATLAS1D_MAX_ATLASES; i++) {
 		j = i + ATLAS1D_MAX_ATLASES;
 
-		offset = Builder1DPart_CalcOffsets(&Builder_Parts[i], offset);
-		offset = Builder1DPart_CalcOffsets(&Builder_Parts[j], offset);
+		offset = Builder1DPart_CalcOffsets(ctx, &ctx->parts[i], offset);
+		offset = Builder1DPart_CalcOffsets(ctx, &ctx->parts[j], offset);
 	}
 }
 
-static RNGState spriteRng;
-static void Builder_DrawSprite(int x, int y, int z) {
+static void Builder_DrawSprite(struct BuilderContext* ctx, int x, int y, int z) {
 	struct Builder1DPart* part;
 	struct VertexTextured* v;
 	cc_uint8 offsetType;
@@ -501,29 +906,29 @@ static void Builder_DrawSprite(int x, int y, int z) {
 
 #define s_u1 0.0f
 #define s_u2 UV2_Scale
-	loc = Block_Tex(Builder_Block, FACE_XMAX);
+	loc = Block_Tex(ctx->block, FACE_XMAX);
 	v1  = Atlas1D_RowId(loc) * Atlas1D.InvTileSize;
 	v2  = v1 + Atlas1D.InvTileSize * UV2_Scale;
 
-	offsetType = Blocks.SpriteOffset[Builder_Block];
+	offsetType = Blocks.SpriteOffset[ctx->block];
 	if (offsetType >= 6 && offsetType <= 7) {
-		Random_Seed(&spriteRng, (x + 1217 * z) & 0x7fffffff);
-		valX = Random_Range(&spriteRng, -3, 3 + 1) / 16.0f;
-		valY = Random_Range(&spriteRng, 0,  3 + 1) / 16.0f;
-		valZ = Random_Range(&spriteRng, -3, 3 + 1) / 16.0f;
+		Random_Seed(&ctx->spriteRng, (x + 1217 * z) & 0x7fffffff);
+		valX = Random_Range(&ctx->spriteRng, -3, 3 + 1) / 16.0f;
+		valY = Random_Range(&ctx->spriteRng, 0,  3 + 1) / 16.0f;
+		valZ = Random_Range(&ctx->spriteRng, -3, 3 + 1) / 16.0f;
 
 		x1 += valX - 1.7f/16.0f; x2 += valX + 1.7f/16.0f;
 		z1 += valZ - 1.7f/16.0f; z2 += valZ + 1.7f/16.0f;
 		if (offsetType == 7) { y1 -= valY; y2 -= valY; }
 	}
 	
-	bright = Blocks.Brightness[Builder_Block];
-	part   = &Builder_Parts[Atlas1D_Index(loc)];
+	bright = Blocks.Brightness[ctx->block];
+	part   = &ctx->parts[Atlas1D_Index(loc)];
 	color  = bright ? PACKEDCOL_WHITE : Lighting.Color_Sprite_Fast(x, y, z);
-	Block_Tint(color, Builder_Block);
+	Block_Tint(color, ctx->block);
 
 	/* Draw Z axis */
-	v = &Builder_Vertices[part->sOffset];
+	v = &ctx->vertices[part->sOffset];
 	v->x = x1; v->y = y1; v->z = z1; v->Col = color; v->U = s_u2; v->V = v2; v++;
 	v->x = x1; v->y = y2; v->z = z1; v->Col = color; v->U = s_u2; v->V = v1; v++;
 	v->x = x2; v->y = y2; v->z = z2; v->Col = color; v->U = s_u1; v->V = v1; v++;
@@ -578,72 +983,172 @@ static PackedCol Normal_LightColor(int x, int y, int z, Face face, BlockID block
 	return 0; /* should never happen */
 }
 
-static cc_bool Normal_CanStretch(BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
-	BlockID cur = Builder_Chunk[chunkIndex];
+static cc_bool Normal_CanStretch(struct BuilderContext* ctx, BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
+	BlockID cur = ctx->chunk[chunkIndex];
 
-	if (cur != initial || Block_IsFaceHidden(cur, Builder_Chunk[chunkIndex + Builder_Offsets[face]], face)) return false;
-	if (Builder_FullBright) return true;
+	if (cur != initial || Block_IsFaceHidden(cur, ctx->chunk[chunkIndex + Builder_Offsets[face]], face)) return false;
+	if (ctx->fullBright) return true;
 
-	return Normal_LightColor(Builder_X, Builder_Y, Builder_Z, face, initial) == Normal_LightColor(x, y, z, face, cur);
+	return Normal_LightColor(ctx->curX, ctx->curY, ctx->curZ, face, initial) == Normal_LightColor(x, y, z, face, cur);
 }
 
-static int NormalBuilder_StretchXLiquid(int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
+static int NormalBuilder_StretchXLiquid(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
 	int count = 1; cc_bool stretchTile;
-	if (Builder_OccludedLiquid(chunkIndex)) return 0;
+	if (Builder_OccludedLiquid(ctx, chunkIndex)) return 0;
 	
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << FACE_YMAX)) != 0;
 
-	while (x < Builder_ChunkEndX && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(chunkIndex)) {
-		Builder_Counts[countIndex] = 0;
+	while (x < ctx->chunkEndX && stretchTile && Normal_CanStretch(ctx, block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(ctx, chunkIndex)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		x++;
 		chunkIndex++;
 		countIndex += FACE_COUNT;
 	}
-	AddVertices(block, FACE_YMAX);
+	AddVertices(ctx, block, FACE_YMAX);
 	return count;
 }
 
-static int NormalBuilder_StretchX(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int NormalBuilder_StretchX(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
 
-	while (x < Builder_ChunkEndX && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, face)) {
-		Builder_Counts[countIndex] = 0;
+	while (x < ctx->chunkEndX && stretchTile && Normal_CanStretch(ctx, block, chunkIndex, x, y, z, face)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		x++;
 		chunkIndex++;
 		countIndex += FACE_COUNT;
 	}
-	AddVertices(block, face);
+	AddVertices(ctx, block, face);
 	return count;
 }
 
-static int NormalBuilder_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int NormalBuilder_StretchZ(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
 	z++;
 	chunkIndex += EXTCHUNK_SIZE;
 	countIndex += CHUNK_SIZE * FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
 
-	while (z < Builder_ChunkEndZ && stretchTile && Normal_CanStretch(block, chunkIndex, x, y, z, face)) {
-		Builder_Counts[countIndex] = 0;
+	while (z < ctx->chunkEndZ && stretchTile && Normal_CanStretch(ctx, block, chunkIndex, x, y, z, face)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		z++;
 		chunkIndex += EXTCHUNK_SIZE;
 		countIndex += CHUNK_SIZE * FACE_COUNT;
 	}
-	AddVertices(block, face);
+	AddVertices(ctx, block, face);
+	return count;
+}
+
+/* Whether faces of this block can be merged into rectangles */
+#define Greedy_CanMerge(block) (Blocks.FullOpaque[block] && !Blocks.IsLiquid[block] && Atlas1D.TilesPerAtlas == 1)
+
+/* Extends a row of 'count' faces into a rectangle, by merging following rows of identical faces */
+/* Rows of X/Z faces are merged upwards, rows of Y faces are merged along the Z axis */
+static int Greedy_StretchRows(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face, int count) {
+	int runX, runZ, runChunk, runCount; /* step between faces within a row */
+	int rowY, rowZ, rowChunk, rowCount; /* step between rows */
+	int rows, i, cx, cz, ci, ni;
+
+	if (face == FACE_XMIN || face == FACE_XMAX) {
+		runX = 0; runZ = 1; runChunk = EXTCHUNK_SIZE; runCount = CHUNK_SIZE * FACE_COUNT;
+	} else {
+		runX = 1; runZ = 0; runChunk = 1;             runCount = FACE_COUNT;
+	}
+
+	if (face == FACE_YMIN || face == FACE_YMAX) {
+		rowY = 0; rowZ = 1; rowChunk = EXTCHUNK_SIZE;   rowCount = CHUNK_SIZE   * FACE_COUNT;
+	} else {
+		rowY = 1; rowZ = 0; rowChunk = EXTCHUNK_SIZE_2; rowCount = CHUNK_SIZE_2 * FACE_COUNT;
+	}
+
+	for (rows = 1; ; rows++) {
+		y += rowY; z += rowZ;
+		chunkIndex += rowChunk; countIndex += rowCount;
+		if (y >= ctx->chunkEndY || z >= ctx->chunkEndZ) break;
+
+		cx = x; cz = z; ci = chunkIndex; ni = countIndex;
+		for (i = 0; i < count; i++) {
+			/* Face may have already been merged into another rectangle */
+			if (!ctx->counts[ni] || !Normal_CanStretch(ctx, block, ci, cx, y, cz, face)) break;
+			cx += runX; cz += runZ; ci += runChunk; ni += runCount;
+		}
+		if (i < count) break;
+
+		for (i = 0, ni = countIndex; i < count; i++, ni += runCount) {
+			ctx->counts[ni] = 0;
+		}
+	}
+	return rows;
+}
+
+static int GreedyBuilder_StretchX(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+	int count = 1, cx = x + 1, ci = chunkIndex + 1, ni = countIndex + FACE_COUNT;
+	cc_bool stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
+
+	while (cx < ctx->chunkEndX && stretchTile && ctx->counts[ni] && Normal_CanStretch(ctx, block, ci, cx, y, z, face)) {
+		ctx->counts[ni] = 0;
+		count++;
+		cx++;
+		ci++;
+		ni += FACE_COUNT;
+	}
+
+	if (Greedy_CanMerge(block)) {
+		ctx->rows[countIndex] = Greedy_StretchRows(ctx, countIndex, x, y, z, chunkIndex, block, face, count);
+	}
+	AddVertices(ctx, block, face);
+	return count;
+}
+
+static int GreedyBuilder_StretchZ(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+	int count = 1, cz = z + 1, ci = chunkIndex + EXTCHUNK_SIZE, ni = countIndex + CHUNK_SIZE * FACE_COUNT;
+	cc_bool stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
+
+	while (cz < ctx->chunkEndZ && stretchTile && ctx->counts[ni] && Normal_CanStretch(ctx, block, ci, x, y, cz, face)) {
+		ctx->counts[ni] = 0;
+		count++;
+		cz++;
+		ci += EXTCHUNK_SIZE;
+		ni += CHUNK_SIZE * FACE_COUNT;
+	}
+
+	if (Greedy_CanMerge(block)) {
+		ctx->rows[countIndex] = Greedy_StretchRows(ctx, countIndex, x, y, z, chunkIndex, block, face, count);
+	}
+	AddVertices(ctx, block, face);
 	return count;
 }
 
-static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {	
+/* Returns the drawer state for the given face, expanded to cover all of its rows when greedy meshed */
+static const struct _DrawerData* NormalBuilder_FaceDrawer(struct BuilderContext* ctx, int countIndex, Face face, struct _DrawerData* merged) {
+	int extra;
+	if (!Builder_GreedyMeshing || ctx->rows[countIndex] == 1) return &ctx->drawer;
+
+	extra   = ctx->rows[countIndex] - 1;
+	*merged = ctx->drawer;
+
+	/* The texture V coordinate at the far end of the face is scaled by UV2_Scale, */
+	/*  so adjust the bounds so that the texture repeats exactly once per block */
+	if (face == FACE_YMIN || face == FACE_YMAX) {
+		merged->Z2      += extra;
+		merged->MaxBB.z = 1.0f + extra / UV2_Scale;
+	} else {
+		merged->Y2      += extra;
+		merged->MinBB.y = 1.0f + extra / UV2_Scale;
+	}
+	return merged;
+}
+
+static void NormalBuilder_RenderBlock(struct BuilderContext* ctx, int index, int x, int y, int z) {	
 	/* counters */
 	int count_XMin, count_XMax, count_ZMin;
 	int count_ZMax, count_YMin, count_YMax;
@@ -655,94 +1160,95 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 
 	/* per-face state */
 	struct Builder1DPart* part;
+	struct _DrawerData merged;
 	TextureLoc loc;
 	PackedCol col;
 	int offset;
 
-	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
-		Builder_DrawSprite(x, y, z); return;
+	if (Blocks.Draw[ctx->block] == DRAW_SPRITE) {
+		Builder_DrawSprite(ctx, x, y, z); return;
 	}
 
-	count_XMin = Builder_Counts[index + FACE_XMIN];
-	count_XMax = Builder_Counts[index + FACE_XMAX];
-	count_ZMin = Builder_Counts[index + FACE_ZMIN];
-	count_ZMax = Builder_Counts[index + FACE_ZMAX];
-	count_YMin = Builder_Counts[index + FACE_YMIN];
-	count_YMax = Builder_Counts[index + FACE_YMAX];
+	count_XMin = ctx->counts[index + FACE_XMIN];
+	count_XMax = ctx->counts[index + FACE_XMAX];
+	count_ZMin = ctx->counts[index + FACE_ZMIN];
+	count_ZMax = ctx->counts[index + FACE_ZMAX];
+	count_YMin = ctx->counts[index + FACE_YMIN];
+	count_YMax = ctx->counts[index + FACE_YMAX];
 
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
-	fullBright = Blocks.Brightness[Builder_Block];
-	baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	lightFlags = Blocks.LightOffset[Builder_Block];
+	fullBright = Blocks.Brightness[ctx->block];
+	baseOffset = (Blocks.Draw[ctx->block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	lightFlags = Blocks.LightOffset[ctx->block];
 
-	Drawer.MinBB = Blocks.MinBB[Builder_Block]; Drawer.MinBB.y = 1.0f - Drawer.MinBB.y;
-	Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Drawer.MaxBB.y = 1.0f - Drawer.MaxBB.y;
+	ctx->drawer.MinBB = Blocks.MinBB[ctx->block]; ctx->drawer.MinBB.y = 1.0f - ctx->drawer.MinBB.y;
+	ctx->drawer.MaxBB = Blocks.MaxBB[ctx->block]; ctx->drawer.MaxBB.y = 1.0f - ctx->drawer.MaxBB.y;
 
-	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	Drawer.X1 = x + min.x; Drawer.Y1 = y + min.y; Drawer.Z1 = z + min.z;
-	Drawer.X2 = x + max.x; Drawer.Y2 = y + max.y; Drawer.Z2 = z + max.z;
+	min = Blocks.RenderMinBB[ctx->block]; max = Blocks.RenderMaxBB[ctx->block];
+	ctx->drawer.X1 = x + min.x; ctx->drawer.Y1 = y + min.y; ctx->drawer.Z1 = z + min.z;
+	ctx->drawer.X2 = x + max.x; ctx->drawer.Y2 = y + max.y; ctx->drawer.Z2 = z + max.z;
 
-	Drawer.Tinted  = Blocks.Tinted[Builder_Block];
-	Drawer.TintCol = Blocks.FogCol[Builder_Block];
+	ctx->drawer.Tinted  = Blocks.Tinted[ctx->block];
+	ctx->drawer.TintCol = Blocks.FogCol[ctx->block];
 
 	if (count_XMin) {
-		loc    = Block_Tex(Builder_Block, FACE_XMIN);
+		loc    = Block_Tex(ctx->block, FACE_XMIN);
 		offset = (lightFlags >> FACE_XMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
 			x >= offset ? Lighting.Color_XSide_Fast(x - offset, y, z) : Env.SunXSide;
-		Drawer_XMin(count_XMin, col, loc, &part->faces.vertices[FACE_XMIN]);
+		DrawerData_XMin(NormalBuilder_FaceDrawer(ctx, index + FACE_XMIN, FACE_XMIN, &merged), count_XMin, col, loc, &part->faces.vertices[FACE_XMIN]);
 	}
 
 	if (count_XMax) {
-		loc    = Block_Tex(Builder_Block, FACE_XMAX);
+		loc    = Block_Tex(ctx->block, FACE_XMAX);
 		offset = (lightFlags >> FACE_XMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
 			x <= (World.MaxX - offset) ? Lighting.Color_XSide_Fast(x + offset, y, z) : Env.SunXSide;
-		Drawer_XMax(count_XMax, col, loc, &part->faces.vertices[FACE_XMAX]);
+		DrawerData_XMax(NormalBuilder_FaceDrawer(ctx, index + FACE_XMAX, FACE_XMAX, &merged), count_XMax, col, loc, &part->faces.vertices[FACE_XMAX]);
 	}
 
 	if (count_ZMin) {
-		loc    = Block_Tex(Builder_Block, FACE_ZMIN);
+		loc    = Block_Tex(ctx->block, FACE_ZMIN);
 		offset = (lightFlags >> FACE_ZMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
 			z >= offset ? Lighting.Color_ZSide_Fast(x, y, z - offset) : Env.SunZSide;
-		Drawer_ZMin(count_ZMin, col, loc, &part->faces.vertices[FACE_ZMIN]);
+		DrawerData_ZMin(NormalBuilder_FaceDrawer(ctx, index + FACE_ZMIN, FACE_ZMIN, &merged), count_ZMin, col, loc, &part->faces.vertices[FACE_ZMIN]);
 	}
 
 	if (count_ZMax) {
-		loc    = Block_Tex(Builder_Block, FACE_ZMAX);
+		loc    = Block_Tex(ctx->block, FACE_ZMAX);
 		offset = (lightFlags >> FACE_ZMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
 			z <= (World.MaxZ - offset) ? Lighting.Color_ZSide_Fast(x, y, z + offset) : Env.SunZSide;
-		Drawer_ZMax(count_ZMax, col, loc, &part->faces.vertices[FACE_ZMAX]);
+		DrawerData_ZMax(NormalBuilder_FaceDrawer(ctx, index + FACE_ZMAX, FACE_ZMAX, &merged), count_ZMax, col, loc, &part->faces.vertices[FACE_ZMAX]);
 	}
 
 	if (count_YMin) {
-		loc    = Block_Tex(Builder_Block, FACE_YMIN);
+		loc    = Block_Tex(ctx->block, FACE_YMIN);
 		offset = (lightFlags >> FACE_YMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE : Lighting.Color_YMin_Fast(x, y - offset, z);
-		Drawer_YMin(count_YMin, col, loc, &part->faces.vertices[FACE_YMIN]);
+		DrawerData_YMin(NormalBuilder_FaceDrawer(ctx, index + FACE_YMIN, FACE_YMIN, &merged), count_YMin, col, loc, &part->faces.vertices[FACE_YMIN]);
 	}
 
 	if (count_YMax) {
-		loc    = Block_Tex(Builder_Block, FACE_YMAX);
+		loc    = Block_Tex(ctx->block, FACE_YMAX);
 		offset = (lightFlags >> FACE_YMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &ctx->parts[baseOffset + Atlas1D_Index(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE : Lighting.Color_YMax_Fast(x, y + offset, z);
-		Drawer_YMax(count_YMax, col, loc, &part->faces.vertices[FACE_YMAX]);
+		DrawerData_YMax(NormalBuilder_FaceDrawer(ctx, index + FACE_YMAX, FACE_YMAX, &merged), count_YMax, col, loc, &part->faces.vertices[FACE_YMAX]);
 	}
 }
 
@@ -759,8 +1265,8 @@ static void Builder_SetDefault(void) {
 static void NormalBuilder_SetActive(void) {
 	Builder_SetDefault();
 	Builder_StretchXLiquid = NormalBuilder_StretchXLiquid;
-	Builder_StretchX       = NormalBuilder_StretchX;
-	Builder_StretchZ       = NormalBuilder_StretchZ;
+	Builder_StretchX       = Builder_GreedyMeshing ? GreedyBuilder_StretchX : NormalBuilder_StretchX;
+	Builder_StretchZ       = Builder_GreedyMeshing ? GreedyBuilder_StretchZ : NormalBuilder_StretchZ;
 	Builder_RenderBlock    = NormalBuilder_RenderBlock;
 }
 
@@ -769,12 +1275,6 @@ static void NormalBuilder_SetActive(void) {
 *-------------------------------------------------Advanced mesh builder---------------------------------------------------*
 *#########################################################################################################################*/
 #ifdef CC_BUILD_ADVLIGHTING
-static Vec3 adv_minBB, adv_maxBB;
-static int adv_initBitFlags, adv_baseOffset;
-static int* adv_bitFlags;
-static float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
-static PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
-static cc_bool adv_tinted;
 
 enum ADV_MASK {
 	/* z-1 cube points */
@@ -799,7 +1299,7 @@ enum ADV_MASK {
 /* - bit 0 set: Y-1 is in light */
 /* - bit 1 set: Y   is in light */
 /* - bit 2 set: Y+1 is in light */
-static int Adv_Lit(int x, int y, int z, int cIndex) {
+static int Adv_Lit(struct BuilderContext* ctx, int x, int y, int z, int cIndex) {
 	int flags, offset, lightFlags;
 	BlockID block;
 	if (y < 0 || y >= World.Height) return LIT_M1 | LIT_CC | LIT_P1; /* all faces lit */
@@ -810,7 +1310,7 @@ static int Adv_Lit(int x, int y, int z, int cIndex) {
 	}
 
 	flags = 0;
-	block = Builder_Chunk[cIndex];
+	block = ctx->chunk[cIndex];
 	lightFlags = Blocks.LightOffset[block];
 
 	/* TODO using LIGHT_FLAG_SHADES_FROM_BELOW is wrong here, */
@@ -828,26 +1328,26 @@ static int Adv_Lit(int x, int y, int z, int cIndex) {
 	flags |= Lighting.IsLit_Fast(x, (y + 1) - offset, z) ? LIT_P1 : 0;
 
 	/* If a block is fullbright, it should also look as if that spot is lit */
-	if (Blocks.Brightness[Builder_Chunk[cIndex - 324]]) flags |= LIT_M1;
+	if (Blocks.Brightness[ctx->chunk[cIndex - 324]]) flags |= LIT_M1;
 	if (Blocks.Brightness[block])                       flags |= LIT_CC;
-	if (Blocks.Brightness[Builder_Chunk[cIndex + 324]]) flags |= LIT_P1;
+	if (Blocks.Brightness[ctx->chunk[cIndex + 324]]) flags |= LIT_P1;
 	
 	return flags;
 }
 
-static int Adv_ComputeLightFlags(int x, int y, int z, int cIndex) {
-	if (Builder_FullBright) return (1 << xP1_yP1_zP1) - 1; /* all faces fully bright */
+static int Adv_ComputeLightFlags(struct BuilderContext* ctx, int x, int y, int z, int cIndex) {
+	if (ctx->fullBright) return (1 << xP1_yP1_zP1) - 1; /* all faces fully bright */
 
 	return
-		Adv_Lit(x - 1, y, z - 1, cIndex - 1 - 18) << xM1_yM1_zM1 |
-		Adv_Lit(x - 1, y, z,     cIndex - 1)      << xM1_yM1_zCC |
-		Adv_Lit(x - 1, y, z + 1, cIndex - 1 + 18) << xM1_yM1_zP1 |
-		Adv_Lit(x,     y, z - 1, cIndex + 0 - 18) << xCC_yM1_zM1 |
-		Adv_Lit(x,     y, z,     cIndex + 0)      << xCC_yM1_zCC |
-		Adv_Lit(x,     y, z + 1, cIndex + 0 + 18) << xCC_yM1_zP1 |
-		Adv_Lit(x + 1, y, z - 1, cIndex + 1 - 18) << xP1_yM1_zM1 |
-		Adv_Lit(x + 1, y, z,     cIndex + 1)      << xP1_yM1_zCC |
-		Adv_Lit(x + 1, y, z + 1, cIndex + 1 + 18) << xP1_yM1_zP1;
+		Adv_Lit(ctx, x - 1, y, z - 1, cIndex - 1 - 18) << xM1_yM1_zM1 |
+		Adv_Lit(ctx, x - 1, y, z,     cIndex - 1)      << xM1_yM1_zCC |
+		Adv_Lit(ctx, x - 1, y, z + 1, cIndex - 1 + 18) << xM1_yM1_zP1 |
+		Adv_Lit(ctx, x,     y, z - 1, cIndex + 0 - 18) << xCC_yM1_zM1 |
+		Adv_Lit(ctx, x,     y, z,     cIndex + 0)      << xCC_yM1_zCC |
+		Adv_Lit(ctx, x,     y, z + 1, cIndex + 0 + 18) << xCC_yM1_zP1 |
+		Adv_Lit(ctx, x + 1, y, z - 1, cIndex + 1 - 18) << xP1_yM1_zM1 |
+		Adv_Lit(ctx, x + 1, y, z,     cIndex + 1)      << xP1_yM1_zCC |
+		Adv_Lit(ctx, x + 1, y, z + 1, cIndex + 1 + 18) << xP1_yM1_zP1;
 }
 
 static int adv_masks[FACE_COUNT] = {
@@ -878,384 +1378,383 @@ static int adv_masks[FACE_COUNT] = {
 };
 
 
-static cc_bool Adv_CanStretch(BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
-	BlockID cur = Builder_Chunk[chunkIndex];
-	adv_bitFlags[chunkIndex] = Adv_ComputeLightFlags(x, y, z, chunkIndex);
+static cc_bool Adv_CanStretch(struct BuilderContext* ctx, BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
+	BlockID cur = ctx->chunk[chunkIndex];
+	ctx->bitFlags[chunkIndex] = Adv_ComputeLightFlags(ctx, x, y, z, chunkIndex);
 
 	return cur == initial
-		&& !Block_IsFaceHidden(cur, Builder_Chunk[chunkIndex + Builder_Offsets[face]], face)
-		&& (adv_initBitFlags == adv_bitFlags[chunkIndex]
+		&& !Block_IsFaceHidden(cur, ctx->chunk[chunkIndex + Builder_Offsets[face]], face)
+		&& (ctx->adv.initBitFlags == ctx->bitFlags[chunkIndex]
 		/* Check that this face is either fully bright or fully in shadow */
-		&& (adv_initBitFlags == 0 || (adv_initBitFlags & adv_masks[face]) == adv_masks[face]));
+		&& (ctx->adv.initBitFlags == 0 || (ctx->adv.initBitFlags & adv_masks[face]) == adv_masks[face]));
 }
 
-static int Adv_StretchXLiquid(int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
+static int Adv_StretchXLiquid(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
 	int count = 1; cc_bool stretchTile;
-	if (Builder_OccludedLiquid(chunkIndex)) return 0;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
-	adv_bitFlags[chunkIndex] = adv_initBitFlags;
+	if (Builder_OccludedLiquid(ctx, chunkIndex)) return 0;
+	ctx->adv.initBitFlags = Adv_ComputeLightFlags(ctx, x, y, z, chunkIndex);
+	ctx->bitFlags[chunkIndex] = ctx->adv.initBitFlags;
 
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << FACE_YMAX)) != 0;
 
-	while (x < Builder_ChunkEndX && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(chunkIndex)) {
-		Builder_Counts[countIndex] = 0;
+	while (x < ctx->chunkEndX && stretchTile && Adv_CanStretch(ctx, block, chunkIndex, x, y, z, FACE_YMAX) && !Builder_OccludedLiquid(ctx, chunkIndex)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		x++;
 		chunkIndex++;
 		countIndex += FACE_COUNT;
 	}
-	AddVertices(block, FACE_YMAX);
+	AddVertices(ctx, block, FACE_YMAX);
 	return count;
 }
 
-static int Adv_StretchX(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int Adv_StretchX(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
-	adv_bitFlags[chunkIndex] = adv_initBitFlags;
+	ctx->adv.initBitFlags = Adv_ComputeLightFlags(ctx, x, y, z, chunkIndex);
+	ctx->bitFlags[chunkIndex] = ctx->adv.initBitFlags;
 	
 	x++;
 	chunkIndex++;
 	countIndex += FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
 
-	while (x < Builder_ChunkEndX && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, face)) {
-		Builder_Counts[countIndex] = 0;
+	while (x < ctx->chunkEndX && stretchTile && Adv_CanStretch(ctx, block, chunkIndex, x, y, z, face)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		x++;
 		chunkIndex++;
 		countIndex += FACE_COUNT;
 	}
-	AddVertices(block, face);
+	AddVertices(ctx, block, face);
 	return count;
 }
 
-static int Adv_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int Adv_StretchZ(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
-	adv_bitFlags[chunkIndex] = adv_initBitFlags;
+	ctx->adv.initBitFlags = Adv_ComputeLightFlags(ctx, x, y, z, chunkIndex);
+	ctx->bitFlags[chunkIndex] = ctx->adv.initBitFlags;
 
 	z++;
 	chunkIndex += EXTCHUNK_SIZE;
 	countIndex += CHUNK_SIZE * FACE_COUNT;
 	stretchTile = (Blocks.CanStretch[block] & (1 << face)) != 0;
 
-	while (z < Builder_ChunkEndZ && stretchTile && Adv_CanStretch(block, chunkIndex, x, y, z, face)) {
-		Builder_Counts[countIndex] = 0;
+	while (z < ctx->chunkEndZ && stretchTile && Adv_CanStretch(ctx, block, chunkIndex, x, y, z, face)) {
+		ctx->counts[countIndex] = 0;
 		count++;
 		z++;
 		chunkIndex += EXTCHUNK_SIZE;
 		countIndex += CHUNK_SIZE * FACE_COUNT;
 	}
-	AddVertices(block, face);
+	AddVertices(ctx, block, face);
 	return count;
 }
 
 
 #define Adv_CountBits(F, a, b, c, d) (((F >> a) & 1) + ((F >> b) & 1) + ((F >> c) & 1) + ((F >> d) & 1))
 
-static void Adv_DrawXMin(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMIN);
+static void Adv_DrawXMin(struct BuilderContext* ctx, int count) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_XMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.z, u2 = (count - 1) + adv_maxBB.z * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.z, u2 = (count - 1) + ctx->adv.maxBB.z * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.minBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aY0_Z0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yCC_zM1, xM1_yM1_zCC, xM1_yCC_zCC);
 	int aY0_Z1 = Adv_CountBits(F, xM1_yM1_zP1, xM1_yCC_zP1, xM1_yM1_zCC, xM1_yCC_zCC);
 	int aY1_Z0 = Adv_CountBits(F, xM1_yP1_zM1, xM1_yCC_zM1, xM1_yP1_zCC, xM1_yCC_zCC);
 	int aY1_Z1 = Adv_CountBits(F, xM1_yP1_zP1, xM1_yCC_zP1, xM1_yP1_zCC, xM1_yCC_zCC);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerpX[aY0_Z0], col1_0 = Builder_FullBright ? white : adv_lerpX[aY1_Z0];
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerpX[aY1_Z1], col0_1 = Builder_FullBright ? white : adv_lerpX[aY0_Z1];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerpX[aY0_Z0], col1_0 = ctx->fullBright ? white : ctx->adv.lerpX[aY1_Z0];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerpX[aY1_Z1], col0_1 = ctx->fullBright ? white : ctx->adv.lerpX[aY0_Z1];
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_XMIN];
-	v.x = adv_x1;
+	v.x = ctx->adv.x1;
 	if (aY0_Z0 + aY1_Z1 > aY0_Z1 + aY1_Z0) {
-		v.y = adv_y2; v.z = adv_z1;               v.U = u1; v.V = v1; v.Col = col1_0; *vertices++ = v;
-		v.y = adv_y1;                                       v.V = v2; v.Col = col0_0; *vertices++ = v;
-		              v.z = adv_z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
-		v.y = adv_y2;                                       v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.y = ctx->adv.y2; v.z = ctx->adv.z1;               v.U = u1; v.V = v1; v.Col = col1_0; *vertices++ = v;
+		v.y = ctx->adv.y1;                                       v.V = v2; v.Col = col0_0; *vertices++ = v;
+		              v.z = ctx->adv.z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
+		v.y = ctx->adv.y2;                                       v.V = v1; v.Col = col1_1; *vertices++ = v;
 	} else {
-		v.y = adv_y2; v.z = adv_z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		              v.z = adv_z1;               v.U = u1;           v.Col = col1_0; *vertices++ = v;
-		v.y = adv_y1;                                       v.V = v2; v.Col = col0_0; *vertices++ = v;
-		              v.z = adv_z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
+		v.y = ctx->adv.y2; v.z = ctx->adv.z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		              v.z = ctx->adv.z1;               v.U = u1;           v.Col = col1_0; *vertices++ = v;
+		v.y = ctx->adv.y1;                                       v.V = v2; v.Col = col0_0; *vertices++ = v;
+		              v.z = ctx->adv.z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
 	}
 	part->faces.vertices[FACE_XMIN] = vertices;
 }
 
-static void Adv_DrawXMax(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMAX);
+static void Adv_DrawXMax(struct BuilderContext* ctx, int count) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_XMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = (count - adv_minBB.z), u2 = (1 - adv_maxBB.z) * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = (count - ctx->adv.minBB.z), u2 = (1 - ctx->adv.maxBB.z) * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.minBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aY0_Z0 = Adv_CountBits(F, xP1_yM1_zM1, xP1_yCC_zM1, xP1_yM1_zCC, xP1_yCC_zCC);
 	int aY0_Z1 = Adv_CountBits(F, xP1_yM1_zP1, xP1_yCC_zP1, xP1_yM1_zCC, xP1_yCC_zCC);
 	int aY1_Z0 = Adv_CountBits(F, xP1_yP1_zM1, xP1_yCC_zM1, xP1_yP1_zCC, xP1_yCC_zCC);
 	int aY1_Z1 = Adv_CountBits(F, xP1_yP1_zP1, xP1_yCC_zP1, xP1_yP1_zCC, xP1_yCC_zCC);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerpX[aY0_Z0], col1_0 = Builder_FullBright ? white : adv_lerpX[aY1_Z0];
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerpX[aY1_Z1], col0_1 = Builder_FullBright ? white : adv_lerpX[aY0_Z1];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerpX[aY0_Z0], col1_0 = ctx->fullBright ? white : ctx->adv.lerpX[aY1_Z0];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerpX[aY1_Z1], col0_1 = ctx->fullBright ? white : ctx->adv.lerpX[aY0_Z1];
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_XMAX];
-	v.x = adv_x2;
+	v.x = ctx->adv.x2;
 	if (aY0_Z0 + aY1_Z1 > aY0_Z1 + aY1_Z0) {
-		v.y = adv_y2; v.z = adv_z1;               v.U = u1; v.V = v1; v.Col = col1_0; *vertices++ = v;
-		              v.z = adv_z2 + (count - 1); v.U = u2;           v.Col = col1_1; *vertices++ = v;
-		v.y = adv_y1;                                       v.V = v2; v.Col = col0_1; *vertices++ = v;
-		              v.z = adv_z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		v.y = ctx->adv.y2; v.z = ctx->adv.z1;               v.U = u1; v.V = v1; v.Col = col1_0; *vertices++ = v;
+		              v.z = ctx->adv.z2 + (count - 1); v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		v.y = ctx->adv.y1;                                       v.V = v2; v.Col = col0_1; *vertices++ = v;
+		              v.z = ctx->adv.z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
 	} else {
-		v.y = adv_y2; v.z = adv_z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		v.y = adv_y1;                                       v.V = v2; v.Col = col0_1; *vertices++ = v;
-		              v.z = adv_z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
-		v.y = adv_y2;                                       v.V = v1; v.Col = col1_0; *vertices++ = v;
+		v.y = ctx->adv.y2; v.z = ctx->adv.z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.y = ctx->adv.y1;                                       v.V = v2; v.Col = col0_1; *vertices++ = v;
+		              v.z = ctx->adv.z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		v.y = ctx->adv.y2;                                       v.V = v1; v.Col = col1_0; *vertices++ = v;
 	}
 	part->faces.vertices[FACE_XMAX] = vertices;
 }
 
-static void Adv_DrawZMin(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMIN);
+static void Adv_DrawZMin(struct BuilderContext* ctx, int count) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_ZMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = (count - adv_minBB.x), u2 = (1 - adv_maxBB.x) * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = (count - ctx->adv.minBB.x), u2 = (1 - ctx->adv.maxBB.x) * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.minBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aX0_Y0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yCC_zM1, xCC_yM1_zM1, xCC_yCC_zM1);
 	int aX0_Y1 = Adv_CountBits(F, xM1_yP1_zM1, xM1_yCC_zM1, xCC_yP1_zM1, xCC_yCC_zM1);
 	int aX1_Y0 = Adv_CountBits(F, xP1_yM1_zM1, xP1_yCC_zM1, xCC_yM1_zM1, xCC_yCC_zM1);
 	int aX1_Y1 = Adv_CountBits(F, xP1_yP1_zM1, xP1_yCC_zM1, xCC_yP1_zM1, xCC_yCC_zM1);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerpZ[aX0_Y0], col1_0 = Builder_FullBright ? white : adv_lerpZ[aX1_Y0];
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerpZ[aX1_Y1], col0_1 = Builder_FullBright ? white : adv_lerpZ[aX0_Y1];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerpZ[aX0_Y0], col1_0 = ctx->fullBright ? white : ctx->adv.lerpZ[aX1_Y0];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerpZ[aX1_Y1], col0_1 = ctx->fullBright ? white : ctx->adv.lerpZ[aX0_Y1];
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_ZMIN];
-	v.z = adv_z1;
+	v.z = ctx->adv.z1;
 	if (aX1_Y1 + aX0_Y0 > aX0_Y1 + aX1_Y0) {
-		v.x = adv_x2 + (count - 1); v.y = adv_y1; v.U = u2; v.V = v2; v.Col = col1_0; *vertices++ = v;
-		v.x = adv_x1;                             v.U = u1;           v.Col = col0_0; *vertices++ = v;
-		                            v.y = adv_y2;           v.V = v1; v.Col = col0_1; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1); v.y = ctx->adv.y1; v.U = u2; v.V = v2; v.Col = col1_0; *vertices++ = v;
+		v.x = ctx->adv.x1;                             v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		                            v.y = ctx->adv.y2;           v.V = v1; v.Col = col0_1; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
 	} else {
-		v.x = adv_x1;               v.y = adv_y1; v.U = u1; v.V = v2; v.Col = col0_0; *vertices++ = v;
-		                            v.y = adv_y2;           v.V = v1; v.Col = col0_1; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
-		                            v.y = adv_y1;           v.V = v2; v.Col = col1_0; *vertices++ = v;
+		v.x = ctx->adv.x1;               v.y = ctx->adv.y1; v.U = u1; v.V = v2; v.Col = col0_0; *vertices++ = v;
+		                            v.y = ctx->adv.y2;           v.V = v1; v.Col = col0_1; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		                            v.y = ctx->adv.y1;           v.V = v2; v.Col = col1_0; *vertices++ = v;
 	}
 	part->faces.vertices[FACE_ZMIN] = vertices;
 }
 
-static void Adv_DrawZMax(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMAX);
+static void Adv_DrawZMax(struct BuilderContext* ctx, int count) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_ZMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.x, u2 = (count - 1) + ctx->adv.maxBB.x * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.minBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aX0_Y0 = Adv_CountBits(F, xM1_yM1_zP1, xM1_yCC_zP1, xCC_yM1_zP1, xCC_yCC_zP1);
 	int aX1_Y0 = Adv_CountBits(F, xP1_yM1_zP1, xP1_yCC_zP1, xCC_yM1_zP1, xCC_yCC_zP1);
 	int aX0_Y1 = Adv_CountBits(F, xM1_yP1_zP1, xM1_yCC_zP1, xCC_yP1_zP1, xCC_yCC_zP1);
 	int aX1_Y1 = Adv_CountBits(F, xP1_yP1_zP1, xP1_yCC_zP1, xCC_yP1_zP1, xCC_yCC_zP1);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerpZ[aX1_Y1], col1_0 = Builder_FullBright ? white : adv_lerpZ[aX1_Y0];
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerpZ[aX0_Y0], col0_1 = Builder_FullBright ? white : adv_lerpZ[aX0_Y1];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerpZ[aX1_Y1], col1_0 = ctx->fullBright ? white : ctx->adv.lerpZ[aX1_Y0];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerpZ[aX0_Y0], col0_1 = ctx->fullBright ? white : ctx->adv.lerpZ[aX0_Y1];
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_ZMAX];
-	v.z = adv_z2;
+	v.z = ctx->adv.z2;
 	if (aX1_Y1 + aX0_Y0 > aX0_Y1 + aX1_Y0) {
-		v.x = adv_x1;               v.y = adv_y2; v.U = u1; v.V = v1; v.Col = col0_1; *vertices++ = v;
-		                            v.y = adv_y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
-		                            v.y = adv_y2;           v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.x = ctx->adv.x1;               v.y = ctx->adv.y2; v.U = u1; v.V = v1; v.Col = col0_1; *vertices++ = v;
+		                            v.y = ctx->adv.y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		                            v.y = ctx->adv.y2;           v.V = v1; v.Col = col1_1; *vertices++ = v;
 	} else {
-		v.x = adv_x2 + (count - 1); v.y = adv_y2; v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		v.x = adv_x1;                             v.U = u1;           v.Col = col0_1; *vertices++ = v;
-		                            v.y = adv_y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1); v.y = ctx->adv.y2; v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.x = ctx->adv.x1;                             v.U = u1;           v.Col = col0_1; *vertices++ = v;
+		                            v.y = ctx->adv.y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
 	}
 	part->faces.vertices[FACE_ZMAX] = vertices;
 }
 
-static void Adv_DrawYMin(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMIN);
+static void Adv_DrawYMin(struct BuilderContext* ctx, int count) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_YMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
-	float v1 = vOrigin + adv_minBB.z * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.x, u2 = (count - 1) + ctx->adv.maxBB.x * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.minBB.z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aX0_Z0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yM1_zCC, xCC_yM1_zM1, xCC_yM1_zCC);
 	int aX1_Z0 = Adv_CountBits(F, xP1_yM1_zM1, xP1_yM1_zCC, xCC_yM1_zM1, xCC_yM1_zCC);
 	int aX0_Z1 = Adv_CountBits(F, xM1_yM1_zP1, xM1_yM1_zCC, xCC_yM1_zP1, xCC_yM1_zCC);
 	int aX1_Z1 = Adv_CountBits(F, xP1_yM1_zP1, xP1_yM1_zCC, xCC_yM1_zP1, xCC_yM1_zCC);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_1 = Builder_FullBright ? white : adv_lerpY[aX0_Z1], col1_1 = Builder_FullBright ? white : adv_lerpY[aX1_Z1];
-	PackedCol col1_0 = Builder_FullBright ? white : adv_lerpY[aX1_Z0], col0_0 = Builder_FullBright ? white : adv_lerpY[aX0_Z0];
+	PackedCol col0_1 = ctx->fullBright ? white : ctx->adv.lerpY[aX0_Z1], col1_1 = ctx->fullBright ? white : ctx->adv.lerpY[aX1_Z1];
+	PackedCol col1_0 = ctx->fullBright ? white : ctx->adv.lerpY[aX1_Z0], col0_0 = ctx->fullBright ? white : ctx->adv.lerpY[aX0_Z0];
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_YMIN];
-	v.y = adv_y1;
+	v.y = ctx->adv.y1;
 	if (aX0_Z1 + aX1_Z0 > aX0_Z0 + aX1_Z1) {
-		v.x = adv_x2 + (count - 1); v.z = adv_z2; v.U = u2; v.V = v2; v.Col = col1_1; *vertices++ = v;
-		v.x = adv_x1;                             v.U = u1;           v.Col = col0_1; *vertices++ = v;
-		                            v.z = adv_z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1); v.z = ctx->adv.z2; v.U = u2; v.V = v2; v.Col = col1_1; *vertices++ = v;
+		v.x = ctx->adv.x1;                             v.U = u1;           v.Col = col0_1; *vertices++ = v;
+		                            v.z = ctx->adv.z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
 	} else {
-		v.x = adv_x1;               v.z = adv_z2; v.U = u1; v.V = v2; v.Col = col0_1; *vertices++ = v;
-		                            v.z = adv_z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
-		                            v.z = adv_z2;           v.V = v2; v.Col = col1_1; *vertices++ = v;
+		v.x = ctx->adv.x1;               v.z = ctx->adv.z2; v.U = u1; v.V = v2; v.Col = col0_1; *vertices++ = v;
+		                            v.z = ctx->adv.z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		                            v.z = ctx->adv.z2;           v.V = v2; v.Col = col1_1; *vertices++ = v;
 	}
 	part->faces.vertices[FACE_YMIN] = vertices;
 }
 
-static void Adv_DrawYMax(int count) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMAX);
+static void Adv_DrawYMax(struct BuilderContext* ctx, int count) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_YMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
-	float v1 = vOrigin + adv_minBB.z * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.x, u2 = (count - 1) + ctx->adv.maxBB.x * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.minBB.z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
-	int F = adv_bitFlags[Builder_ChunkIndex];
+	int F = ctx->bitFlags[ctx->chunkIndex];
 	int aX0_Z0 = Adv_CountBits(F, xM1_yP1_zM1, xM1_yP1_zCC, xCC_yP1_zM1, xCC_yP1_zCC);
 	int aX1_Z0 = Adv_CountBits(F, xP1_yP1_zM1, xP1_yP1_zCC, xCC_yP1_zM1, xCC_yP1_zCC);
 	int aX0_Z1 = Adv_CountBits(F, xM1_yP1_zP1, xM1_yP1_zCC, xCC_yP1_zP1, xCC_yP1_zCC);
 	int aX1_Z1 = Adv_CountBits(F, xP1_yP1_zP1, xP1_yP1_zCC, xCC_yP1_zP1, xCC_yP1_zCC);
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	PackedCol col0_0 = Builder_FullBright ? white : adv_lerp[aX0_Z0], col1_0 = Builder_FullBright ? white : adv_lerp[aX1_Z0];
-	PackedCol col1_1 = Builder_FullBright ? white : adv_lerp[aX1_Z1], col0_1 = Builder_FullBright ? white : adv_lerp[aX0_Z1];
+	PackedCol col0_0 = ctx->fullBright ? white : ctx->adv.lerp[aX0_Z0], col1_0 = ctx->fullBright ? white : ctx->adv.lerp[aX1_Z0];
+	PackedCol col1_1 = ctx->fullBright ? white : ctx->adv.lerp[aX1_Z1], col0_1 = ctx->fullBright ? white : ctx->adv.lerp[aX0_Z1];
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_YMAX];
-	v.y = adv_y2;
+	v.y = ctx->adv.y2;
 	if (aX0_Z0 + aX1_Z1 > aX0_Z1 + aX1_Z0) {
-		v.x = adv_x2 + (count - 1); v.z = adv_z1; v.U = u2; v.V = v1; v.Col = col1_0; *vertices++ = v;
-		v.x = adv_x1;                             v.U = u1;           v.Col = col0_0; *vertices++ = v;
-		                            v.z = adv_z2;           v.V = v2; v.Col = col0_1; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1); v.z = ctx->adv.z1; v.U = u2; v.V = v1; v.Col = col1_0; *vertices++ = v;
+		v.x = ctx->adv.x1;                             v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		                            v.z = ctx->adv.z2;           v.V = v2; v.Col = col0_1; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
 	} else {
-		v.x = adv_x1;               v.z = adv_z1; v.U = u1; v.V = v1; v.Col = col0_0; *vertices++ = v;
-		                            v.z = adv_z2;           v.V = v2; v.Col = col0_1; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
-		                            v.z = adv_z1;           v.V = v1; v.Col = col1_0; *vertices++ = v;
+		v.x = ctx->adv.x1;               v.z = ctx->adv.z1; v.U = u1; v.V = v1; v.Col = col0_0; *vertices++ = v;
+		                            v.z = ctx->adv.z2;           v.V = v2; v.Col = col0_1; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		                            v.z = ctx->adv.z1;           v.V = v1; v.Col = col1_0; *vertices++ = v;
 	}
 	part->faces.vertices[FACE_YMAX] = vertices;
 }
 
-static void Adv_RenderBlock(int index, int x, int y, int z) {
+static void Adv_RenderBlock(struct BuilderContext* ctx, int index, int x, int y, int z) {
 	Vec3 min, max;
 	int count_XMin, count_XMax, count_ZMin;
 	int count_ZMax, count_YMin, count_YMax;
 
-	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
-		Builder_DrawSprite(x, y, z); return;
+	if (Blocks.Draw[ctx->block] == DRAW_SPRITE) {
+		Builder_DrawSprite(ctx, x, y, z); return;
 	}
 
-	count_XMin = Builder_Counts[index + FACE_XMIN];
-	count_XMax = Builder_Counts[index + FACE_XMAX];
-	count_ZMin = Builder_Counts[index + FACE_ZMIN];
-	count_ZMax = Builder_Counts[index + FACE_ZMAX];
-	count_YMin = Builder_Counts[index + FACE_YMIN];
-	count_YMax = Builder_Counts[index + FACE_YMAX];
+	count_XMin = ctx->counts[index + FACE_XMIN];
+	count_XMax = ctx->counts[index + FACE_XMAX];
+	count_ZMin = ctx->counts[index + FACE_ZMIN];
+	count_ZMax = ctx->counts[index + FACE_ZMAX];
+	count_YMin = ctx->counts[index + FACE_YMIN];
+	count_YMax = ctx->counts[index + FACE_YMAX];
 
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
-	Builder_FullBright = Blocks.Brightness[Builder_Block];
-	adv_baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	adv_tinted     = Blocks.Tinted[Builder_Block];
+	ctx->fullBright = Blocks.Brightness[ctx->block];
+	ctx->adv.baseOffset = (Blocks.Draw[ctx->block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	ctx->adv.tinted     = Blocks.Tinted[ctx->block];
 
-	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	adv_x1 = x + min.x; adv_y1 = y + min.y; adv_z1 = z + min.z;
-	adv_x2 = x + max.x; adv_y2 = y + max.y; adv_z2 = z + max.z;
+	min = Blocks.RenderMinBB[ctx->block]; max = Blocks.RenderMaxBB[ctx->block];
+	ctx->adv.x1 = x + min.x; ctx->adv.y1 = y + min.y; ctx->adv.z1 = z + min.z;
+	ctx->adv.x2 = x + max.x; ctx->adv.y2 = y + max.y; ctx->adv.z2 = z + max.z;
 
-	adv_minBB = Blocks.MinBB[Builder_Block]; adv_maxBB = Blocks.MaxBB[Builder_Block];
-	adv_minBB.y = 1.0f - adv_minBB.y; adv_maxBB.y = 1.0f - adv_maxBB.y;
+	ctx->adv.minBB = Blocks.MinBB[ctx->block]; ctx->adv.maxBB = Blocks.MaxBB[ctx->block];
+	ctx->adv.minBB.y = 1.0f - ctx->adv.minBB.y; ctx->adv.maxBB.y = 1.0f - ctx->adv.maxBB.y;
 
-	if (count_XMin) Adv_DrawXMin(count_XMin);
-	if (count_XMax) Adv_DrawXMax(count_XMax);
-	if (count_ZMin) Adv_DrawZMin(count_ZMin);
-	if (count_ZMax) Adv_DrawZMax(count_ZMax);
-	if (count_YMin) Adv_DrawYMin(count_YMin);
-	if (count_YMax) Adv_DrawYMax(count_YMax);
+	if (count_XMin) Adv_DrawXMin(ctx, count_XMin);
+	if (count_XMax) Adv_DrawXMax(ctx, count_XMax);
+	if (count_ZMin) Adv_DrawZMin(ctx, count_ZMin);
+	if (count_ZMax) Adv_DrawZMax(ctx, count_ZMax);
+	if (count_YMin) Adv_DrawYMin(ctx, count_YMin);
+	if (count_YMax) Adv_DrawYMax(ctx, count_YMax);
 }
 
-static void Adv_PrePrepareChunk(void) {
+static void Adv_PrePrepareChunk(struct BuilderContext* ctx) {
 	int i;
-	DefaultPrePrepateChunk();
-	adv_bitFlags = Builder_BitFlags;
+	DefaultPrePrepateChunk(ctx);
 
 	for (i = 0; i <= 4; i++) {
-		adv_lerp[i]  = PackedCol_Lerp(Env.ShadowCol,   Env.SunCol,   i / 4.0f);
-		adv_lerpX[i] = PackedCol_Lerp(Env.ShadowXSide, Env.SunXSide, i / 4.0f);
-		adv_lerpZ[i] = PackedCol_Lerp(Env.ShadowZSide, Env.SunZSide, i / 4.0f);
-		adv_lerpY[i] = PackedCol_Lerp(Env.ShadowYMin,  Env.SunYMin,  i / 4.0f);
+		ctx->adv.lerp[i]  = PackedCol_Lerp(Env.ShadowCol,   Env.SunCol,   i / 4.0f);
+		ctx->adv.lerpX[i] = PackedCol_Lerp(Env.ShadowXSide, Env.SunXSide, i / 4.0f);
+		ctx->adv.lerpZ[i] = PackedCol_Lerp(Env.ShadowZSide, Env.SunZSide, i / 4.0f);
+		ctx->adv.lerpY[i] = PackedCol_Lerp(Env.ShadowYMin,  Env.SunYMin,  i / 4.0f);
 	}
 }
 
@@ -1294,22 +1793,22 @@ static cc_bool Modern_CanStretch(BlockID initial, int chunkIndex, int x, int y,
 	return false;
 }
 
-static int Modern_StretchXLiquid(int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
+static int Modern_StretchXLiquid(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
 	int count = 1;
-	if (Builder_OccludedLiquid(chunkIndex)) return 0;
-	AddVertices(block, FACE_YMAX);
+	if (Builder_OccludedLiquid(ctx, chunkIndex)) return 0;
+	AddVertices(ctx, block, FACE_YMAX);
 	return count;
 }
 
-static int Modern_StretchX(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int Modern_StretchX(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1;
-	AddVertices(block, face);
+	AddVertices(ctx, block, face);
 	return count;
 }
 
-static int Modern_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
+static int Modern_StretchZ(struct BuilderContext* ctx, int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1;
-	AddVertices(block, face);
+	AddVertices(ctx, block, face);
 	return count;
 }
 
@@ -1326,69 +1825,69 @@ static PackedCol Modern_GetColorX(PackedCol orig, int x, int y, int z, int oY, i
 	PackedCol cd = AVERAGE(CoXoZ, orig);
 	return AVERAGE(ab, cd);
 }
-static void Modern_DrawXMin(int count, int x, int y, int z) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMIN);
+static void Modern_DrawXMin(struct BuilderContext* ctx, int count, int x, int y, int z) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_XMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.z, u2 = (count - 1) + adv_maxBB.z * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.z, u2 = (count - 1) + ctx->adv.maxBB.z * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.minBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_XMIN) & 1;
+	int offset = 1;// (Blocks.LightOffset[ctx->block] >> FACE_XMIN) & 1;
 	PackedCol orig = Lighting.Color_XSide_Fast(x-offset, y, z);
-	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorX(orig, x-offset, y, z, -1, -1);
-	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorX(orig, x-offset, y, z, 1, -1);
-	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorX(orig, x-offset, y, z, 1, 1);
-	PackedCol col0_1 = Builder_FullBright ? white : Modern_GetColorX(orig, x-offset, y, z, -1, 1);
+	PackedCol col0_0 = ctx->fullBright ? white : Modern_GetColorX(orig, x-offset, y, z, -1, -1);
+	PackedCol col1_0 = ctx->fullBright ? white : Modern_GetColorX(orig, x-offset, y, z, 1, -1);
+	PackedCol col1_1 = ctx->fullBright ? white : Modern_GetColorX(orig, x-offset, y, z, 1, 1);
+	PackedCol col0_1 = ctx->fullBright ? white : Modern_GetColorX(orig, x-offset, y, z, -1, 1);
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_XMIN];
-	v.x = adv_x1;
-		v.y = adv_y2; v.z = adv_z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		              v.z = adv_z1;               v.U = u1;           v.Col = col1_0; *vertices++ = v;
-		v.y = adv_y1;                                       v.V = v2; v.Col = col0_0; *vertices++ = v;
-		              v.z = adv_z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
+	v.x = ctx->adv.x1;
+		v.y = ctx->adv.y2; v.z = ctx->adv.z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		              v.z = ctx->adv.z1;               v.U = u1;           v.Col = col1_0; *vertices++ = v;
+		v.y = ctx->adv.y1;                                       v.V = v2; v.Col = col0_0; *vertices++ = v;
+		              v.z = ctx->adv.z2 + (count - 1); v.U = u2;           v.Col = col0_1; *vertices++ = v;
 	part->faces.vertices[FACE_XMIN] = vertices;
 }
 
-static void Modern_DrawXMax(int count, int x, int y, int z) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMAX);
+static void Modern_DrawXMax(struct BuilderContext* ctx, int count, int x, int y, int z) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_XMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = (count - adv_minBB.z), u2 = (1 - adv_maxBB.z) * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = (count - ctx->adv.minBB.z), u2 = (1 - ctx->adv.maxBB.z) * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.minBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_XMAX) & 1;
+	int offset = 1;// (Blocks.LightOffset[ctx->block] >> FACE_XMAX) & 1;
 	PackedCol orig = Lighting.Color_XSide_Fast(x+offset, y, z);
-	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorX(orig, x+offset, y, z, -1, -1);
-	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorX(orig, x+offset, y, z, 1, -1);
-	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorX(orig, x+offset, y, z, 1, 1);
-	PackedCol col0_1 = Builder_FullBright ? white : Modern_GetColorX(orig, x+offset, y, z, -1, 1);
+	PackedCol col0_0 = ctx->fullBright ? white : Modern_GetColorX(orig, x+offset, y, z, -1, -1);
+	PackedCol col1_0 = ctx->fullBright ? white : Modern_GetColorX(orig, x+offset, y, z, 1, -1);
+	PackedCol col1_1 = ctx->fullBright ? white : Modern_GetColorX(orig, x+offset, y, z, 1, 1);
+	PackedCol col0_1 = ctx->fullBright ? white : Modern_GetColorX(orig, x+offset, y, z, -1, 1);
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_XMAX];
-	v.x = adv_x2;
-		v.y = adv_y2; v.z = adv_z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		v.y = adv_y1;                                       v.V = v2; v.Col = col0_1; *vertices++ = v;
-		              v.z = adv_z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
-		v.y = adv_y2;                                       v.V = v1; v.Col = col1_0; *vertices++ = v;
+	v.x = ctx->adv.x2;
+		v.y = ctx->adv.y2; v.z = ctx->adv.z2 + (count - 1); v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.y = ctx->adv.y1;                                       v.V = v2; v.Col = col0_1; *vertices++ = v;
+		              v.z = ctx->adv.z1;               v.U = u1;           v.Col = col0_0; *vertices++ = v;
+		v.y = ctx->adv.y2;                                       v.V = v1; v.Col = col1_0; *vertices++ = v;
 	part->faces.vertices[FACE_XMAX] = vertices;
 }
 
@@ -1405,69 +1904,69 @@ static PackedCol Modern_GetColorZ(PackedCol orig, int x, int y, int z, int oX, i
 	PackedCol cd = AVERAGE(CoXoZ, orig);
 	return AVERAGE(ab, cd);
 }
-static void Modern_DrawZMin(int count, int x, int y, int z) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMIN);
+static void Modern_DrawZMin(struct BuilderContext* ctx, int count, int x, int y, int z) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_ZMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = (count - adv_minBB.x), u2 = (1 - adv_maxBB.x) * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = (count - ctx->adv.minBB.x), u2 = (1 - ctx->adv.maxBB.x) * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.minBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_ZMIN) & 1;
+	int offset = 1;// (Blocks.LightOffset[ctx->block] >> FACE_ZMIN) & 1;
 	PackedCol orig = Lighting.Color_ZSide_Fast(x, y, z-offset);
-	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, -1, -1);
-	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, 1, -1);
-	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, 1, 1);
-	PackedCol col0_1 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, -1, 1);
+	PackedCol col0_0 = ctx->fullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, -1, -1);
+	PackedCol col1_0 = ctx->fullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, 1, -1);
+	PackedCol col1_1 = ctx->fullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, 1, 1);
+	PackedCol col0_1 = ctx->fullBright ? white : Modern_GetColorZ(orig, x, y, z-offset, -1, 1);
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_ZMIN];
-	v.z = adv_z1;
-		v.x = adv_x1;               v.y = adv_y1; v.U = u1; v.V = v2; v.Col = col0_0; *vertices++ = v;
-		                            v.y = adv_y2;           v.V = v1; v.Col = col0_1; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
-		                            v.y = adv_y1;           v.V = v2; v.Col = col1_0; *vertices++ = v;
+	v.z = ctx->adv.z1;
+		v.x = ctx->adv.x1;               v.y = ctx->adv.y1; v.U = u1; v.V = v2; v.Col = col0_0; *vertices++ = v;
+		                            v.y = ctx->adv.y2;           v.V = v1; v.Col = col0_1; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		                            v.y = ctx->adv.y1;           v.V = v2; v.Col = col1_0; *vertices++ = v;
 	part->faces.vertices[FACE_ZMIN] = vertices;
 }
 
-static void Modern_DrawZMax(int count, int x, int y, int z) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMAX);
+static void Modern_DrawZMax(struct BuilderContext* ctx, int count, int x, int y, int z) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_ZMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
-	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.x, u2 = (count - 1) + ctx->adv.maxBB.x * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.maxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.minBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_ZMAX) & 1;
+	int offset = 1;// (Blocks.LightOffset[ctx->block] >> FACE_ZMAX) & 1;
 	PackedCol orig = Lighting.Color_ZSide_Fast(x, y, z+offset);
-	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, -1, -1);
-	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, 1, -1);
-	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, 1, 1);
-	PackedCol col0_1 = Builder_FullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, -1, 1);
+	PackedCol col0_0 = ctx->fullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, -1, -1);
+	PackedCol col1_0 = ctx->fullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, 1, -1);
+	PackedCol col1_1 = ctx->fullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, 1, 1);
+	PackedCol col0_1 = ctx->fullBright ? white : Modern_GetColorZ(orig, x, y, z+offset, -1, 1);
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_ZMAX];
-	v.z = adv_z2;
-		v.x = adv_x2 + (count - 1); v.y = adv_y2; v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
-		v.x = adv_x1;                             v.U = u1;           v.Col = col0_1; *vertices++ = v;
-		                            v.y = adv_y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+	v.z = ctx->adv.z2;
+		v.x = ctx->adv.x2 + (count - 1); v.y = ctx->adv.y2; v.U = u2; v.V = v1; v.Col = col1_1; *vertices++ = v;
+		v.x = ctx->adv.x1;                             v.U = u1;           v.Col = col0_1; *vertices++ = v;
+		                            v.y = ctx->adv.y1;           v.V = v2; v.Col = col0_0; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
 	part->faces.vertices[FACE_ZMAX] = vertices;
 }
 
@@ -1484,36 +1983,36 @@ static PackedCol Modern_GetColorYMin(PackedCol orig, int x, int y, int z, int oX
 	PackedCol cd = AVERAGE(CoXoZ, orig);
 	return AVERAGE(ab, cd);
 }
-static void Modern_DrawYMin(int count, int x, int y, int z) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMIN);
+static void Modern_DrawYMin(struct BuilderContext* ctx, int count, int x, int y, int z) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_YMIN);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
-	float v1 = vOrigin + adv_minBB.z * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.x, u2 = (count - 1) + ctx->adv.maxBB.x * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.minBB.z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_YMIN) & 1;
+	int offset = 1;// (Blocks.LightOffset[ctx->block] >> FACE_YMIN) & 1;
 	PackedCol orig = Lighting.Color_YMin_Fast(x, y-offset, z);
-	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z, -1, -1);
-	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z,  1, -1);
-	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z,  1,  1);
-	PackedCol col0_1 = Builder_FullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z, -1,  1);
+	PackedCol col0_0 = ctx->fullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z, -1, -1);
+	PackedCol col1_0 = ctx->fullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z,  1, -1);
+	PackedCol col1_1 = ctx->fullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z,  1,  1);
+	PackedCol col0_1 = ctx->fullBright ? white : Modern_GetColorYMin(orig, x, y-offset, z, -1,  1);
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_YMIN];
-	v.y = adv_y1;
-		v.x = adv_x1;               v.z = adv_z2; v.U = u1; v.V = v2; v.Col = col0_1; *vertices++ = v;
-		                            v.z = adv_z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
-		                            v.z = adv_z2;           v.V = v2; v.Col = col1_1; *vertices++ = v;
+	v.y = ctx->adv.y1;
+		v.x = ctx->adv.x1;               v.z = ctx->adv.z2; v.U = u1; v.V = v2; v.Col = col0_1; *vertices++ = v;
+		                            v.z = ctx->adv.z1;           v.V = v1; v.Col = col0_0; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_0; *vertices++ = v;
+		                            v.z = ctx->adv.z2;           v.V = v2; v.Col = col1_1; *vertices++ = v;
 	part->faces.vertices[FACE_YMIN] = vertices;
 }
 
@@ -1530,81 +2029,80 @@ static PackedCol Modern_GetColorYMax(PackedCol orig, int x, int y, int z, int oX
 	PackedCol cd = AVERAGE(CoXoZ, orig);
 	return AVERAGE(ab, cd);
 }
-static void Modern_DrawYMax(int count, int x, int y, int z) {
-	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMAX);
+static void Modern_DrawYMax(struct BuilderContext* ctx, int count, int x, int y, int z) {
+	TextureLoc texLoc = Block_Tex(ctx->block, FACE_YMAX);
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
-	float v1 = vOrigin + adv_minBB.z * Atlas1D.InvTileSize;
-	float v2 = vOrigin + adv_maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	float u1 = ctx->adv.minBB.x, u2 = (count - 1) + ctx->adv.maxBB.x * UV2_Scale;
+	float v1 = vOrigin + ctx->adv.minBB.z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + ctx->adv.maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
+	struct Builder1DPart* part = &ctx->parts[ctx->adv.baseOffset + Atlas1D_Index(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
-	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_YMAX) & 1;
+	int offset = 1;// (Blocks.LightOffset[ctx->block] >> FACE_YMAX) & 1;
 	PackedCol orig = Lighting.Color(x, y+offset, z);
-	PackedCol col0_0 = Builder_FullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z, -1, -1);
-	PackedCol col1_0 = Builder_FullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z,  1, -1);
-	PackedCol col1_1 = Builder_FullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z,  1,  1);
-	PackedCol col0_1 = Builder_FullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z, -1,  1);
+	PackedCol col0_0 = ctx->fullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z, -1, -1);
+	PackedCol col1_0 = ctx->fullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z,  1, -1);
+	PackedCol col1_1 = ctx->fullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z,  1,  1);
+	PackedCol col0_1 = ctx->fullBright ? white : Modern_GetColorYMax(orig, x, y+offset, z, -1,  1);
 
 	struct VertexTextured* vertices, v;
 
-	if (adv_tinted) {
-		tint   = Blocks.FogCol[Builder_Block];
+	if (ctx->adv.tinted) {
+		tint   = Blocks.FogCol[ctx->block];
 		col0_0 = PackedCol_Tint(col0_0, tint); col1_0 = PackedCol_Tint(col1_0, tint);
 		col1_1 = PackedCol_Tint(col1_1, tint); col0_1 = PackedCol_Tint(col0_1, tint);
 	}
 
 	vertices = part->faces.vertices[FACE_YMAX];
-	v.y = adv_y2;
-		v.x = adv_x1;               v.z = adv_z1; v.U = u1; v.V = v1; v.Col = col0_0; *vertices++ = v;
-		                            v.z = adv_z2;           v.V = v2; v.Col = col0_1; *vertices++ = v;
-		v.x = adv_x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
-		                            v.z = adv_z1;           v.V = v1; v.Col = col1_0; *vertices++ = v;
+	v.y = ctx->adv.y2;
+		v.x = ctx->adv.x1;               v.z = ctx->adv.z1; v.U = u1; v.V = v1; v.Col = col0_0; *vertices++ = v;
+		                            v.z = ctx->adv.z2;           v.V = v2; v.Col = col0_1; *vertices++ = v;
+		v.x = ctx->adv.x2 + (count - 1);               v.U = u2;           v.Col = col1_1; *vertices++ = v;
+		                            v.z = ctx->adv.z1;           v.V = v1; v.Col = col1_0; *vertices++ = v;
 	part->faces.vertices[FACE_YMAX] = vertices;
 }
 
-static void Modern_RenderBlock(int index, int x, int y, int z) {
+static void Modern_RenderBlock(struct BuilderContext* ctx, int index, int x, int y, int z) {
 	Vec3 min, max;
 	int count_XMin, count_XMax, count_ZMin;
 	int count_ZMax, count_YMin, count_YMax;
 
-	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
-		Builder_DrawSprite(x, y, z); return;
+	if (Blocks.Draw[ctx->block] == DRAW_SPRITE) {
+		Builder_DrawSprite(ctx, x, y, z); return;
 	}
 
-	count_XMin = Builder_Counts[index + FACE_XMIN];
-	count_XMax = Builder_Counts[index + FACE_XMAX];
-	count_ZMin = Builder_Counts[index + FACE_ZMIN];
-	count_ZMax = Builder_Counts[index + FACE_ZMAX];
-	count_YMin = Builder_Counts[index + FACE_YMIN];
-	count_YMax = Builder_Counts[index + FACE_YMAX];
+	count_XMin = ctx->counts[index + FACE_XMIN];
+	count_XMax = ctx->counts[index + FACE_XMAX];
+	count_ZMin = ctx->counts[index + FACE_ZMIN];
+	count_ZMax = ctx->counts[index + FACE_ZMAX];
+	count_YMin = ctx->counts[index + FACE_YMIN];
+	count_YMax = ctx->counts[index + FACE_YMAX];
 
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
-	Builder_FullBright = Blocks.Brightness[Builder_Block];
-	adv_baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	adv_tinted = Blocks.Tinted[Builder_Block];
+	ctx->fullBright = Blocks.Brightness[ctx->block];
+	ctx->adv.baseOffset = (Blocks.Draw[ctx->block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	ctx->adv.tinted = Blocks.Tinted[ctx->block];
 
-	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	adv_x1 = x + min.x; adv_y1 = y + min.y; adv_z1 = z + min.z;
-	adv_x2 = x + max.x; adv_y2 = y + max.y; adv_z2 = z + max.z;
+	min = Blocks.RenderMinBB[ctx->block]; max = Blocks.RenderMaxBB[ctx->block];
+	ctx->adv.x1 = x + min.x; ctx->adv.y1 = y + min.y; ctx->adv.z1 = z + min.z;
+	ctx->adv.x2 = x + max.x; ctx->adv.y2 = y + max.y; ctx->adv.z2 = z + max.z;
 
-	adv_minBB = Blocks.MinBB[Builder_Block]; adv_maxBB = Blocks.MaxBB[Builder_Block];
-	adv_minBB.y = 1.0f - adv_minBB.y; adv_maxBB.y = 1.0f - adv_maxBB.y;
+	ctx->adv.minBB = Blocks.MinBB[ctx->block]; ctx->adv.maxBB = Blocks.MaxBB[ctx->block];
+	ctx->adv.minBB.y = 1.0f - ctx->adv.minBB.y; ctx->adv.maxBB.y = 1.0f - ctx->adv.maxBB.y;
 
-	if (count_XMin) Modern_DrawXMin(count_XMin, x, y, z);
-	if (count_XMax) Modern_DrawXMax(count_XMax, x, y, z);
-	if (count_ZMin) Modern_DrawZMin(count_ZMin, x, y, z);
-	if (count_ZMax) Modern_DrawZMax(count_ZMax, x, y, z);
-	if (count_YMin) Modern_DrawYMin(count_YMin, x, y, z);
-	if (count_YMax) Modern_DrawYMax(count_YMax, x, y, z);
+	if (count_XMin) Modern_DrawXMin(ctx, count_XMin, x, y, z);
+	if (count_XMax) Modern_DrawXMax(ctx, count_XMax, x, y, z);
+	if (count_ZMin) Modern_DrawZMin(ctx, count_ZMin, x, y, z);
+	if (count_ZMax) Modern_DrawZMax(ctx, count_ZMax, x, y, z);
+	if (count_YMin) Modern_DrawYMin(ctx, count_YMin, x, y, z);
+	if (count_YMax) Modern_DrawYMax(ctx, count_YMax, x, y, z);
 }
 
-static void Modern_PrePrepareChunk(void) {
-	DefaultPrePrepateChunk();
-	adv_bitFlags = Builder_BitFlags;
+static void Modern_PrePrepareChunk(struct BuilderContext* ctx) {
+	DefaultPrePrepateChunk(ctx);
 }
 
 static void ModernBuilder_SetActive(void) {
@@ -1623,6 +2121,7 @@ static void ModernBuilder_SetActive(void) { NormalBuilder_SetActive(); }
 *---------------------------------------------------Builder interface-----------------------------------------------------*
 *#########################################################################################################################*/
 cc_bool Builder_SmoothLighting;
+cc_bool Builder_GreedyMeshing;
 void Builder_ApplyActive(void) {
 	if (Builder_SmoothLighting) {
 		if (Lighting_Mode != LIGHTING_MODE_CLASSIC) {
@@ -1645,7 +2144,13 @@ static void OnInit(void) {
 	Builder_Offsets[FACE_YMAX] =  EXTCHUNK_SIZE_2;
 
 	if (!Game_ClassicMode) Builder_SmoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
+	Builder_GreedyMeshing = Options_GetBool(OPT_GREEDY_MESHING, false);
 	Builder_ApplyActive();
+	Builder_StartWorkers();
+}
+
+static void OnFree(void) {
+	Builder_StopWorkers();
 }
 
 static void OnNewMapLoaded(void) {
@@ -1655,7 +2160,7 @@ static void OnNewMapLoaded(void) {
 
 struct IGameComponent Builder_Component = {
 	OnInit, /* Init */
-	NULL, /* Free */
+	OnFree, /* Free */
 	NULL, /* Reset */
 	NULL, /* OnNewMap */
 	OnNewMapLoaded /* OnNewMapLoaded */
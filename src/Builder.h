@@ -18,9 +18,13 @@ extern struct IGameComponent Builder_Component;
 extern int Builder_SidesLevel, Builder_EdgeLevel;
 /* Whether smooth/advanced lighting mesh builder is used. */
 extern cc_bool Builder_SmoothLighting;
+/* Whether faces of the normal mesh builder are merged into rectangles instead of just rows. */
+/* NOTE: Requires each terrain tile to be in its own texture, so that it can repeat on both axes. */
+extern cc_bool Builder_GreedyMeshing;
 
-/* Builds the mesh of vertices for the given chunk. */
-void Builder_MakeChunk(struct ChunkInfo* info);
+/* Builds the meshes of vertices for the given chunks. */
+/* NOTE: If mesh builder threads are enabled, the meshes may be built in parallel. */
+void Builder_MakeChunks(struct ChunkInfo** chunks, int count);
 
 void Builder_ApplyActive(void);
 
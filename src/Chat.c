@@ -51,6 +51,108 @@ static cc_string logPath = String_FromArray(logPathBuffer);
 
 static struct Stream logStream;
 static int lastLogDay, lastLogMonth, lastLogYear;
+static cc_uint32 logFileSize, logMaxSize;
+
+/* Chat log lines are first appended to a buffer, which is written out to the log file */
+/*  when it is half full and on a timer, rather than writing every line to the file */
+/* On systems with preemptive multitasking, the buffer is written out on a background */
+/*  thread, so slow disks/network filesystems do not stall the main thread */
+#ifdef CC_BUILD_LOWMEM
+	#define LOG_BUFFER_SIZE 4096
+#else
+	#define LOG_BUFFER_SIZE (64 * 1024)
+#endif
+#define LOG_FLUSH_INTERVAL 1.0
+
+/* While the background thread writes out one buffer, the main thread appends to the other */
+static cc_uint8 logBuffers[2][LOG_BUFFER_SIZE];
+static int logCurBuffer, logPending;
+static volatile cc_result logWriteRes;
+
+#ifndef CC_BUILD_COOPTHREADED
+static void* logThread;
+static void* logWakeup;
+static void* logPendingMutex; /* Protects logCurBuffer and logPending */
+static void* logFileMutex;    /* Protects logStream */
+static volatile cc_bool logStopping;
+
+#define LogPending_Lock()   Mutex_Lock(logPendingMutex)
+#define LogPending_Unlock() Mutex_Unlock(logPendingMutex)
+#define LogFile_Lock()      Mutex_Lock(logFileMutex)
+#define LogFile_Unlock()    Mutex_Unlock(logFileMutex)
+#else
+#define LogPending_Lock()
+#define LogPending_Unlock()
+#define LogFile_Lock()
+#define LogFile_Unlock()
+#endif
+
+/* Writes out all buffered chat log lines to the chat log file */
+static void WriteOutLog(void) {
+	cc_uint8* data;
+	cc_result res;
+	int len;
+
+	LogFile_Lock();
+	{
+		LogPending_Lock();
+		data = logBuffers[logCurBuffer];
+		len  = logPending;
+		logCurBuffer ^= 1;
+		logPending    = 0;
+		LogPending_Unlock();
+
+		if (len && logStream.meta.file) {
+			res = Stream_Write(&logStream, data, len);
+			if (res) logWriteRes = res;
+		}
+	}
+	LogFile_Unlock();
+}
+
+#ifndef CC_BUILD_COOPTHREADED
+static void LogWriter_Run(void) {
+	for (;;)
+	{
+		Waitable_Wait(logWakeup);
+		if (logStopping) return;
+		WriteOutLog();
+	}
+}
+
+static void LogWriter_Init(void) {
+	logWakeup       = Waitable_Create("Chat log wakeup");
+	logPendingMutex = Mutex_Create("Chat log pending");
+	logFileMutex    = Mutex_Create("Chat log file");
+}
+
+static void LogWriter_Start(void) {
+	if (logThread) return;
+	logStopping = false;
+	Thread_Run(&logThread, LogWriter_Run, 64 * 1024, "Chat log writer");
+}
+
+/* Requests the background thread to write out all buffered chat log lines */
+static void LogWriter_Signal(void) { Waitable_Signal(logWakeup); }
+
+static void LogWriter_Free(void) {
+	if (logThread) {
+		logStopping = true;
+		Waitable_Signal(logWakeup);
+		Thread_Join(logThread);
+		logThread = NULL;
+	}
+
+	Waitable_Free(logWakeup);
+	Mutex_Free(logPendingMutex);
+	Mutex_Free(logFileMutex);
+}
+#else
+static void LogWriter_Init(void)   { }
+static void LogWriter_Start(void)  { }
+static void LogWriter_Signal(void) { WriteOutLog(); }
+static void LogWriter_Free(void)   { }
+#endif
 
 /* Resets log name to empty and resets last log date */
 static void ResetLogFile(void) {
@@ -58,12 +160,17 @@ static void ResetLogFile(void) {
 	lastLogYear    = -123;
 }
 
-/* Closes handle to the chat log file */
+/* Writes out any buffered lines, then closes handle to the chat log file */
 static void CloseLogFile(void) {
 	cc_result res;
+	WriteOutLog();
 	if (!logStream.meta.file) return;
 
-	res = logStream.Close(&logStream);
+	LogFile_Lock();
+	{
+		res = logStream.Close(&logStream);
+	}
+	LogFile_Unlock();
 	if (res) { Logger_SysWarn2(res, "closing", &logPath); }
 }
 
@@ -121,13 +228,20 @@ static cc_bool CreateLogsDirectory(void) {
 	return false;
 }
 
-static void OpenChatLog(struct DateTime* now) {
+/* Whether adding the given number of bytes would exceed the max size of a chat log file */
+static cc_bool LogFileFull(cc_uint32 extra) {
+	return logMaxSize && logFileSize && logFileSize + extra > logMaxSize;
+}
+
+/* Opens the chat log file for the given day, skipping over files without space for lineLen more bytes */
+static void OpenChatLog(struct DateTime* now, int lineLen) {
 	cc_result res;
-	int i;
+	int i, tries = 0;
 	if (Platform_ReadonlyFilesystem || !CreateLogsDirectory()) return;
 
 	/* Ensure multiple instances do not end up overwriting each other's log entries. */
-	for (i = 0; i < 20; i++) {
+	/* Files that have already reached the max size are also skipped over */
+	for (i = 0; tries < 20; i++) {
 		logPath.length = 0;
 		String_Format3(&logPath, "logs/%p4-%p2-%p2 ", &now->year, &now->month, &now->day);
 
@@ -137,32 +251,93 @@ static void OpenChatLog(struct DateTime* now) {
 			String_Format1(&logPath, "%s.txt", &logName);
 		}
 
-		res = Stream_AppendFile(&logStream, &logPath);
+		LogFile_Lock();
+		{
+			res = Stream_AppendFile(&logStream, &logPath);
+			logFileSize = 0;
+			if (!res && logStream.Length(&logStream, &logFileSize)) logFileSize = 0;
+		}
+		LogFile_Unlock();
+
 		if (res && res != ReturnCode_FileShareViolation) {
 			Chat_DisableLogging();
 			Logger_SysWarn2(res, "appending to", &logPath);
 			return;
 		}
 
-		if (res == ReturnCode_FileShareViolation) continue;
+		if (res == ReturnCode_FileShareViolation) { tries++; continue; }
+		if (LogFileFull(lineLen)) { CloseLogFile(); continue; }
+
+		LogWriter_Start();
 		return;
 	}
 
 	Chat_DisableLogging();
-	Chat_Add1("&cFailed to open a chat log file after %i tries, giving up", &i);	
+	Chat_Add1("&cFailed to open a chat log file after %i tries, giving up", &tries);	
+}
+
+static void CheckLogWriteResult(void) {
+	cc_result res = logWriteRes;
+	if (!res) return;
+
+	Chat_DisableLogging();
+	logWriteRes = 0;
+	Logger_SysWarn2(res, "writing to", &logPath);
+}
+
+/* Appends the given line to the chat log buffer, converting it to UTF8 */
+static void BufferLogLine(const cc_string* str, struct DateTime* now) {
+	cc_uint8 line[DRAWER2D_MAX_TEXT_LENGTH * 3 + 2];
+	const char* nl;
+	cc_bool halfFull;
+	int i, len = 0;
+
+	for (i = 0; i < str->length; i++) 
+	{
+		len += Convert_CP437ToUtf8(str->buffer[i], line + len);
+	}
+	nl = _NL;
+	while (*nl) { line[len++] = *nl++; }
+
+	if (LogFileFull(len)) {
+		CloseLogFile();
+		OpenChatLog(now, len);
+		if (!logStream.meta.file) return;
+	}
+	logFileSize += len;
+
+	LogPending_Lock();
+	{
+		/* Buffer can only be full if the disk is being slow, so wait for it */
+		if (logPending + len > LOG_BUFFER_SIZE) {
+			LogPending_Unlock();
+			WriteOutLog();
+			LogPending_Lock();
+		}
+
+		Mem_Copy(logBuffers[logCurBuffer] + logPending, line, len);
+		logPending += len;
+		halfFull    = logPending >= LOG_BUFFER_SIZE / 2;
+	}
+	LogPending_Unlock();
+	if (halfFull) LogWriter_Signal();
+}
+
+static void FlushLogTask(struct ScheduledTask* task) {
+	if (logPending) LogWriter_Signal();
+	CheckLogWriteResult();
 }
 
 static void AppendChatLog(const cc_string* text) {
 	cc_string str; char strBuffer[DRAWER2D_MAX_TEXT_LENGTH];
 	struct DateTime now;
-	cc_result res;	
 
 	if (!logName.length || !Chat_Logging) return;
 	DateTime_CurrentLocal(&now);
 
 	if (now.day != lastLogDay || now.month != lastLogMonth || now.year != lastLogYear) {
 		CloseLogFile();
-		OpenChatLog(&now);
+		OpenChatLog(&now, 1);
 	}
 
 	lastLogDay = now.day; lastLogMonth = now.month; lastLogYear = now.year;
@@ -173,10 +348,8 @@ static void AppendChatLog(const cc_string* text) {
 	String_Format3(&str, "[%p2:%p2:%p2] ", &now.hour, &now.minute, &now.second);
 	Drawer2D_WithoutColors(&str, text);
 
-	res = Stream_WriteLine(&logStream, &str);
-	if (!res) return;
-	Chat_DisableLogging();
-	Logger_SysWarn2(res, "writing to", &logPath);
+	BufferLogLine(&str, &now);
+	CheckLogWriteResult();
 }
 
 void Chat_Add1(const char* format, const void* a1) {
@@ -278,6 +451,10 @@ static void OnInit(void) {
 #else
 	Chat_Logging = Options_GetBool(OPT_CHAT_LOGGING, true);
 #endif
+	logMaxSize = (cc_uint32)Options_GetInt(OPT_CHAT_LOG_MAX_SIZE, 0, 4095, 0) * 1024 * 1024;
+
+	LogWriter_Init();
+	ScheduledTask_Add(LOG_FLUSH_INTERVAL, FlushLogTask);
 }
 
 static void ClearCPEMessages(void) {
@@ -300,6 +477,7 @@ static void OnReset(void) {
 
 static void OnFree(void) {
 	CloseLogFile();
+	LogWriter_Free();
 	ClearCPEMessages();
 
 	ClearChatLogs();
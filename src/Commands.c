@@ -17,6 +17,7 @@
 #include "TexturePack.h"
 #include "Options.h"
 #include "Drawer2D.h"
+#include "Http.h"
 
 #define COMMANDS_PREFIX "/client"
 #define COMMANDS_PREFIX_SPACE "/client "
@@ -286,6 +287,28 @@ static struct ChatCommand ClearDeniedCommand = {
 	}
 };
 
+static void HttpCacheCommand_Execute(const cc_string* args, int argsCount) {
+	struct HttpCacheStats stats;
+	int sizeKB, savedKB;
+	Http_GetCacheStats(&stats);
+
+	sizeKB  = (int)(stats.size       / 1024);
+	savedKB = (int)(stats.bytesSaved / 1024);
+	Chat_Add2("&eHTTP cache: &f%i entries, %i KB", &stats.entries, &sizeKB);
+	Chat_Add3("&eHits: &f%i&e, misses: &f%i&e, evictions: &f%i",
+		&stats.hits, &stats.misses, &stats.evictions);
+	Chat_Add1("&eAvoided downloading &f%i KB", &savedKB);
+}
+
+static struct ChatCommand HttpCacheCommand = {
+	"HttpCache", HttpCacheCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client httpcache",
+		"&eDisplays statistics about the cache of downloaded skins",
+	}
+};
+
 static void MotdCommand_Execute(const cc_string* args, int argsCount) {
 	if (Server.IsSinglePlayer) {
 		Chat_AddRaw("&eThis command can only be used in multiplayer.");
@@ -804,6 +827,7 @@ static void OnInit(void) {
 	Commands_Register(&SkinCommand);
 	Commands_Register(&TeleportCommand);
 	Commands_Register(&ClearDeniedCommand);
+	Commands_Register(&HttpCacheCommand);
 	Commands_Register(&MotdCommand);
 	Commands_Register(&PlaceCommand);
 	Commands_Register(&BlockEditCommand);
@@ -6,6 +6,7 @@
 #include "Stream.h"
 #include "Errors.h"
 #include "Utils.h"
+#include "ExtMath.h"
 
 #define Header_ReadU8(value) if ((res = s->ReadU8(s, &value))) return res;
 /*########################################################################################################################*
@@ -792,24 +793,44 @@ void Inflate_MakeStream2(struct Stream* stream, struct InflateState* state, stru
 /*########################################################################################################################*
 *---------------------------------------------------Deflate (compress)----------------------------------------------------*
 *#########################################################################################################################*/
-/* these are copies of len_base and dist_base, with UINT16_MAX instead of 0 for sentinel cutoff */
-static const cc_uint16 deflate_len[30] = {
-	3,4,5,6,7,8,9,10,11,13,
-	15,17,19,23,27,31,35,43,51,59,
-	67,83,99,115,131,163,195,227,258,UInt16_MaxValue
+/* Parameters that control how thoroughly input data is searched for matches */
+struct DeflateLevel {
+	cc_uint16 maxChain; /* Max number of previous matches explored in a hash chain */
+	cc_uint16 lazyLen;  /* Only try lazy matching when best match is shorter than this */
+	cc_uint16 niceLen;  /* Stop searching once a match at least this long has been found */
 };
-static const cc_uint16 deflate_dist[31] = {
-	1,2,3,4,5,7,9,13,17,25,
-	33,49,65,97,129,193,257,385,513,769,
-	1025,1537,2049,3073,4097,6145,8193,12289,16385,24577,UInt16_MaxValue
+static const struct DeflateLevel deflate_levels[DEFLATE_LEVEL_BEST + 1] = {
+	{    0,   0,   0 }, /* huffman only */
+	{    4,   0,   8 }, {    8,   0,  16 }, {   16,   0,  32 }, /* greedy matching */
+	{   16,   4,  16 }, {   32,  16,  32 }, {  128,  16, 128 }, /* lazy matching */
+	{  256,  32, 128 }, { 1024, 128, 258 }, { 4096, 258, 258 }
+};
+
+#define DEFLATE_MAX_SYMS 8192
+/* Compressor state for the block of symbols currently being built up */
+/* NOTE: This is allocated separately from DeflateState, so that DeflateState */
+/*  (and GZipState/ZLibState) keep the same size and layout for plugins */
+struct DeflateBlock {
+	struct DeflateState* state; /* Base state this block state belongs to */
+	int Level;      /* How thoroughly to search for matches, see DEFLATE_LEVEL_ */
+	int NumSyms;    /* Number of symbols in the current block */
+	int BlockStart; /* Offset of current block's first byte in Input buffer (negative if no longer in buffer) */
+	int BlockLen;   /* Number of input bytes the current block's symbols represent */
+	cc_uint16 LitsFreqs[INFLATE_MAX_LITS];   /* Number of times each literal/length occurs in current block */
+	cc_uint16 DistsFreqs[INFLATE_MAX_DISTS]; /* Number of times each distance occurs in current block */
+
+	cc_uint16 DistsCodewords[INFLATE_MAX_DISTS]; /* Codewords for each distance */
+	cc_uint8 DistsLens[INFLATE_MAX_DISTS];       /* Bit lengths of each distance codeword */
+	cc_uint8 SymLits[DEFLATE_MAX_SYMS];   /* Literal, or (match length - 3) for each symbol */
+	cc_uint16 SymDists[DEFLATE_MAX_SYMS]; /* Match distance for each symbol, 0 if literal */
 };
 
 /* Pushes given bits, but does not write them */
 #define Deflate_PushBits(state, value, bits) state->Bits |= (value) << state->NumBits; state->NumBits += (bits);
 /* Pushes bits of the huffman codeword bits for the given literal, but does not write them */
 #define Deflate_PushLit(state, value) Deflate_PushBits(state, state->LitsCodewords[value], state->LitsLens[value])
-/* Pushes given bits (reversing for huffman code), but does not write them */
-#define Deflate_PushHuff(state, value, bits) Deflate_PushBits(state, Huffman_ReverseBits(value, bits), bits)
+/* Pushes bits of the huffman codeword bits for the given distance, but does not write them */
+#define Deflate_PushDist(state, blk, value) Deflate_PushBits(state, blk->DistsCodewords[value], blk->DistsLens[value])
 /* Writes given byte to output */
 #define Deflate_WriteByte(state) *state->NextOut++ = state->Bits; state->AvailOut--; state->Bits >>= 8; state->NumBits -= 8;
 /* Flushes bits in buffer to output buffer */
@@ -817,6 +838,12 @@ static const cc_uint16 deflate_dist[31] = {
 
 #define MIN_MATCH_LEN 3
 #define MAX_MATCH_LEN 258
+/* Matches of MIN_MATCH_LEN further back than this usually take more bits than just using literals */
+#define DEFLATE_TOO_FAR 4096
+
+#define DEFLATE_MAX_LITS  286
+#define DEFLATE_MAX_DISTS 30
+#define DEFLATE_MAX_CODEBITS 7
 
 /* Number of bytes that match (are the same) from a and b */
 static int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
@@ -830,33 +857,350 @@ static cc_uint32 Deflate_Hash(cc_uint8* src) {
 	return (cc_uint32)((src[0] << 8) ^ (src[1] << 4) ^ (src[2])) & DEFLATE_HASH_MASK;
 }
 
-/* Writes a literal to state->Output */
-static void Deflate_Lit(struct DeflateState* state, int lit) {
-	Deflate_PushLit(state, lit);
-	Deflate_FlushBits(state);
+/* Returns index into len_base/len_bits for the given (match length - 3) */
+static int Deflate_LenCode(int len) {
+	int bits;
+	if (len < 8)    return len;
+	if (len == 255) return 28;
+
+	bits = Math_ilog2(len);
+	return 4 * (bits - 1) + ((len >> (bits - 2)) & 3);
+}
+
+/* Returns index into dist_base/dist_bits for the given match distance */
+static int Deflate_DistCode(int dist) {
+	int bits;
+	dist--;
+	if (dist < 4) return dist;
+
+	bits = Math_ilog2(dist);
+	return 2 * bits + ((dist >> (bits - 1)) & 1);
 }
 
-/* Writes a length-distance pair to state->Output */
-static void Deflate_LenDist(struct DeflateState* state, int len, int dist) {
-	int j;
-	/* TODO: Do we actually need the if (len_bits[j]) ????????? does writing 0 bits matter??? */
+/* Adds a literal to the symbols of the current block */
+static void Deflate_Lit(struct DeflateBlock* blk, int lit) {
+	blk->SymLits[blk->NumSyms]  = lit;
+	blk->SymDists[blk->NumSyms] = 0;
+	blk->NumSyms++;
+
+	blk->LitsFreqs[lit]++;
+	blk->BlockLen++;
+}
+
+/* Adds a length-distance pair to the symbols of the current block */
+static void Deflate_LenDist(struct DeflateBlock* blk, int len, int dist) {
+	blk->SymLits[blk->NumSyms]  = len - MIN_MATCH_LEN;
+	blk->SymDists[blk->NumSyms] = dist;
+	blk->NumSyms++;
+
+	blk->LitsFreqs[257 + Deflate_LenCode(len - MIN_MATCH_LEN)]++;
+	blk->DistsFreqs[Deflate_DistCode(dist)]++;
+	blk->BlockLen += len;
+}
+
+/* Calculates length limited huffman codeword lengths for the given frequencies */
+/* Based off the approach used in miniz: lengths are first calculated from an unlimited huffman tree, */
+/*  then codewords that are too long are moved to shorter lengths until the tree is valid again */
+static void Deflate_BuildLengths(cc_uint16* freqs, int count, int maxBits, cc_uint8* lens) {
+	cc_uint16 syms[DEFLATE_MAX_LITS];
+	cc_uint32 weights[DEFLATE_MAX_LITS * 2];
+	cc_uint16 parents[DEFLATE_MAX_LITS * 2];
+	int bl_count[32];
+	cc_uint32 a, b, total;
+	int i, j, n, leaf, node, next;
+
+	/* Trees must have at least two codewords */
+	for (i = 0, n = 0; i < count; i++) { if (freqs[i]) n++; }
+	for (i = 0; i < count && n < 2; i++) {
+		if (!freqs[i]) { freqs[i] = 1; n++; }
+	}
+
+	/* Sort used symbols by ascending frequency */
+	for (i = 0, n = 0; i < count; i++) {
+		lens[i] = 0;
+		if (!freqs[i]) continue;
+
+		for (j = n; j > 0 && freqs[syms[j - 1]] > freqs[i]; j--) {
+			syms[j] = syms[j - 1];
+		}
+		syms[j] = i; n++;
+	}
+
+	/* Build huffman tree, by repeatedly combining the two lowest weight nodes */
+	/* Since nodes are created in ascending weight order, */
+	/*  lowest weight nodes are always at front of either leaves or nodes queue */
+	for (i = 0; i < n; i++) weights[i] = freqs[syms[i]];
+	leaf = 0; node = n; next = n;
+
+	for (; next < 2 * n - 1; next++) {
+		if (leaf < n && (node == next || weights[leaf] <= weights[node])) {
+			a = leaf++;
+		} else { a = node++; }
+		if (leaf < n && (node == next || weights[leaf] <= weights[node])) {
+			b = leaf++;
+		} else { b = node++; }
+
+		weights[next] = weights[a] + weights[b];
+		parents[a]    = next;
+		parents[b]    = next;
+	}
+
+	/* Calculate depth of each node, reusing weights array */
+	/* Parent nodes are always after child nodes, so work backwards from root */
+	weights[2 * n - 2] = 0;
+	for (i = 2 * n - 3; i >= 0; i--) {
+		weights[i] = weights[parents[i]] + 1;
+	}
+
+	for (i = 0; i < Array_Elems(bl_count); i++) bl_count[i] = 0;
+	for (i = 0; i < n; i++) {
+		bl_count[min(weights[i], Array_Elems(bl_count) - 1)]++;
+	}
+
+	/* Move codewords that are too long to be max length, then move */
+	/*  codewords to longer lengths until huffman tree is complete */
+	for (i = maxBits + 1; i < Array_Elems(bl_count); i++) {
+		bl_count[maxBits] += bl_count[i];
+	}
+	for (i = maxBits, total = 0; i > 0; i--) {
+		total += (cc_uint32)bl_count[i] << (maxBits - i);
+	}
+
+	for (; total != (1UL << maxBits); total--) {
+		bl_count[maxBits]--;
+		for (i = maxBits - 1; i > 0; i--) {
+			if (!bl_count[i]) continue;
+			bl_count[i]--; bl_count[i + 1] += 2; break;
+		}
+	}
+
+	/* Least frequent symbols are assigned the longest codewords */
+	for (i = maxBits, j = 0; i > 0; i--) {
+		for (a = 0; a < (cc_uint32)bl_count[i]; a++) lens[syms[j++]] = i;
+	}
+}
+
+/* Run length encodes codeword lengths, returning number of encoded entries */
+/* Each entry is a codelens symbol, followed by number of extra repeats for symbols 16/17/18 */
+static int Deflate_EncodeLengths(const cc_uint8* lens, int count, cc_uint8* syms, cc_uint8* extra) {
+	int i, j, len, run, n = 0;
+	#define Deflate_AddLen(sym, value) syms[n] = sym; extra[n] = value; n++;
+
+	for (i = 0; i < count; i += run) {
+		len = lens[i];
+		for (run = 1; i + run < count && lens[i + run] == len; run++) { }
+
+		if (len == 0) {
+			/* Use 18 for runs of 11-138 zeros, and 17 for runs of 3-10 zeros */
+			for (j = run; j >= 11; j -= min(j, 138)) { Deflate_AddLen(18, min(j, 138) - 11); }
+			if (j >= 3) { Deflate_AddLen(17, j - 3); j = 0; }
+		} else {
+			/* Use 16 to repeat previous length 3-6 times */
+			Deflate_AddLen(len, 0);
+			for (j = run - 1; j >= 3; j -= min(j, 6)) { Deflate_AddLen(16, min(j, 6) - 3); }
+		}
+		for (; j > 0; j--) { Deflate_AddLen(len, 0); }
+	}
+	return n;
+}
 
-	for (j = 0; len >= deflate_len[j + 1]; j++);
-	Deflate_PushLit(state, j + 257);
-	if (len_bits[j]) { Deflate_PushBits(state, len - deflate_len[j], len_bits[j]); }
+/* Constructs a huffman encoding table (for values to codewords) */
+static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
+	int i, j, offset, codeword;
+	struct HuffmanTable table;
+
+	/* NOTE: Can ignore since lens table is not user controlled */
+	(void)Huffman_Build(&table, lens, count);
+	for (i = 0; i < INFLATE_MAX_BITS; i++) {
+		if (!table.endCodewords[i]) continue;
+		count = table.endCodewords[i] - table.firstCodewords[i];
+
+		for (j = 0; j < count; j++) {
+			offset   = table.values[table.firstOffsets[i] + j];
+			codeword = table.firstCodewords[i] + j;
+			bitlens[offset]   = i;
+			codewords[offset] = Huffman_ReverseBits(codeword, i);
+		}
+	}
+}
+
+/* Calculates number of bits needed to encode the current block's symbols with the given codeword lengths */
+static cc_uint32 Deflate_DataBits(struct DeflateBlock* blk, const cc_uint8* litLens, const cc_uint8* distLens) {
+	cc_uint32 bits = 0;
+	int i;
+
+	for (i = 0; i < 257; i++) {
+		bits += blk->LitsFreqs[i] * litLens[i];
+	}
+	for (i = 257; i < DEFLATE_MAX_LITS; i++) {
+		bits += blk->LitsFreqs[i] * (litLens[i] + len_bits[i - 257]);
+	}
+	for (i = 0; i < DEFLATE_MAX_DISTS; i++) {
+		bits += blk->DistsFreqs[i] * (distLens[i] + dist_bits[i]);
+	}
+	return bits;
+}
+
+static cc_result Deflate_FlushOutput(struct DeflateState* state) {
+	cc_result res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	state->NextOut  = state->Output;
+	state->AvailOut = DEFLATE_OUT_SIZE;
+	return res;
+}
+
+/* Writes the current block's input data as an uncompressed block */
+static cc_result Deflate_WriteStored(struct DeflateBlock* blk) {
+	struct DeflateState* state = blk->state;
+	cc_uint8* src = state->Input + blk->BlockStart;
+	cc_uint32 len = blk->BlockLen, count;
+	cc_result res;
+
+	/* Stored block data starts at next byte boundary */
+	if (state->NumBits & 7) { Deflate_PushBits(state, 0, 8 - (state->NumBits & 7)); }
+	Deflate_PushBits(state, len, 16);
+	Deflate_FlushBits(state);
+	Deflate_PushBits(state, len ^ 0xFFFF, 16);
 	Deflate_FlushBits(state);
 
-	for (j = 0; dist >= deflate_dist[j + 1]; j++);
-	Deflate_PushHuff(state, j, 5);
-	if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
+	while (len) {
+		if (!state->AvailOut && (res = Deflate_FlushOutput(state))) return res;
+		count = min(len, state->AvailOut);
+
+		Mem_Copy(state->NextOut, src, count);
+		state->NextOut  += count; state->AvailOut -= count;
+		src += count; len -= count;
+	}
+	return 0;
+}
+
+/* Writes the current block's symbols using the current huffman codewords */
+static cc_result Deflate_WriteSymbols(struct DeflateBlock* blk) {
+	struct DeflateState* state = blk->state;
+	int i, len, dist, code;
+	cc_result res;
+
+	for (i = 0; i < blk->NumSyms; i++) {
+		dist = blk->SymDists[i];
+
+		if (!dist) {
+			Deflate_PushLit(state, blk->SymLits[i]);
+			Deflate_FlushBits(state);
+		} else {
+			len  = blk->SymLits[i];
+			code = Deflate_LenCode(len);
+			Deflate_PushLit(state, code + 257);
+			Deflate_PushBits(state, len + MIN_MATCH_LEN - len_base[code], len_bits[code]);
+			Deflate_FlushBits(state);
+
+			code = Deflate_DistCode(dist);
+			Deflate_PushDist(state, blk, code);
+			Deflate_FlushBits(state);
+			Deflate_PushBits(state, dist - dist_base[code], dist_bits[code]);
+			Deflate_FlushBits(state);
+		}
+
+		/* leave room for a few bytes and literals at end */
+		if (state->AvailOut < 20 && (res = Deflate_FlushOutput(state))) return res;
+	}
+
+	/* Write huffman encoded "literal 256" to terminate symbols */
+	Deflate_PushLit(state, 256);
 	Deflate_FlushBits(state);
+	return 0;
+}
+
+/* Writes out the current block, using whichever of stored/fixed/dynamic huffman block types is smallest */
+static cc_result Deflate_WriteBlock(struct DeflateBlock* blk, cc_bool final) {
+	struct DeflateState* state = blk->state;
+	cc_uint8 lens[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS];
+	cc_uint8 lensSyms[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS];
+	cc_uint8 lensExtra[DEFLATE_MAX_LITS + DEFLATE_MAX_DISTS];
+	cc_uint16 codeFreqs[INFLATE_MAX_CODELENS] = { 0 };
+	cc_uint8 codeLens[INFLATE_MAX_CODELENS];
+	cc_uint16 codeCodewords[INFLATE_MAX_CODELENS];
+	cc_uint8 codeBitlens[INFLATE_MAX_CODELENS];
+	static const cc_uint8 code_bits[3] = { 2, 3, 7 };
+
+	cc_uint32 dynamicBits, fixedBits, storedBits;
+	int numLits, numDists, numCodes, numLens;
+	int i, sym;
+	cc_result res;
+
+	blk->LitsFreqs[256] = 1; /* End of block */
+	Deflate_BuildLengths(blk->LitsFreqs,  DEFLATE_MAX_LITS,  15, lens);
+	Deflate_BuildLengths(blk->DistsFreqs, DEFLATE_MAX_DISTS, 15, lens + DEFLATE_MAX_LITS);
+
+	/* Trailing unused codewords don't need to be written out */
+	for (numLits  = DEFLATE_MAX_LITS;  numLits  > 257 && !lens[numLits - 1]; numLits--) { }
+	for (numDists = DEFLATE_MAX_DISTS; numDists > 1   && !lens[DEFLATE_MAX_LITS + numDists - 1]; numDists--) { }
+	Mem_Move(lens + numLits, lens + DEFLATE_MAX_LITS, numDists);
+
+	numLens = Deflate_EncodeLengths(lens, numLits + numDists, lensSyms, lensExtra);
+	for (i = 0; i < numLens; i++) codeFreqs[lensSyms[i]]++;
+	Deflate_BuildLengths(codeFreqs, INFLATE_MAX_CODELENS, DEFLATE_MAX_CODEBITS, codeLens);
+	for (numCodes = INFLATE_MAX_CODELENS; numCodes > 4 && !codeLens[codelens_order[numCodes - 1]]; numCodes--) { }
+
+	/* Calculate the size of each possible block type */
+	dynamicBits = 3 + 5 + 5 + 4 + 3 * numCodes;
+	for (i = 0; i < numLens; i++) {
+		sym = lensSyms[i];
+		dynamicBits += codeLens[sym] + (sym >= 16 ? code_bits[sym - 16] : 0);
+	}
+	dynamicBits += Deflate_DataBits(blk, lens, lens + numLits);
+	fixedBits    = 3 + Deflate_DataBits(blk, fixed_lits, fixed_dists);
+	/* Uncompressed data for stored blocks may no longer be in the input buffer */
+	storedBits   = blk->BlockStart >= 0 ? 3 + 7 + 32 + blk->BlockLen * 8 : Int32_MaxValue;
+
+	if (storedBits <= fixedBits && storedBits <= dynamicBits) {
+		Deflate_PushBits(state, final, 3); /* block type STORED */
+		res = Deflate_WriteStored(blk);
+	} else if (fixedBits <= dynamicBits) {
+		Deflate_PushBits(state, final | (1 << 1), 3); /* block type FIXED */
+		Deflate_BuildTable(fixed_lits,  INFLATE_MAX_LITS,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(fixed_dists, INFLATE_MAX_DISTS, blk->DistsCodewords, blk->DistsLens);
+		res = Deflate_WriteSymbols(blk);
+	} else {
+		Deflate_PushBits(state, final | (2 << 1), 3); /* block type DYNAMIC */
+		Deflate_PushBits(state, numLits  - 257, 5);
+		Deflate_PushBits(state, numDists - 1,   5);
+		Deflate_PushBits(state, numCodes - 4,   4);
+		Deflate_FlushBits(state);
+
+		for (i = 0; i < numCodes; i++) {
+			Deflate_PushBits(state, codeLens[codelens_order[i]], 3);
+			Deflate_FlushBits(state);
+		}
+
+		Deflate_BuildTable(codeLens, INFLATE_MAX_CODELENS, codeCodewords, codeBitlens);
+		for (i = 0; i < numLens; i++) {
+			sym = lensSyms[i];
+			Deflate_PushBits(state, codeCodewords[sym], codeBitlens[sym]);
+			if (sym >= 16) { Deflate_PushBits(state, lensExtra[i], code_bits[sym - 16]); }
+			Deflate_FlushBits(state);
+			if (state->AvailOut < 20 && (res = Deflate_FlushOutput(state))) return res;
+		}
+
+		Deflate_BuildTable(lens,           numLits,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(lens + numLits, numDists, blk->DistsCodewords, blk->DistsLens);
+		res = Deflate_WriteSymbols(blk);
+	}
+
+	/* Start next block */
+	Mem_Set(blk->LitsFreqs,  0, sizeof(blk->LitsFreqs));
+	Mem_Set(blk->DistsFreqs, 0, sizeof(blk->DistsFreqs));
+	blk->NumSyms     = 0;
+	blk->BlockStart += blk->BlockLen;
+	blk->BlockLen    = 0;
+	return res;
 }
 
 /* Moves "current block" to "previous block", adjusting state if needed. */
-static void Deflate_MoveBlock(struct DeflateState* state) {
+static void Deflate_MoveBlock(struct DeflateBlock* blk) {
+	struct DeflateState* state = blk->state;
 	int i;
 	Mem_Copy(state->Input, state->Input + DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
 	state->InputPosition = DEFLATE_BLOCK_SIZE;
+	blk->BlockStart      -= DEFLATE_BLOCK_SIZE;
 
 	/* adjust hash table offsets, removing offsets that are no longer in data at all */
 	for (i = 0; i < Array_Elems(state->Head); i++) {
@@ -867,21 +1211,23 @@ static void Deflate_MoveBlock(struct DeflateState* state) {
 	}
 }
 
+/* Inserts the 3 bytes starting at the given position into the hash chains */
+#define Deflate_Insert(state, input, pos) \
+	hash = Deflate_Hash(&input[pos]);\
+	state->Prev[pos]  = state->Head[hash];\
+	state->Head[hash] = pos;
+
 /* Compresses current block of data */
-static cc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
-	cc_uint32 hash, nextHash;
+static cc_result Deflate_FlushBlock(struct DeflateBlock* blk, int len) {
+	struct DeflateState* state = blk->state;
+	const struct DeflateLevel* level = &deflate_levels[blk->Level];
+	cc_uint32 hash;
 	int bestLen, maxLen, matchLen, depth;
-	int bestPos, pos, nextPos;
-	cc_uint16 oldHead;
+	int bestPos, pos, nextPos, i;
 	cc_uint8* input;
 	cc_uint8* cur;
 	cc_result res;
 
-	if (!state->WroteHeader) {
-		state->WroteHeader = true;
-		Deflate_PushBits(state, 3, 3); /* final block TRUE, block type FIXED */
-	}
-
 	/* Based off descriptions from http://www.gzip.org/algorithm.txt and
 	https://github.com/nothings/stb/blob/master/stb_image_write.h */
 	input = state->Input;
@@ -897,71 +1243,88 @@ static cc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
 		bestPos = 0;
 
 		/* Find longest match starting at this byte */
-		/* Only explore up to 5 previous matches, to avoid slow performance */
-		/* (i.e prefer quickly saving maps/screenshots to completely optimal filesize) */
+		/* Number of previous matches explored depends on compression level */
+		/* (i.e to trade off quickly saving maps/screenshots vs optimal filesize) */
 		pos = state->Head[hash];
-		for (depth = 0; pos != 0 && depth < 5; depth++) {
-			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
-			if (matchLen > bestLen) { bestLen = matchLen; bestPos = pos; }
+		for (depth = 0; pos != 0 && depth < level->maxChain; depth++) {
+			/* Can only be a longer match if the byte after the current best match also matches */
+			if (input[pos + bestLen] == cur[bestLen]) {
+				matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
+				if (matchLen > bestLen) { 
+					bestLen = matchLen; bestPos = pos; 
+					if (matchLen >= level->niceLen || matchLen == maxLen) break;
+				}
+			}
 			pos = state->Prev[pos];
 		}
 
 		/* Insert this entry into the hash chain */
 		pos = (int)(cur - input);
-		oldHead = state->Head[hash];
+		state->Prev[pos]  = state->Head[hash];
 		state->Head[hash] = pos;
-		state->Prev[pos]  = oldHead;
+		if (bestLen == MIN_MATCH_LEN && pos - bestPos > DEFLATE_TOO_FAR) bestPos = 0;
 
 		/* Lazy evaluation: Find longest match starting at next byte */
 		/* If that's longer than the longest match at current byte, throwaway this match */
-		if (bestPos) {
-			nextHash = Deflate_Hash(cur + 1);
-			nextPos  = state->Head[nextHash];
-			maxLen   = min(len - 1, MAX_MATCH_LEN);
-
-			for (depth = 0; nextPos != 0 && depth < 5; depth++) {
-				matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
-				if (matchLen > bestLen) { bestPos = 0; break; }
+		if (bestPos && bestLen < level->lazyLen) {
+			nextPos = state->Head[Deflate_Hash(cur + 1)];
+			maxLen  = min(len - 1, MAX_MATCH_LEN);
+
+			for (depth = 0; bestLen < maxLen && nextPos != 0 && depth < level->maxChain; depth++) {
+				if (input[nextPos + bestLen] == cur[1 + bestLen]) {
+					matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
+					if (matchLen > bestLen) { bestPos = 0; break; }
+				}
 				nextPos = state->Prev[nextPos];
 			}
 		}
 
 		if (bestPos) {
-			Deflate_LenDist(state, bestLen, pos - bestPos);
+			Deflate_LenDist(blk, bestLen, pos - bestPos);
+			/* Also insert the rest of the match, so later data can match against it */
+			for (i = 1; i < bestLen && i < len - 2; i++) { 
+				Deflate_Insert(state, input, pos + i); 
+			}
 			len -= bestLen; cur += bestLen;
 		} else {
-			Deflate_Lit(state, *cur);
+			Deflate_Lit(blk, *cur);
 			len--; cur++;
 		}
 
-		/* leave room for a few bytes and literals at end */
-		if (state->AvailOut >= 20) continue;
-		res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-		state->NextOut  = state->Output;
-		state->AvailOut = DEFLATE_OUT_SIZE;
-		if (res) return res;
+		if (blk->NumSyms < DEFLATE_MAX_SYMS) continue;
+		if ((res = Deflate_WriteBlock(blk, false))) return res;
 	}
 
 	/* literals for last few bytes */
 	while (len > 0) {
-		Deflate_Lit(state, *cur);
+		Deflate_Lit(blk, *cur);
 		len--; cur++;
+
+		if (blk->NumSyms < DEFLATE_MAX_SYMS) continue;
+		if ((res = Deflate_WriteBlock(blk, false))) return res;
 	}
+	return 0;
+}
 
-	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-	state->NextOut  = state->Output;
-	state->AvailOut = DEFLATE_OUT_SIZE;
+#define Deflate_Block(stream) ((struct DeflateBlock*)(stream)->meta.inflate)
 
-	Deflate_MoveBlock(state);
+/* Frees block state, since the stream can't be written to anymore after an error or being closed */
+/* NOTE: Callers usually don't close the stream after a failed write, so this can't be left to Close */
+static cc_result Deflate_EndStream(struct Stream* stream, cc_result res) {
+	Mem_Free(stream->meta.inflate);
+	stream->meta.inflate = NULL;
+	Stream_Init(stream);
 	return res;
 }
 
 /* Adds data to buffered output data, flushing if needed */
 static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 total, cc_uint32* modified) {
+	struct DeflateBlock* blk;
 	struct DeflateState* state;
 	cc_result res;
 
-	state = (struct DeflateState*)stream->meta.inflate;
+	blk   = Deflate_Block(stream);
+	state = blk->state;
 	*modified = 0;
 
 	while (total > 0) {
@@ -978,8 +1341,9 @@ static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data
 		data += len;
 
 		if (state->InputPosition == DEFLATE_BUFFER_SIZE) {
-			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE);
-			if (res) return res;
+			res = Deflate_FlushBlock(blk, DEFLATE_BLOCK_SIZE);
+			if (res) return Deflate_EndStream(stream, res);
+			Deflate_MoveBlock(blk);
 		}
 	}
 	return 0;
@@ -987,49 +1351,43 @@ static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data
 
 /* Flushes any buffered data, then writes terminating symbol */
 static cc_result Deflate_StreamClose(struct Stream* stream) {
+	struct DeflateBlock* blk;
 	struct DeflateState* state;
 	cc_result res;
 
-	state = (struct DeflateState*)stream->meta.inflate;
-	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE);
-	if (res) return res;
-
-	/* Write huffman encoded "literal 256" to terminate symbols */
-	Deflate_PushLit(state, 256);
-	Deflate_FlushBits(state);
+	blk   = Deflate_Block(stream);
+	state = blk->state;
+	res   = Deflate_FlushBlock(blk, state->InputPosition - DEFLATE_BLOCK_SIZE);
+	if (res) return Deflate_EndStream(stream, res);
+	res   = Deflate_WriteBlock(blk, true);
+	if (res) return Deflate_EndStream(stream, res);
 
 	/* In case last byte still has a few extra bits */
 	if (state->NumBits) {
 		while (state->NumBits < 8) { Deflate_PushBits(state, 0, 1); }
 		Deflate_FlushBits(state);
 	}
-
-	return Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	return Deflate_EndStream(stream, Deflate_FlushOutput(state));
 }
 
-/* Constructs a huffman encoding table (for values to codewords) */
-static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
-	int i, j, offset, codeword;
-	struct HuffmanTable table;
+static cc_result Deflate_NoMemWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 total, cc_uint32* modified) {
+	return ERR_OUT_OF_MEMORY;
+}
+static cc_result Deflate_NoMemClose(struct Stream* stream) { return ERR_OUT_OF_MEMORY; }
 
-	/* NOTE: Can ignore since lens table is not user controlled */
-	(void)Huffman_Build(&table, lens, count);
-	for (i = 0; i < INFLATE_MAX_BITS; i++) {
-		if (!table.endCodewords[i]) continue;
-		count = table.endCodewords[i] - table.firstCodewords[i];
+static cc_bool Deflate_InitStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying, int level) {
+	struct DeflateBlock* blk;
+	Stream_Init(stream);
 
-		for (j = 0; j < count; j++) {
-			offset   = table.values[table.firstOffsets[i] + j];
-			codeword = table.firstCodewords[i] + j;
-			bitlens[offset]   = i;
-			codewords[offset] = Huffman_ReverseBits(codeword, i);
-		}
+	blk = (struct DeflateBlock*)Mem_TryAllocCleared(1, sizeof(struct DeflateBlock));
+	if (!blk) {
+		stream->meta.inflate = NULL;
+		stream->Write = Deflate_NoMemWrite;
+		stream->Close = Deflate_NoMemClose;
+		return false;
 	}
-}
 
-void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
-	Stream_Init(stream);
-	stream->meta.inflate = state;
+	stream->meta.inflate = blk;
 	stream->Write = Deflate_StreamWrite;
 	stream->Close = Deflate_StreamClose;
 
@@ -1045,7 +1403,19 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 
 	Mem_Set(state->Head, 0, sizeof(state->Head));
 	Mem_Set(state->Prev, 0, sizeof(state->Prev));
-	Deflate_BuildTable(fixed_lits, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
+
+	blk->state      = state;
+	blk->Level      = max(DEFLATE_LEVEL_HUFFMAN, min(level, DEFLATE_LEVEL_BEST));
+	blk->BlockStart = DEFLATE_BLOCK_SIZE;
+	return true;
+}
+
+void Deflate_MakeStreamLevel(struct Stream* stream, struct DeflateState* state, struct Stream* underlying, int level) {
+	Deflate_InitStream(stream, state, underlying, level);
+}
+
+void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
+	Deflate_MakeStreamLevel(stream, state, underlying, DEFLATE_LEVEL_DEFAULT);
 }
 
 
@@ -1053,7 +1423,7 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 *-----------------------------------------------------GZip (compress)-----------------------------------------------------*
 *#########################################################################################################################*/
 static cc_result GZip_StreamClose(struct Stream* stream) {
-	struct GZipState* state = (struct GZipState*)stream->meta.inflate;
+	struct GZipState* state = (struct GZipState*)Deflate_Block(stream)->state;
 	cc_uint8 data[8];
 	cc_result res;
 
@@ -1064,43 +1434,44 @@ static cc_result GZip_StreamClose(struct Stream* stream) {
 }
 
 static cc_result GZip_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
-	struct GZipState* state = (struct GZipState*)stream->meta.inflate;
-	cc_uint32 i, crc32 = state->Crc32;
+	struct GZipState* state = (struct GZipState*)Deflate_Block(stream)->state;
 	state->Size += count;
-
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
-	}
-
-	state->Crc32 = crc32;
+	state->Crc32 = Utils_UpdateCRC32(state->Crc32, data, count);
 	return Deflate_StreamWrite(stream, data, count, modified);
 }
 
 static cc_result GZip_StreamWriteFirst(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
-	static cc_uint8 header[10] = { 0x1F, 0x8B, 0x08 }; /* GZip header */
-	struct GZipState* state = (struct GZipState*)stream->meta.inflate;
+	cc_uint8 header[10] = { 0x1F, 0x8B, 0x08 }; /* GZip header */
+	struct DeflateBlock* blk = Deflate_Block(stream);
 	cc_result res;
 
-	if ((res = Stream_Write(state->Base.Dest, header, sizeof(header)))) return res;
+	/* Extra flags: 2 = best compression, 4 = fastest compression */
+	if (blk->Level == DEFLATE_LEVEL_BEST)    header[8] = 2;
+	if (blk->Level == DEFLATE_LEVEL_FASTEST) header[8] = 4;
+
+	if ((res = Stream_Write(blk->state->Dest, header, sizeof(header)))) return Deflate_EndStream(stream, res);
 	stream->Write = GZip_StreamWrite;
 	return GZip_StreamWrite(stream, data, count, modified);
 }
 
-void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stream* underlying) {
-	Deflate_MakeStream(stream, &state->Base, underlying);
+void GZip_MakeStreamLevel(struct Stream* stream, struct GZipState* state, struct Stream* underlying, int level) {
+	if (!Deflate_InitStream(stream, &state->Base, underlying, level)) return;
 	state->Crc32  = 0xFFFFFFFFUL;
 	state->Size   = 0;
 	stream->Write = GZip_StreamWriteFirst;
 	stream->Close = GZip_StreamClose;
 }
 
+void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stream* underlying) {
+	GZip_MakeStreamLevel(stream, state, underlying, DEFLATE_LEVEL_DEFAULT);
+}
+
 
 /*########################################################################################################################*
 *-----------------------------------------------------ZLib (compress)-----------------------------------------------------*
 *#########################################################################################################################*/
 static cc_result ZLib_StreamClose(struct Stream* stream) {
-	struct ZLibState* state = (struct ZLibState*)stream->meta.inflate;
+	struct ZLibState* state = (struct ZLibState*)Deflate_Block(stream)->state;
 	cc_uint8 data[4];
 	cc_result res;
 
@@ -1110,7 +1481,7 @@ static cc_result ZLib_StreamClose(struct Stream* stream) {
 }
 
 static cc_result ZLib_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
-	struct ZLibState* state = (struct ZLibState*)stream->meta.inflate;
+	struct ZLibState* state = (struct ZLibState*)Deflate_Block(stream)->state;
 	cc_uint32 i, adler32 = state->Adler32;
 	cc_uint32 s1 = adler32 & 0xFFFF, s2 = (adler32 >> 16) & 0xFFFF;
 
@@ -1126,22 +1497,31 @@ static cc_result ZLib_StreamWrite(struct Stream* stream, const cc_uint8* data, c
 }
 
 static cc_result ZLib_StreamWriteFirst(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
-	static cc_uint8 header[2] = { 0x78, 0x9C }; /* ZLib header */
-	struct ZLibState* state = (struct ZLibState*)stream->meta.inflate;
+	/* Second byte indicates fastest, fast, default or best compression level */
+	static const cc_uint8 levels[4] = { 0x01, 0x5E, 0x9C, 0xDA };
+	cc_uint8 header[2] = { 0x78 }; /* ZLib header */
+	struct DeflateBlock* blk = Deflate_Block(stream);
+	int level = blk->Level;
 	cc_result res;
 
-	if ((res = Stream_Write(state->Base.Dest, header, sizeof(header)))) return res;
+	header[1] = levels[level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3];
+
+	if ((res = Stream_Write(blk->state->Dest, header, sizeof(header)))) return Deflate_EndStream(stream, res);
 	stream->Write = ZLib_StreamWrite;
 	return ZLib_StreamWrite(stream, data, count, modified);
 }
 
-void ZLib_MakeStream(struct Stream* stream, struct ZLibState* state, struct Stream* underlying) {
-	Deflate_MakeStream(stream, &state->Base, underlying);
+void ZLib_MakeStreamLevel(struct Stream* stream, struct ZLibState* state, struct Stream* underlying, int level) {
+	if (!Deflate_InitStream(stream, &state->Base, underlying, level)) return;
 	state->Adler32 = 1;
 	stream->Write = ZLib_StreamWriteFirst;
 	stream->Close = ZLib_StreamClose;
 }
 
+void ZLib_MakeStream(struct Stream* stream, struct ZLibState* state, struct Stream* underlying) {
+	ZLib_MakeStreamLevel(stream, state, underlying, DEFLATE_LEVEL_DEFAULT);
+}
+
 
 /*########################################################################################################################*
 *--------------------------------------------------------ZipReader--------------------------------------------------------*
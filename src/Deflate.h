@@ -89,6 +89,13 @@ CC_API void Inflate_MakeStream2(struct Stream* stream, struct InflateState* stat
 #define DEFLATE_OUT_SIZE 8192
 #define DEFLATE_HASH_SIZE 0x1000UL
 #define DEFLATE_HASH_MASK 0x0FFFUL
+
+/* Compression levels, trading off compression speed for compressed size */
+#define DEFLATE_LEVEL_HUFFMAN 0 /* Only huffman coding, without searching for repeated data */
+#define DEFLATE_LEVEL_FASTEST 1
+#define DEFLATE_LEVEL_DEFAULT 6
+#define DEFLATE_LEVEL_BEST    9
+
 struct DeflateState {
 	cc_uint32 Bits;         /* Holds bits across byte boundaries */
 	cc_uint32 NumBits;      /* Number of bits in Bits buffer */
@@ -112,18 +119,25 @@ struct DeflateState {
 /* Compresses input data using DEFLATE, then writes compressed output to another stream. Write only stream. */
 /* DEFLATE compression is pure compressed data, there is no header or footer. */
 CC_API void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying);
+/* Same as Deflate_MakeStream, but compresses using the given level instead of DEFLATE_LEVEL_DEFAULT */
+/* level is from DEFLATE_LEVEL_HUFFMAN (fastest) to DEFLATE_LEVEL_BEST (smallest output) */
+CC_API void Deflate_MakeStreamLevel(struct Stream* stream, struct DeflateState* state, struct Stream* underlying, int level);
 
 struct GZipState { struct DeflateState Base; cc_uint32 Crc32, Size; };
 /* Compresses input data using GZIP, then writes compressed output to another stream. Write only stream. */
 /* GZIP compression is GZIP header, followed by DEFLATE compressed data, followed by GZIP footer. */
 CC_API  void GZip_MakeStream(      struct Stream* stream, struct GZipState* state, struct Stream* underlying);
 typedef void (*FP_GZip_MakeStream)(struct Stream* stream, struct GZipState* state, struct Stream* underlying);
+/* Same as GZip_MakeStream, but compresses using the given level instead of DEFLATE_LEVEL_DEFAULT */
+CC_API void GZip_MakeStreamLevel(struct Stream* stream, struct GZipState* state, struct Stream* underlying, int level);
 
 struct ZLibState { struct DeflateState Base; cc_uint32 Adler32; };
 /* Compresses input data using ZLIB, then writes compressed output to another stream. Write only stream. */
 /* ZLIB compression is ZLIB header, followed by DEFLATE compressed data, followed by ZLIB footer. */
 CC_API  void ZLib_MakeStream(      struct Stream* stream, struct ZLibState* state, struct Stream* underlying);
 typedef void (*FP_ZLib_MakeStream)(struct Stream* stream, struct ZLibState* state, struct Stream* underlying);
+/* Same as ZLib_MakeStream, but compresses using the given level instead of DEFLATE_LEVEL_DEFAULT */
+CC_API void ZLib_MakeStreamLevel(struct Stream* stream, struct ZLibState* state, struct Stream* underlying, int level);
 
 /* Minimal data needed to describe an entry in a .zip archive */
 struct ZipEntry { cc_uint32 CompressedSize, UncompressedSize, LocalHeaderOffset; };
@@ -4,20 +4,20 @@
 #include "Graphics.h"
 struct _DrawerData Drawer;
 
-void Drawer_XMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+void DrawerData_XMin(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
 	struct VertexTextured* v = *vertices;
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = Drawer.MinBB.z;
-	float u2 = (count - 1) + Drawer.MaxBB.z * UV2_Scale;
-	float v1 = vOrigin + Drawer.MaxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + Drawer.MinBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	float u1 = d->MinBB.z;
+	float u2 = (count - 1) + d->MaxBB.z * UV2_Scale;
+	float v1 = vOrigin + d->MaxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + d->MinBB.y * Atlas1D.InvTileSize * UV2_Scale;
 
-	float x1 = Drawer.X1;
-	float y1 = Drawer.Y1, y2 = Drawer.Y2;
-	float z1 = Drawer.Z1, z2 = Drawer.Z2 + (count - 1);
+	float x1 = d->X1;
+	float y1 = d->Y1, y2 = d->Y2;
+	float z1 = d->Z1, z2 = d->Z2 + (count - 1);
 
-	if (Drawer.Tinted) col = PackedCol_Tint(col, Drawer.TintCol);
+	if (d->Tinted) col = PackedCol_Tint(col, d->TintCol);
 
 	v->x = x1; v->y = y2; v->z = z2; v->Col = col; v->U = u2; v->V = v1; v++;
 	v->x = x1; v->y = y2; v->z = z1; v->Col = col; v->U = u1; v->V = v1; v++;
@@ -26,20 +26,20 @@ void Drawer_XMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextu
 	*vertices = v;
 }
 
-void Drawer_XMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+void DrawerData_XMax(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
 	struct VertexTextured* v = *vertices;
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = (count - Drawer.MinBB.z);
-	float u2 = (1 - Drawer.MaxBB.z) * UV2_Scale;
-	float v1 = vOrigin + Drawer.MaxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + Drawer.MinBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	float u1 = (count - d->MinBB.z);
+	float u2 = (1 - d->MaxBB.z) * UV2_Scale;
+	float v1 = vOrigin + d->MaxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + d->MinBB.y * Atlas1D.InvTileSize * UV2_Scale;
 
-	float x2 = Drawer.X2;
-	float y1 = Drawer.Y1, y2 = Drawer.Y2;
-	float z1 = Drawer.Z1, z2 = Drawer.Z2 + (count - 1);
+	float x2 = d->X2;
+	float y1 = d->Y1, y2 = d->Y2;
+	float z1 = d->Z1, z2 = d->Z2 + (count - 1);
 
-	if (Drawer.Tinted) col = PackedCol_Tint(col, Drawer.TintCol);
+	if (d->Tinted) col = PackedCol_Tint(col, d->TintCol);
 
 	v->x = x2; v->y = y2; v->z = z1; v->Col = col; v->U = u1; v->V = v1; v++;
 	v->x = x2; v->y = y2; v->z = z2; v->Col = col; v->U = u2; v->V = v1; v++;
@@ -48,20 +48,20 @@ void Drawer_XMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextu
 	*vertices = v;
 }
 
-void Drawer_ZMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+void DrawerData_ZMin(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
 	struct VertexTextured* v = *vertices;
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = (count - Drawer.MinBB.x);
-	float u2 = (1 - Drawer.MaxBB.x) * UV2_Scale;
-	float v1 = vOrigin + Drawer.MaxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + Drawer.MinBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	float u1 = (count - d->MinBB.x);
+	float u2 = (1 - d->MaxBB.x) * UV2_Scale;
+	float v1 = vOrigin + d->MaxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + d->MinBB.y * Atlas1D.InvTileSize * UV2_Scale;
 
-	float x1 = Drawer.X1, x2 = Drawer.X2 + (count - 1);
-	float y1 = Drawer.Y1, y2 = Drawer.Y2;
-	float z1 = Drawer.Z1;
+	float x1 = d->X1, x2 = d->X2 + (count - 1);
+	float y1 = d->Y1, y2 = d->Y2;
+	float z1 = d->Z1;
 
-	if (Drawer.Tinted) col = PackedCol_Tint(col, Drawer.TintCol);
+	if (d->Tinted) col = PackedCol_Tint(col, d->TintCol);
 
 	v->x = x2; v->y = y1; v->z = z1; v->Col = col; v->U = u2; v->V = v2; v++;
 	v->x = x1; v->y = y1; v->z = z1; v->Col = col; v->U = u1; v->V = v2; v++;
@@ -70,20 +70,20 @@ void Drawer_ZMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextu
 	*vertices = v;
 }
 
-void Drawer_ZMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+void DrawerData_ZMax(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
 	struct VertexTextured* v = *vertices;
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = Drawer.MinBB.x;
-	float u2 = (count - 1) + Drawer.MaxBB.x * UV2_Scale;
-	float v1 = vOrigin + Drawer.MaxBB.y * Atlas1D.InvTileSize;
-	float v2 = vOrigin + Drawer.MinBB.y * Atlas1D.InvTileSize * UV2_Scale;
+	float u1 = d->MinBB.x;
+	float u2 = (count - 1) + d->MaxBB.x * UV2_Scale;
+	float v1 = vOrigin + d->MaxBB.y * Atlas1D.InvTileSize;
+	float v2 = vOrigin + d->MinBB.y * Atlas1D.InvTileSize * UV2_Scale;
 
-	float x1 = Drawer.X1, x2 = Drawer.X2 + (count - 1);
-	float y1 = Drawer.Y1, y2 = Drawer.Y2;
-	float z2 = Drawer.Z2;
+	float x1 = d->X1, x2 = d->X2 + (count - 1);
+	float y1 = d->Y1, y2 = d->Y2;
+	float z2 = d->Z2;
 
-	if (Drawer.Tinted) col = PackedCol_Tint(col, Drawer.TintCol);
+	if (d->Tinted) col = PackedCol_Tint(col, d->TintCol);
 
 	v->x = x2; v->y = y2; v->z = z2; v->Col = col; v->U = u2; v->V = v1; v++;
 	v->x = x1; v->y = y2; v->z = z2; v->Col = col; v->U = u1; v->V = v1; v++;
@@ -92,20 +92,20 @@ void Drawer_ZMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextu
 	*vertices = v;
 }
 
-void Drawer_YMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+void DrawerData_YMin(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
 	struct VertexTextured* v = *vertices;
 
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
-	float u1 = Drawer.MinBB.x;
-	float u2 = (count - 1) + Drawer.MaxBB.x * UV2_Scale;
-	float v1 = vOrigin + Drawer.MinBB.z * Atlas1D.InvTileSize;
-	float v2 = vOrigin + Drawer.MaxBB.z * Atlas1D.InvTileSize * UV2_Scale;
+	float u1 = d->MinBB.x;
+	float u2 = (count - 1) + d->MaxBB.x * UV2_Scale;
+	float v1 = vOrigin + d->MinBB.z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + d->MaxBB.z * Atlas1D.InvTileSize * UV2_Scale;
 
-	float x1 = Drawer.X1, x2 = Drawer.X2 + (count - 1);
-	float y1 = Drawer.Y1;
-	float z1 = Drawer.Z1, z2 = Drawer.Z2;
+	float x1 = d->X1, x2 = d->X2 + (count - 1);
+	float y1 = d->Y1;
+	float z1 = d->Z1, z2 = d->Z2;
 
-	if (Drawer.Tinted) col = PackedCol_Tint(col, Drawer.TintCol);
+	if (d->Tinted) col = PackedCol_Tint(col, d->TintCol);
 
 	v->x = x2; v->y = y1; v->z = z2; v->Col = col; v->U = u2; v->V = v2; v++;
 	v->x = x1; v->y = y1; v->z = z2; v->Col = col; v->U = u1; v->V = v2; v++;
@@ -114,20 +114,20 @@ void Drawer_YMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextu
 	*vertices = v;
 }
 
-void Drawer_YMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+void DrawerData_YMax(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
 	struct VertexTextured* v = *vertices;
 	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
 
-	float u1 = Drawer.MinBB.x;
-	float u2 = (count - 1) + Drawer.MaxBB.x * UV2_Scale;
-	float v1 = vOrigin + Drawer.MinBB.z * Atlas1D.InvTileSize;
-	float v2 = vOrigin + Drawer.MaxBB.z * Atlas1D.InvTileSize * UV2_Scale;
+	float u1 = d->MinBB.x;
+	float u2 = (count - 1) + d->MaxBB.x * UV2_Scale;
+	float v1 = vOrigin + d->MinBB.z * Atlas1D.InvTileSize;
+	float v2 = vOrigin + d->MaxBB.z * Atlas1D.InvTileSize * UV2_Scale;
 
-	float x1 = Drawer.X1, x2 = Drawer.X2 + (count - 1);
-	float y2 = Drawer.Y2;
-	float z1 = Drawer.Z1, z2 = Drawer.Z2;
+	float x1 = d->X1, x2 = d->X2 + (count - 1);
+	float y2 = d->Y2;
+	float z1 = d->Z1, z2 = d->Z2;
 
-	if (Drawer.Tinted) col = PackedCol_Tint(col, Drawer.TintCol);
+	if (d->Tinted) col = PackedCol_Tint(col, d->TintCol);
 
 	v->x = x2; v->y = y2; v->z = z1; v->Col = col; v->U = u2; v->V = v1; v++;
 	v->x = x1; v->y = y2; v->z = z1; v->Col = col; v->U = u1; v->V = v1; v++;
@@ -135,3 +135,22 @@ void Drawer_YMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextu
 	v->x = x2; v->y = y2; v->z = z2; v->Col = col; v->U = u2; v->V = v2; v++;
 	*vertices = v;
 }
+
+void Drawer_XMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+	DrawerData_XMin(&Drawer, count, col, texLoc, vertices);
+}
+void Drawer_XMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+	DrawerData_XMax(&Drawer, count, col, texLoc, vertices);
+}
+void Drawer_ZMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+	DrawerData_ZMin(&Drawer, count, col, texLoc, vertices);
+}
+void Drawer_ZMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+	DrawerData_ZMax(&Drawer, count, col, texLoc, vertices);
+}
+void Drawer_YMin(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+	DrawerData_YMin(&Drawer, count, col, texLoc, vertices);
+}
+void Drawer_YMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices) {
+	DrawerData_YMax(&Drawer, count, col, texLoc, vertices);
+}
@@ -38,5 +38,14 @@ CC_API void Drawer_YMin(int count, PackedCol col, TextureLoc texLoc, struct Vert
 /* Draws maximum Y face of the cuboid. (i.e. at Y2) */
 CC_API void Drawer_YMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
 
+/* Variants of the above functions that use the given state instead of the global Drawer state. */
+/* NOTE: These are used by the chunk mesh builder, which may draw cuboids on multiple threads at once. */
+void DrawerData_XMin(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_XMax(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_ZMin(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_ZMax(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_YMin(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void DrawerData_YMax(const struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+
 CC_END_HEADER
 #endif
@@ -205,6 +205,8 @@ cc_bool Entity_TouchesAnyWater(struct Entity* e) {
 /*########################################################################################################################*
 *------------------------------------------------------Entity skins-------------------------------------------------------*
 *#########################################################################################################################*/
+static cc_bool skins_asyncDecode;
+
 static struct Entity* Entity_FirstOtherWithSameSkinAndFetchedSkin(struct Entity* except) {
 	struct Entity* e;
 	cc_string skin, eSkin;
@@ -289,8 +291,15 @@ static void Entity_ClearHat(struct Bitmap* bmp, cc_uint8 skinType) {
 	}
 }
 
+/* Skin bitmap that has already been decoded and converted to a power of two size */
+struct DecodedSkin {
+	struct Bitmap bmp;
+	float uScale, vScale;
+	cc_uint8 skinType;
+};
+
 /* Ensures skin is a power of two size, resizing if needed. */
-static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
+static cc_result EnsurePow2Skin(struct DecodedSkin* skin, struct Bitmap* bmp) {
 	struct Bitmap scaled;
 	cc_uint32 stride;
 	int width, height;
@@ -303,8 +312,8 @@ static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
 	Bitmap_TryAllocate(&scaled, width, height);
 	if (!scaled.scan0) return ERR_OUT_OF_MEMORY;
 
-	e->uScale = (float)bmp->width  / width;
-	e->vScale = (float)bmp->height / height;
+	skin->uScale = (float)bmp->width  / width;
+	skin->vScale = (float)bmp->height / height;
 	stride = bmp->width * 4;
 
 	for (y = 0; y < bmp->height; y++) {
@@ -318,25 +327,66 @@ static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
 	return 0;
 }
 
-static cc_result ApplySkin(struct Entity* e, struct Bitmap* bmp, struct Stream* src, cc_string* skin) {
+/* Decodes a skin, then converts it to a power of two size and clears its hat if needed */
+static cc_result DecodeSkin(struct DecodedSkin* skin, struct Stream* src, cc_bool clearHat) {
+	cc_result res;
+	skin->uScale = 1.0f; skin->vScale = 1.0f;
+	if ((res = Png_Decode(&skin->bmp, src)))           return res;
+	if ((res = EnsurePow2Skin(skin, &skin->bmp)))      return res;
+	skin->skinType = Utils_CalcSkinType(&skin->bmp);
+
+	if (clearHat) Entity_ClearHat(&skin->bmp, skin->skinType);
+	return 0;
+}
+
+/* Decodes a downloaded skin on the http worker thread. On success, the request's */
+/*  data is replaced with a DecodedSkin, immediately followed by the skin's pixels */
+static cc_result DecodeSkinAsync(struct HttpRequest* req, cc_bool clearHat) {
+	struct DecodedSkin skin;
+	struct DecodedSkin* dst;
+	struct Stream mem;
+	cc_uint32 size;
 	cc_result res;
-	if ((res = Png_Decode(bmp, src))) return res;
 
+	Stream_ReadonlyMemory(&mem, req->data, req->size);
+	res = DecodeSkin(&skin, &mem, clearHat);
+	if (res) { Mem_Free(skin.bmp.scan0); return res; }
+
+	size = sizeof(struct DecodedSkin) + Bitmap_DataSize(skin.bmp.width, skin.bmp.height);
+	dst  = (struct DecodedSkin*)Mem_TryAlloc(size, 1);
+	if (!dst) { Mem_Free(skin.bmp.scan0); return ERR_OUT_OF_MEMORY; }
+
+	*dst = skin;
+	dst->bmp.scan0 = (BitmapCol*)(dst + 1);
+	Mem_Copy(dst->bmp.scan0, skin.bmp.scan0, Bitmap_DataSize(skin.bmp.width, skin.bmp.height));
+	Mem_Free(skin.bmp.scan0);
+
+	Mem_Free(req->data);
+	req->data = (cc_uint8*)dst;
+	req->size = size;
+	return 0;
+}
+
+static cc_result DecodeSkinAsync_Normal(struct HttpRequest* req) {
+	return DecodeSkinAsync(req, false);
+}
+static cc_result DecodeSkinAsync_ClearHat(struct HttpRequest* req) {
+	return DecodeSkinAsync(req, true);
+}
+
+static void ApplySkin(struct Entity* e, struct DecodedSkin* skin, cc_string* skinName) {
 	Gfx_DeleteTexture(&e->TextureId);
 	Entity_SetSkinAll(e, true);
-	if ((res = EnsurePow2Skin(e, bmp))) return res;
-	e->SkinType = Utils_CalcSkinType(bmp);
+	e->uScale   = skin->uScale;
+	e->vScale   = skin->vScale;
+	e->SkinType = skin->skinType;
 
-	if (!Gfx_CheckTextureSize(bmp->width, bmp->height, 0)) {
-		Chat_Add1("&cSkin %s is too large", skin);
+	if (!Gfx_CheckTextureSize(skin->bmp.width, skin->bmp.height, 0)) {
+		Chat_Add1("&cSkin %s is too large", skinName);
 	} else {
-		if (e->Model->flags & MODEL_FLAG_CLEAR_HAT)
-			Entity_ClearHat(bmp, e->SkinType);
-
-		e->TextureId = Gfx_CreateTexture(bmp, TEXTURE_FLAG_MANAGED, false);
+		e->TextureId = Gfx_CreateTexture(&skin->bmp, TEXTURE_FLAG_MANAGED, false);
 		Entity_SetSkinAll(e, false);
 	}
-	return 0;
 }
 
 static void LogInvalidSkin(cc_result res, const cc_string* skin, const cc_uint8* data, int size) {
@@ -355,23 +405,29 @@ static void LogInvalidSkin(cc_result res, const cc_string* skin, const cc_uint8*
 static void Entity_CheckSkin(struct Entity* e) {
 	struct Entity* first;
 	struct HttpRequest item;
+	struct DecodedSkin decoded;
+	Http_ProcessFunc process;
 	struct Stream mem;
-	struct Bitmap bmp;
 	cc_string skin;
 	cc_uint8 flags;
+	cc_bool clearHat;
 	cc_result res;
 
 	/* Don't check skin if don't have to */
 	if (!e->Model->usesSkin) return;
 	if (e->SkinFetchState == SKIN_FETCH_COMPLETED) return;
-	skin = String_FromRawArray(e->SkinRaw);
+	skin     = String_FromRawArray(e->SkinRaw);
+	clearHat = e->Model->flags & MODEL_FLAG_CLEAR_HAT;
 
 	if (!e->SkinFetchState) {
 		first = Entity_FirstOtherWithSameSkinAndFetchedSkin(e);
-		flags = e == &LocalPlayer_Instances[0].Base ? HTTP_FLAG_NOCACHE : 0;
+		flags = e == &LocalPlayer_Instances[0].Base ? HTTP_FLAG_NOCACHE : HTTP_FLAG_DISKCACHE;
 
 		if (!first) {
-			e->_skinReqID     = Http_AsyncGetSkin(&skin, flags);
+			process = NULL;
+			if (skins_asyncDecode) process = clearHat ? DecodeSkinAsync_ClearHat : DecodeSkinAsync_Normal;
+
+			e->_skinReqID     = Http_AsyncGetSkin(&skin, flags, process);
 			e->SkinFetchState = SKIN_FETCH_DOWNLOADING;
 		} else {
 			Entity_CopySkin(e, first);
@@ -384,13 +440,24 @@ static void Entity_CheckSkin(struct Entity* e) {
 
 	if (!item.success) {
 		Entity_SetSkinAll(e, true);
+	} else if (item.process) {
+		/* Skin was already decoded on the http worker thread */
+		if ((res = item.processResult)) {
+			LogInvalidSkin(res, &skin, item.data, item.size);
+			Entity_SetSkinAll(e, true);
+		} else {
+			ApplySkin(e, (struct DecodedSkin*)item.data, &skin);
+		}
 	} else {
 		Stream_ReadonlyMemory(&mem, item.data, item.size);
 
-		if ((res = ApplySkin(e, &bmp, &mem, &skin))) {
+		if ((res = DecodeSkin(&decoded, &mem, clearHat))) {
 			LogInvalidSkin(res, &skin, item.data, item.size);
+			Entity_SetSkinAll(e, true);
+		} else {
+			ApplySkin(e, &decoded, &skin);
 		}
-		Mem_Free(bmp.scan0);
+		Mem_Free(decoded.bmp.scan0);
 	}
 	HttpRequest_Free(&item);
 }
@@ -440,6 +507,254 @@ void Entity_LerpAngles(struct Entity* e, float t) {
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------------Entity grid-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Entities are bucketed by the 16x16 column of blocks their position lies in */
+#define GRID_CELL_SHIFT 4
+#define GRID_BUCKETS  256
+/* Queries needing more than this many rings of neighbouring cells just check every entity */
+#define GRID_MAX_RINGS  4
+#define GRID_MAX_COORD  (1 << 26)
+#define GRID_MASK_WORDS ((ENTITIES_MAX_COUNT + 31) / 32)
+
+/* NOTE: Links are stored as entity ID + 1, so that 0 means 'none' */
+static cc_uint16 grid_heads[GRID_BUCKETS];
+static cc_uint16 grid_next[ENTITIES_MAX_COUNT], grid_prev[ENTITIES_MAX_COUNT];
+static int grid_cellX[ENTITIES_MAX_COUNT], grid_cellZ[ENTITIES_MAX_COUNT];
+static cc_bool grid_inserted[ENTITIES_MAX_COUNT];
+static int grid_count;
+/* Largest distance from an entity's position to any corner of its picking bounds */
+/* NOTE: Only ever grows while there are entities in the grid */
+static float grid_extent;
+/* Range of cells that have contained an entity */
+static int grid_minX, grid_maxX, grid_minZ, grid_maxZ;
+
+static int Grid_Cell(float value) {
+	if (!(value > -GRID_MAX_COORD)) return -GRID_MAX_COORD >> GRID_CELL_SHIFT; /* also catches NaN */
+	if (value > GRID_MAX_COORD)     return  GRID_MAX_COORD >> GRID_CELL_SHIFT;
+	return Math_Floor(value) >> GRID_CELL_SHIFT;
+}
+
+static int Grid_Bucket(int cx, int cz) {
+	cc_uint32 hash = ((cc_uint32)cx * 0x9E3779B1U) ^ ((cc_uint32)cz * 0x85EBCA77U);
+	return hash >> 24;
+}
+
+static int Grid_Rings(void) { return (int)(grid_extent / (1 << GRID_CELL_SHIFT)) + 1; }
+
+static void Grid_Unlink(int id) {
+	int next = grid_next[id], prev = grid_prev[id];
+
+	if (prev) { grid_next[prev - 1] = next; }
+	else      { grid_heads[Grid_Bucket(grid_cellX[id], grid_cellZ[id])] = next; }
+	if (next) { grid_prev[next - 1] = prev; }
+}
+
+static void Grid_Link(int id, int cx, int cz) {
+	int bucket = Grid_Bucket(cx, cz);
+	int head   = grid_heads[bucket];
+
+	grid_cellX[id] = cx; grid_cellZ[id] = cz;
+	grid_prev[id]  = 0;  grid_next[id]  = head;
+	if (head) grid_prev[head - 1] = id + 1;
+	grid_heads[bucket] = id + 1;
+}
+
+static float Grid_CalcExtent(struct Entity* e) {
+	struct AABB* bb = &e->ModelAABB;
+	float x = max(Math_AbsF(bb->Min.x), Math_AbsF(bb->Max.x));
+	float y = max(Math_AbsF(bb->Min.y), Math_AbsF(bb->Max.y));
+	float z = max(Math_AbsF(bb->Min.z), Math_AbsF(bb->Max.z));
+	/* Covers picking bounds in any orientation */
+	return Math_SqrtF(x * x + y * y + z * z);
+}
+
+void Entities_UpdateCell(int id) {
+	struct Entity* e = Entities.List[id];
+	float extent;
+	int cx, cz;
+	if (!e) { Entities_RemoveCell(id); return; }
+
+	cx = Grid_Cell(e->Position.x);
+	cz = Grid_Cell(e->Position.z);
+	extent = Grid_CalcExtent(e);
+	if (extent > grid_extent) grid_extent = extent;
+
+	if (!grid_inserted[id]) {
+		if (!grid_count) {
+			grid_minX = cx; grid_maxX = cx;
+			grid_minZ = cz; grid_maxZ = cz;
+		}
+		grid_inserted[id] = true;
+		grid_count++;
+	} else if (grid_cellX[id] == cx && grid_cellZ[id] == cz) {
+		return;
+	} else {
+		Grid_Unlink(id);
+	}
+
+	Grid_Link(id, cx, cz);
+	grid_minX = min(grid_minX, cx); grid_maxX = max(grid_maxX, cx);
+	grid_minZ = min(grid_minZ, cz); grid_maxZ = max(grid_maxZ, cz);
+}
+
+void Entities_RemoveCell(int id) {
+	if (!grid_inserted[id]) return;
+	Grid_Unlink(id);
+	grid_inserted[id] = false;
+
+	grid_count--;
+	if (!grid_count) grid_extent = 0.0f;
+}
+
+/* Marks all entities within the given cell in the candidates mask */
+static void Grid_MarkCell(int cx, int cz, cc_uint32* mask) {
+	int id = grid_heads[Grid_Bucket(cx, cz)];
+
+	for (; id; id = grid_next[id - 1])
+	{
+		if (grid_cellX[id - 1] != cx || grid_cellZ[id - 1] != cz) continue;
+		mask[(id - 1) >> 5] |= 1U << ((id - 1) & 31);
+	}
+}
+
+/* Marks all entities within the given range of cells in the candidates mask */
+static void Grid_MarkCells(int x1, int z1, int x2, int z2, cc_uint32* mask) {
+	int id, cx, cz;
+	x1 = max(x1, grid_minX); x2 = min(x2, grid_maxX);
+	z1 = max(z1, grid_minZ); z2 = min(z2, grid_maxZ);
+	if (x1 > x2 || z1 > z2) return;
+
+	/* Cheaper to just check every entity's cell when range is large */
+	if ((cc_uint64)(x2 - x1 + 1) * (z2 - z1 + 1) > GRID_BUCKETS) {
+		for (id = 0; id < ENTITIES_MAX_COUNT; id++)
+		{
+			if (!grid_inserted[id]) continue;
+			cx = grid_cellX[id]; cz = grid_cellZ[id];
+
+			if (cx < x1 || cx > x2 || cz < z1 || cz > z2) continue;
+			mask[id >> 5] |= 1U << (id & 31);
+		}
+		return;
+	}
+
+	for (cz = z1; cz <= z2; cz++)
+		for (cx = x1; cx <= x2; cx++)
+		{
+			Grid_MarkCell(cx, cz, mask);
+		}
+}
+
+int Entities_QueryRadius(Vec3 pos, float radius, int* ids) {
+	cc_uint32 mask[GRID_MASK_WORDS] = { 0 };
+	struct Entity* e;
+	float dx, dz, maxDist = radius + grid_extent;
+	int i, id, count = 0;
+	if (!grid_count) return 0;
+
+	Grid_MarkCells(Grid_Cell(pos.x - maxDist), Grid_Cell(pos.z - maxDist),
+				   Grid_Cell(pos.x + maxDist), Grid_Cell(pos.z + maxDist), mask);
+	maxDist *= maxDist;
+
+	for (i = 0; i < GRID_MASK_WORDS; i++)
+	{
+		if (!mask[i]) continue;
+		for (id = i << 5; id < (i + 1) << 5; id++)
+		{
+			if (!(mask[i] & (1U << (id & 31)))) continue;
+			e  = Entities.List[id];
+			if (!e) continue;
+			dx = e->Position.x - pos.x; dz = e->Position.z - pos.z;
+
+			if (dx * dx + dz * dz > maxDist) continue;
+			ids[count++] = id;
+		}
+	}
+	return count;
+}
+
+/* Clips the line (origin + dir * t) to the given range along one axis */
+static cc_bool Grid_ClipLine(float origin, float dir, float min, float max, float* t0, float* t1) {
+	float a, b;
+	if (Math_AbsF(dir) < 0.000001f) return origin >= min && origin <= max;
+
+	a = (min - origin) / dir;
+	b = (max - origin) / dir;
+	if (a > b) { float tmp = a; a = b; b = tmp; }
+
+	*t0 = max(*t0, a);
+	*t1 = min(*t1, b);
+	return *t0 <= *t1;
+}
+
+int Entities_QueryLine(Vec3 origin, Vec3 dir, int* ids) {
+	cc_uint32 mask[GRID_MASK_WORDS] = { 0 };
+	float t0 = -1e30f, t1 = 1e30f, size = (float)(1 << GRID_CELL_SHIFT);
+	float tNextX, tNextZ, tDeltaX, tDeltaZ, len;
+	int i, id, count = 0, steps;
+	int r, cx, cz, endX, endZ, stepX, stepZ;
+	Vec3 start;
+	if (!grid_count) return 0;
+
+	r = Grid_Rings();
+	if (r > GRID_MAX_RINGS) {
+		Grid_MarkCells(grid_minX, grid_minZ, grid_maxX, grid_maxZ, mask);
+		goto output;
+	}
+
+	/* Only need to trace the part of the line that passes near occupied cells */
+	if (!Grid_ClipLine(origin.x, dir.x, (float)((grid_minX - r) << GRID_CELL_SHIFT),
+						(float)((grid_maxX + r + 1) << GRID_CELL_SHIFT), &t0, &t1)) return 0;
+	if (!Grid_ClipLine(origin.z, dir.z, (float)((grid_minZ - r) << GRID_CELL_SHIFT),
+						(float)((grid_maxZ + r + 1) << GRID_CELL_SHIFT), &t0, &t1)) return 0;
+
+	/* Line is vertical */
+	if (t0 == -1e30f) { t0 = 0.0f; t1 = 0.0f; }
+	start.x = origin.x + dir.x * t0;
+	start.z = origin.z + dir.z * t0;
+	len     = t1 - t0;
+
+	cx    = Grid_Cell(start.x);                 cz    = Grid_Cell(start.z);
+	endX  = Grid_Cell(origin.x + dir.x * t1);   endZ  = Grid_Cell(origin.z + dir.z * t1);
+	stepX = dir.x >= 0.0f ? 1 : -1;             stepZ = dir.z >= 0.0f ? 1 : -1;
+
+	tDeltaX = Math_AbsF(dir.x) < 0.000001f ? 1e30f : size / Math_AbsF(dir.x);
+	tDeltaZ = Math_AbsF(dir.z) < 0.000001f ? 1e30f : size / Math_AbsF(dir.z);
+	tNextX  = tDeltaX == 1e30f ? 1e30f : (((cx + (stepX > 0)) << GRID_CELL_SHIFT) - start.x) / dir.x;
+	tNextZ  = tDeltaZ == 1e30f ? 1e30f : (((cz + (stepZ > 0)) << GRID_CELL_SHIFT) - start.z) / dir.z;
+	steps   = Math_AbsI(endX - cx) + Math_AbsI(endZ - cz) + 1;
+
+	/* Walk along the cells the line passes through, also checking neighbouring */
+	/*  cells that entities may poke into. After the first cell, only the row or */
+	/*  column of neighbours newly brought into range needs to be checked */
+	Grid_MarkCells(cx - r, cz - r, cx + r, cz + r, mask);
+	for (i = 0; i < steps; i++)
+	{
+		if (tNextX < tNextZ) {
+			if (tNextX > len) break;
+			cx += stepX; tNextX += tDeltaX;
+			Grid_MarkCells(cx + stepX * r, cz - r, cx + stepX * r, cz + r, mask);
+		} else {
+			if (tNextZ > len) break;
+			cz += stepZ; tNextZ += tDeltaZ;
+			Grid_MarkCells(cx - r, cz + stepZ * r, cx + r, cz + stepZ * r, mask);
+		}
+	}
+
+output:
+	for (i = 0; i < GRID_MASK_WORDS; i++)
+	{
+		if (!mask[i]) continue;
+		for (id = i << 5; id < (i + 1) << 5; id++)
+		{
+			if (mask[i] & (1U << (id & 31))) ids[count++] = id;
+		}
+	}
+	return count;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------Entities---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -451,18 +766,23 @@ void Entities_Tick(struct ScheduledTask* task) {
 	{
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->Tick(Entities.List[i], task->interval);
+		Entities_UpdateCell(i);
 	}
 }
 
 void Entities_RenderModels(float delta, float t) {
 	int i;
 	Gfx_SetAlphaTest(true);
+	Model_BeginBatch();
 	
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++)
 	{
 		if (!Entities.List[i]) continue;
 		Entities.List[i]->VTABLE->RenderModel(Entities.List[i], delta, t);
+		Entities_UpdateCell(i);
 	}
+
+	Model_EndBatch();
 	Gfx_SetAlphaTest(false);
 }
 
@@ -491,6 +811,7 @@ void Entities_Remove(int id) {
 	Event_RaiseInt(&EntityEvents.Removed, id);
 	e->VTABLE->Despawn(e);
 	Entities.List[id] = NULL;
+	Entities_RemoveCell(id);
 
 	/* TODO: Move to EntityEvents.Removed callback instead */
 	if (id < TABLIST_MAX_NAMES && TabList_EntityLinked_Get(id)) {
@@ -505,13 +826,17 @@ int Entities_GetClosest(struct Entity* src) {
 	float closestDist = -200; /* NOTE: was previously positive infinity */
 	int targetID = -1;
 
+	int ids[ENTITIES_MAX_COUNT];
 	float t0, t1;
-	int i;
+	int i, j, count;
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) /* because we don't want to pick against local player */
+	count = Entities_QueryLine(eyePos, dir, ids);
+	for (j = 0; j < count; j++)
 	{
-		struct Entity* e = Entities.List[i];
-		if (!e || e == &Entities.CurPlayer->Base) continue;
+		struct Entity* e;
+		i = ids[j];
+		e = Entities.List[i];
+		if (!e || e == &Entities.CurPlayer->Base) continue; /* because we don't want to pick against local player */
 		if (!Intersection_RayIntersectsRotatedBox(eyePos, dir, e, &t0, &t1)) continue;
 
 		if (targetID == -1 || t0 < closestDist) {
@@ -1129,6 +1454,7 @@ static void Entities_Init(void) {
 	Entities.ShadowsMode = Options_GetEnum(OPT_ENTITY_SHADOW, SHADOW_MODE_NONE,
 		ShadowMode_Names, Array_Elems(ShadowMode_Names));
 	if (Game_ClassicMode) Entities.ShadowsMode = SHADOW_MODE_NONE;
+	skins_asyncDecode = Options_GetBool(OPT_SKIN_ASYNC_DECODE, true);
 
 	for (i = 0; i < Game_NumStates; i++)
 	{
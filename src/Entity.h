@@ -185,6 +185,21 @@ void Entities_Remove(int id);
 /* Returns -1 if there is no other entity nearby */
 int Entities_GetClosest(struct Entity* src);
 
+/* Moves the given entity to the grid cell for its current position */
+/* NOTE: Called automatically after each entity is ticked and rendered */
+void Entities_UpdateCell(int id);
+/* Removes the given entity from the grid of entity positions */
+void Entities_RemoveCell(int id);
+/* Spatial queries below output (in ascending order) the IDs of entities that may */
+/*  overlap the given region, and return how many were found. ids must have room for */
+/*  ENTITIES_MAX_COUNT entries. Callers still need to perform exact tests on each entity. */
+/* Gets entities whose picking bounds may be within the given horizontal distance */
+/* NOTE: Only the X and Z coordinates are compared */
+int Entities_QueryRadius(Vec3 pos, float radius, int* ids);
+/* Gets entities whose picking bounds may be intersected by the given line */
+/* NOTE: The line extends both forwards and backwards from origin */
+int Entities_QueryLine(Vec3 origin, Vec3 dir, int* ids);
+
 #define TABLIST_MAX_NAMES 256
 /* Data for all entries in tab list */
 CC_VAR extern struct _TabListData {
@@ -627,25 +627,21 @@ static void Collisions_ClipYMax(struct CollisionsComp* comp, struct AABB* blockB
 }
 
 static void Collisions_CollideWithReachableBlocks(struct CollisionsComp* comp, int count, struct AABB* entityBB,
-												struct AABB* extentBB) {
+												struct AABB* extentBB, cc_bool wasOn) {
 	struct Entity* entity = comp->Entity;
 	struct SearcherState state;
 	struct AABB blockBB, finalBB;
 	Vec3 size;
-	cc_bool wasOn;
 
 	Vec3 bPos, v;
 	float tx, ty, tz;
 	int i, block;
 
-	/* Reset collision detection states */
-	wasOn = entity->OnGround;
-	entity->OnGround = false;
-	comp->HitXMin = false; comp->HitYMin = false; comp->HitZMin = false;
-	comp->HitXMax = false; comp->HitYMax = false; comp->HitZMax = false;
-
 	size = entity->Size;
 	for (i = 0; i < count; i++) {
+		/* Entity can't reach any further blocks once it has stopped on every axis */
+		if (Vec3_IsZero(entity->Velocity)) return;
+
 		/* Unpack the block and coordinate data */
 		state  = Searcher_States[i];
 		bPos.x = state.x >> 3; bPos.y = state.y >> 4; bPos.z = state.z >> 3;
@@ -707,11 +703,22 @@ static void Collisions_CollideWithReachableBlocks(struct CollisionsComp* comp, i
 void Collisions_MoveAndWallSlide(struct CollisionsComp* comp) {
 	struct Entity* e = comp->Entity;
 	struct AABB entityBB, entityExtentBB;
+	cc_bool wasOn;
 	int count;
 
 	if (Vec3_IsZero(e->Velocity)) return;
-	count = Searcher_FindReachableBlocks(e,            &entityBB, &entityExtentBB);
-	Collisions_CollideWithReachableBlocks(comp, count, &entityBB, &entityExtentBB);
+	/* Reset collision detection states */
+	wasOn = e->OnGround;
+	e->OnGround = false;
+	comp->HitXMin = false; comp->HitYMin = false; comp->HitZMin = false;
+	comp->HitXMax = false; comp->HitYMax = false; comp->HitZMax = false;
+
+	count = Searcher_FindReachableBlocks(e, &entityBB, &entityExtentBB);
+	while (count) {
+		Collisions_CollideWithReachableBlocks(comp, count, &entityBB, &entityExtentBB, wasOn);
+		if (Vec3_IsZero(e->Velocity)) break;
+		count = Searcher_FindMoreBlocks(&entityExtentBB);
+	}
 }
 
 
@@ -1034,11 +1041,13 @@ void PhysicsComp_DoEntityPush(struct Entity* entity) {
 	cc_bool yIntersects;
 	Vec3 dir;
 	float dist, pushStrength;
-	int id;
+	int ids[ENTITIES_MAX_COUNT];
+	int i, count;
 	dir.y = 0.0f;
 
-	for (id = 0; id < ENTITIES_MAX_COUNT; id++) {
-		other = Entities.List[id];
+	count = Entities_QueryRadius(entity->Position, 1.0f, ids);
+	for (i = 0; i < count; i++) {
+		other = Entities.List[ids[i]];
 		if (!other || other == entity) continue;
 		if (!other->Model->pushes)     continue;
 
@@ -11,6 +11,18 @@
 #include "World.h"
 #include "Particle.h"
 #include "Drawer2D.h"
+#include "Camera.h"
+
+/* Gets the IDs of entities within the camera's view distance */
+static int EntityRenderers_QueryVisible(int* ids, float padding) {
+	/* Far corners of the view frustum are further away than the far plane */
+	float fov  = Camera.Fov * MATH_DEG2RAD * 0.5f;
+	float tanY = Math_SinF(fov) / Math_CosF(fov);
+	float tanX = tanY * (float)Game.Width / (float)Game.Height;
+	float dist = (float)Game_ViewDistance * Math_SqrtF(1.0f + tanX * tanX + tanY * tanY);
+
+	return Entities_QueryRadius(Camera.CurrentPos, dist + padding, ids);
+}
 
 /*########################################################################################################################*
 *------------------------------------------------------Entity Shadow------------------------------------------------------*
@@ -243,8 +255,9 @@ static void EntityShadows_MakeTexture(void) {
 }
 
 void EntityShadows_Render(void) {
+	int ids[ENTITIES_MAX_COUNT];
 	struct Entity* e;
-	int i;
+	int i, count;
 	if (Entities.ShadowsMode == SHADOW_MODE_NONE) return;
 
 	shadows_boundTex = false;
@@ -261,9 +274,10 @@ void EntityShadows_Render(void) {
 	EntityShadow_Draw(&Entities.CurPlayer->Base);
 
 	if (Entities.ShadowsMode == SHADOW_MODE_CIRCLE_ALL) {	
-		for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+		count = EntityRenderers_QueryVisible(ids, 0.0f);
+		for (i = 0; i < count; i++) 
 		{
-			e = Entities.List[i];
+			e = Entities.List[ids[i]];
 			if (!e || !e->ShouldRender || e == &Entities.CurPlayer->Base) continue;
 			EntityShadow_Draw(e);
 		}
@@ -379,10 +393,26 @@ void EntityNames_Delete(struct Entity* e) {
 *#########################################################################################################################*/
 static int closestEntityId;
 
+/* Names are drawn slightly above entities, and may be several blocks wide */
+#define NAME_QUERY_PADDING 16.0f
+static int EntityNames_QueryVisible(int* ids) {
+	int i, count = 0;
+	if (Entities.NamesMode != NAME_MODE_ALL_UNSCALED) 
+		return EntityRenderers_QueryVisible(ids, NAME_QUERY_PADDING);
+
+	/* Unscaled names grow with distance, so may be visible even when entity isn't */
+	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+	{
+		if (Entities.List[i]) ids[count++] = i;
+	}
+	return count;
+}
+
 void EntityNames_Render(void) {
 	struct LocalPlayer* p = Entities.CurPlayer;
+	int ids[ENTITIES_MAX_COUNT];
 	cc_bool hadFog;
-	int i;
+	int i, count;
 
 	if (Entities.NamesMode == NAME_MODE_NONE) return;
 	closestEntityId = Entities_GetClosest(&p->Base);
@@ -392,10 +422,11 @@ void EntityNames_Render(void) {
 	hadFog = Gfx_GetFog();
 	if (hadFog) Gfx_SetFog(false);
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+	count = EntityNames_QueryVisible(ids);
+	for (i = 0; i < count; i++) 
 	{
-		if (!Entities.List[i]) continue;
-		if (i != closestEntityId) DrawName(Entities.List[i]);
+		if (!Entities.List[ids[i]]) continue;
+		if (ids[i] != closestEntityId) DrawName(Entities.List[ids[i]]);
 	}
 
 	Gfx_SetAlphaTest(false);
@@ -404,20 +435,28 @@ void EntityNames_Render(void) {
 
 void EntityNames_RenderHovered(void) {
 	struct LocalPlayer* p = Entities.CurPlayer;
+	int ids[ENTITIES_MAX_COUNT];
 	struct Entity* e;
 	cc_bool allNames, hadFog;
 	cc_bool setupState = false;
-	int i;
+	int i, count;
 
 	if (Entities.NamesMode == NAME_MODE_NONE) return;
 	allNames = !(Entities.NamesMode == NAME_MODE_HOVERED || Entities.NamesMode == NAME_MODE_ALL) 
 		&& p->Hacks.CanSeeAllNames;
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+	if (allNames) {
+		count = EntityNames_QueryVisible(ids);
+	} else if (closestEntityId >= 0) {
+		ids[0] = closestEntityId; count = 1;
+	} else {
+		count = 0;
+	}
+
+	for (i = 0; i < count; i++) 
 	{
-		e = Entities.List[i];
+		e = Entities.List[ids[i]];
 		if (!e || e == &p->Base) continue;
-		if (!allNames && i != closestEntityId) continue;
 
 		/* Only alter the GPU state when actually necessary */
 		if (!setupState) {
@@ -77,6 +77,7 @@ void Event_UnregisterAll(void) {
 
 	BlockEvents.PermissionsChanged.Count = 0;
 	BlockEvents.BlockDefChanged.Count    = 0;
+	BlockEvents.BlockDefUpdated.Count    = 0;
 
 	WorldEvents.NewMap.Count    = 0;
 	WorldEvents.Loading.Count   = 0;
@@ -171,6 +171,7 @@ CC_VAR extern struct _UserEventsList {
 CC_VAR extern struct _BlockEventsList {
 	struct Event_Void PermissionsChanged; /* Block permissions (can place/delete) for a block changes */
 	struct Event_Void BlockDefChanged;    /* Block definition is changed or removed */
+	struct Event_Int  BlockDefUpdated;    /* Definition of a particular block is changed or removed (arg is block ID) */
 } BlockEvents;
 
 CC_VAR extern struct _WorldEventsList {
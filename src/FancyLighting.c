@@ -8,6 +8,7 @@
 #include "Event.h"
 #include "Game.h"
 #include "String.h"
+#include "Utils.h"
 #include "Chat.h"
 #include "ExtMath.h"
 #include "Options.h"
@@ -44,8 +45,26 @@ static cc_uint8* chunkLightingDataFlags;
 #define CHUNK_UNCALCULATED 0
 #define CHUNK_SELF_CALCULATED 1
 #define CHUNK_ALL_CALCULATED 2
+#define CHUNK_CALCULATING 3 /* Light from this chunk is being calculated by another thread */
 static LightingChunk* chunkLightingData;
 
+/* Chunk lighting may be calculated by several mesh builder threads at once. */
+/* Each thread spreads the light from a chunk's blocks into its own scratch copy */
+/*  of the 3x3x3 chunks around it, then merges that into the shared lighting data */
+#define SCRATCH_SIZE (CHUNK_SIZE * 3)
+struct LightScratch {
+	struct Queue queue;
+	cc_uint8* cells; /* Light levels of the SCRATCH_SIZE^3 cells around the chunk */
+	cc_uint32* lit;  /* Indices of cells which have been lit */
+	int litCount, litCapacity;
+	int x0, y0, z0;  /* World coordinates of first cell */
+	struct LightScratch* next;
+};
+static struct LightScratch* freeScratch;
+static void* lightMutex;
+static void* lightDone;
+static int lightWaiters;
+
 #define MakePaletteIndex(lampLevel, lavaLevel) ((lampLevel << FANCY_LIGHTING_LAMP_SHIFT) | lavaLevel)
 /* Fill in a palette with values based on the current light colors, shaded by the given shade value and lightened by the given ambientColor */
 static void InitPalette(PackedCol* palette, float shaded, PackedCol ambientColor) {
@@ -131,6 +150,16 @@ static void FreeState(void) {
 	chunkLightingData = NULL;
 	Queue_Clear(&lightQueue);
 	Queue_Clear(&unlightQueue);
+
+	while (freeScratch) {
+		struct LightScratch* s = freeScratch;
+		freeScratch = s->next;
+
+		Queue_Clear(&s->queue);
+		Mem_Free(s->cells);
+		Mem_Free(s->lit);
+		Mem_Free(s);
+	}
 }
 
 /* Converts chunk x/y/z coordinates to the corresponding index in chunks array/list */
@@ -269,7 +298,123 @@ cc_uint8 GetBlockBrightness(BlockID curBlock, cc_bool isLamp) {
 #define LightNode_Init(node, X, Y, Z, bright) \
 	node.coords.x = X; node.coords.y = Y; node.coords.z = Z; node.brightness = bright;
 
-static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
+/*########################################################################################################################*
+*----------------------------------------------------Chunk calculation----------------------------------------------------*
+*#########################################################################################################################*/
+#define Scratch_Index(s, x, y, z) ((((y) - (s)->y0) * SCRATCH_SIZE + ((z) - (s)->z0)) * SCRATCH_SIZE + ((x) - (s)->x0))
+#define Scratch_Get(s, x, y, z, shift) (((s)->cells[Scratch_Index(s, x, y, z)] >> (shift)) & FANCY_LIGHTING_MAX_LEVEL)
+
+static void Scratch_Set(struct LightScratch* s, cc_uint8 brightness, int index, int shift) {
+	if (!s->cells[index]) {
+		if (s->litCount == s->litCapacity) {
+			Utils_Resize((void**)&s->lit, &s->litCapacity, sizeof(cc_uint32), 0, 4096);
+		}
+		s->lit[s->litCount++] = index;
+	}
+
+	s->cells[index] &= ~(FANCY_LIGHTING_MAX_LEVEL << shift);
+	s->cells[index] |= brightness << shift;
+}
+
+#define Scratch_TrySpreadInto(axis, AXIS, dir, limit, thisFace, thatFace) \
+	if (ln.coords.axis dir ## = limit && \
+		CanLightPass(thisBlock, FACE_ ## AXIS ## thisFace) && \
+		CanLightPass(World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z), FACE_ ## AXIS ## thatFace) && \
+		Scratch_Get(s, ln.coords.x, ln.coords.y, ln.coords.z, shift) < ln.brightness) { \
+		Queue_Enqueue(&s->queue, &ln); \
+	} \
+
+/* Same as FlushLightQueue, but spreads light into the scratch cells instead */
+static void Scratch_FlushQueue(struct LightScratch* s, cc_bool isLamp) {
+	int shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0;
+	struct LightNode ln;
+	BlockID thisBlock;
+	int index;
+
+	while (s->queue.count > 0) {
+		ln = *(struct LightNode*)(Queue_Dequeue(&s->queue));
+		index = Scratch_Index(s, ln.coords.x, ln.coords.y, ln.coords.z);
+
+		if (((s->cells[index] >> shift) & FANCY_LIGHTING_MAX_LEVEL) >= ln.brightness) { continue; }
+		if (ln.brightness == 0) { continue; }
+
+		Scratch_Set(s, ln.brightness, index, shift);
+
+		thisBlock = World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z);
+		ln.brightness--;
+		if (ln.brightness == 0) continue;
+
+		ln.coords.x--;
+		Scratch_TrySpreadInto(x, X, > , 0, MAX, MIN)
+		ln.coords.x += 2;
+		Scratch_TrySpreadInto(x, X, < , World.MaxX, MIN, MAX)
+		ln.coords.x--;
+
+		ln.coords.y--;
+		Scratch_TrySpreadInto(y, Y, >, 0, MAX, MIN)
+		ln.coords.y += 2;
+		Scratch_TrySpreadInto(y, Y, <, World.MaxY, MIN, MAX)
+		ln.coords.y--;
+
+		ln.coords.z--;
+		Scratch_TrySpreadInto(z, Z, > , 0, MAX, MIN)
+		ln.coords.z += 2;
+		Scratch_TrySpreadInto(z, Z, < , World.MaxZ, MIN, MAX)
+	}
+}
+
+/* Merges the scratch cells into the shared lighting data, then clears them */
+/* NOTE: lightMutex must be held, as light from other chunks may be merged into the same cells */
+static void Scratch_Merge(struct LightScratch* s) {
+	int i, index, x, y, z, chunkIndex, localIndex;
+	cc_uint8 cur, lit, lamp, lava;
+
+	for (i = 0; i < s->litCount; i++) 
+	{
+		index = s->lit[i];
+		x = s->x0 + index % SCRATCH_SIZE;
+		z = s->z0 + (index / SCRATCH_SIZE) % SCRATCH_SIZE;
+		y = s->y0 + index / (SCRATCH_SIZE * SCRATCH_SIZE);
+
+		chunkIndex = ChunkCoordsToIndex(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+		localIndex = GlobalCoordsToChunkCoordsIndex(x, y, z);
+
+		if (chunkLightingData[chunkIndex] == NULL) {
+			chunkLightingData[chunkIndex] = (cc_uint8*)Mem_TryAllocCleared(CHUNK_SIZE_3, sizeof(cc_uint8));
+			if (!chunkLightingData[chunkIndex]) { s->cells[index] = 0; continue; }
+		}
+
+		/* Light from different chunks combines by taking the brightest level */
+		cur  = chunkLightingData[chunkIndex][localIndex];
+		lit  = s->cells[index];
+		lamp = max(cur & FANCY_LIGHTING_LAMP_MASK, lit & FANCY_LIGHTING_LAMP_MASK);
+		lava = max(cur & FANCY_LIGHTING_MAX_LEVEL, lit & FANCY_LIGHTING_MAX_LEVEL);
+
+		chunkLightingData[chunkIndex][localIndex] = lamp | lava;
+		s->cells[index] = 0;
+	}
+	s->litCount = 0;
+}
+
+static struct LightScratch* Scratch_Claim(void) {
+	struct LightScratch* s;
+
+	Mutex_Lock(lightMutex);
+	{
+		s = freeScratch;
+		if (s) freeScratch = s->next;
+	}
+	Mutex_Unlock(lightMutex);
+	if (s) return s;
+
+	s = (struct LightScratch*)Mem_AllocCleared(1, sizeof(struct LightScratch), "light scratch");
+	s->cells = (cc_uint8*)Mem_AllocCleared(SCRATCH_SIZE * SCRATCH_SIZE, SCRATCH_SIZE, "light scratch cells");
+	Queue_Init(&s->queue, sizeof(struct LightNode));
+	return s;
+}
+
+/* Spreads the light from all light casting blocks in the chunk into the scratch cells */
+static void CalculateChunkLightingSelf(struct LightScratch* s, int cx, int cy, int cz) {
 	int x, y, z;
 	/* Block coordinates */
 	int chunkStartX, chunkStartY, chunkStartZ, chunkEndX, chunkEndY, chunkEndZ;
@@ -288,6 +433,11 @@ static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
 	if (chunkEndY > World.Height) { chunkEndY = World.Height; }
 	if (chunkEndZ > World.Length) { chunkEndZ = World.Length; }
 
+	/* Light can spread at most FANCY_LIGHTING_MAX_LEVEL blocks, so never leaves the neighbouring chunks */
+	s->x0 = chunkStartX - CHUNK_SIZE;
+	s->y0 = chunkStartY - CHUNK_SIZE;
+	s->z0 = chunkStartZ - CHUNK_SIZE;
+
 	for (y = chunkStartY; y < chunkEndY; y++) {
 		for (z = chunkStartZ; z < chunkEndZ; z++) {
 			for (x = chunkStartX; x < chunkEndX; x++) {
@@ -300,15 +450,15 @@ static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
 
 					if (brightness > 0) {
 						LightNode_Init(entry, x, y, z, brightness);
-						Queue_Enqueue(&lightQueue, &entry);
-						FlushLightQueue(false, false);
+						Queue_Enqueue(&s->queue, &entry);
+						Scratch_FlushQueue(s, false);
 					}
 					else {
 						/* If no lava brightness, it must use lamp brightness */
 						brightness = Blocks.Brightness[curBlock] >> FANCY_LIGHTING_LAMP_SHIFT;
 						LightNode_Init(entry, x, y, z, brightness);
-						Queue_Enqueue(&lightQueue, &entry);
-						FlushLightQueue(true, false);
+						Queue_Enqueue(&s->queue, &entry);
+						Scratch_FlushQueue(s, true);
 					}
 				}
 
@@ -318,16 +468,19 @@ static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
 			}
 		}
 	}
-
-	chunkLightingDataFlags[chunkIndex] = CHUNK_SELF_CALCULATED;
 }
 
+/* Ensures the light from all of the chunks neighbouring the given chunk has been calculated */
+/* NOTE: Can be called from multiple threads at once */
 static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 	int x, y, z;
 	/* Chunk coordinates */
 	int chunkStartX, chunkStartY, chunkStartZ;
 	int chunkEndX, chunkEndY, chunkEndZ;
 	int curChunkIndex;
+	IVec3 claimed[27];
+	int i, claimedCount = 0;
+	struct LightScratch* s;
 
 	chunkStartX = cx - 1;
 	chunkStartY = cy - 1;
@@ -343,18 +496,67 @@ static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 	if (chunkEndY == World.ChunksY) { chunkEndY--; }
 	if (chunkEndZ == World.ChunksZ) { chunkEndZ--; }
 
+	/* Claim all of the neighbouring chunks which still need to be calculated */
+	Mutex_Lock(lightMutex);
 	for (y = chunkStartY; y <= chunkEndY; y++) {
 		for (z = chunkStartZ; z <= chunkEndZ; z++) {
 			for (x = chunkStartX; x <= chunkEndX; x++) {
 				curChunkIndex = ChunkCoordsToIndex(x, y, z);
 
 				if (chunkLightingDataFlags[curChunkIndex] == CHUNK_UNCALCULATED) {
-					CalculateChunkLightingSelf(curChunkIndex, x, y, z);
+					chunkLightingDataFlags[curChunkIndex] = CHUNK_CALCULATING;
+					claimed[claimedCount].x = x; claimed[claimedCount].y = y; claimed[claimedCount].z = z;
+					claimedCount++;
+				}
+			}
+		}
+	}
+	Mutex_Unlock(lightMutex);
+
+	if (claimedCount) {
+		s = Scratch_Claim();
+		for (i = 0; i < claimedCount; i++) 
+		{
+			CalculateChunkLightingSelf(s, claimed[i].x, claimed[i].y, claimed[i].z);
+			curChunkIndex = ChunkCoordsToIndex(claimed[i].x, claimed[i].y, claimed[i].z);
+
+			Mutex_Lock(lightMutex);
+			{
+				Scratch_Merge(s);
+				chunkLightingDataFlags[curChunkIndex] = CHUNK_SELF_CALCULATED;
+				if (lightWaiters) Waitable_Signal(lightDone);
+			}
+			Mutex_Unlock(lightMutex);
+		}
+
+		Mutex_Lock(lightMutex);
+		{
+			s->next     = freeScratch;
+			freeScratch = s;
+		}
+		Mutex_Unlock(lightMutex);
+	}
+
+	/* Wait for any neighbouring chunks still being calculated by other threads */
+	Mutex_Lock(lightMutex);
+	for (y = chunkStartY; y <= chunkEndY; y++) {
+		for (z = chunkStartZ; z <= chunkEndZ; z++) {
+			for (x = chunkStartX; x <= chunkEndX; x++) {
+				curChunkIndex = ChunkCoordsToIndex(x, y, z);
+
+				while (chunkLightingDataFlags[curChunkIndex] == CHUNK_CALCULATING) {
+					lightWaiters++;
+					Mutex_Unlock(lightMutex);
+					/* Several threads may be waiting, so only wait briefly before checking again */
+					Waitable_WaitFor(lightDone, 1);
+					Mutex_Lock(lightMutex);
+					lightWaiters--;
 				}
 			}
 		}
 	}
 	chunkLightingDataFlags[chunkIndex] = CHUNK_ALL_CALCULATED;
+	Mutex_Unlock(lightMutex);
 }
 
 
@@ -469,6 +671,17 @@ static void OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlo
 	CalcBlockChange(x, y, z, oldBlock, newBlock, false);
 	CalcBlockChange(x, y, z, oldBlock, newBlock, true);
 }
+static void OnBlocksChanged(const struct BlockChange* changes, int count) {
+	int i;
+	ClassicLighting_OnBlocksChanged(changes, count);
+
+	/* Light propagation still has to be updated for each block */
+	for (i = 0; i < count; i++) 
+	{
+		CalcBlockChange(changes[i].x, changes[i].y, changes[i].z, changes[i].oldBlock, changes[i].newBlock, false);
+		CalcBlockChange(changes[i].x, changes[i].y, changes[i].z, changes[i].oldBlock, changes[i].newBlock, true);
+	}
+}
 /* Invalidates/Resets lighting state for all of the blocks in the world */
 /*  (e.g. because a block changed whether it is full bright or not) */
 static void Refresh(void) {
@@ -480,21 +693,15 @@ static cc_bool IsLit(int x, int y, int z) { return ClassicLighting_IsLit(x, y, z
 static cc_bool IsLit_Fast(int x, int y, int z) { return ClassicLighting_IsLit_Fast(x, y, z); }
 
 #define CalcForChunkIfNeeded(cx, cy, cz, chunkIndex) \
-	if (chunkLightingDataFlags[chunkIndex] < CHUNK_ALL_CALCULATED) { \
+	if (chunkLightingDataFlags[chunkIndex] != CHUNK_ALL_CALCULATED) { \
 		CalculateChunkLightingAll(chunkIndex, cx, cy, cz); \
 	}
 
-static PackedCol Color_Core(int x, int y, int z, int paletteFace) {
+/* Returns the light colour, assuming the light from all chunks around the cell has been calculated */
+static PackedCol Color_Fast(int x, int y, int z, int paletteFace) {
 	cc_uint8 lightData;
-	int cx, cy, cz, chunkIndex;
-	int chunkCoordsIndex;
-
-	cx = x >> CHUNK_SHIFT;
-	cy = y >> CHUNK_SHIFT;
-	cz = z >> CHUNK_SHIFT;
-
-	chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
-	CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
+	int chunkIndex, chunkCoordsIndex;
+	chunkIndex = ChunkCoordsToIndex(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
 
 	/* There might be no light data in this chunk even after it was calculated */
 	if (chunkLightingData[chunkIndex] == NULL) {
@@ -513,6 +720,18 @@ static PackedCol Color_Core(int x, int y, int z, int paletteFace) {
 	return palettes[paletteFace][lightData];
 }
 
+static PackedCol Color_Core(int x, int y, int z, int paletteFace) {
+	int cx, cy, cz, chunkIndex;
+
+	cx = x >> CHUNK_SHIFT;
+	cy = y >> CHUNK_SHIFT;
+	cz = z >> CHUNK_SHIFT;
+
+	chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
+	CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
+	return Color_Fast(x, y, z, paletteFace);
+}
+
 #define TRY_OOB_CASE(sun, shadow) if (!World_Contains(x, y, z)) return y >= Env.EdgeHeight ? sun : shadow
 static PackedCol Color(int x, int y, int z) {
 	TRY_OOB_CASE(Env.SunCol, Env.ShadowCol);
@@ -522,22 +741,36 @@ static PackedCol Color_YMaxSide(int x, int y, int z) {
 	TRY_OOB_CASE(Env.SunCol, Env.ShadowCol);
 	return Color_Core(x, y, z, PALETTE_YMAX_INDEX);
 }
-static PackedCol Color_YMinSide(int x, int y, int z) {
-	TRY_OOB_CASE(Env.SunYMin, Env.ShadowYMin);
-	return Color_Core(x, y, z, PALETTE_YMIN_INDEX);
-}
 static PackedCol Color_XSide(int x, int y, int z) {
 	TRY_OOB_CASE(Env.SunXSide, Env.ShadowXSide);
 	return Color_Core(x, y, z, PALETTE_XSIDE_INDEX);
 }
-static PackedCol Color_ZSide(int x, int y, int z) {
+
+/* The light in the 18x18x18 region around a chunk only comes from the chunks neighbouring it, */
+/*  so once LightHint_Worker has been called the light there never needs to be lazily calculated */
+static PackedCol Color_Sprite_Fast(int x, int y, int z) {
+	TRY_OOB_CASE(Env.SunCol, Env.ShadowCol);
+	return Color_Fast(x, y, z, PALETTE_YMAX_INDEX);
+}
+static PackedCol Color_YMinSide_Fast(int x, int y, int z) {
+	TRY_OOB_CASE(Env.SunYMin, Env.ShadowYMin);
+	return Color_Fast(x, y, z, PALETTE_YMIN_INDEX);
+}
+static PackedCol Color_XSide_Fast(int x, int y, int z) {
+	TRY_OOB_CASE(Env.SunXSide, Env.ShadowXSide);
+	return Color_Fast(x, y, z, PALETTE_XSIDE_INDEX);
+}
+static PackedCol Color_ZSide_Fast(int x, int y, int z) {
 	TRY_OOB_CASE(Env.SunZSide, Env.ShadowZSide);
-	return Color_Core(x, y, z, PALETTE_ZSIDE_INDEX);
+	return Color_Fast(x, y, z, PALETTE_ZSIDE_INDEX);
 }
 
 static void LightHint(int startX, int startY, int startZ) {
-	int cx, cy, cz, chunkIndex;
 	ClassicLighting_LightHint(startX, startY, startZ);
+}
+
+static void LightHint_Worker(int startX, int startY, int startZ) {
+	int cx, cy, cz, chunkIndex;
 	/* Add 1 to startX/Z, as coordinates are for the extended chunk (18x18x18) */
 	startX++; startY++; startZ++;
 
@@ -551,21 +784,23 @@ static void LightHint(int startX, int startY, int startZ) {
 
 void FancyLighting_SetActive(void) {
 	Lighting.OnBlockChanged = OnBlockChanged;
+	Lighting.OnBlocksChanged = OnBlocksChanged;
 	Lighting.Refresh = Refresh;
 	Lighting.IsLit = IsLit;
 	Lighting.Color = Color;
 	Lighting.Color_XSide = Color_XSide;
 
 	Lighting.IsLit_Fast = IsLit_Fast;
-	Lighting.Color_Sprite_Fast = Color;
-	Lighting.Color_YMax_Fast   = Color;
-	Lighting.Color_YMin_Fast   = Color_YMinSide;
-	Lighting.Color_XSide_Fast  = Color_XSide;
-	Lighting.Color_ZSide_Fast  = Color_ZSide;
+	Lighting.Color_Sprite_Fast = Color_Sprite_Fast;
+	Lighting.Color_YMax_Fast   = Color_Sprite_Fast;
+	Lighting.Color_YMin_Fast   = Color_YMinSide_Fast;
+	Lighting.Color_XSide_Fast  = Color_XSide_Fast;
+	Lighting.Color_ZSide_Fast  = Color_ZSide_Fast;
 
 	Lighting.FreeState  = FreeState;
 	Lighting.AllocState = AllocState;
 	Lighting.LightHint  = LightHint;
+	Lighting.LightHint_Worker = LightHint_Worker;
 }
 
 static void OnEnvVariableChanged(void* obj, int envVar) {
@@ -579,5 +814,7 @@ static void OnEnvVariableChanged(void* obj, int envVar) {
 }
 
 void FancyLighting_OnInit(void) {
+	lightMutex = Mutex_Create("Fancy lighting");
+	lightDone  = Waitable_Create("Fancy lighting done");
 	Event_Register_(&WorldEvents.EnvVarChanged, NULL, OnEnvVariableChanged);
 }
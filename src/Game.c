@@ -196,6 +196,86 @@ void Game_Reset(void) {
 	}
 }
 
+static struct BlockChange* batchChanges;
+static int batchCount, batchCapacity, batchDepth;
+
+static void BlockBatch_Add(int x, int y, int z, BlockID old, BlockID now) {
+	struct BlockChange* change;
+	if (batchCount == batchCapacity) {
+		batchCapacity = max(batchCapacity * 2, 256);
+		batchChanges  = (struct BlockChange*)Mem_Realloc(batchChanges, batchCapacity, 
+										sizeof(struct BlockChange), "block batch");
+	}
+
+	change = &batchChanges[batchCount];
+	change->x = x; change->y = y; change->z = z;
+	change->order    = batchCount++;
+	change->oldBlock = old;
+	change->newBlock = now;
+}
+
+/* Orders changes by column, then by Y, then by the order they were made in */
+static int BlockBatch_Compare(const struct BlockChange* a, const struct BlockChange* b) {
+	if (a->z != b->z) return a->z - b->z;
+	if (a->x != b->x) return a->x - b->x;
+	if (a->y != b->y) return a->y - b->y;
+	return a->order - b->order;
+}
+
+static void BlockBatch_QuickSort(int left, int right) {
+	struct BlockChange* keys = batchChanges; struct BlockChange key;
+
+	while (left < right) {
+		int i = left, j = right;
+		struct BlockChange pivot = keys[(i + j) >> 1];
+
+		/* partition the list */
+		while (i <= j) {
+			while (BlockBatch_Compare(&pivot, &keys[i]) > 0) i++;
+			while (BlockBatch_Compare(&pivot, &keys[j]) < 0) j--;
+			QuickSort_Swap_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(BlockBatch_QuickSort)
+	}
+}
+
+/* Merges multiple changes to the same block into one change, and removes changes that were later undone */
+static int BlockBatch_Coalesce(void) {
+	struct BlockChange* cur;
+	struct BlockChange* last = NULL;
+	int i, count = 0;
+
+	for (i = 0; i < batchCount; i++) {
+		cur = &batchChanges[i];
+
+		if (last && last->x == cur->x && last->y == cur->y && last->z == cur->z) {
+			last->newBlock = cur->newBlock;
+			if (last->oldBlock == last->newBlock) { count--; last = NULL; }
+		} else if (cur->oldBlock != cur->newBlock) {
+			batchChanges[count] = *cur;
+			last = &batchChanges[count++];
+		}
+	}
+	return count;
+}
+
+void Game_BeginBlockBatch(void) { batchDepth++; }
+
+void Game_EndBlockBatch(void) {
+	int count;
+	if (--batchDepth > 0 || !batchCount) return;
+
+	BlockBatch_QuickSort(0, batchCount - 1);
+	count = BlockBatch_Coalesce();
+	batchCount = 0;
+
+	if (!count) return;
+
+	MapRenderer_OnBlocksChanged(batchChanges, count);
+	Lighting_OnBlocksChanged(batchChanges, count);
+}
+
 void Game_UpdateBlock(int x, int y, int z, BlockID block) {
 	BlockID old = World_GetBlock(x, y, z);
 	World_SetBlock(x, y, z, block);
@@ -203,8 +283,13 @@ void Game_UpdateBlock(int x, int y, int z, BlockID block) {
 	if (Weather_Heightmap) {
 		EnvRenderer_OnBlockChanged(x, y, z, old, block);
 	}
-	Lighting.OnBlockChanged(x, y, z, old, block);
-	MapRenderer_OnBlockChanged(x, y, z, block);
+
+	if (batchDepth) {
+		BlockBatch_Add(x, y, z, old, block);
+	} else {
+		Lighting.OnBlockChanged(x, y, z, old, block);
+		MapRenderer_OnBlockChanged(x, y, z, block);
+	}
 }
 
 void Game_ChangeBlock(int x, int y, int z, BlockID block) {
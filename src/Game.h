@@ -107,6 +107,15 @@ CC_API void Game_UpdateBlock(int x, int y, int z, BlockID block);
 /* In multiplayer this is sent to the server, in singleplayer just activates physics. */
 CC_API void Game_ChangeBlock(int x, int y, int z, BlockID block);
 
+/* Describes a block that was changed during a block batch */
+struct BlockChange { int x, y, z, order; BlockID oldBlock, newBlock; };
+/* Begins a batch of block changes. While a batch is active, Game_UpdateBlock still changes the */
+/*  block in the map, but defers recalculating lighting and redrawing chunks until the batch ends. */
+/* NOTE: Batches can be nested, lighting is only updated when the outermost batch ends. */
+CC_API void Game_BeginBlockBatch(void);
+/* Ends a batch of block changes, then updates lighting and chunks once for all of the changed blocks. */
+CC_API void Game_EndBlockBatch(void);
+
 cc_bool Game_CanPick(BlockID block);
 /* Updates Game_Width and Game_Height. */
 void Game_UpdateDimensions(void);
@@ -7,6 +7,7 @@
 #include "Utils.h"
 #include "Game.h"
 #include "Window.h"
+#include "Options.h"
 
 const struct MapGenerator* Gen_Active;
 BlockRaw* Gen_Blocks;
@@ -77,6 +78,74 @@ static void Gen_Run(void) {
 cc_bool Gen_IsDone(void) { return gen_done; }
 #endif
 
+
+/*########################################################################################################################*
+*------------------------------------------------------Slab workers-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Some generation passes only depend on the x/z coordinates of each column, */
+/*  so the map can be split into slabs along the z axis that are generated in parallel */
+typedef void (*Gen_SlabFunc)(int zBeg, int zEnd);
+#define GEN_SLAB_LENGTH 16
+#define GEN_MAX_WORKERS 16
+static int slabWorkers;
+
+#ifndef CC_BUILD_COOPTHREADED
+static void* slabMutex;
+static Gen_SlabFunc slabFunc;
+static int nextSlab, slabsDone;
+
+static void Gen_RunSlabs(void) {
+	int zBeg, zEnd;
+	for (;;)
+	{
+		Mutex_Lock(slabMutex);
+		zBeg      = nextSlab;
+		nextSlab += GEN_SLAB_LENGTH;
+		Mutex_Unlock(slabMutex);
+
+		if (zBeg >= World.Length) return;
+		zEnd = min(zBeg + GEN_SLAB_LENGTH, World.Length);
+		slabFunc(zBeg, zEnd);
+
+		Mutex_Lock(slabMutex);
+		slabsDone += zEnd - zBeg;
+		Gen_CurrentProgress = (float)slabsDone / World.Length;
+		Mutex_Unlock(slabMutex);
+	}
+}
+
+/* Calls func for every slab of the map, using worker threads if possible */
+static void Gen_ForEachSlab(Gen_SlabFunc func) {
+	void* threads[GEN_MAX_WORKERS];
+	int i;
+	slabMutex = Mutex_Create("Gen slabs");
+	slabFunc  = func;
+	nextSlab  = 0;
+	slabsDone = 0;
+
+	for (i = 0; i < slabWorkers; i++) 
+	{
+		Thread_Run(&threads[i], Gen_RunSlabs, 64 * 1024, "Map gen worker");
+	}
+	Gen_RunSlabs();
+
+	for (i = 0; i < slabWorkers; i++) 
+	{
+		Thread_Join(threads[i]);
+	}
+	Mutex_Free(slabMutex);
+}
+#else
+static void Gen_ForEachSlab(Gen_SlabFunc func) {
+	int z;
+	for (z = 0; z < World.Length; z += GEN_SLAB_LENGTH)
+	{
+		Gen_CurrentProgress = (float)z / World.Length;
+		func(z, min(z + GEN_SLAB_LENGTH, World.Length));
+	}
+}
+#endif
+
 static void Gen_Reset(void) {
 	Gen_CurrentProgress = 0.0f;
 	Gen_CurrentState    = "";
@@ -85,7 +154,8 @@ static void Gen_Reset(void) {
 
 void Gen_Start(void) {
 	Gen_Reset();
-	Gen_Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+	Gen_Blocks  = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+	slabWorkers = Options_GetInt(OPT_GEN_THREADS, 0, GEN_MAX_WORKERS, 3);
 
 	if (!Gen_Blocks || !Gen_Active->Prepare()) {
 		Window_ShowDialog("Out of memory", "Not enough free memory to generate a map that large.\nTry a smaller size.");
@@ -195,6 +265,85 @@ static float ImprovedNoise_Calc(const cc_uint8* p, float x, float y) {
 }
 
 
+/* Calculates noise for each of the given x coordinates (scaled by freq), */
+/*  then adds that noise multiplied by amplitude to the corresponding element in sum */
+#if defined __SSE2_MATH__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+static void ImprovedNoise_AddRow(const cc_uint8* p, const float* xs, float freq, float y, 
+								float amplitude, float* sum, int count) {
+	int xFloors[4], gx[4][4], gy[4][4];
+	__m128 x, u, g22, g12, g21, g11, c1, c2;
+	__m128i xi;
+	int yFloor, Y, X, A, B, hash;
+	float yFrac, v;
+	int i, j;
+
+	/* NOTE: Calculations must be performed in exactly the same order as ImprovedNoise_Calc, */
+	/*  so that the results are identical to calculating noise for each x individually */
+	yFloor = y >= 0 ? (int)y : (int)y - 1;
+	Y = yFloor & 0xFF;
+	yFrac = y - yFloor;
+	v = yFrac * yFrac * yFrac * (yFrac * (yFrac * 6 - 15) + 10); /* Fade(y) */
+
+	for (i = 0; i <= count - 4; i += 4) 
+	{
+		x  = _mm_mul_ps(_mm_loadu_ps(xs + i), _mm_set1_ps(freq));
+		xi = _mm_cvttps_epi32(x);
+		/* Subtract 1 from (int)x if x < 0 */
+		xi = _mm_add_epi32(xi, _mm_castps_si128(_mm_cmplt_ps(x, _mm_setzero_ps())));
+		_mm_storeu_si128((__m128i*)xFloors, xi);
+		x  = _mm_sub_ps(x, _mm_cvtepi32_ps(xi));
+
+		/* Fade(x) */
+		u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, x), x), 
+				_mm_add_ps(_mm_mul_ps(x, _mm_sub_ps(_mm_mul_ps(x, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10)));
+
+		/* Permutation table lookups can't be vectorised */
+		for (j = 0; j < 4; j++) 
+		{
+			X = xFloors[j] & 0xFF;
+			A = p[X] + Y; B = p[X + 1] + Y;
+
+			hash = (p[p[A]]     & 0xF) << 1; gx[0][j] = ((xFlags >> hash) & 3) - 1; gy[0][j] = ((yFlags >> hash) & 3) - 1;
+			hash = (p[p[B]]     & 0xF) << 1; gx[1][j] = ((xFlags >> hash) & 3) - 1; gy[1][j] = ((yFlags >> hash) & 3) - 1;
+			hash = (p[p[A + 1]] & 0xF) << 1; gx[2][j] = ((xFlags >> hash) & 3) - 1; gy[2][j] = ((yFlags >> hash) & 3) - 1;
+			hash = (p[p[B + 1]] & 0xF) << 1; gx[3][j] = ((xFlags >> hash) & 3) - 1; gy[3][j] = ((yFlags >> hash) & 3) - 1;
+		}
+
+#define ImprovedNoise_Grad(i, xVal, yVal) _mm_add_ps(\
+			_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((__m128i*)gx[i])), xVal),\
+			_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((__m128i*)gy[i])), _mm_set1_ps(yVal)))
+
+		g22 = ImprovedNoise_Grad(0, x, yFrac);
+		g12 = ImprovedNoise_Grad(1, _mm_sub_ps(x, _mm_set1_ps(1)), yFrac);
+		c1  = _mm_add_ps(g22, _mm_mul_ps(u, _mm_sub_ps(g12, g22)));
+
+		g21 = ImprovedNoise_Grad(2, x, yFrac - 1);
+		g11 = ImprovedNoise_Grad(3, _mm_sub_ps(x, _mm_set1_ps(1)), yFrac - 1);
+		c2  = _mm_add_ps(g21, _mm_mul_ps(u, _mm_sub_ps(g11, g21)));
+
+		c1  = _mm_add_ps(c1, _mm_mul_ps(_mm_set1_ps(v), _mm_sub_ps(c2, c1)));
+		_mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(c1, _mm_set1_ps(amplitude))));
+	}
+
+	for (; i < count; i++) 
+	{
+		sum[i] += ImprovedNoise_Calc(p, xs[i] * freq, y) * amplitude;
+	}
+}
+#else
+static void ImprovedNoise_AddRow(const cc_uint8* p, const float* xs, float freq, float y, 
+								float amplitude, float* sum, int count) {
+	int i;
+	for (i = 0; i < count; i++) 
+	{
+		sum[i] += ImprovedNoise_Calc(p, xs[i] * freq, y) * amplitude;
+	}
+}
+#endif
+
+
 struct OctaveNoise { cc_uint8 p[8][NOISE_TABLE_SIZE]; int octaves; };
 static void OctaveNoise_Init(struct OctaveNoise* n, RNGState* rnd, int octaves) {
 	int i;
@@ -218,16 +367,36 @@ static float OctaveNoise_Calc(const struct OctaveNoise* n, float x, float y) {
 	return sum;
 }
 
+/* Calculates noise for a row of x coordinates, all with the same y coordinate */
+/* Results are identical to calling OctaveNoise_Calc for each x coordinate */
+static void OctaveNoise_CalcRow(const struct OctaveNoise* n, const float* xs, float y, float* out, int count) {
+	float amplitude = 1, freq = 1;
+	int i;
+	for (i = 0; i < count; i++) out[i] = 0;
 
+	for (i = 0; i < n->octaves; i++) {
+		ImprovedNoise_AddRow(n->p[i], xs, freq, y * freq, amplitude, out, count);
+		amplitude *= 2.0f;
+		freq *= 0.5f;
+	}
+}
+
+
+#define NOISE_ROW_SIZE 64
 struct CombinedNoise { struct OctaveNoise noise1, noise2; };
 static void CombinedNoise_Init(struct CombinedNoise* n, RNGState* rnd, int octaves1, int octaves2) {
 	OctaveNoise_Init(&n->noise1, rnd, octaves1);
 	OctaveNoise_Init(&n->noise2, rnd, octaves2);
 }
 
-static float CombinedNoise_Calc(const struct CombinedNoise* n, float x, float y) {
-	float offset = OctaveNoise_Calc(&n->noise2, x, y);
-	return OctaveNoise_Calc(&n->noise1, x + offset, y);
+/* Calculates noise for a row of (at most NOISE_ROW_SIZE) x coordinates, all with the same y coordinate */
+static void CombinedNoise_CalcRow(const struct CombinedNoise* n, const float* xs, float y, float* out, int count) {
+	float offsets[NOISE_ROW_SIZE];
+	int i;
+	OctaveNoise_CalcRow(&n->noise2, xs, y, offsets, count);
+
+	for (i = 0; i < count; i++) offsets[i] += xs[i];
+	OctaveNoise_CalcRow(&n->noise1, offsets, y, out, count);
 }
 
 
@@ -300,40 +469,67 @@ static void NotchyGen_FloodFill(int index, BlockRaw block) {
 }
 
 
-static void NotchyGen_CreateHeightmap(void) {
-	float hLow, hHigh, height;
-	int hIndex = 0, adjHeight;
-	int x, z;
-	struct CombinedNoise n1, n2;
-	struct OctaveNoise n3;
+static struct CombinedNoise heightNoise1, heightNoise2;
+static struct OctaveNoise heightNoise3;
 
-	CombinedNoise_Init(&n1, &rnd, 8, 8);
-	CombinedNoise_Init(&n2, &rnd, 8, 8);	
-	OctaveNoise_Init(&n3, &rnd, 6);
+static void NotchyGen_HeightmapSlab(int zBeg, int zEnd) {
+	float xs[NOISE_ROW_SIZE], highXs[NOISE_ROW_SIZE];
+	float hLow[NOISE_ROW_SIZE], hHigh[NOISE_ROW_SIZE], noise[NOISE_ROW_SIZE];
+	int highIndices[NOISE_ROW_SIZE];
+	float height;
+	int hIndex, adjHeight;
+	int x, z, i, count, numHigh;
 
-	Gen_CurrentState = "Building heightmap";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+	for (z = zBeg; z < zEnd; z++) {
+		for (x = 0; x < World.Width; x += NOISE_ROW_SIZE) {
+			count = min(World.Width - x, NOISE_ROW_SIZE);
 
-		for (x = 0; x < World.Width; x++) {
-			hLow   = CombinedNoise_Calc(&n1, x * 1.3f, z * 1.3f) / 6 - 4;
-			height = hLow;
+			for (i = 0; i < count; i++) xs[i] = (float)(x + i);
+			OctaveNoise_CalcRow(&heightNoise3, xs, (float)z, noise, count);
+
+			/* Only need to calculate high heights for columns where they may be used */
+			for (i = 0, numHigh = 0; i < count; i++) {
+				xs[i] = (x + i) * 1.3f;
+				if (noise[i] > 0) continue;
 
-			if (OctaveNoise_Calc(&n3, (float)x, (float)z) <= 0) {
-				hHigh = CombinedNoise_Calc(&n2, x * 1.3f, z * 1.3f) / 5 + 6;
-				height = max(hLow, hHigh);
+				highXs[numHigh] = xs[i];
+				highIndices[numHigh++] = i;
 			}
+			CombinedNoise_CalcRow(&heightNoise1, xs,     z * 1.3f, hLow,  count);
+			CombinedNoise_CalcRow(&heightNoise2, highXs, z * 1.3f, hHigh, numHigh);
 
-			height *= 0.5f;
-			if (height < 0) height *= 0.8f;
+			for (i = 0; i < count; i++) hLow[i] = hLow[i] / 6 - 4;
+			for (i = 0; i < numHigh; i++) {
+				height = hHigh[i] / 5 + 6;
+				hLow[highIndices[i]] = max(hLow[highIndices[i]], height);
+			}
 
-			adjHeight = (int)(height + waterLevel);
-			minHeight = min(adjHeight, minHeight);
-			heightmap[hIndex++] = adjHeight;
+			hIndex = z * World.Width + x;
+			for (i = 0; i < count; i++) {
+				height = hLow[i] * 0.5f;
+				if (height < 0) height *= 0.8f;
+
+				adjHeight = (int)(height + waterLevel);
+				heightmap[hIndex++] = adjHeight;
+			}
 		}
 	}
 }
 
+static void NotchyGen_CreateHeightmap(void) {
+	int i;
+	CombinedNoise_Init(&heightNoise1, &rnd, 8, 8);
+	CombinedNoise_Init(&heightNoise2, &rnd, 8, 8);	
+	OctaveNoise_Init(&heightNoise3, &rnd, 6);
+
+	Gen_CurrentState = "Building heightmap";
+	Gen_ForEachSlab(NotchyGen_HeightmapSlab);
+
+	for (i = 0; i < World.Width * World.Length; i++) {
+		minHeight = min(heightmap[i], minHeight);
+	}
+}
+
 static int NotchyGen_CreateStrataFast(void) {
 	cc_uint32 oneY = (cc_uint32)World.OneY;
 	int stoneHeight, airHeight;
@@ -363,23 +559,25 @@ static int NotchyGen_CreateStrataFast(void) {
 	return max(stoneHeight, 1);
 }
 
-static void NotchyGen_CreateStrata(void) {
-	int dirtThickness, dirtHeight;
-	int minStoneY, stoneHeight;
-	int hIndex = 0, maxY = World.MaxY, index = 0;
-	int x, y, z;
-	struct OctaveNoise n;
-
-	/* Try to bulk fill bottom of the map if possible */
-	minStoneY = NotchyGen_CreateStrataFast();
-	OctaveNoise_Init(&n, &rnd, 8);
+static struct OctaveNoise strataNoise;
+static int minStoneY;
 
-	Gen_CurrentState = "Creating strata";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+static void NotchyGen_StrataSlab(int zBeg, int zEnd) {
+	int dirtThickness, dirtHeight, stoneHeight;
+	int hIndex = zBeg * World.Width, maxY = World.MaxY, index = 0;
+	float xs[NOISE_ROW_SIZE], noise[NOISE_ROW_SIZE];
+	int x, y, z, i, count;
 
+	for (z = zBeg; z < zEnd; z++) {
 		for (x = 0; x < World.Width; x++) {
-			dirtThickness = (int)(OctaveNoise_Calc(&n, (float)x, (float)z) / 24 - 4);
+			/* Calculate noise for the next row of columns */
+			if ((x % NOISE_ROW_SIZE) == 0) {
+				count = min(World.Width - x, NOISE_ROW_SIZE);
+				for (i = 0; i < count; i++) xs[i] = (float)(x + i);
+				OctaveNoise_CalcRow(&strataNoise, xs, (float)z, noise, count);
+			}
+
+			dirtThickness = (int)(noise[x % NOISE_ROW_SIZE] / 24 - 4);
 			dirtHeight    = heightmap[hIndex++];
 			stoneHeight   = dirtHeight + dirtThickness;
 
@@ -400,6 +598,15 @@ static void NotchyGen_CreateStrata(void) {
 	}
 }
 
+static void NotchyGen_CreateStrata(void) {
+	/* Try to bulk fill bottom of the map if possible */
+	minStoneY = NotchyGen_CreateStrataFast();
+	OctaveNoise_Init(&strataNoise, &rnd, 8);
+
+	Gen_CurrentState = "Creating strata";
+	Gen_ForEachSlab(NotchyGen_StrataSlab);
+}
+
 static void NotchyGen_CarveCaves(void) {
 	int cavesCount, caveLen;
 	float caveX, caveY, caveZ;
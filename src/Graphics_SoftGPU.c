@@ -4,6 +4,14 @@
 #include "Errors.h"
 #include "Window.h"
 
+/* Stops the compiler fusing multiplies and adds (e.g. into FMA instructions), so that the SIMD */
+/*  and scalar rasterizers round intermediate results exactly the same way */
+#if defined __clang__
+	#pragma STDC FP_CONTRACT OFF
+#elif defined __GNUC__
+	#pragma GCC optimize("fp-contract=off")
+#endif
+
 static cc_bool faceCulling;
 static int fb_width, fb_height; 
 static struct Bitmap fb_bmp;
@@ -22,6 +30,11 @@ static int db_stride;
 
 static void* gfx_vertices;
 static GfxResourceID white_square;
+/* Whether state used when rasterizing triangles has changed */
+static cc_bool stateDirty = true;
+static void FlushTiles(void);
+static void StartRasterWorkers(void);
+static void StopRasterWorkers(void);
 
 void Gfx_RestoreState(void) {
 	InitDefaultResources();
@@ -50,6 +63,7 @@ void Gfx_Create(void) {
 	Gfx.Created      = true;
 	Gfx.BackendType  = CC_GFX_BACKEND_SOFTGPU;
 	
+	StartRasterWorkers();
 	Gfx_RestoreState();
 }
 
@@ -60,6 +74,7 @@ static void DestroyBuffers(void) {
 }
 
 void Gfx_Free(void) { 
+	StopRasterWorkers();
 	Gfx_FreeState();
 	DestroyBuffers();
 }
@@ -86,11 +101,13 @@ void Gfx_BindTexture(GfxResourceID texId) {
 
 	texWidthMask  = (1 << Math_ilog2(tex->width))  - 1;
 	texHeightMask = (1 << Math_ilog2(tex->height)) - 1;
+	stateDirty    = true;
 }
 		
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	GfxResourceID data = *texId;
-	if (data) Mem_Free(data);
+	/* Binned triangles may still be using this texture */
+	if (data) { FlushTiles(); Mem_Free(data); }
 	*texId = NULL;
 }
 		
@@ -107,6 +124,7 @@ static GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8
 void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) {
 	CCTexture* tex = (CCTexture*)texId;
 	BitmapCol* dst = (tex->pixels + x) + y * tex->width;
+	FlushTiles();
 
 	CopyTextureData(dst, tex->width * BITMAPCOLOR_SIZE,
 					part, rowWidth  * BITMAPCOLOR_SIZE);
@@ -131,10 +149,12 @@ void Gfx_SetFaceCulling(cc_bool enabled) {
 
 static void SetAlphaTest(cc_bool enabled) {
 	/* Uses value from Gfx_SetAlphaTest */
+	stateDirty = true;
 }
 
 static void SetAlphaBlend(cc_bool enabled) {
 	/* Uses value from Gfx_SetAlphaBlending */
+	stateDirty = true;
 }
 
 void Gfx_SetAlphaArgBlend(cc_bool enabled) { }
@@ -163,6 +183,7 @@ static void ClearDepthBuffer(void) {
 }
 
 void Gfx_ClearBuffers(GfxBuffers buffers) {
+	FlushTiles();
 	if (buffers & GFX_BUFFER_COLOR) ClearColorBuffer();
 	if (buffers & GFX_BUFFER_DEPTH) ClearDepthBuffer();
 }
@@ -177,11 +198,13 @@ void Gfx_ClearColor(PackedCol color) {
 }
 
 void Gfx_SetDepthTest(cc_bool enabled) {
-	depthTest = enabled;
+	depthTest  = enabled;
+	stateDirty = true;
 }
 
 void Gfx_SetDepthWrite(cc_bool enabled) {
 	depthWrite = enabled;
+	stateDirty = true;
 }
 
 static void SetColorWrite(cc_bool r, cc_bool g, cc_bool b, cc_bool a) {
@@ -189,7 +212,8 @@ static void SetColorWrite(cc_bool r, cc_bool g, cc_bool b, cc_bool a) {
 }
 
 void Gfx_DepthOnlyRendering(cc_bool depthOnly) {
-	colWrite = !depthOnly;
+	colWrite   = !depthOnly;
+	stateDirty = true;
 }
 
 
@@ -384,63 +408,573 @@ static CC_INLINE int FastFloor(float value) {
 
 #define edgeFunction(ax,ay, bx,by, cx,cy) (((bx) - (ax)) * ((cy) - (ay)) - ((by) - (ay)) * ((cx) - (ax)))
 
-static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+/* Narrows [beg, end] (pixel offsets from start of row) to the pixels which may be inside the given edge */
+/* NOTE: The range is conservative, so pixels within it still need to be tested */
+static CC_INLINE void NarrowSpan(double bc, int dx, int area, int* beg, int* end) {
+	/* Pixels are inside an edge when its edge function has the same sign as the triangle's area */
+	double f = area > 0 ? bc : -bc;
+	double d = area > 0 ? dx : -dx;
+	double k;
+
+	if (d > 0) {
+		k = -f / d;
+		if (k > *end + 1) { *beg = *end + 1; return; }
+		if (k > *beg + 1) *beg = (int)k - 1;
+	} else if (d < 0) {
+		k = f / -d;
+		if (k < *beg - 1) { *end = *beg - 1; return; }
+		if (k < *end - 1) *end = (int)k + 1;
+	} else if (f < 0) {
+		*beg = *end + 1;
+	}
+}
+
+/* Calculates the range of pixels in a row which may be inside the triangle */
+static CC_INLINE void CalcRowSpan(double bc0, double bc1, double bc2, int dx12, int dx20, int dx01,
+								int area, int* beg, int* end) {
+	if (!area) return;
+	NarrowSpan(bc0, dx12, area, beg, end);
+	NarrowSpan(bc1, dx20, area, beg, end);
+	NarrowSpan(bc2, dx01, area, beg, end);
+}
+
+/* State that affects how the pixels of a triangle are drawn */
+struct RasterState {
+	BitmapCol* texPixels;
+	int texWidth, texHeight;
+	int texWidthMask, texHeightMask;
+	cc_bool textured, alphaTest, alphaBlend;
+	cc_bool depthTest, depthWrite, colWrite;
+};
+static struct RasterState curState;
+
+static void UpdateRasterState(void) {
+	curState.texPixels     = curTexPixels;
+	curState.texWidth      = curTexWidth;
+	curState.texHeight     = curTexHeight;
+	curState.texWidthMask  = texWidthMask;
+	curState.texHeightMask = texHeightMask;
+
+	curState.textured   = gfx_format == VERTEX_FORMAT_TEXTURED;
+	curState.alphaTest  = gfx_alphaTest;
+	curState.alphaBlend = gfx_alphaBlend;
+	curState.depthTest  = depthTest;
+	curState.depthWrite = depthWrite;
+	curState.colWrite   = colWrite;
+}
+
+/*########################################################################################################################*
+*------------------------------------------------------SIMD rasterizer----------------------------------------------------*
+*#########################################################################################################################*/
+/* On CPUs with SSE2 or NEON support, triangles are tested and shaded 4 pixels at a time */
+/* NOTE: SIMD rasterization is only used for triangles whose edge functions can be exactly */
+/*  represented as floats, so it produces exactly the same results as scalar rasterization */
+/*  (as long as scalar float math isn't done at higher precision, e.g. using x87 instructions) */
+#if !defined SOFTGPU_DISABLE_SIMD && !defined BITMAP_16BPP
+	#if defined __SSE2_MATH__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+		#define SOFTGPU_SIMD_SSE2
+	#elif defined __ARM_NEON && defined __aarch64__
+		#define SOFTGPU_SIMD_NEON
+	#endif
+#endif
+
+#if defined SOFTGPU_SIMD_SSE2
+#include <emmintrin.h>
+typedef __m128  SimdF;
+typedef __m128i SimdI;
+
+static CC_INLINE SimdF SimdF_Splat(float v) { return _mm_set1_ps(v); }
+static CC_INLINE SimdF SimdF_Make(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static CC_INLINE SimdF SimdF_Load(const float* p) { return _mm_loadu_ps(p); }
+static CC_INLINE void  SimdF_Store(float* p, SimdF v) { _mm_storeu_ps(p, v); }
+
+static CC_INLINE SimdF SimdF_Add(SimdF a, SimdF b) { return _mm_add_ps(a, b); }
+static CC_INLINE SimdF SimdF_Sub(SimdF a, SimdF b) { return _mm_sub_ps(a, b); }
+static CC_INLINE SimdF SimdF_Mul(SimdF a, SimdF b) { return _mm_mul_ps(a, b); }
+static CC_INLINE SimdF SimdF_Div(SimdF a, SimdF b) { return _mm_div_ps(a, b); }
+static CC_INLINE SimdF SimdF_Abs(SimdF a) { return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF))); }
+
+static CC_INLINE SimdI SimdF_Less(SimdF a, SimdF b)    { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+static CC_INLINE SimdI SimdF_Greater(SimdF a, SimdF b) { return _mm_castps_si128(_mm_cmpgt_ps(a, b)); }
+static CC_INLINE SimdI SimdF_Truncate(SimdF a) { return _mm_cvttps_epi32(a); }
+static CC_INLINE SimdF SimdI_ToFloat(SimdI a)  { return _mm_cvtepi32_ps(a); }
+static CC_INLINE SimdF SimdF_Select(SimdI mask, SimdF a, SimdF b) {
+	SimdF m = _mm_castsi128_ps(mask);
+	return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+
+static CC_INLINE SimdI SimdI_Splat(int v) { return _mm_set1_epi32(v); }
+static CC_INLINE SimdI SimdI_Load(const void* p) { return _mm_loadu_si128((const __m128i*)p); }
+static CC_INLINE void  SimdI_Store(void* p, SimdI v) { _mm_storeu_si128((__m128i*)p, v); }
+
+static CC_INLINE SimdI SimdI_Add(SimdI a, SimdI b) { return _mm_add_epi32(a, b); }
+static CC_INLINE SimdI SimdI_And(SimdI a, SimdI b) { return _mm_and_si128(a, b); }
+static CC_INLINE SimdI SimdI_Or(SimdI a, SimdI b)  { return _mm_or_si128(a, b); }
+static CC_INLINE SimdI SimdI_Less(SimdI a, SimdI b) { return _mm_cmplt_epi32(a, b); }
+static CC_INLINE SimdI SimdI_Select(SimdI mask, SimdI a, SimdI b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#define SimdI_ShiftLeft(a, bits)  _mm_slli_epi32(a, bits)
+#define SimdI_ShiftRight(a, bits) _mm_srli_epi32(a, bits)
+
+static CC_INLINE cc_bool SimdI_AllSet(SimdI mask) { return _mm_movemask_epi8(mask) == 0xFFFF; }
+
+/* Calculates (a * b) >> 8 for each 8 bit component */
+static CC_INLINE SimdI SimdI_MulBytes(SimdI a, SimdI b) {
+	SimdI zero = _mm_setzero_si128();
+	SimdI lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+	SimdI hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+/* Calculates (a * alpha + b * (255 - alpha)) >> 8 for each 8 bit component */
+static CC_INLINE SimdI SimdI_BlendBytes(SimdI a, SimdI b, SimdI alpha) {
+	SimdI zero  = _mm_setzero_si128();
+	SimdI inv   = _mm_xor_si128(alpha, _mm_set1_epi8((char)0xFF));
+	SimdI lo    = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(alpha, zero)),
+								_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(inv,   zero)));
+	SimdI hi    = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(alpha, zero)),
+								_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(inv,   zero)));
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+#define SOFTGPU_SIMD
+#elif defined SOFTGPU_SIMD_NEON
+#include <arm_neon.h>
+typedef float32x4_t SimdF;
+typedef int32x4_t   SimdI;
+
+static CC_INLINE SimdF SimdF_Splat(float v) { return vdupq_n_f32(v); }
+static CC_INLINE SimdF SimdF_Make(float a, float b, float c, float d) {
+	float v[4]; v[0] = a; v[1] = b; v[2] = c; v[3] = d;
+	return vld1q_f32(v);
+}
+static CC_INLINE SimdF SimdF_Load(const float* p) { return vld1q_f32(p); }
+static CC_INLINE void  SimdF_Store(float* p, SimdF v) { vst1q_f32(p, v); }
+
+static CC_INLINE SimdF SimdF_Add(SimdF a, SimdF b) { return vaddq_f32(a, b); }
+static CC_INLINE SimdF SimdF_Sub(SimdF a, SimdF b) { return vsubq_f32(a, b); }
+static CC_INLINE SimdF SimdF_Mul(SimdF a, SimdF b) { return vmulq_f32(a, b); }
+static CC_INLINE SimdF SimdF_Div(SimdF a, SimdF b) { return vdivq_f32(a, b); }
+static CC_INLINE SimdF SimdF_Abs(SimdF a) { return vabsq_f32(a); }
+
+static CC_INLINE SimdI SimdF_Less(SimdF a, SimdF b)    { return vreinterpretq_s32_u32(vcltq_f32(a, b)); }
+static CC_INLINE SimdI SimdF_Greater(SimdF a, SimdF b) { return vreinterpretq_s32_u32(vcgtq_f32(a, b)); }
+static CC_INLINE SimdI SimdF_Truncate(SimdF a) { return vcvtq_s32_f32(a); }
+static CC_INLINE SimdF SimdI_ToFloat(SimdI a)  { return vcvtq_f32_s32(a); }
+static CC_INLINE SimdF SimdF_Select(SimdI mask, SimdF a, SimdF b) {
+	return vbslq_f32(vreinterpretq_u32_s32(mask), a, b);
+}
+
+static CC_INLINE SimdI SimdI_Splat(int v) { return vdupq_n_s32(v); }
+static CC_INLINE SimdI SimdI_Load(const void* p) { return vld1q_s32((const int32_t*)p); }
+static CC_INLINE void  SimdI_Store(void* p, SimdI v) { vst1q_s32((int32_t*)p, v); }
+
+static CC_INLINE SimdI SimdI_Add(SimdI a, SimdI b) { return vaddq_s32(a, b); }
+static CC_INLINE SimdI SimdI_And(SimdI a, SimdI b) { return vandq_s32(a, b); }
+static CC_INLINE SimdI SimdI_Or(SimdI a, SimdI b)  { return vorrq_s32(a, b); }
+static CC_INLINE SimdI SimdI_Less(SimdI a, SimdI b) { return vreinterpretq_s32_u32(vcltq_s32(a, b)); }
+static CC_INLINE SimdI SimdI_Select(SimdI mask, SimdI a, SimdI b) {
+	return vbslq_s32(vreinterpretq_u32_s32(mask), a, b);
+}
+#define SimdI_ShiftLeft(a, bits)  vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(a), vdupq_n_s32( (bits))))
+#define SimdI_ShiftRight(a, bits) vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(a), vdupq_n_s32(-(bits))))
+
+static CC_INLINE cc_bool SimdI_AllSet(SimdI mask) { return vminvq_u32(vreinterpretq_u32_s32(mask)) == 0xFFFFFFFFU; }
+
+/* Calculates (a * b) >> 8 for each 8 bit component */
+static CC_INLINE SimdI SimdI_MulBytes(SimdI a, SimdI b) {
+	uint8x16_t a8 = vreinterpretq_u8_s32(a), b8 = vreinterpretq_u8_s32(b);
+	uint16x8_t lo = vmull_u8(vget_low_u8(a8),  vget_low_u8(b8));
+	uint16x8_t hi = vmull_u8(vget_high_u8(a8), vget_high_u8(b8));
+	return vreinterpretq_s32_u8(vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+}
+
+/* Calculates (a * alpha + b * (255 - alpha)) >> 8 for each 8 bit component */
+static CC_INLINE SimdI SimdI_BlendBytes(SimdI a, SimdI b, SimdI alpha) {
+	uint8x16_t a8 = vreinterpretq_u8_s32(a), b8 = vreinterpretq_u8_s32(b);
+	uint8x16_t al = vreinterpretq_u8_s32(alpha), inv = vmvnq_u8(al);
+	uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(a8),  vget_low_u8(al)),  vget_low_u8(b8),  vget_low_u8(inv));
+	uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(a8), vget_high_u8(al)), vget_high_u8(b8), vget_high_u8(inv));
+	return vreinterpretq_s32_u8(vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8)));
+}
+#define SOFTGPU_SIMD
+#endif
+
+#ifdef SOFTGPU_SIMD
+/* Edge functions of a triangle at (minX + 0.5, minY + 0.5), and how they change per X/Y step */
+struct TriEdges {
+	double bc0, bc1, bc2;
+	int dx12, dx20, dx01;
+	int dy12, dy20, dy01;
+	int area;
+	float factor;
+};
+
+/* Values of the edge functions (which are multiples of 0.5) are only exactly */
+/*  representable as floats when their magnitude is less than 2^22 */
+#define SIMD_MAX_EDGE 4194304.0
+#define EdgeInRange(value) ((value) > -SIMD_MAX_EDGE && (value) < SIMD_MAX_EDGE)
+
+static cc_bool EdgeIsExact(double bc, int dx, int dy, int width, int height) {
+	/* Edge functions are linear, so are largest at one of the corners */
+	/* NOTE: Last group of pixels in each row may extend up to 3 pixels past maxX */
+	double x = (double)dx * (width + 3);
+	double y = (double)dy * height;
+
+	return EdgeInRange(bc)     && EdgeInRange(bc + x)
+		&& EdgeInRange(bc + y) && EdgeInRange(bc + x + y);
+}
+
+static cc_bool TriEdges_Exact(const struct TriEdges* e, int minX, int minY, int maxX, int maxY) {
+	int width = maxX - minX, height = maxY - minY;
+	return EdgeIsExact(e->bc0, e->dx12, e->dy12, width, height)
+		&& EdgeIsExact(e->bc1, e->dx20, e->dy20, width, height)
+		&& EdgeIsExact(e->bc2, e->dx01, e->dy01, width, height);
+}
+
+/* Interpolation state shared by every group of 4 pixels in a triangle */
+struct SimdSetup {
+	SimdF factor, zero, one;
+	SimdF w0, w1, w2, z0, z1, z2;
+	SimdF u0, u1, u2, v0, v1, v2;
+	SimdF texWidth, texHeight;
+	SimdI texWidthMask, texHeightMask;
+	SimdI color, byteMask, alphaMask, alphaCutoff;
+};
+
+static void SimdSetup_Init(struct SimdSetup* p, const struct RasterState* s, float factor, PackedCol color) {
+	p->factor = SimdF_Splat(factor);
+	p->zero   = SimdF_Splat(0.0f);
+	p->one    = SimdF_Splat(1.0f);
+
+	p->texWidth      = SimdF_Splat((float)s->texWidth);
+	p->texHeight     = SimdF_Splat((float)s->texHeight);
+	p->texWidthMask  = SimdI_Splat(s->texWidthMask);
+	p->texHeightMask = SimdI_Splat(s->texHeightMask);
+
+	p->color       = SimdI_Splat((int)BitmapCol_Make(PackedCol_R(color), PackedCol_G(color),
+												PackedCol_B(color), PackedCol_A(color)));
+	p->byteMask    = SimdI_Splat(0xFF);
+	p->alphaMask   = SimdI_Splat((int)BITMAPCOLOR_A_MASK);
+	p->alphaCutoff = SimdI_Splat(0x80);
+}
+
+/* Fetches the texels at the given texture coordinates for each pixel */
+static CC_INLINE SimdI SimdSample(const struct RasterState* s, SimdI texX, SimdI texY) {
+	int x[4], y[4];
+	BitmapCol texels[4];
+	int i;
+
+	SimdI_Store(x, texX);
+	SimdI_Store(y, texY);
+	for (i = 0; i < 4; i++) 
+	{
+		texels[i] = s->texPixels[y[i] * s->texWidth + x[i]];
+	}
+	return SimdI_Load(texels);
+}
+
+/* Returns mask of the pixels which fail the alpha test */
+static CC_INLINE SimdI SimdAlphaTest(const struct SimdSetup* p, SimdI pixels) {
+	SimdI alpha = SimdI_And(SimdI_ShiftRight(pixels, BITMAPCOLOR_A_SHIFT), p->byteMask);
+	return SimdI_Less(alpha, p->alphaCutoff);
+}
+
+/* Blends the pixels that were not skipped into the color buffer */
+static CC_INLINE void SimdWritePixels(const struct RasterState* s, const struct SimdSetup* p, 
+								SimdI pixels, SimdI skip, BitmapCol* cb) {
+	SimdI alpha, dst = SimdI_Load(cb);
+
+	if (s->alphaBlend) {
+		alpha  = SimdI_And(SimdI_ShiftRight(pixels, BITMAPCOLOR_A_SHIFT), p->byteMask);
+		alpha  = SimdI_Or(SimdI_Or(alpha, SimdI_ShiftLeft(alpha, 8)), 
+						 SimdI_Or(SimdI_ShiftLeft(alpha, 16), SimdI_ShiftLeft(alpha, 24)));
+		pixels = SimdI_BlendBytes(pixels, dst, alpha);
+	}
+
+	pixels = SimdI_Or(pixels, p->alphaMask);
+	SimdI_Store(cb, SimdI_Select(skip, dst, pixels));
+}
+
+static CC_INLINE void SimdGroup2D(const struct RasterState* s, const struct SimdSetup* p, 
+								SimdF bc0, SimdF bc1, SimdF bc2, SimdI skip, BitmapCol* cb) {
+	SimdF ic0 = SimdF_Mul(bc0, p->factor);
+	SimdF ic1 = SimdF_Mul(bc1, p->factor);
+	SimdF ic2 = SimdF_Mul(bc2, p->factor);
+	SimdF u, v;
+	SimdI texX, texY, pixels;
+
+	skip = SimdI_Or(skip, SimdI_Or(SimdF_Less(ic0, p->zero), 
+						SimdI_Or(SimdF_Less(ic1, p->zero), SimdF_Less(ic2, p->zero))));
+	if (SimdI_AllSet(skip)) return;
+
+	if (s->textured) {
+		u = SimdF_Add(SimdF_Add(SimdF_Mul(ic0, p->u0), SimdF_Mul(ic1, p->u1)), SimdF_Mul(ic2, p->u2));
+		v = SimdF_Add(SimdF_Add(SimdF_Mul(ic0, p->v0), SimdF_Mul(ic1, p->v1)), SimdF_Mul(ic2, p->v2));
+		texX   = SimdI_And(SimdF_Truncate(u), p->texWidthMask);
+		texY   = SimdI_And(SimdF_Truncate(v), p->texHeightMask);
+		pixels = SimdI_MulBytes(SimdSample(s, texX, texY), p->color);
+	} else {
+		pixels = p->color;
+	}
+
+	if (s->alphaTest) {
+		skip = SimdI_Or(skip, SimdAlphaTest(p, pixels));
+		if (SimdI_AllSet(skip)) return;
+	}
+	SimdWritePixels(s, p, pixels, skip, cb);
+}
+
+/* Calculates (int)(|value - FastFloor(value)| * scale) */
+static CC_INLINE SimdI SimdWrapCoord(SimdF value, SimdF scale) {
+	SimdI floor = SimdF_Truncate(value);
+	/* Comparison mask is -1 when truncation rounded up */
+	floor = SimdI_Add(floor, SimdF_Greater(SimdI_ToFloat(floor), value));
+	return SimdF_Truncate(SimdF_Mul(SimdF_Abs(SimdF_Sub(value, SimdI_ToFloat(floor))), scale));
+}
+
+static CC_INLINE void SimdGroup3D(const struct RasterState* s, const struct SimdSetup* p, 
+								SimdF bc0, SimdF bc1, SimdF bc2, SimdI skip, BitmapCol* cb, float* db) {
+	SimdF ic0 = SimdF_Mul(bc0, p->factor);
+	SimdF ic1 = SimdF_Mul(bc1, p->factor);
+	SimdF ic2 = SimdF_Mul(bc2, p->factor);
+	SimdF w, u, v;
+	SimdI texX, texY, pixels;
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+	SimdF z, depth;
+#endif
+
+	skip = SimdI_Or(skip, SimdI_Or(SimdF_Less(ic0, p->zero), 
+						SimdI_Or(SimdF_Less(ic1, p->zero), SimdF_Less(ic2, p->zero))));
+	if (SimdI_AllSet(skip)) return;
+
+	w = SimdF_Div(p->one, SimdF_Add(SimdF_Add(SimdF_Mul(ic0, p->w0), SimdF_Mul(ic1, p->w1)), SimdF_Mul(ic2, p->w2)));
+
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+	z = SimdF_Mul(SimdF_Add(SimdF_Add(SimdF_Mul(ic0, p->z0), SimdF_Mul(ic1, p->z1)), SimdF_Mul(ic2, p->z2)), w);
+	depth = SimdF_Load(db);
+	if (s->depthTest) {
+		skip = SimdI_Or(skip, SimdI_Or(SimdF_Less(z, p->zero), SimdF_Greater(z, depth)));
+		if (SimdI_AllSet(skip)) return;
+	}
+	if (!s->colWrite) {
+		if (s->depthWrite) SimdF_Store(db, SimdF_Select(skip, depth, z));
+		return;
+	}
+#else
+	if (!s->colWrite) return;
+#endif
+
+	if (s->textured) {
+		u = SimdF_Mul(SimdF_Add(SimdF_Add(SimdF_Mul(ic0, p->u0), SimdF_Mul(ic1, p->u1)), SimdF_Mul(ic2, p->u2)), w);
+		v = SimdF_Mul(SimdF_Add(SimdF_Add(SimdF_Mul(ic0, p->v0), SimdF_Mul(ic1, p->v1)), SimdF_Mul(ic2, p->v2)), w);
+		texX   = SimdI_And(SimdWrapCoord(u, p->texWidth),  p->texWidthMask);
+		texY   = SimdI_And(SimdWrapCoord(v, p->texHeight), p->texHeightMask);
+		pixels = SimdI_MulBytes(SimdSample(s, texX, texY), p->color);
+	} else {
+		pixels = p->color;
+	}
+
+	if (s->alphaTest) {
+		skip = SimdI_Or(skip, SimdAlphaTest(p, pixels));
+		if (SimdI_AllSet(skip)) return;
+	}
+	SimdWritePixels(s, p, pixels, skip, cb);
+
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+	if (s->depthWrite) SimdF_Store(db, SimdF_Select(skip, depth, z));
+#endif
+}
+
+/* Masks for the lanes past the end of a row, indexed by number of remaining pixels */
+static const int tailMasks[4][4] = {
+	{ -1, -1, -1, -1 }, { 0, -1, -1, -1 }, { 0, 0, -1, -1 }, { 0, 0, 0, -1 }
+};
+
+static void RasterTriangle2D_Simd(const struct RasterState* s, const Vertex* V0, const Vertex* V1, const Vertex* V2,
+								const struct TriEdges* e, int minX, int minY, int maxX, int maxY) {
+	struct SimdSetup p;
+	SimdF bc0, bc1, bc2, step0, step1, step2, lanes0, lanes1, lanes2;
+	BitmapCol tmp[4];
+	BitmapCol* cb;
+	double row0, row1, row2;
+	int x, y, i, count, beg, end;
+
+	SimdSetup_Init(&p, s, e->factor, V0->c);
+	p.u0 = SimdF_Splat(V0->u * s->texWidth);  p.v0 = SimdF_Splat(V0->v * s->texHeight);
+	p.u1 = SimdF_Splat(V1->u * s->texWidth);  p.v1 = SimdF_Splat(V1->v * s->texHeight);
+	p.u2 = SimdF_Splat(V2->u * s->texWidth);  p.v2 = SimdF_Splat(V2->v * s->texHeight);
+
+	lanes0 = SimdF_Make(0.0f, (float)e->dx12, (float)(2.0 * e->dx12), (float)(3.0 * e->dx12));
+	lanes1 = SimdF_Make(0.0f, (float)e->dx20, (float)(2.0 * e->dx20), (float)(3.0 * e->dx20));
+	lanes2 = SimdF_Make(0.0f, (float)e->dx01, (float)(2.0 * e->dx01), (float)(3.0 * e->dx01));
+	step0  = SimdF_Splat((float)(4.0 * e->dx12));
+	step1  = SimdF_Splat((float)(4.0 * e->dx20));
+	step2  = SimdF_Splat((float)(4.0 * e->dx01));
+
+	for (y = minY; y <= maxY; y++)
+	{
+		row0 = e->bc0 + (double)(y - minY) * e->dy12;
+		row1 = e->bc1 + (double)(y - minY) * e->dy20;
+		row2 = e->bc2 + (double)(y - minY) * e->dy01;
+
+		beg = 0; end = maxX - minX;
+		CalcRowSpan(row0, row1, row2, e->dx12, e->dx20, e->dx01, e->area, &beg, &end);
+		if (beg > end) continue;
+
+		bc0 = SimdF_Add(SimdF_Splat((float)(row0 + (double)beg * e->dx12)), lanes0);
+		bc1 = SimdF_Add(SimdF_Splat((float)(row1 + (double)beg * e->dx20)), lanes1);
+		bc2 = SimdF_Add(SimdF_Splat((float)(row2 + (double)beg * e->dx01)), lanes2);
+		cb  = &colorBuffer[y * cb_stride + minX + beg];
+
+		for (x = minX + beg; x <= minX + end - 3; x += 4, cb += 4)
+		{
+			SimdGroup2D(s, &p, bc0, bc1, bc2, SimdI_Splat(0), cb);
+			bc0 = SimdF_Add(bc0, step0); bc1 = SimdF_Add(bc1, step1); bc2 = SimdF_Add(bc2, step2);
+		}
+		if (x > minX + end) continue;
+
+		/* Avoid reading/writing past the end of the row */
+		count = minX + end - x + 1;
+		for (i = 0; i < count; i++) tmp[i] = cb[i];
+		SimdGroup2D(s, &p, bc0, bc1, bc2, SimdI_Load(tailMasks[count]), tmp);
+		for (i = 0; i < count; i++) cb[i] = tmp[i];
+	}
+}
+
+static void RasterTriangle3D_Simd(const struct RasterState* s, const Vertex* V0, const Vertex* V1, const Vertex* V2,
+								const struct TriEdges* e, int minX, int minY, int maxX, int maxY) {
+	struct SimdSetup p;
+	SimdF bc0, bc1, bc2, step0, step1, step2, lanes0, lanes1, lanes2;
+	BitmapCol tmpColor[4];
+	float tmpDepth[4] = { 0 };
+	BitmapCol* cb;
+	float* db;
+	double row0, row1, row2;
+	int x, y, i, count, beg, end;
+
+	SimdSetup_Init(&p, s, e->factor, V0->c);
+	p.w0 = SimdF_Splat(V0->w); p.z0 = SimdF_Splat(V0->z); p.u0 = SimdF_Splat(V0->u); p.v0 = SimdF_Splat(V0->v);
+	p.w1 = SimdF_Splat(V1->w); p.z1 = SimdF_Splat(V1->z); p.u1 = SimdF_Splat(V1->u); p.v1 = SimdF_Splat(V1->v);
+	p.w2 = SimdF_Splat(V2->w); p.z2 = SimdF_Splat(V2->z); p.u2 = SimdF_Splat(V2->u); p.v2 = SimdF_Splat(V2->v);
+
+	lanes0 = SimdF_Make(0.0f, (float)e->dx12, (float)(2.0 * e->dx12), (float)(3.0 * e->dx12));
+	lanes1 = SimdF_Make(0.0f, (float)e->dx20, (float)(2.0 * e->dx20), (float)(3.0 * e->dx20));
+	lanes2 = SimdF_Make(0.0f, (float)e->dx01, (float)(2.0 * e->dx01), (float)(3.0 * e->dx01));
+	step0  = SimdF_Splat((float)(4.0 * e->dx12));
+	step1  = SimdF_Splat((float)(4.0 * e->dx20));
+	step2  = SimdF_Splat((float)(4.0 * e->dx01));
+
+	for (y = minY; y <= maxY; y++)
+	{
+		row0 = e->bc0 + (double)(y - minY) * e->dy12;
+		row1 = e->bc1 + (double)(y - minY) * e->dy20;
+		row2 = e->bc2 + (double)(y - minY) * e->dy01;
+
+		beg = 0; end = maxX - minX;
+		CalcRowSpan(row0, row1, row2, e->dx12, e->dx20, e->dx01, e->area, &beg, &end);
+		if (beg > end) continue;
+
+		bc0 = SimdF_Add(SimdF_Splat((float)(row0 + (double)beg * e->dx12)), lanes0);
+		bc1 = SimdF_Add(SimdF_Splat((float)(row1 + (double)beg * e->dx20)), lanes1);
+		bc2 = SimdF_Add(SimdF_Splat((float)(row2 + (double)beg * e->dx01)), lanes2);
+		cb  = &colorBuffer[y * cb_stride + minX + beg];
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+		db  = &depthBuffer[y * db_stride + minX + beg];
+#else
+		db  = tmpDepth;
+#endif
+
+		for (x = minX + beg; x <= minX + end - 3; x += 4)
+		{
+			SimdGroup3D(s, &p, bc0, bc1, bc2, SimdI_Splat(0), cb, db);
+			bc0 = SimdF_Add(bc0, step0); bc1 = SimdF_Add(bc1, step1); bc2 = SimdF_Add(bc2, step2);
+
+			cb += 4;
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+			db += 4;
+#endif
+		}
+		if (x > minX + end) continue;
+
+		/* Avoid reading/writing past the end of the row */
+		count = minX + end - x + 1;
+		for (i = 0; i < count; i++) tmpColor[i] = cb[i];
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+		for (i = 0; i < count; i++) tmpDepth[i] = db[i];
+#endif
+
+		SimdGroup3D(s, &p, bc0, bc1, bc2, SimdI_Load(tailMasks[count]), tmpColor, tmpDepth);
+
+		for (i = 0; i < count; i++) cb[i] = tmpColor[i];
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+		for (i = 0; i < count; i++) db[i] = tmpDepth[i];
+#endif
+	}
+}
+#endif
+
+
+static void RasterTriangle2D(const struct RasterState* s, const Vertex* V0, const Vertex* V1, const Vertex* V2,
+							int minX, int minY, int maxX, int maxY) {
 	int x0 = (int)V0->x, y0 = (int)V0->y;
 	int x1 = (int)V1->x, y1 = (int)V1->y;
 	int x2 = (int)V2->x, y2 = (int)V2->y;
-	int minX = min(x0, min(x1, x2));
-	int minY = min(y0, min(y1, y2));
-	int maxX = max(x0, max(x1, x2));
-	int maxY = max(y0, max(y1, y2));
 
 	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
-	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
-
-	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
 	float factor = 1.0f / area;
 
-	float u0 = V0->u * curTexWidth,  u1 = V1->u * curTexWidth,  u2 = V2->u * curTexWidth;
-	float v0 = V0->v * curTexHeight, v1 = V1->v * curTexHeight, v2 = V2->v * curTexHeight;
+	float u0 = V0->u * s->texWidth,  u1 = V1->u * s->texWidth,  u2 = V2->u * s->texWidth;
+	float v0 = V0->v * s->texHeight, v1 = V1->v * s->texHeight, v2 = V2->v * s->texHeight;
 	PackedCol color = V0->c;
 	
 	// https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
 	// Essentially these are the deltas of edge functions between X/Y and X/Y + 1 (i.e. one X/Y step)
+	// NOTE: Edge functions are accumulated in doubles so they are always exact, which ensures
+	//  the same result no matter which pixel of the triangle rasterization starts from
 	int dx01  = y0 - y1, dy01 = x1 - x0;
 	int dx12  = y1 - y2, dy12 = x2 - x1;
 	int dx20  = y2 - y0, dy20 = x0 - x2;
 
-	float bc0_start = edgeFunction(x1,y1, x2,y2, minX+0.5f,minY+0.5f);
-	float bc1_start = edgeFunction(x2,y2, x0,y0, minX+0.5f,minY+0.5f);
-	float bc2_start = edgeFunction(x0,y0, x1,y1, minX+0.5f,minY+0.5f);
+	double bc0_start = edgeFunction(x1,y1, x2,y2, minX+0.5,minY+0.5);
+	double bc1_start = edgeFunction(x2,y2, x0,y0, minX+0.5,minY+0.5);
+	double bc2_start = edgeFunction(x0,y0, x1,y1, minX+0.5,minY+0.5);
+
+#ifdef SOFTGPU_SIMD
+	struct TriEdges e = { bc0_start, bc1_start, bc2_start, dx12, dx20, dx01, dy12, dy20, dy01, area, factor };
+	if (TriEdges_Exact(&e, minX, minY, maxX, maxY)) {
+		RasterTriangle2D_Simd(s, V0, V1, V2, &e, minX, minY, maxX, maxY);
+		return;
+	}
+#endif
 
 	for (int y = minY; y <= maxY; y++, bc0_start += dy12, bc1_start += dy20, bc2_start += dy01) 
 	{
-		float bc0 = bc0_start;
-		float bc1 = bc1_start;
-		float bc2 = bc2_start;
+		int beg = 0, end = maxX - minX;
+		CalcRowSpan(bc0_start, bc1_start, bc2_start, dx12, dx20, dx01, area, &beg, &end);
 
-		for (int x = minX; x <= maxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
+		double bc0 = bc0_start + (double)beg * dx12;
+		double bc1 = bc1_start + (double)beg * dx20;
+		double bc2 = bc2_start + (double)beg * dx01;
+
+		for (int x = minX + beg; x <= minX + end; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
 		{
-			float ic0 = bc0 * factor;
-			float ic1 = bc1 * factor;
-			float ic2 = bc2 * factor;
+			float ic0 = (float)bc0 * factor;
+			float ic1 = (float)bc1 * factor;
+			float ic2 = (float)bc2 * factor;
 
 			if (ic0 < 0 || ic1 < 0 || ic2 < 0) continue;
 			int cb_index = y * cb_stride + x;
 
 			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+			if (s->textured) {
 				float u = ic0 * u0 + ic1 * u1 + ic2 * u2;
 				float v = ic0 * v0 + ic1 * v1 + ic2 * v2;
-				int texX = ((int)u) & texWidthMask;
-				int texY = ((int)v) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
+				int texX = ((int)u) & s->texWidthMask;
+				int texY = ((int)v) & s->texHeightMask;
+				int texIndex = texY * s->texWidth + texX;
 
-				BitmapCol tColor = curTexPixels[texIndex];
+				BitmapCol tColor = s->texPixels[texIndex];
 				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
 				A = ( a1 * a2 ) >> 8;
 				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
@@ -456,8 +990,8 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				A = PackedCol_A(color);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
-			if (gfx_alphaBlend) {
+			if (s->alphaTest && A < 0x80) continue;
+			if (s->alphaBlend) {
 				BitmapCol dst = colorBuffer[cb_index];
 				int dstR = BitmapCol_R(dst);
 				int dstG = BitmapCol_G(dst);
@@ -473,37 +1007,16 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	}
 }
 
-static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
+static void RasterTriangle3D(const struct RasterState* s, const Vertex* V0, const Vertex* V1, const Vertex* V2,
+							int minX, int minY, int maxX, int maxY) {
 	int x0 = (int)V0->x, y0 = (int)V0->y;
 	int x1 = (int)V1->x, y1 = (int)V1->y;
 	int x2 = (int)V2->x, y2 = (int)V2->y;
-	int minX = min(x0, min(x1, x2));
-	int minY = min(y0, min(y1, y2));
-	int maxX = max(x0, max(x1, x2));
-	int maxY = max(y0, max(y1, y2));
 
 	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
-	if (faceCulling) {
-		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
-		if (area < 0) return;
-	}
-
-	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
-
-	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
-
 	// NOTE: W in frag variables below is actually 1/W 
 	float factor = 1.0f / area;
 	float w0 = V0->w, w1 = V1->w, w2 = V2->w;
-	
-	// TODO proper clipping
-	if (w0 <= 0 || w1 <= 0 || w2 <= 0) {
-		return;
-	}
 
 	float z0 = V0->z, z1 = V1->z, z2 = V2->z;
 	float u0 = V0->u, u1 = V1->u, u2 = V2->u;
@@ -512,25 +1025,38 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	
 	// https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
 	// Essentially these are the deltas of edge functions between X/Y and X/Y + 1 (i.e. one X/Y step)
+	// NOTE: Edge functions are accumulated in doubles so they are always exact, which ensures
+	//  the same result no matter which pixel of the triangle rasterization starts from
 	int dx01  = y0 - y1, dy01 = x1 - x0;
 	int dx12  = y1 - y2, dy12 = x2 - x1;
 	int dx20  = y2 - y0, dy20 = x0 - x2;
 
-	float bc0_start = edgeFunction(x1,y1, x2,y2, minX+0.5f,minY+0.5f);
-	float bc1_start = edgeFunction(x2,y2, x0,y0, minX+0.5f,minY+0.5f);
-	float bc2_start = edgeFunction(x0,y0, x1,y1, minX+0.5f,minY+0.5f);
+	double bc0_start = edgeFunction(x1,y1, x2,y2, minX+0.5,minY+0.5);
+	double bc1_start = edgeFunction(x2,y2, x0,y0, minX+0.5,minY+0.5);
+	double bc2_start = edgeFunction(x0,y0, x1,y1, minX+0.5,minY+0.5);
+
+#ifdef SOFTGPU_SIMD
+	struct TriEdges e = { bc0_start, bc1_start, bc2_start, dx12, dx20, dx01, dy12, dy20, dy01, area, factor };
+	if (TriEdges_Exact(&e, minX, minY, maxX, maxY)) {
+		RasterTriangle3D_Simd(s, V0, V1, V2, &e, minX, minY, maxX, maxY);
+		return;
+	}
+#endif
 
 	for (int y = minY; y <= maxY; y++, bc0_start += dy12, bc1_start += dy20, bc2_start += dy01) 
 	{
-		float bc0 = bc0_start;
-		float bc1 = bc1_start;
-		float bc2 = bc2_start;
+		int beg = 0, end = maxX - minX;
+		CalcRowSpan(bc0_start, bc1_start, bc2_start, dx12, dx20, dx01, area, &beg, &end);
+
+		double bc0 = bc0_start + (double)beg * dx12;
+		double bc1 = bc1_start + (double)beg * dx20;
+		double bc2 = bc2_start + (double)beg * dx01;
 
-		for (int x = minX; x <= maxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
+		for (int x = minX + beg; x <= minX + end; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
 		{
-			float ic0 = bc0 * factor;
-			float ic1 = bc1 * factor;
-			float ic2 = bc2 * factor;
+			float ic0 = (float)bc0 * factor;
+			float ic1 = (float)bc1 * factor;
+			float ic2 = (float)bc2 * factor;
 			if (ic0 < 0 || ic1 < 0 || ic2 < 0) continue;
 			int db_index = y * db_stride + x;
 
@@ -538,24 +1064,24 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 			float z = (ic0 * z0 + ic1 * z1 + ic2 * z2) * w;
 
 #ifndef SOFTGPU_DISABLE_ZBUFFER
-			if (depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
-			if (!colWrite) {
-				if (depthWrite) depthBuffer[db_index] = z;
+			if (s->depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
+			if (!s->colWrite) {
+				if (s->depthWrite) depthBuffer[db_index] = z;
 				continue;
 			}
 #else
-			if (!colWrite) continue;
+			if (!s->colWrite) continue;
 #endif
 
 			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+			if (s->textured) {
 				float u = (ic0 * u0 + ic1 * u1 + ic2 * u2) * w;
 				float v = (ic0 * v0 + ic1 * v1 + ic2 * v2) * w;
-				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * curTexWidth )) & texWidthMask;
-				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * curTexHeight)) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
+				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * s->texWidth )) & s->texWidthMask;
+				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * s->texHeight)) & s->texHeightMask;
+				int texIndex = texY * s->texWidth + texX;
 
-				BitmapCol tColor = curTexPixels[texIndex];
+				BitmapCol tColor = s->texPixels[texIndex];
 				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
 				A = ( a1 * a2 ) >> 8;
 				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
@@ -571,10 +1097,10 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				A = PackedCol_A(color);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
+			if (s->alphaTest && A < 0x80) continue;
 			int cb_index = y * cb_stride + x;
 			
-			if (gfx_alphaBlend) {
+			if (s->alphaBlend) {
 				BitmapCol dst = colorBuffer[cb_index];
 				int dstR = BitmapCol_R(dst);
 				int dstG = BitmapCol_G(dst);
@@ -586,13 +1112,380 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 			}
 
 #ifndef SOFTGPU_DISABLE_ZBUFFER
-			if (depthWrite) depthBuffer[db_index] = z;
+			if (s->depthWrite) depthBuffer[db_index] = z;
 #endif
 			colorBuffer[cb_index] = BitmapCol_Make(R, G, B, 0xFF);
 		}
 	}
 }
 
+
+/*########################################################################################################################*
+*-------------------------------------------------------Tile binning------------------------------------------------------*
+*#########################################################################################################################*/
+/* When rasterizer threads are enabled, triangles are not drawn immediately. Instead: */
+/*   1) Each triangle is transformed to screen space, then recorded in every tile it overlaps */
+/*   2) When the frame ends (or the framebuffer/a texture is about to be changed), the */
+/*       tiles are rasterized in parallel by worker threads (and the main thread) */
+/* Since tiles never overlap and each tile draws its triangles in submission order, */
+/*  the resulting image is identical to drawing every triangle immediately */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_LOWMEM
+#define RASTER_MAX_WORKERS 16
+#define RASTER_TILE_SHIFT  5
+#define RASTER_TILE_SIZE   (1 << RASTER_TILE_SHIFT)
+/* Binned triangles are flushed early once this many have been recorded, to limit memory usage */
+#define RASTER_MAX_TRIS    65536
+
+/* A triangle in screen space, with its bounding box already clipped to the scissor region */
+struct RasterTri {
+	Vertex v[3];
+	int minX, minY, maxX, maxY;
+	int state;
+	cc_bool is3D;
+};
+
+struct RasterTile {
+	int* tris;
+	int count, capacity;
+	int minX, minY, maxX, maxY;
+};
+
+static struct RasterWorker {
+	void* thread;
+	void* wakeup;
+} workers[RASTER_MAX_WORKERS];
+static int workersCount, workersStarted;
+static volatile cc_bool workersStopping;
+
+static struct RasterTri* tris;
+static int trisCount, trisCapacity;
+static struct RasterState* states;
+static int statesCount, statesCapacity, binnedState = -1;
+
+static struct RasterTile* tiles;
+static int tilesX, tilesY, tilesCount;
+static void* tilesMutex;
+static void* tilesDone;
+static int nextTile, tilesLeft;
+static cc_bool tilesWaiting;
+
+static void RasterTile(struct RasterTile* tile) {
+	struct RasterTri* t;
+	int i, minX, minY, maxX, maxY;
+
+	for (i = 0; i < tile->count; i++)
+	{
+		t    = &tris[tile->tris[i]];
+		minX = max(t->minX, tile->minX); maxX = min(t->maxX, tile->maxX);
+		minY = max(t->minY, tile->minY); maxY = min(t->maxY, tile->maxY);
+
+		if (t->is3D) {
+			RasterTriangle3D(&states[t->state], &t->v[0], &t->v[1], &t->v[2], minX, minY, maxX, maxY);
+		} else {
+			RasterTriangle2D(&states[t->state], &t->v[0], &t->v[1], &t->v[2], minX, minY, maxX, maxY);
+		}
+	}
+}
+
+static struct RasterTile* NextTile(void) {
+	struct RasterTile* tile = NULL;
+
+	Mutex_Lock(tilesMutex);
+	/* Skip over tiles without any triangles */
+	while (nextTile < tilesCount && !tiles[nextTile].count) 
+	{
+		nextTile++; tilesLeft--;
+	}
+	if (nextTile < tilesCount) tile = &tiles[nextTile++];
+
+	if (!tilesLeft && tilesWaiting) {
+		tilesWaiting = false;
+		Waitable_Signal(tilesDone);
+	}
+	Mutex_Unlock(tilesMutex);
+	return tile;
+}
+
+static void FinishTile(void) {
+	Mutex_Lock(tilesMutex);
+	tilesLeft--;
+	if (!tilesLeft && tilesWaiting) {
+		tilesWaiting = false;
+		Waitable_Signal(tilesDone);
+	}
+	Mutex_Unlock(tilesMutex);
+}
+
+static void RunTiles(void) {
+	struct RasterTile* tile;
+	while ((tile = NextTile()))
+	{
+		RasterTile(tile);
+		FinishTile();
+	}
+}
+
+static void WorkerLoop(void) {
+	struct RasterWorker* worker;
+
+	Mutex_Lock(tilesMutex);
+	worker = &workers[workersStarted++];
+	Mutex_Unlock(tilesMutex);
+
+	for (;;)
+	{
+		Waitable_Wait(worker->wakeup);
+		if (workersStopping) return;
+		RunTiles();
+	}
+}
+
+static void ResetTiles(void) {
+	int i;
+	for (i = 0; i < tilesCount; i++) tiles[i].count = 0;
+
+	trisCount   = 0;
+	statesCount = 0;
+	binnedState = -1;
+}
+
+static void FlushTiles(void) {
+	cc_bool waiting;
+	int i;
+	if (!trisCount) return;
+
+	Mutex_Lock(tilesMutex);
+	{
+		nextTile  = 0;
+		tilesLeft = tilesCount;
+	}
+	Mutex_Unlock(tilesMutex);
+
+	for (i = 0; i < workersCount; i++) 
+	{
+		Waitable_Signal(workers[i].wakeup);
+	}
+	RunTiles();
+
+	/* Wait for worker threads to finish rasterizing any remaining tiles */
+	Mutex_Lock(tilesMutex);
+	tilesWaiting = tilesLeft > 0;
+	waiting      = tilesWaiting;
+	Mutex_Unlock(tilesMutex);
+	if (waiting) Waitable_Wait(tilesDone);
+
+	ResetTiles();
+}
+
+static void FreeTiles(void) {
+	int i;
+	ResetTiles();
+
+	for (i = 0; i < tilesCount; i++) 
+	{
+		Mem_Free(tiles[i].tris);
+	}
+	Mem_Free(tiles);
+
+	tiles      = NULL;
+	tilesCount = 0;
+}
+
+static void AllocTiles(int width, int height) {
+	struct RasterTile* tile;
+	int x, y;
+	if (!workersCount) return;
+	FreeTiles();
+
+	tilesX     = (width  + RASTER_TILE_SIZE - 1) >> RASTER_TILE_SHIFT;
+	tilesY     = (height + RASTER_TILE_SIZE - 1) >> RASTER_TILE_SHIFT;
+	tilesCount = tilesX * tilesY;
+	tiles      = (struct RasterTile*)Mem_AllocCleared(tilesCount, sizeof(struct RasterTile), "raster tiles");
+
+	for (y = 0; y < tilesY; y++)
+		for (x = 0; x < tilesX; x++)
+	{
+		tile = &tiles[y * tilesX + x];
+		tile->minX = x << RASTER_TILE_SHIFT;
+		tile->minY = y << RASTER_TILE_SHIFT;
+		tile->maxX = min(tile->minX + RASTER_TILE_SIZE, width)  - 1;
+		tile->maxY = min(tile->minY + RASTER_TILE_SIZE, height) - 1;
+	}
+}
+
+static void BinTriangle(const Vertex* V0, const Vertex* V1, const Vertex* V2, 
+						int minX, int minY, int maxX, int maxY, cc_bool is3D) {
+	struct RasterTile* tile;
+	struct RasterTri* t;
+	int x, y, index;
+	if (trisCount == RASTER_MAX_TRIS) FlushTiles();
+
+	if (binnedState == -1) {
+		if (statesCount == statesCapacity) {
+			statesCapacity = max(64, statesCapacity * 2);
+			states = (struct RasterState*)Mem_Realloc(states, statesCapacity, sizeof(struct RasterState), "raster states");
+		}
+		binnedState = statesCount++;
+		states[binnedState] = curState;
+	}
+
+	if (trisCount == trisCapacity) {
+		trisCapacity = min(RASTER_MAX_TRIS, max(1024, trisCapacity * 2));
+		tris = (struct RasterTri*)Mem_Realloc(tris, trisCapacity, sizeof(struct RasterTri), "raster triangles");
+	}
+	index = trisCount++;
+	t     = &tris[index];
+
+	t->v[0] = *V0; t->v[1] = *V1; t->v[2] = *V2;
+	t->minX = minX; t->minY = minY;
+	t->maxX = maxX; t->maxY = maxY;
+	t->state = binnedState;
+	t->is3D  = is3D;
+
+	maxX = min(maxX >> RASTER_TILE_SHIFT, tilesX - 1);
+	maxY = min(maxY >> RASTER_TILE_SHIFT, tilesY - 1);
+
+	for (y = minY >> RASTER_TILE_SHIFT; y <= maxY; y++)
+		for (x = minX >> RASTER_TILE_SHIFT; x <= maxX; x++)
+	{
+		tile = &tiles[y * tilesX + x];
+		if (tile->count == tile->capacity) {
+			tile->capacity = max(64, tile->capacity * 2);
+			tile->tris = (int*)Mem_Realloc(tile->tris, tile->capacity, 4, "raster tile");
+		}
+		tile->tris[tile->count++] = index;
+	}
+}
+
+static void StartRasterWorkers(void) {
+	int i, count = Options_GetInt(OPT_SOFTGPU_THREADS, 0, RASTER_MAX_WORKERS, 3);
+	if (!count) return;
+
+	tilesMutex = Mutex_Create("Raster tiles");
+	tilesDone  = Waitable_Create("Raster tiles done");
+	for (i = 0; i < count; i++) 
+	{
+		workers[i].wakeup = Waitable_Create("Raster worker");
+	}
+
+	workersCount    = count;
+	workersStopping = false;
+	for (i = 0; i < count; i++) 
+	{
+		Thread_Run(&workers[i].thread, WorkerLoop, 64 * 1024, "Rasterizer");
+	}
+}
+
+static void StopRasterWorkers(void) {
+	int i;
+	if (!workersCount) return;
+	workersStopping = true;
+
+	for (i = 0; i < workersCount; i++) 
+	{
+		Waitable_Signal(workers[i].wakeup);
+		Thread_Join(workers[i].thread);
+		Waitable_Free(workers[i].wakeup);
+	}
+	FreeTiles();
+
+	Mem_Free(tris);
+	Mem_Free(states);
+	Mutex_Free(tilesMutex);
+	Waitable_Free(tilesDone);
+
+	tris   = NULL; trisCapacity   = 0;
+	states = NULL; statesCapacity = 0;
+	workersCount   = 0;
+	workersStarted = 0;
+}
+
+static void SubmitTriangle(const Vertex* V0, const Vertex* V1, const Vertex* V2,
+							int minX, int minY, int maxX, int maxY, cc_bool is3D) {
+	if (stateDirty) {
+		UpdateRasterState();
+		stateDirty  = false;
+		binnedState = -1;
+	}
+
+	if (tilesCount) {
+		BinTriangle(V0, V1, V2, minX, minY, maxX, maxY, is3D);
+	} else if (is3D) {
+		RasterTriangle3D(&curState, V0, V1, V2, minX, minY, maxX, maxY);
+	} else {
+		RasterTriangle2D(&curState, V0, V1, V2, minX, minY, maxX, maxY);
+	}
+}
+#else
+static void FlushTiles(void) { }
+static void AllocTiles(int width, int height) { }
+static void StartRasterWorkers(void) { }
+static void StopRasterWorkers(void)  { }
+
+static void SubmitTriangle(const Vertex* V0, const Vertex* V1, const Vertex* V2,
+							int minX, int minY, int maxX, int maxY, cc_bool is3D) {
+	if (stateDirty) {
+		UpdateRasterState();
+		stateDirty = false;
+	}
+
+	if (is3D) {
+		RasterTriangle3D(&curState, V0, V1, V2, minX, minY, maxX, maxY);
+	} else {
+		RasterTriangle2D(&curState, V0, V1, V2, minX, minY, maxX, maxY);
+	}
+}
+#endif
+
+static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = min(x0, min(x1, x2));
+	int minY = min(y0, min(y1, y2));
+	int maxX = max(x0, max(x1, x2));
+	int maxY = max(y0, max(y1, y2));
+
+	// Reject triangles completely outside
+	if (maxX < 0 || minX > fb_maxX) return;
+	if (maxY < 0 || minY > fb_maxY) return;
+
+	// Perform scissoring
+	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
+	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+	SubmitTriangle(V0, V1, V2, minX, minY, maxX, maxY, false);
+}
+
+static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = min(x0, min(x1, x2));
+	int minY = min(y0, min(y1, y2));
+	int maxX = max(x0, max(x1, x2));
+	int maxY = max(y0, max(y1, y2));
+
+	if (faceCulling) {
+		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
+		int area = edgeFunction(x0,y0, x1,y1, x2,y2);
+		if (area < 0) return;
+	}
+
+	// Reject triangles completely outside
+	if (maxX < 0 || minX > fb_maxX) return;
+	if (maxY < 0 || minY > fb_maxY) return;
+
+	// Perform scissoring
+	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
+	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+	
+	// TODO proper clipping
+	if (V0->w <= 0 || V1->w <= 0 || V2->w <= 0) {
+		return;
+	}
+	SubmitTriangle(V0, V1, V2, minX, minY, maxX, maxY, true);
+}
+
 #define V0_VIS (1 << 0)
 #define V1_VIS (1 << 1)
 #define V2_VIS (1 << 2)
@@ -903,6 +1796,7 @@ void DrawQuads(int startVertex, int verticesCount) {
 void Gfx_SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
+	stateDirty = true;
 }
 
 void Gfx_DrawVb_Lines(int verticesCount) { } /* TODO */
@@ -929,6 +1823,7 @@ static BitmapCol* CB_GetRow(struct Bitmap* bmp, int y, void* ctx) {
 
 cc_result Gfx_TakeScreenshot(struct Stream* output) {
 	struct Bitmap bmp;
+	FlushTiles();
 	Bitmap_Init(bmp, fb_width, fb_height, NULL);
 	return Png_Encode(&bmp, output, CB_GetRow, false, NULL);
 }
@@ -940,6 +1835,7 @@ void Gfx_BeginFrame(void) { }
 
 void Gfx_EndFrame(void) {
 	Rect2D r = { 0, 0, fb_width, fb_height };
+	FlushTiles();
 	Window_DrawFramebuffer(r, &fb_bmp);
 }
 
@@ -948,6 +1844,7 @@ void Gfx_SetVSync(cc_bool vsync) {
 }
 
 void Gfx_OnWindowResize(void) {
+	FlushTiles();
 	if (depthBuffer) DestroyBuffers();
 
 	fb_width   = Game.Width;
@@ -961,6 +1858,7 @@ void Gfx_OnWindowResize(void) {
 	depthBuffer = Mem_Alloc(fb_width * fb_height, 4, "depth buffer");
 	db_stride   = fb_width;
 #endif
+	AllocTiles(fb_width, fb_height);
 
 	Gfx_SetViewport(0, 0, Game.Width, Game.Height);
 	Gfx_SetScissor (0, 0, Game.Width, Game.Height);
@@ -12,10 +12,12 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 struct IGameComponent;
 struct ScheduledTask;
 struct StringsBuffer;
+struct HttpRequest;
 
 #define URL_MAX_SIZE (STRING_SIZE * 2)
 #define HTTP_FLAG_PRIORITY 0x01
 #define HTTP_FLAG_NOCACHE  0x02
+#define HTTP_FLAG_DISKCACHE 0x04 /* Response may be stored in and revalidated from the on-disk cache */
 
 extern struct IGameComponent Http_Component;
 
@@ -26,10 +28,18 @@ enum HttpProgress {
 	HTTP_PROGRESS_FETCHING_DATA  = -1
 };
 
+/* Transforms the contents of a successfully completed request, before it is retrieved with Http_GetResult. */
+/* NOTE: This is called on the http worker thread, so must not access any game state. */
+/* On success, data/size should be replaced with the transformed contents. (old data must be freed) */
+/* On failure, data/size should be left untouched and an error code should be returned. */
+typedef cc_result (*Http_ProcessFunc)(struct HttpRequest* req);
+
 struct HttpRequest {
 	char url[URL_MAX_SIZE];   /* URL data is downloaded from/uploaded to. */
 	int id;                   /* Unique identifier for this request. */
 	volatile int progress;    /* Progress with downloading this request */
+	cc_uint64 timeAdded;      /* Time request was added to the queue of pending requests. */
+	cc_uint64 timeStarted;    /* Time a worker started performing this request. */
 	cc_uint64 timeDownloaded; /* Time response contents were completely downloaded. */
 	int statusCode;           /* HTTP status code returned in the response. */
 	cc_uint32 contentLength;  /* HTTP content length returned in the response. */
@@ -44,8 +54,11 @@ struct HttpRequest {
 	char lastModified[STRING_SIZE]; /* Time item cached at (if at all) */
 	char etag[STRING_SIZE];         /* ETag of cached item (if any) */
 	cc_uint8 requestType;           /* See the various REQUEST_TYPE_ */
+	cc_uint8 flags;                 /* See the various HTTP_FLAG_ */
 	cc_bool success;                /* Whether Result is 0, status is 200, and data is not NULL */
 	struct StringsBuffer* cookies;  /* Cookie list sent in requests. May be modified by the response. */
+	Http_ProcessFunc process;       /* Optional function to transform contents of the response */
+	cc_result processResult;        /* 0 if contents were transformed by process, otherwise error */
 };
 
 /* Frees all dynamically allocated data from a HTTP request */
@@ -53,7 +66,8 @@ void HttpRequest_Free(struct HttpRequest* request);
 
 /* Aschronously performs a http GET request to download a skin. */
 /* If url is a skin, downloads from there. (if not, downloads from SKIN_SERVER/[skinName].png) */
-int Http_AsyncGetSkin(const cc_string* skinName, cc_uint8 flags);
+/* If process is not NULL, it is used to transform the downloaded skin. (e.g. to decode it) */
+int Http_AsyncGetSkin(const cc_string* skinName, cc_uint8 flags, Http_ProcessFunc process);
 /* Asynchronously performs a http GET request. (e.g. to download data) */
 int Http_AsyncGetData(const cc_string* url, cc_uint8 flags);
 /* Asynchronously performs a http HEAD request. (e.g. to get Content-Length header) */
@@ -80,6 +94,7 @@ cc_bool Http_DescribeError(cc_result res, cc_string* dst);
 /* (Data may still be non NULL even on error, e.g. on a http 404 error) */
 cc_bool Http_GetResult(int reqID, struct HttpRequest* item);
 /* Retrieves information about the request currently being processed. */
+/* NOTE: If multiple requests are being processed, returns the one that started earliest. */
 cc_bool Http_GetCurrent(int* reqID, int* progress);
 /* Retrieves information about the download progress of the given request. */
 /* NOTE: This may return HTTP_PROGRESS_NOT_WORKING_ON if download has finished. */
@@ -90,5 +105,16 @@ void Http_ClearPending(void);
 
 void Http_LogError(const char* action, const struct HttpRequest* item);
 
+struct HttpCacheStats {
+	int entries;          /* Number of responses currently stored in the on-disk cache */
+	cc_uint64 size;       /* Total size of the responses currently stored */
+	int hits;             /* Requests served from the cache, after server confirmed it was unchanged */
+	int misses;           /* Cacheable requests whose contents had to be downloaded */
+	int evictions;        /* Responses removed to keep cache under its maximum size */
+	cc_uint64 bytesSaved; /* Total size of contents that didn't need to be downloaded */
+};
+/* Retrieves statistics about the on-disk cache used by HTTP_FLAG_DISKCACHE requests. */
+void Http_GetCacheStats(struct HttpCacheStats* stats);
+
 CC_END_HEADER
 #endif
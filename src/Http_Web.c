@@ -44,6 +44,11 @@ void Http_TryCancel(int reqID) {
 	RequestList_TryFree(&processedReqs, reqID);
 }
 
+void Http_GetCacheStats(struct HttpCacheStats* stats) {
+	/* Browser already caches responses itself */
+	Mem_Set(stats, 0, sizeof(*stats));
+}
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Emscripten backend---------------------------------------------------*
@@ -65,6 +70,7 @@ static void Http_StartNextDownload(void) {
 	String_InitArray(url, urlBuffer);
 
 	req = &queuedReqs.entries[0];
+	req->timeStarted = Stopwatch_Measure();
 	Http_GetUrl(req, &url);
 	Platform_Log1("Fetching %s", &url);
 
@@ -1,6 +1,7 @@
 #include "Core.h"
 #ifndef CC_BUILD_WEB
 #include "_HttpBase.h"
+#define HTTP_MAX_WORKERS 8
 
 /* Allocates initial data buffer to store response contents */
 static void Http_BufferInit(struct HttpRequest* req) {
@@ -108,15 +109,14 @@ static void Http_SetRequestHeaders(struct HttpRequest* req) {
 	Http_AddHeader(req, "Cookie", &cookies);
 }
 
-/* TODO: Rewrite to use a local variable instead */
-static cc_string* Http_GetUserAgent_UNSAFE(void) {
-	static char userAgentBuffer[STRING_SIZE];
-	static cc_string userAgent;
+/* NOTE: Uses a local buffer, since several worker threads may be adding headers at once */
+static void Http_AddUserAgent(struct HttpRequest* req) {
+	cc_string userAgent; char userAgentBuffer[STRING_SIZE];
 
 	String_InitArray(userAgent, userAgentBuffer);
 	String_AppendConst(&userAgent, GAME_APP_NAME);
 	String_AppendConst(&userAgent, Platform_AppNameSuffix);
-	return &userAgent;
+	Http_AddHeader(req, "User-Agent", &userAgent);
 }
 
 
@@ -222,7 +222,8 @@ static cc_bool LoadCurlFuncs(void) {
 	return success;
 }
 
-static CURL* curl;
+/* Each worker uses its own handle, which also keeps its own cache of keep-alive connections */
+static CURL* curlHandles[HTTP_MAX_WORKERS];
 static cc_bool curlSupported, curlVerbose;
 
 static cc_bool HttpBackend_DescribeError(cc_result res, cc_string* dst) {
@@ -243,8 +244,8 @@ static void HttpBackend_Init(void) {
 	if (!LoadCurlFuncs()) { Logger_WarnFunc(&msg); return; }
 	res = _curl_global_init(CURL_GLOBAL_DEFAULT);
 	if (res) { Logger_SimpleWarn(res, "initing curl"); return; }
-	curl = _curl_easy_init();
-	if (!curl) { Logger_SimpleWarn(res, "initing curl_easy"); return; }
+	curlHandles[0] = _curl_easy_init();
+	if (!curlHandles[0]) { Logger_SimpleWarn(res, "initing curl_easy"); return; }
 
 	curlSupported = true;
 	curlVerbose = Options_GetBool("curl-verbose", false);
@@ -286,7 +287,7 @@ static size_t Http_ProcessData(char *buffer, size_t size, size_t nitems, void* u
 }
 
 /* Sets general curl options for a request */
-static void Http_SetCurlOpts(struct HttpRequest* req) {
+static void Http_SetCurlOpts(CURL* curl, struct HttpRequest* req) {
 	_curl_easy_setopt(curl, CURLOPT_USERAGENT,      GAME_APP_NAME);
 	_curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 	_curl_easy_setopt(curl, CURLOPT_MAXREDIRS,      20L);
@@ -303,17 +304,22 @@ static void Http_SetCurlOpts(struct HttpRequest* req) {
 	_curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
 }
 
-static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
+static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url, int worker) {
 	char urlStr[NATIVE_STR_LEN];
 	void* post_data = req->data;
 	CURLcode res;
+	CURL* curl;
 	if (!curlSupported) return ERR_NOT_SUPPORTED;
 
+	curl = curlHandles[worker];
+	if (!curl) curl = curlHandles[worker] = _curl_easy_init();
+	if (!curl) return ERR_OUT_OF_MEMORY;
+
 	req->meta = NULL;
 	Http_SetRequestHeaders(req);
 	_curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->meta);
 
-	Http_SetCurlOpts(req);
+	Http_SetCurlOpts(curl, req);
 	String_EncodeUtf8(urlStr, url);
 	_curl_easy_setopt(curl, CURLOPT_URL, urlStr);
 
@@ -522,46 +528,83 @@ static cc_result HttpConnection_Write(struct HttpConnection* conn, const cc_uint
 /*########################################################################################################################*
 *-----------------------------------------------------Connection Pool-----------------------------------------------------*
 *#########################################################################################################################*/
+/* Keep-alive connections are shared between all the http workers, */
+/*  but a connection can only be used by one worker at a time */
 static struct ConnectionPoolEntry {
 	struct HttpConnection conn;
 	cc_string addr;
 	char addrBuffer[STRING_SIZE];
-	cc_bool https;
+	cc_bool https, inUse;
 } connection_pool[10];
+static void* poolMutex;
 
-static cc_result ConnectionPool_Insert(int i, struct HttpConnection** conn, const struct HttpUrl* url) {
-	struct ConnectionPoolEntry* e = &connection_pool[i];
-	*conn = &e->conn;
-
-	String_InitArray(e->addr, e->addrBuffer);
-	String_Copy(&e->addr, &url->address);
-	e->https = url->https;
-	return HttpConnection_Open(&e->conn, url);
-}
-
-static cc_result ConnectionPool_Open(struct HttpConnection** conn, const struct HttpUrl* url) {
+static struct ConnectionPoolEntry* ConnectionPool_Claim(const struct HttpUrl* url, cc_bool* reused) {
 	struct ConnectionPoolEntry* e;
-	int i;
+	int i, j;
+	*reused = false;
 
+	/* Prefer reusing an idle keep-alive connection to the same host */
 	for (i = 0; i < Array_Elems(connection_pool); i++)
 	{
 		e = &connection_pool[i];
-		if (e->conn.valid && e->https == url->https && String_Equals(&e->addr, &url->address)) {
-			*conn = &connection_pool[i].conn;
-			return 0;
+		if (e->inUse || !e->conn.valid) continue;
+
+		if (e->https == url->https && String_Equals(&e->addr, &url->address)) {
+			*reused = true; return e;
 		}
 	}
 
 	for (i = 0; i < Array_Elems(connection_pool); i++)
 	{
 		e = &connection_pool[i];
-		if (!e->conn.valid) return ConnectionPool_Insert(i, conn, url);
+		if (!e->inUse && !e->conn.valid) return e;
 	}
 
 	/* TODO: Should we be consistent in which entry gets evicted? */
-	i = (cc_uint8)Stopwatch_Measure() % Array_Elems(connection_pool);
-	HttpConnection_Close(&connection_pool[i].conn);
-	return ConnectionPool_Insert(i, conn, url);
+	j = (cc_uint8)Stopwatch_Measure();
+	for (i = 0; i < Array_Elems(connection_pool); i++)
+	{
+		e = &connection_pool[(i + j) % Array_Elems(connection_pool)];
+		if (!e->inUse) return e;
+	}
+	return NULL;
+}
+
+static cc_result ConnectionPool_Open(struct HttpConnection** conn, const struct HttpUrl* url) {
+	struct ConnectionPoolEntry* e;
+	cc_bool reused;
+
+	Mutex_Lock(poolMutex);
+	{
+		e = ConnectionPool_Claim(url, &reused);
+		if (e) e->inUse = true;
+	}
+	Mutex_Unlock(poolMutex);
+
+	/* Only possible with more workers than pool entries */
+	if (!e) return ERR_NOT_SUPPORTED;
+	*conn = &e->conn;
+	if (reused) return 0;
+
+	/* Opening a new connection is slow, so don't block other workers while doing so */
+	if (e->conn.valid) HttpConnection_Close(&e->conn);
+	String_InitArray(e->addr, e->addrBuffer);
+	String_Copy(&e->addr, &url->address);
+	e->https = url->https;
+	return HttpConnection_Open(&e->conn, url);
+}
+
+/* Makes the given connection available for use by other requests again */
+static void ConnectionPool_Release(struct HttpConnection* conn) {
+	int i;
+	Mutex_Lock(poolMutex);
+	{
+		for (i = 0; i < Array_Elems(connection_pool); i++)
+		{
+			if (&connection_pool[i].conn == conn) connection_pool[i].inUse = false;
+		}
+	}
+	Mutex_Unlock(poolMutex);
 }
 
 
@@ -619,7 +662,7 @@ static void HttpClient_Serialise(struct HttpClientState* state) {
 					verbs[req->requestType], &state->url.resource);
 
 	Http_AddHeader(req, "Host",       &state->url.address);
-	Http_AddHeader(req, "User-Agent", Http_GetUserAgent_UNSAFE());
+	Http_AddUserAgent(req);
 	if (req->data) String_Format1(buffer, "Content-Length: %i\r\n", &req->size);
 
 	Http_SetRequestHeaders(req);
@@ -890,6 +933,7 @@ static cc_result HttpClient_HandleRedirect(struct HttpClientState* state) {
 *#########################################################################################################################*/
 static void HttpBackend_Init(void) {
 	SSLBackend_Init(httpsVerify);
+	poolMutex = Mutex_Create("HTTP connection pool");
 	//httpOnly = true; // TODO: insecure
 }
 
@@ -900,19 +944,20 @@ static void Http_AddHeader(struct HttpRequest* req, const char* key, const cc_st
 static cc_result HttpBackend_PerformRequest(struct HttpClientState* state) {
 	cc_result res;
 
+	state->conn = NULL;
 	res = ConnectionPool_Open(&state->conn, &state->url);
-	if (res) { HttpConnection_Close(state->conn); return res; }
-
-	res = HttpClient_SendRequest(state);
-	if (res) { HttpConnection_Close(state->conn); return res; }
+	if (!state->conn) return res;
 
-	res = HttpClient_ParseResponse(state);
-	if (res) HttpConnection_Close(state->conn);
+	if (!res) res = HttpClient_SendRequest(state);
+	if (!res) res = HttpClient_ParseResponse(state);
 
+	/* Server may have asked for connection to not be kept alive */
+	if (res || state->autoClose) HttpConnection_Close(state->conn);
+	ConnectionPool_Release(state->conn);
 	return res;
 }
 
-static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* urlStr) {
+static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* urlStr, int worker) {
 	struct HttpClientState state;
 	cc_bool retried = false;
 	int redirects   = 0;
@@ -1056,7 +1101,7 @@ static cc_result Http_SetData(JNIEnv* env, struct HttpRequest* req) {
 	return res;
 }
 
-static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
+static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url, int worker) {
 	JNIEnv* env;
 	jint res;
 
@@ -1065,7 +1110,7 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 	java_req = req;
 
 	Http_SetRequestHeaders(req);
-	Http_AddHeader(req, "User-Agent", Http_GetUserAgent_UNSAFE());
+	Http_AddUserAgent(req);
 	if (req->data && (res = Http_SetData(env, req))) return res;
 
 	req->_capacity = 0;
@@ -1130,7 +1175,7 @@ static cc_result ParseResponseHeaders(struct HttpRequest* req, CFReadStreamRef s
     return 0;
 }
 
-static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
+static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url, int worker) {
     static CFStringRef verbs[] = { CFSTR("GET"), CFSTR("HEAD"), CFSTR("POST") };
     cc_bool gotHeaders = false;
     char tmp[NATIVE_STR_LEN];
@@ -1149,7 +1194,7 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
     request = CFHTTPMessageCreateRequest(NULL, verbs[req->requestType], urlRef, kCFHTTPVersion1_1);
     req->meta = request;
     Http_SetRequestHeaders(req);
-    Http_AddHeader(req, "User-Agent", Http_GetUserAgent_UNSAFE());
+    Http_AddUserAgent(req);
     CFRelease(urlRef);
     
     if (req->data && req->size) {
@@ -1206,21 +1251,410 @@ static void HttpBackend_Init(void) { }
 
 static void Http_AddHeader(struct HttpRequest* req, const char* key, const cc_string* value) { }
 
-static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
+static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url, int worker) {
 	req->progress = 100;
 	return ERR_NOT_SUPPORTED;
 }
 #endif
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------Http disk cache-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Responses to HTTP_FLAG_DISKCACHE requests are stored in the httpcache folder. */
+/* Cached files are named by the CRC32 and size of their contents, so identical */
+/*  responses from different URLs (e.g. the same skin) share the same file. */
+/* The index file maps each URL to its cached contents, ETag and Last-Modified. */
+#define HTTPCACHE_INDEX "httpcache/index.txt"
+
+struct HttpCacheEntry {
+	cc_uint32 urlHash;     /* CRC32 of URL, to avoid comparing every URL when searching */
+	cc_uint32 contentHash; /* CRC32 of cached contents */
+	cc_uint32 size;        /* Size of cached contents */
+	cc_uint32 lastUsed;    /* Value of cacheClock when cached contents were last stored or used */
+	char url[URL_MAX_SIZE];
+	char etag[STRING_SIZE];
+	char lastModified[STRING_SIZE];
+};
+
+static struct HttpCacheEntry* cacheEntries;
+static int cacheCount, cacheCapacity;
+static cc_uint64 cacheSize, cacheMaxSize;
+static cc_uint32 cacheClock; /* Incremented whenever an entry is used, for LRU eviction */
+static cc_bool cacheDirty;
+static void* cacheMutex;
+static struct HttpCacheStats cacheStats;
+
+static cc_uint32 HttpCache_HashUrl(const cc_string* url) {
+	return Utils_CRC32((const cc_uint8*)url->buffer, url->length);
+}
+
+static int HttpCache_Find(const cc_string* url) {
+	cc_uint32 hash = HttpCache_HashUrl(url);
+	cc_string entryUrl;
+	int i;
+
+	for (i = 0; i < cacheCount; i++)
+	{
+		if (cacheEntries[i].urlHash != hash) continue;
+		entryUrl = String_FromRawArray(cacheEntries[i].url);
+		if (String_Equals(&entryUrl, url)) return i;
+	}
+	return -1;
+}
+
+static void HttpCache_MakePath(cc_string* path, const struct HttpCacheEntry* e) {
+	String_Format2(path, "httpcache/%h%h", &e->contentHash, &e->size);
+}
+
+static cc_bool HttpCache_IsShared(int index) {
+	struct HttpCacheEntry* e = &cacheEntries[index];
+	int i;
+
+	for (i = 0; i < cacheCount; i++)
+	{
+		if (i == index) continue;
+		if (cacheEntries[i].contentHash == e->contentHash && cacheEntries[i].size == e->size) return true;
+	}
+	return false;
+}
+
+/* Removes the given entry, also emptying its cached file if no other entry uses it */
+static void HttpCache_Remove(int index) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	struct HttpCacheEntry* e = &cacheEntries[index];
+
+	/* The platform layer doesn't support deleting files, so truncate it instead */
+	if (!HttpCache_IsShared(index)) {
+		String_InitArray(path, pathBuffer);
+		HttpCache_MakePath(&path, e);
+		Stream_WriteAllTo(&path, NULL, 0);
+		cacheSize -= e->size;
+	}
+	cacheEntries[index] = cacheEntries[--cacheCount];
+	cacheDirty = true;
+}
+
+/* Removes least recently used entries until cache is under its maximum size */
+static void HttpCache_Evict(void) {
+	int i, oldest;
+
+	while (cacheCount && cacheSize > cacheMaxSize)
+	{
+		oldest = 0;
+		for (i = 1; i < cacheCount; i++)
+		{
+			if (cacheEntries[i].lastUsed < cacheEntries[oldest].lastUsed) oldest = i;
+		}
+
+		HttpCache_Remove(oldest);
+		cacheStats.evictions++;
+	}
+}
+
+static void HttpCache_Add(const struct HttpCacheEntry* entry) {
+	if (cacheCount == cacheCapacity) {
+		Utils_Resize((void**)&cacheEntries, &cacheCapacity,
+					sizeof(struct HttpCacheEntry), 0, 64);
+	}
+	cacheEntries[cacheCount] = *entry;
+
+	/* Contents shared with other entries are only stored once */
+	if (!HttpCache_IsShared(cacheCount)) cacheSize += entry->size;
+	cacheCount++;
+	cacheDirty = true;
+}
+
+/* Index file consists of lines of "[content hash]|[size]|[last used]|[etag]|[last modified]|[url]" */
+static void HttpCache_ParseEntry(const cc_string* line) {
+	struct HttpCacheEntry e;
+	cc_string parts[6];
+	cc_uint64 hash, used;
+	int size;
+
+	if (String_UNSAFE_Split(line, '|', parts, 6) < 6) return;
+	if (!Convert_ParseUInt64(&parts[0], &hash)) return;
+	if (!Convert_ParseInt(&parts[1],    &size)) return;
+	if (!Convert_ParseUInt64(&parts[2], &used)) return;
+	if (size <= 0 || HttpCache_Find(&parts[5]) >= 0) return;
+
+	e.contentHash = (cc_uint32)hash;
+	e.size        = size;
+	e.lastUsed    = (cc_uint32)used;
+	e.urlHash     = HttpCache_HashUrl(&parts[5]);
+
+	String_CopyToRawArray(e.etag,         &parts[3]);
+	String_CopyToRawArray(e.lastModified, &parts[4]);
+	String_CopyToRawArray(e.url,          &parts[5]);
+	HttpCache_Add(&e);
+	cacheClock = max(cacheClock, e.lastUsed);
+}
+
+static void HttpCache_Load(void) {
+	cc_string line; char lineBuffer[1024];
+	static const cc_string path = String_FromConst(HTTPCACHE_INDEX);
+	cc_uint8 buffer[2048];
+	struct Stream stream, buffered;
+	cc_result res;
+
+	res = Stream_OpenFile(&stream, &path);
+	if (res == ReturnCode_FileNotFound) return;
+	if (res) { Logger_SysWarn2(res, "opening", &path); return; }
+
+	Stream_ReadonlyBuffered(&buffered, &stream, buffer, sizeof(buffer));
+	for (;;) {
+		String_InitArray(line, lineBuffer);
+		res = Stream_ReadLine(&buffered, &line);
+		if (res == ERR_END_OF_STREAM) break;
+		if (res) { Logger_SysWarn2(res, "reading from", &path); break; }
+
+		HttpCache_ParseEntry(&line);
+	}
+	stream.Close(&stream);
+}
+
+static void HttpCache_Save(void) {
+	cc_string line; char lineBuffer[1024];
+	static const cc_string path = String_FromConst(HTTPCACHE_INDEX);
+	struct HttpCacheEntry* e;
+	struct Stream stream;
+	cc_result res;
+	int i;
+
+	res = Stream_CreateFile(&stream, &path);
+	if (res) { Logger_SysWarn2(res, "creating", &path); return; }
+
+	for (i = 0; i < cacheCount; i++)
+	{
+		e = &cacheEntries[i];
+		String_InitArray(line, lineBuffer);
+
+		String_AppendUInt32(&line, e->contentHash); String_Append(&line, '|');
+		String_AppendUInt32(&line, e->size);        String_Append(&line, '|');
+		String_AppendUInt32(&line, e->lastUsed);    String_Append(&line, '|');
+		String_Format3(&line, "%c|%c|%c", e->etag, e->lastModified, e->url);
+
+		res = Stream_WriteLine(&stream, &line);
+		if (res) { Logger_SysWarn2(res, "writing to", &path); break; }
+	}
+
+	res = stream.Close(&stream);
+	if (res) { Logger_SysWarn2(res, "closing", &path); }
+	cacheDirty = false;
+}
+
+/* Sets If-None-Match and If-Modified-Since headers, if the URL has been cached before */
+/* Returns whether the request is revalidating previously cached contents */
+static cc_bool HttpCache_Lookup(struct HttpRequest* req) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_string url = String_FromRawArray(req->url);
+	struct HttpCacheEntry* e;
+	cc_filepath str;
+	cc_bool exists = false;
+	int i;
+
+	if (!cacheMaxSize || !(req->flags & HTTP_FLAG_DISKCACHE)) return false;
+	if (req->requestType != REQUEST_TYPE_GET) return false;
+	String_InitArray(path, pathBuffer);
+
+	Mutex_Lock(cacheMutex);
+	{
+		i = HttpCache_Find(&url);
+		if (i >= 0) {
+			e = &cacheEntries[i];
+			HttpCache_MakePath(&path, e);
+			Platform_EncodePath(&str, &path);
+
+			/* This inconsistency can occur if user deleted some cached files */
+			exists = File_Exists(&str);
+			if (exists) {
+				Mem_Copy(req->etag,         e->etag,         sizeof(req->etag));
+				Mem_Copy(req->lastModified, e->lastModified, sizeof(req->lastModified));
+			} else {
+				HttpCache_Remove(i);
+			}
+		}
+	}
+	Mutex_Unlock(cacheMutex);
+	return exists;
+}
+
+/* Reads previously cached contents into the request, after the server responded with 304 Not Modified */
+static cc_bool HttpCache_Read(struct HttpRequest* req) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_string url = String_FromRawArray(req->url);
+	struct HttpCacheEntry entry;
+	struct Stream stream;
+	cc_uint8* data;
+	cc_result res;
+	int i;
+
+	String_InitArray(path, pathBuffer);
+	Mutex_Lock(cacheMutex);
+	{
+		i = HttpCache_Find(&url);
+		if (i >= 0) entry = cacheEntries[i];
+	}
+	Mutex_Unlock(cacheMutex);
+	if (i < 0) return false;
+
+	HttpCache_MakePath(&path, &entry);
+	data = (cc_uint8*)Mem_TryAlloc(entry.size, 1);
+	if (!data) return false;
+
+	res = Stream_OpenFile(&stream, &path);
+	if (!res) {
+		res = Stream_Read(&stream, data, entry.size);
+		stream.Close(&stream);
+	}
+
+	/* Cached file may have been evicted or corrupted since */
+	if (res || Utils_CRC32(data, entry.size) != entry.contentHash) {
+		Mem_Free(data);
+		Mutex_Lock(cacheMutex);
+		{
+			i = HttpCache_Find(&url);
+			if (i >= 0) HttpCache_Remove(i);
+		}
+		Mutex_Unlock(cacheMutex);
+		return false;
+	}
+
+	req->data       = data;
+	req->size       = entry.size;
+	req->statusCode = 200;
+
+	Mutex_Lock(cacheMutex);
+	{
+		i = HttpCache_Find(&url);
+		if (i >= 0) cacheEntries[i].lastUsed = ++cacheClock;
+
+		cacheDirty = true;
+		cacheStats.hits++;
+		cacheStats.bytesSaved += entry.size;
+	}
+	Mutex_Unlock(cacheMutex);
+	return true;
+}
+
+/* Stores the contents of a successful response in the cache */
+static void HttpCache_Store(struct HttpRequest* req, cc_result res) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_string url = String_FromRawArray(req->url);
+	struct HttpCacheEntry entry;
+	cc_filepath str;
+	cc_bool exists;
+	int i;
+
+	if (!cacheMaxSize || !(req->flags & HTTP_FLAG_DISKCACHE)) return;
+	if (req->requestType != REQUEST_TYPE_GET) return;
+
+	Mutex_Lock(cacheMutex);
+	cacheStats.misses++;
+	Mutex_Unlock(cacheMutex);
+
+	if (res || req->statusCode != 200 || !req->data || !req->size) return;
+	/* Can't revalidate the cached contents later without either of these */
+	if (!req->etag[0] && !req->lastModified[0]) return;
+	if (req->size > cacheMaxSize) return;
+
+	entry.contentHash = Utils_CRC32(req->data, req->size);
+	entry.size        = req->size;
+	entry.urlHash     = HttpCache_HashUrl(&url);
+	Mem_Copy(entry.url,          req->url,          sizeof(entry.url));
+	Mem_Copy(entry.etag,         req->etag,         sizeof(entry.etag));
+	Mem_Copy(entry.lastModified, req->lastModified, sizeof(entry.lastModified));
+
+	String_InitArray(path, pathBuffer);
+	HttpCache_MakePath(&path, &entry);
+	Platform_EncodePath(&str, &path);
+
+	/* Another URL may have already cached identical contents */
+	exists = File_Exists(&str);
+	if (exists) {
+		Mutex_Lock(cacheMutex);
+		{
+			for (i = 0; i < cacheCount; i++)
+			{
+				if (cacheEntries[i].contentHash == entry.contentHash && cacheEntries[i].size == entry.size) break;
+			}
+			exists = i < cacheCount;
+		}
+		Mutex_Unlock(cacheMutex);
+	}
+
+	if (!exists && (res = Stream_WriteAllTo(&path, req->data, req->size))) {
+		Logger_SysWarn2(res, "caching", &url); return;
+	}
+
+	Mutex_Lock(cacheMutex);
+	{
+		i = HttpCache_Find(&url);
+		entry.lastUsed = ++cacheClock;
+		HttpCache_Add(&entry);
+
+		/* Remove old entry afterwards, so its file isn't emptied if contents are unchanged */
+		if (i >= 0) HttpCache_Remove(i);
+
+		HttpCache_Evict();
+		/* Index is written later by HttpCache_Flush, rather than after every response */
+		cacheDirty = true;
+	}
+	Mutex_Unlock(cacheMutex);
+}
+
+static void HttpCache_Init(void) {
+	int maxSize = Options_GetInt(OPT_HTTP_CACHE_SIZE, 0, 4096, 64);
+	if (Platform_ReadonlyFilesystem || !maxSize) return;
+
+	cacheMutex   = Mutex_Create("HTTP cache");
+	cacheMaxSize = (cc_uint64)maxSize * 1024 * 1024;
+	Utils_EnsureDirectory("httpcache");
+	HttpCache_Load();
+	cacheDirty = false;
+
+	/* Maximum size may have been reduced since last time */
+	HttpCache_Evict();
+	if (cacheDirty) HttpCache_Save();
+}
+
+/* Saves the index, if any cached contents have been stored or used since it was last saved */
+static void HttpCache_Flush(void) {
+	if (!cacheMaxSize) return;
+
+	Mutex_Lock(cacheMutex);
+	{
+		if (cacheDirty) HttpCache_Save();
+	}
+	Mutex_Unlock(cacheMutex);
+}
+
+void Http_GetCacheStats(struct HttpCacheStats* stats) {
+	if (!cacheMaxSize) { Mem_Set(stats, 0, sizeof(*stats)); return; }
+
+	Mutex_Lock(cacheMutex);
+	{
+		*stats         = cacheStats;
+		stats->entries = cacheCount;
+		stats->size    = cacheSize;
+	}
+	Mutex_Unlock(cacheMutex);
+}
+
+
 static void* workerWaitable;
-static void* workerThread;
+static void* workersMutex;
+static int workersCount, workersStarted;
 
 static void* pendingMutex;
 static struct RequestList pendingReqs;
 
+/* Each worker performs one request at a time */
 static void* curRequestMutex;
-static struct HttpRequest http_curRequest;
+static struct HttpWorker {
+	void* thread;
+	struct HttpRequest curRequest;
+} workers[HTTP_MAX_WORKERS];
 
 
 /*########################################################################################################################*
@@ -1239,20 +1673,43 @@ cc_bool Http_GetResult(int reqID, struct HttpRequest* item) {
 }
 
 cc_bool Http_GetCurrent(int* reqID, int* progress) {
+	struct HttpRequest* oldest = NULL;
+	struct HttpRequest* req;
+	int i;
+	*reqID    = 0;
+	*progress = HTTP_PROGRESS_NOT_WORKING_ON;
+
 	Mutex_Lock(curRequestMutex);
 	{
-		*reqID    = http_curRequest.id;
-		*progress = http_curRequest.progress;
+		/* Report whichever request has been in progress the longest */
+		for (i = 0; i < workersCount; i++)
+		{
+			req = &workers[i].curRequest;
+			if (!req->id) continue;
+			if (!oldest || req->timeStarted < oldest->timeStarted) oldest = req;
+		}
+
+		if (oldest) {
+			*reqID    = oldest->id;
+			*progress = oldest->progress;
+		}
 	}
 	Mutex_Unlock(curRequestMutex);
 	return *reqID != 0;
 }
 
 int Http_CheckProgress(int reqID) {
-	int curReqID, progress;
-	Http_GetCurrent(&curReqID, &progress);
+	int i, progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	if (!reqID) return progress;
 
-	if (reqID != curReqID) progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	Mutex_Lock(curRequestMutex);
+	{
+		for (i = 0; i < workersCount; i++)
+		{
+			if (workers[i].curRequest.id == reqID) progress = workers[i].curRequest.progress;
+		}
+	}
+	Mutex_Unlock(curRequestMutex);
 	return progress;
 }
 
@@ -1262,6 +1719,7 @@ void Http_ClearPending(void) {
 		RequestList_Free(&pendingReqs);
 	}
 	Mutex_Unlock(pendingMutex);
+	HttpCache_Flush();
 }
 
 void Http_TryCancel(int reqID) {
@@ -1283,56 +1741,85 @@ void Http_TryCancel(int reqID) {
 *-----------------------------------------------------Http worker---------------------------------------------------------*
 *#########################################################################################################################*/
 /* Sets up state to begin a http request */
-static void PrepareCurrentRequest(struct HttpRequest* req, cc_string* url) {
+static void PrepareCurrentRequest(struct HttpWorker* worker, struct HttpRequest* req, cc_string* url) {
 	static const char* verbs[] = { "GET", "HEAD", "POST" };
+	int index  = (int)(worker - workers);
+	int waited = Stopwatch_ElapsedMS(req->timeAdded, Stopwatch_Measure());
+
 	Http_GetUrl(req, url);
-	Platform_Log2("Fetching %s (%c)", url, verbs[req->requestType]);
+	Platform_Log4("Fetching %s (%c, worker %i, queued for %i ms)",
+		url, verbs[req->requestType], &index, &waited);
 	/* TODO change to verbs etc */
 
 	Mutex_Lock(curRequestMutex);
 	{
-		HttpRequest_Copy(&http_curRequest, req);
-		http_curRequest.progress = HTTP_PROGRESS_MAKING_REQUEST;
+		HttpRequest_Copy(&worker->curRequest, req);
+		worker->curRequest.progress    = HTTP_PROGRESS_MAKING_REQUEST;
+		worker->curRequest.timeStarted = Stopwatch_Measure();
 	}
 	Mutex_Unlock(curRequestMutex);
 }
 
-static void PerformRequest(struct HttpRequest* req, cc_string* url) {
-	cc_uint64 beg, end;
+static cc_result PerformCachedRequest(struct HttpRequest* req, cc_string* url, int worker) {
+	cc_bool revalidating = HttpCache_Lookup(req);
+	cc_result res        = HttpBackend_Do(req, url, worker);
+
+	if (!revalidating || res || req->statusCode != 304) {
+		HttpCache_Store(req, res); return res;
+	}
+	/* Server confirmed that the cached contents are still up to date */
+	if (HttpCache_Read(req)) return 0;
+
+	/* Cached contents were lost or corrupted, so download them again */
+	Platform_LogConst("  Cached contents missing, downloading again..");
+	HttpRequest_Free(req);
+	req->etag[0]         = '\0';
+	req->lastModified[0] = '\0';
+
+	res = HttpBackend_Do(req, url, worker);
+	HttpCache_Store(req, res);
+	return res;
+}
+
+static void PerformRequest(struct HttpRequest* req, cc_string* url, int worker) {
 	int elapsed;
 
-	beg = Stopwatch_Measure();
-	req->result = HttpBackend_Do(req, url);
-	end = Stopwatch_Measure();
+	req->result = PerformCachedRequest(req, url, worker);
+	elapsed     = Stopwatch_ElapsedMS(req->timeStarted, Stopwatch_Measure());
 
-	elapsed = Stopwatch_ElapsedMS(beg, end);
 	Platform_Log4("HTTP: result %e (http %i) in %i ms (%i bytes)",
 		&req->result, &req->statusCode, &elapsed, &req->size);
 
 	Http_FinishRequest(req);
 }
 
-static void ClearCurrentRequest(void) {
+static void ClearCurrentRequest(struct HttpWorker* worker) {
 	Mutex_Lock(curRequestMutex);
 	{
-		http_curRequest.id       = 0;
-		http_curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+		worker->curRequest.id       = 0;
+		worker->curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
 	}
 	Mutex_Unlock(curRequestMutex);
 }
 
-static void DoRequest(struct HttpRequest* request) {
+static void DoRequest(struct HttpRequest* request, int index) {
 	char urlBuffer[URL_MAX_SIZE]; cc_string url;
+	struct HttpWorker* worker = &workers[index];
 
 	String_InitArray(url, urlBuffer);
-	PrepareCurrentRequest(request, &url);
-	PerformRequest(&http_curRequest, &url);
-	ClearCurrentRequest();
+	PrepareCurrentRequest(worker, request, &url);
+	PerformRequest(&worker->curRequest, &url, index);
+	ClearCurrentRequest(worker);
 }
 
 static void WorkerLoop(void) {
 	struct HttpRequest request;
-	cc_bool hasRequest;
+	cc_bool hasRequest, hasMore;
+	int index;
+
+	Mutex_Lock(workersMutex);
+	index = workersStarted++;
+	Mutex_Unlock(workersMutex);
 
 	for (;;) {
 		hasRequest = false;
@@ -1344,11 +1831,14 @@ static void WorkerLoop(void) {
 				hasRequest = true;
 				RequestList_RemoveAt(&pendingReqs, 0);
 			}
+			hasMore = pendingReqs.count > 0;
 		}
 		Mutex_Unlock(pendingMutex);
 
 		if (hasRequest) {
-			DoRequest(&request);
+			/* Wake up another worker to start on the next request */
+			if (hasMore) Waitable_Signal(workerWaitable);
+			DoRequest(&request, index);
 		} else {
 			/* Block until another thread submits a request to do */
 			Platform_LogConst("Download queue empty, going back to sleep...");
@@ -1361,7 +1851,7 @@ static void WorkerLoop(void) {
 static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 #if defined CC_BUILD_PSP || defined CC_BUILD_NDS
 	/* TODO why doesn't threading work properly on PSP */
-	DoRequest(req);
+	DoRequest(req, 0);
 #else
 	Mutex_Lock(pendingMutex);
 	{
@@ -1376,20 +1866,37 @@ static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 *-----------------------------------------------------Http component------------------------------------------------------*
 *#########################################################################################################################*/
 static void Http_Init(void) {
+	int i, count;
 	Http_InitCommon();
-	http_curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	for (i = 0; i < HTTP_MAX_WORKERS; i++)
+	{
+		workers[i].curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	}
 	/* Http component gets initialised multiple times on Android */
-	if (workerThread) return;
+	if (workersCount) return;
+
+#ifdef CC_BUILD_ANDROID
+	/* Android backend only supports one request at a time */
+	count = 1;
+#else
+	count = Options_GetInt(OPT_HTTP_WORKERS, 1, HTTP_MAX_WORKERS, 4);
+#endif
 
 	HttpBackend_Init();
+	HttpCache_Init();
 	RequestList_Init(&pendingReqs);
 	RequestList_Init(&processedReqs);
 
 	workerWaitable  = Waitable_Create("HTTP wakeup");
+	workersMutex    = Mutex_Create("HTTP workers");
 	pendingMutex    = Mutex_Create("HTTP pending");
 	processedMutex  = Mutex_Create("HTTP processed");
 	curRequestMutex = Mutex_Create("HTTP current");
 	
-	Thread_Run(&workerThread, WorkerLoop, 128 * 1024, "HTTP");
+	workersCount = count;
+	for (i = 0; i < count; i++)
+	{
+		Thread_Run(&workers[i].thread, WorkerLoop, 128 * 1024, "HTTP");
+	}
 }
 #endif
@@ -255,6 +255,98 @@ static void ClassicLighting_RefreshAffected(int x, int y, int z, BlockID block,
 	}
 }
 
+/* Refreshes the chunks in a neighbouring column that are affected by all of the changes in a column */
+/* NOTE: Gives the same result as calling ClassicLighting_ResetNeighbour for each change, */
+/*  but only scans each chunk in the neighbouring column at most once */
+static void ClassicLighting_ResetNeighbourColumn(int x, int z, int cx, int cz, const struct BlockChange* changes, int count, int minCy, int maxCy) {
+	int i, j, cy, minY, maxY;
+	cc_bool affected;
+
+	if (minCy == maxCy) {
+		/* Only blocks at or below the highest change in each chunk need to be checked */
+		for (i = 0; i < count; i = j) {
+			cy = changes[i].y >> CHUNK_SHIFT;
+			affected = false;
+
+			for (j = i; j < count && (changes[j].y >> CHUNK_SHIFT) == cy; j++) {
+				if (Blocks.Draw[changes[j].newBlock] != DRAW_OPAQUE) affected = true;
+			}
+			maxY = changes[j - 1].y;
+			minY = cy << CHUNK_SHIFT;
+
+			if (affected || ClassicLighting_NeedsNeighour(BLOCK_AIR, World_Pack(x, maxY, z), minY, maxY, -1)) {
+				MapRenderer_RefreshChunk(cx, cy, cz);
+			}
+		}
+	} else {
+		for (cy = maxCy; cy >= minCy; cy--) {
+			minY = (cy << CHUNK_SHIFT); 
+			maxY = (cy << CHUNK_SHIFT) + CHUNK_MAX;
+			if (maxY > World.MaxY) maxY = World.MaxY;
+			affected = false;
+
+			for (i = 0; i < count; i++) {
+				if (changes[i].y < minY || changes[i].y > maxY) continue;
+				if (Blocks.Draw[changes[i].newBlock] != DRAW_OPAQUE) affected = true;
+			}
+
+			if (affected || ClassicLighting_NeedsNeighour(BLOCK_AIR, World_Pack(x, maxY, z), minY, maxY, -1)) {
+				MapRenderer_RefreshChunk(cx, cy, cz);
+			}
+		}
+	}
+}
+
+/* Refreshes the chunks that are affected by all of the changes in a column */
+/* NOTE: Gives the same result as calling ClassicLighting_RefreshAffected for each change */
+static void ClassicLighting_RefreshAffectedColumn(const struct BlockChange* changes, int count, int oldHeight, int newHeight) {
+	int x = changes[0].x, cx = x >> CHUNK_SHIFT, bX = x & CHUNK_MASK;
+	int z = changes[0].z, cz = z >> CHUNK_SHIFT, bZ = z & CHUNK_MASK;
+	int i, y, cy, bY, lastCy = -1;
+	BlockID block;
+
+	int newCy = newHeight < 0 ? 0 : newHeight >> 4;
+	int oldCy = oldHeight < 0 ? 0 : oldHeight >> 4;
+	int minCy = min(oldCy, newCy), maxCy = max(oldCy, newCy);
+
+	if (minCy == maxCy) {
+		for (i = 0; i < count; i++) {
+			cy = changes[i].y >> CHUNK_SHIFT;
+			if (cy != lastCy) MapRenderer_RefreshChunk(cx, cy, cz);
+			lastCy = cy;
+		}
+	} else {
+		for (cy = maxCy; cy >= minCy; cy--) {
+			MapRenderer_RefreshChunk(cx, cy, cz);
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		y = changes[i].y; cy = y >> CHUNK_SHIFT; bY = y & CHUNK_MASK;
+		block = changes[i].newBlock;
+
+		if (bY == 0 && cy > 0 && ClassicLighting_Needs(block, World_GetBlock(x, y - 1, z))) {
+			MapRenderer_RefreshChunk(cx, cy - 1, cz);
+		}
+		if (bY == 15 && cy < World.ChunksY - 1 && ClassicLighting_Needs(block, World_GetBlock(x, y + 1, z))) {
+			MapRenderer_RefreshChunk(cx, cy + 1, cz);
+		}
+	}
+
+	if (bX == 0 && cx > 0) {
+		ClassicLighting_ResetNeighbourColumn(x - 1, z, cx - 1, cz, changes, count, minCy, maxCy);
+	}
+	if (bZ == 0 && cz > 0) {
+		ClassicLighting_ResetNeighbourColumn(x, z - 1, cx, cz - 1, changes, count, minCy, maxCy);
+	}
+	if (bX == 15 && cx < World.ChunksX - 1) {
+		ClassicLighting_ResetNeighbourColumn(x + 1, z, cx + 1, cz, changes, count, minCy, maxCy);
+	}
+	if (bZ == 15 && cz < World.ChunksZ - 1) {
+		ClassicLighting_ResetNeighbourColumn(x, z + 1, cx, cz + 1, changes, count, minCy, maxCy);
+	}
+}
+
 void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
 	int hIndex = Lighting_Pack(x, z);
 	int lightH = classic_heightmap[hIndex];
@@ -269,123 +361,211 @@ void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, Block
 	ClassicLighting_RefreshAffected(x, y, z, newBlock, lightH + 1, newHeight);
 }
 
+void ClassicLighting_OnBlocksChanged(const struct BlockChange* changes, int count) {
+	int i, j, x, z, maxY;
+	int hIndex, lightH, newHeight;
+
+	for (i = 0; i < count; i = j) {
+		x = changes[i].x; z = changes[i].z;
+		/* Find all the changes in this column */
+		for (j = i + 1; j < count && changes[j].x == x && changes[j].z == z; j++) { }
+
+		hIndex = Lighting_Pack(x, z);
+		lightH = classic_heightmap[hIndex];
+		if (lightH == HEIGHT_UNCALCULATED) continue;
+
+		/* Nothing above the highest changed block or the old light blocking block changed, */
+		/*  so the new light height can be found with a single scan down the column from there */
+		maxY = max(changes[j - 1].y, lightH + 1);
+		maxY = min(maxY, World.MaxY);
+		ClassicLighting_CalcHeightAt(x, maxY, z, hIndex);
+		newHeight = classic_heightmap[hIndex] + 1;
+		ClassicLighting_RefreshAffectedColumn(&changes[i], j - i, lightH + 1, newHeight);
+	}
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------Lighting heightmap----------------------------------------------------*
 *#########################################################################################################################*/
-static int Heightmap_InitialCoverage(int x1, int z1, int xCount, int zCount, int* skip) {
-	int elemsLeft = 0, index = 0, curRunCount = 0;
-	int x, z, hIndex, lightH;
-
-	for (z = 0; z < zCount; z++) {
-		hIndex = Lighting_Pack(x1, z1 + z);
-		for (x = 0; x < xCount; x++) {
-			lightH = classic_heightmap[hIndex++];
-
-			skip[index] = 0;
-			if (lightH == HEIGHT_UNCALCULATED) {
-				elemsLeft++;
-				curRunCount = 0;
-			} else {
-				skip[index - curRunCount]++;
-				curRunCount++;
-			}
-			index++;
+/* The heights of a row of columns are calculated together, by scanning down from the top of the map */
+/* Most blocks near the top of a map are air, so on CPUs with SSE2 or NEON support, */
+/*  16 columns are checked at once for whether they contain a non-air block at that height */
+#define HEIGHTMAP_GROUP_SIZE 16
+#define HEIGHTMAP_MAX_GROUPS 64
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+/* Returns a bitmask of which of the 16 given blocks are non-zero */
+static CC_INLINE int Heightmap_NonZero16(const BlockRaw* blocks) {
+	__m128i row = _mm_loadu_si128((const __m128i*)blocks);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(row, _mm_setzero_si128())) ^ 0xFFFF;
+}
+#elif defined __ARM_NEON
+#include <arm_neon.h>
+static const cc_uint8 heightmap_bits[16] = { 1,2,4,8,16,32,64,128, 1,2,4,8,16,32,64,128 };
+
+static CC_INLINE int Heightmap_NonZero16(const BlockRaw* blocks) {
+	uint8x16_t row  = vld1q_u8(blocks);
+	uint8x16_t mask = vandq_u8(vtstq_u8(row, row), vld1q_u8(heightmap_bits));
+	/* Sum the bits of each half together */
+	uint8x8_t  sums = vpadd_u8(vget_low_u8(mask), vget_high_u8(mask));
+	sums = vpadd_u8(sums, sums);
+	sums = vpadd_u8(sums, sums);
+	return vget_lane_u8(sums, 0) | (vget_lane_u8(sums, 1) << 8);
+}
+#else
+static int Heightmap_NonZero16(const BlockRaw* blocks) {
+	int i, mask = 0;
+	for (i = 0; i < HEIGHTMAP_GROUP_SIZE; i++) 
+	{
+		if (blocks[i]) mask |= 1 << i;
+	}
+	return mask;
+}
+#endif
+
+/* Returns a bitmask of which of the given blocks are non-air */
+static int Heightmap_NonAir(int index, int count) {
+	int i, mask = 0;
+	if (count < HEIGHTMAP_GROUP_SIZE) {
+		/* Avoid reading past the end of the map */
+		for (i = 0; i < count; i++) 
+		{
+			if (World_GetRawBlock(index + i) != BLOCK_AIR) mask |= 1 << i;
 		}
-		curRunCount = 0; /* We can only skip an entire X row at most. */
+		return mask;
 	}
-	return elemsLeft;
+
+	mask = Heightmap_NonZero16(World.Blocks + index);
+#ifdef EXTENDED_BLOCKS
+	if (World.IDMask > 0xFF) mask |= Heightmap_NonZero16(World.Blocks2 + index);
+#endif
+	return mask;
 }
 
-#define Heightmap_CalculateBody(get_block)\
-for (y = World.Height - 1; y >= 0; y--) {\
-	if (elemsLeft <= 0) { return true; } \
-	mapIndex = World_Pack(x1, y, z1);\
-	hIndex   = Lighting_Pack(x1, z1);\
-\
-	for (z = 0; z < zCount; z++) {\
-		baseIndex = mapIndex;\
-		index = z * xCount;\
-		for (x = 0; x < xCount;) {\
-			curRunCount = skip[index];\
-			x += curRunCount; mapIndex += curRunCount; index += curRunCount;\
-\
-			if (x < xCount && Blocks.BlocksLight[get_block]) {\
-				lightOffset = (Blocks.LightOffset[get_block] >> LIGHT_FLAG_SHADES_FROM_BELOW) & 1;\
-				classic_heightmap[hIndex + x] = (cc_int16)(y - lightOffset);\
-				elemsLeft--;\
-				skip[index] = 0;\
-\
-				offset = prevRunCount + curRunCount;\
-				newRunCount = skip[index - offset] + 1;\
-\
-				/* consider case 1 0 1 0, where we are at last 0 */ \
-				/* we need to make this 3 0 0 0 and advance by 1 */ \
-				oldRunCount = (x - offset + newRunCount) < xCount ? skip[index - offset + newRunCount] : 0; \
-				if (oldRunCount != 0) {\
-					skip[index - offset + newRunCount] = 0; \
-					newRunCount += oldRunCount; \
-				} \
-				skip[index - offset] = newRunCount; \
-				x += oldRunCount; index += oldRunCount; mapIndex += oldRunCount; \
-				prevRunCount = newRunCount; \
-			} else { \
-				prevRunCount = 0; \
-			}\
-			x++; mapIndex++; index++; \
-		}\
-		prevRunCount = 0;\
-		hIndex += World.Width;\
-		mapIndex = baseIndex + World.Width; /* advance one Z */ \
-	}\
+/* Calculates the height of any uncalculated columns in [x1, x1 + count) */
+/* NOTE: count must be HEIGHTMAP_GROUP_SIZE * HEIGHTMAP_MAX_GROUPS or less */
+static void Heightmap_CalculateRow(int x1, int z, int count) {
+	cc_uint16 pending[HEIGHTMAP_MAX_GROUPS];
+	cc_int16* heights = &classic_heightmap[Lighting_Pack(x1, z)];
+	int groups = (count + HEIGHTMAP_GROUP_SIZE - 1) / HEIGHTMAP_GROUP_SIZE;
+	int groupsLeft = 0, g, i, x, y, bits, index, offset;
+	cc_bool airBlocksLight = Blocks.BlocksLight[BLOCK_AIR];
+	BlockID block;
+
+	for (g = 0; g < groups; g++) 
+	{
+		pending[g] = 0;
+		for (i = 0, x = g * HEIGHTMAP_GROUP_SIZE; i < HEIGHTMAP_GROUP_SIZE && x < count; i++, x++) 
+		{
+			if (heights[x] == HEIGHT_UNCALCULATED) pending[g] |= 1 << i;
+		}
+		if (pending[g]) groupsLeft++;
+	}
+
+	for (y = World.Height - 1; y >= 0 && groupsLeft; y--) 
+	{
+		index = World_Pack(x1, y, z);
+
+		for (g = 0; g < groups; g++, index += HEIGHTMAP_GROUP_SIZE) 
+		{
+			if (!pending[g]) continue;
+			x    = g * HEIGHTMAP_GROUP_SIZE;
+			bits = airBlocksLight ? pending[g] : Heightmap_NonAir(index, count - x) & pending[g];
+
+			for (i = 0; bits; i++, bits >>= 1) 
+			{
+				if (!(bits & 1)) continue;
+				block = World_GetRawBlock(index + i);
+				if (!Blocks.BlocksLight[block]) continue;
+
+				offset = (Blocks.LightOffset[block] >> LIGHT_FLAG_SHADES_FROM_BELOW) & 1;
+				heights[x + i] = (cc_int16)(y - offset);
+				pending[g]    &= ~(1 << i);
+			}
+			if (!pending[g]) groupsLeft--;
+		}
+	}
+
+	/* No block in these columns blocks light */
+	for (g = 0; g < groups && groupsLeft; g++) 
+	{
+		for (i = 0, x = g * HEIGHTMAP_GROUP_SIZE; pending[g] >> i; i++) 
+		{
+			if (pending[g] & (1 << i)) heights[x + i] = -10;
+		}
+	}
 }
 
-static cc_bool Heightmap_CalculateCoverage(int x1, int z1, int xCount, int zCount, int elemsLeft, int* skip) {
-	int prevRunCount = 0, curRunCount, newRunCount, oldRunCount;
-	int lightOffset, offset;
-	int mapIndex, hIndex, baseIndex, index;
-	int x, y, z;
+/* Calculates the height of any uncalculated columns in the given region */
+static void Heightmap_Calculate(int x1, int z1, int xCount, int zCount) {
+	int x, z, count;
+	for (z = z1; z < z1 + zCount; z++) 
+	{
+		for (x = x1; x < x1 + xCount; x += count) 
+		{
+			count = min(x1 + xCount - x, HEIGHTMAP_GROUP_SIZE * HEIGHTMAP_MAX_GROUPS);
+			Heightmap_CalculateRow(x, z, count);
+		}
+	}
+}
 
-#ifndef EXTENDED_BLOCKS
-	Heightmap_CalculateBody(World.Blocks[mapIndex]);
-#else
-	if (World.IDMask <= 0xFF) {
-		Heightmap_CalculateBody(World.Blocks[mapIndex]);
-	} else {
-		Heightmap_CalculateBody(World.Blocks[mapIndex] | (World.Blocks2[mapIndex] << 8));
+/* On systems with preemptive multitasking, the heights of every column are calculated */
+/*  as soon as a new map is loaded, using several threads that each calculate slabs of rows */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_LOWMEM
+#define HEIGHTMAP_SLAB_LENGTH 16
+#define HEIGHTMAP_MAX_WORKERS 16
+static void* slabMutex;
+static int nextSlab;
+
+static void Heightmap_RunSlabs(void) {
+	int zBeg;
+	for (;;)
+	{
+		Mutex_Lock(slabMutex);
+		zBeg      = nextSlab;
+		nextSlab += HEIGHTMAP_SLAB_LENGTH;
+		Mutex_Unlock(slabMutex);
+
+		if (zBeg >= World.Length) return;
+		Heightmap_Calculate(0, zBeg, World.Width, min(HEIGHTMAP_SLAB_LENGTH, World.Length - zBeg));
 	}
-#endif
-	return false;
 }
 
-static void Heightmap_FinishCoverage(int x1, int z1, int xCount, int zCount) {
-	int x, z, hIndex, lightH;
+static void Heightmap_CalculateAll(void) {
+	void* threads[HEIGHTMAP_MAX_WORKERS];
+	int i, count = Options_GetInt(OPT_BUILDER_THREADS, 0, HEIGHTMAP_MAX_WORKERS, 3);
+	slabMutex = Mutex_Create("Heightmap slabs");
+	nextSlab  = 0;
 
-	for (z = 0; z < zCount; z++) {
-		hIndex = Lighting_Pack(x1, z1 + z);
-		for (x = 0; x < xCount; x++, hIndex++) {
-			lightH = classic_heightmap[hIndex];
+	for (i = 0; i < count; i++) 
+	{
+		Thread_Run(&threads[i], Heightmap_RunSlabs, 64 * 1024, "Heightmap worker");
+	}
+	Heightmap_RunSlabs();
 
-			if (lightH == HEIGHT_UNCALCULATED) {
-				classic_heightmap[hIndex] = -10;
-			}
-		}
+	for (i = 0; i < count; i++) 
+	{
+		Thread_Join(threads[i]);
 	}
+	Mutex_Free(slabMutex);
 }
+#else
+/* Heights are lazily calculated instead when LightHint is called */
+static void Heightmap_CalculateAll(void) { }
+#endif
 
 
 void ClassicLighting_LightHint(int startX, int startY, int startZ) {
 	int x1 = max(startX, 0), x2 = min(World.Width,  startX + EXTCHUNK_SIZE);
 	int z1 = max(startZ, 0), z2 = min(World.Length, startZ + EXTCHUNK_SIZE);
-	int xCount = x2 - x1, zCount = z2 - z1;
-	int skip[EXTCHUNK_SIZE * EXTCHUNK_SIZE];
 
-	int elemsLeft = Heightmap_InitialCoverage(x1, z1, xCount, zCount, skip);
-	if (!Heightmap_CalculateCoverage(x1, z1, xCount, zCount, elemsLeft, skip)) {
-		Heightmap_FinishCoverage(x1, z1, xCount, zCount);
-	}
+	Heightmap_Calculate(x1, z1, x2 - x1, z2 - z1);
 }
 
+static void ClassicLighting_LightHint_Worker(int startX, int startY, int startZ) { }
+
 void ClassicLighting_FreeState(void) {
 	Mem_Free(classic_heightmap);
 	classic_heightmap = NULL;
@@ -395,6 +575,7 @@ void ClassicLighting_AllocState(void) {
 	classic_heightmap = (cc_int16*)Mem_TryAlloc(World.Width * World.Length, 2);
 	if (classic_heightmap) {
 		ClassicLighting_Refresh();
+		Heightmap_CalculateAll();
 	} else {
 		World_OutOfMemory();
 	}
@@ -404,8 +585,9 @@ static void ClassicLighting_SetActive(void) {
 	cc_bool smoothLighting = false;
 	if (!Game_ClassicMode) smoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
 
-	Lighting.OnBlockChanged = ClassicLighting_OnBlockChanged;
-	Lighting.Refresh        = ClassicLighting_Refresh;
+	Lighting.OnBlockChanged  = ClassicLighting_OnBlockChanged;
+	Lighting.OnBlocksChanged = ClassicLighting_OnBlocksChanged;
+	Lighting.Refresh         = ClassicLighting_Refresh;
 	Lighting.IsLit          = ClassicLighting_IsLit;
 	Lighting.Color          = smoothLighting ? SmoothLighting_Color : ClassicLighting_Color;
 	Lighting.Color_XSide    = ClassicLighting_Color_XSide;
@@ -420,18 +602,39 @@ static void ClassicLighting_SetActive(void) {
 	Lighting.FreeState  = ClassicLighting_FreeState;
 	Lighting.AllocState = ClassicLighting_AllocState;
 	Lighting.LightHint  = ClassicLighting_LightHint;
+	Lighting.LightHint_Worker = ClassicLighting_LightHint_Worker;
 }
 
 
 /*########################################################################################################################*
 *---------------------------------------------------Lighting component----------------------------------------------------*
 *#########################################################################################################################*/
+/* OnBlockChanged and OnBlocksChanged of the active lighting engine */
+static void (*engineOnBlockChanged)(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+static void (*engineOnBlocksChanged)(const struct BlockChange* changes, int count);
+
+void Lighting_OnBlocksChanged(const struct BlockChange* changes, int count) {
+	int i;
+	if (Lighting.OnBlockChanged == engineOnBlockChanged || Lighting.OnBlocksChanged != engineOnBlocksChanged) {
+		Lighting.OnBlocksChanged(changes, count); return;
+	}
+
+	/* A plugin replaced OnBlockChanged, but did not replace OnBlocksChanged too */
+	for (i = 0; i < count; i++) 
+	{
+		Lighting.OnBlockChanged(changes[i].x, changes[i].y, changes[i].z, 
+								changes[i].oldBlock, changes[i].newBlock);
+	}
+}
+
 static void Lighting_ApplyActive(void) {
 	if (Lighting_Mode != LIGHTING_MODE_CLASSIC) {
 		FancyLighting_SetActive();
 	} else {
 		ClassicLighting_SetActive();
 	}
+	engineOnBlockChanged  = Lighting.OnBlockChanged;
+	engineOnBlocksChanged = Lighting.OnBlocksChanged;
 }
 
 static void Lighting_SwitchActive(void) {
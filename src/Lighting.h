@@ -11,6 +11,7 @@ Abstracts lighting of blocks in the world
 Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 */
 struct IGameComponent;
+struct BlockChange;
 extern struct IGameComponent Lighting_Component;
 
 enum LightingMode {
@@ -72,8 +73,22 @@ CC_VAR extern struct _Lighting {
 	PackedCol (*Color_YMin_Fast)(int x, int y, int z);
 	PackedCol (*Color_XSide_Fast)(int x, int y, int z);
 	PackedCol (*Color_ZSide_Fast)(int x, int y, int z);
+
+	/* Called after a batch of blocks has been changed, instead of calling OnBlockChanged for each block. */
+	/* NOTE: Changes are sorted by column and then Y, and each block occurs at most once. */
+	/* NOTE: Implementations ***MUST*** mark all chunks affected by these lighting changes as needing to be refreshed. */
+	void (*OnBlocksChanged)(const struct BlockChange* changes, int count);
+
+	/* Performs any calculations for the region that LightHint leaves to mesh builder threads */
+	/* NOTE: Called after LightHint, and may be called from several threads at once */
+	void (*LightHint_Worker)(int startX, int startY, int startZ);
 } Lighting;
 
+/* Updates lighting state after a batch of blocks has been changed */
+/* NOTE: If a plugin replaced OnBlockChanged but not OnBlocksChanged, */
+/*  OnBlockChanged is called for each changed block instead */
+void Lighting_OnBlocksChanged(const struct BlockChange* changes, int count);
+
 void FancyLighting_SetActive(void);
 void FancyLighting_OnInit(void);
 
@@ -86,6 +101,7 @@ void ClassicLighting_LightHint(int startX, int startY, int startZ);
 cc_bool ClassicLighting_IsLit(int x, int y, int z);
 cc_bool ClassicLighting_IsLit_Fast(int x, int y, int z);
 void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+void ClassicLighting_OnBlocksChanged(const struct BlockChange* changes, int count);
 
 CC_END_HEADER
 #endif
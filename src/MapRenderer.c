@@ -42,8 +42,17 @@ static struct ChunkInfo** renderChunks;
 static int renderChunksCount;
 /* Distance of each chunk from the camera. */
 static cc_uint32* distances;
+/* Bitsets of the blocks in and around each chunk (CHUNK_BLOCKS_WORDS per chunk) */
+static cc_uint32* blocksPresent;
+/* Faces through which each chunk was reached from the camera's chunk (0 if the chunk is occluded) */
+static cc_uint8* reachedFaces;
+/* Queue of chunks for occlusion culling, packed as (chunk index << 9) | (entry face << 6) | directions */
+static cc_uint32* reachQueue;
+static cc_bool occlusionCulling;
+#define FACE_ALL_LINKS ((1 << FACE_COUNT) - 1)
 /* Maximum number of chunk updates that can be performed in one frame. */
 static int maxChunkUpdates;
+#define MAX_CHUNK_UPDATES 1024
 /* Cached number of chunks in the world */
 static int chunksCount;
 
@@ -59,6 +68,8 @@ static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 	chunk->dirty   = false; 
 	chunk->allAir  = false;
 	chunk->noData  = true;
+	Mem_Set(chunk->blocksPresent, 0, CHUNK_BLOCKS_WORDS * 4);
+	Mem_Set(chunk->faceLinks, FACE_ALL_LINKS, FACE_COUNT);
 
 	chunk->drawXMin = false; chunk->drawXMax = false; chunk->drawZMin = false;
 	chunk->drawZMax = false; chunk->drawYMin = false; chunk->drawYMax = false;
@@ -324,10 +335,7 @@ static void DeleteChunk(struct ChunkInfo* info) {
 	info->empty  = false; 
 	info->allAir = false;
 	info->noData = true;
-#ifdef OCCLUSION
-	info.OcclusionFlags = 0;
-	info.OccludedFlags = 0;
-#endif
+	Mem_Set(info->faceLinks, FACE_ALL_LINKS, FACE_COUNT);
 
 	if (info->normalParts) {
 		ptr = info->normalParts;
@@ -354,15 +362,12 @@ static void DeleteChunk(struct ChunkInfo* info) {
 	}
 }
 
-/* Builds the mesh (hence vertex buffer) for the given chunk, and updates internal state */
-static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+/* Updates internal state after the mesh (hence vertex buffer) for the given chunk has been built */
+static void OnChunkBuilt(struct ChunkInfo* info) {
 	struct ChunkPartInfo* ptr;
 	int i;
 
 	Game.ChunkUpdates++;
-	(*chunkUpdates)++;
-	Builder_MakeChunk(info);
-
 	info->dirty  = false;
 	info->noData = !info->normalParts && !info->translucentParts;
 	info->empty  = info->noData;
@@ -398,11 +403,17 @@ static void FreeChunks(void) {
 	Mem_Free(sortedChunks);
 	Mem_Free(renderChunks);
 	Mem_Free(distances);
+	Mem_Free(reachedFaces);
+	Mem_Free(reachQueue);
+	Mem_Free(blocksPresent);
 
 	mapChunks    = NULL;
 	sortedChunks = NULL;
 	renderChunks = NULL;
 	distances    = NULL;
+	reachedFaces = NULL;
+	reachQueue   = NULL;
+	blocksPresent = NULL;
 }
 
 static void AllocateParts(void) {
@@ -419,6 +430,9 @@ static void AllocateChunks(void) {
 	sortedChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
 	renderChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "render chunk info");
 	distances    = (cc_uint32*)Mem_Alloc(chunksCount, 4, "chunk distances");
+	reachedFaces = (cc_uint8*) Mem_Alloc(chunksCount, 1, "chunk reached faces");
+	reachQueue   = (cc_uint32*)Mem_Alloc(chunksCount * FACE_COUNT + 1, 4, "chunk reach queue");
+	blocksPresent = (cc_uint32*)Mem_Alloc(chunksCount, CHUNK_BLOCKS_WORDS * 4, "chunk blocks present");
 }
 
 static void ResetPartFlags(void) {
@@ -444,6 +458,7 @@ static void InitChunks(void) {
 	for (z = 0; z < World.Length; z += CHUNK_SIZE) {
 		for (y = 0; y < World.Height; y += CHUNK_SIZE) {
 			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
+				mapChunks[index].blocksPresent = blocksPresent + index * CHUNK_BLOCKS_WORDS;
 				ChunkInfo_Reset(&mapChunks[index], x, y, z);
 				sortedChunks[index] = &mapChunks[index];
 				renderChunks[index] = &mapChunks[index];
@@ -542,71 +557,146 @@ static void CalcViewDists(void) {
 	renderDistSquared = AdjustDist(Game_ViewDistance);
 }
 
-static int UpdateChunksAndVisibility(int* chunkUpdates) {
+/* Chunks being built in the current frame */
+static struct ChunkInfo* buildChunks[MAX_CHUNK_UPDATES];
+
+/* Builds the meshes of up to chunksTarget nearby chunks that need to be (re)built */
+static int BuildChunks(void) {
+	int renderDistSqr = renderDistSquared;
+	int buildDistSqr  = buildDistSquared;
+
+	struct ChunkInfo* info;
+	int i, count = 0, distSqr;
+
+	for (i = 0; i < chunksCount && count < chunksTarget; i++) {
+		info = sortedChunks[i];
+		if (info->empty || !(info->noData || info->dirty)) continue;
+
+		distSqr = distances[i];
+		if (distSqr > buildDistSqr) continue;
+
+		DeleteChunk(info);
+		buildChunks[count++] = info;
+
+		/* only need to update the visibility of chunks in range. */
+		info->visible = distSqr <= renderDistSqr &&
+			FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
+	}
+	if (!count) return 0;
+
+	Builder_MakeChunks(buildChunks, count);
+	for (i = 0; i < count; i++) {
+		OnChunkBuilt(buildChunks[i]);
+	}
+	return count;
+}
+
+/*########################################################################################################################*
+*---------------------------------------------------Occlusion culling-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Chunks are visited breadth first, starting from the chunk the camera is in. A neighbouring chunk is only visited if */
+/*  it is in render distance and the view frustum, it is not back towards the camera, and it can be seen through the */
+/*  current chunk from the face that chunk was entered from. Chunks that are never visited cannot be seen. */
+#define REACH_FROM_CAMERA FACE_COUNT
+#define Face_Opposite(face) ((face) ^ 1)
+
+static void CalcReachableChunks(void) {
+	static const cc_int8 offsets[FACE_COUNT][3] = {
+		{ -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, -1, 0 }, { 0, 1, 0 }
+	};
+	int renderDistSqr = renderDistSquared;
+	struct ChunkInfo* info;
+	int head = 0, tail = 0, entry, from, dirs, links;
+	int cx, cy, cz, index, dx, dy, dz, f;
+
+	cx = chunkPos.x >> CHUNK_SHIFT; cy = chunkPos.y >> CHUNK_SHIFT; cz = chunkPos.z >> CHUNK_SHIFT;
+	/* Not worth trying to cull when the camera is outside the map */
+	if (!occlusionCulling || cx < 0 || cy < 0 || cz < 0 || cx >= World.ChunksX || cy >= World.ChunksY || cz >= World.ChunksZ) {
+		Mem_Set(reachedFaces, FACE_ALL_LINKS, chunksCount); return;
+	}
+
+	Mem_Set(reachedFaces, 0, chunksCount);
+	index = World_ChunkPack(cx, cy, cz);
+	reachedFaces[index]  = FACE_ALL_LINKS;
+	reachQueue[tail++] = (index << 9) | (REACH_FROM_CAMERA << 6);
+
+	while (head < tail) {
+		entry = reachQueue[head++];
+		index = entry >> 9; from = (entry >> 6) & 0x07; dirs = entry & 0x3F;
+
+		info  = &mapChunks[index];
+		links = from == REACH_FROM_CAMERA ? FACE_ALL_LINKS : info->faceLinks[from];
+
+		for (f = 0; f < FACE_COUNT; f++) 
+		{
+			if (!(links & (1 << f)))              continue;
+			if (dirs & (1 << Face_Opposite(f))) continue;
+
+			cx = (info->centreX >> CHUNK_SHIFT) + offsets[f][0];
+			cy = (info->centreY >> CHUNK_SHIFT) + offsets[f][1];
+			cz = (info->centreZ >> CHUNK_SHIFT) + offsets[f][2];
+			if (cx < 0 || cy < 0 || cz < 0 || cx >= World.ChunksX || cy >= World.ChunksY || cz >= World.ChunksZ) continue;
+
+			index = World_ChunkPack(cx, cy, cz);
+			/* A chunk only needs to be visited once through each face */
+			if (reachedFaces[index] & (1 << Face_Opposite(f))) continue;
+
+			dx = (cx << CHUNK_SHIFT) + HALF_CHUNK_SIZE - chunkPos.x;
+			dy = (cy << CHUNK_SHIFT) + HALF_CHUNK_SIZE - chunkPos.y;
+			dz = (cz << CHUNK_SHIFT) + HALF_CHUNK_SIZE - chunkPos.z;
+			if (dx * dx + dy * dy + dz * dz > renderDistSqr) continue;
+
+			if (!reachedFaces[index] && !FrustumCulling_SphereInFrustum(
+					mapChunks[index].centreX, mapChunks[index].centreY, mapChunks[index].centreZ, 14)) continue;
+
+			reachedFaces[index] |= 1 << Face_Opposite(f);
+			reachQueue[tail++] = (index << 9) | (Face_Opposite(f) << 6) | dirs | (1 << f);
+		}
+	}
+}
+
+static int UpdateChunksAndVisibility(void) {
 	int renderDistSqr = renderDistSquared;
 	int buildDistSqr  = buildDistSquared;
 
 	struct ChunkInfo* info;
 	int i, j = 0, distSqr;
-	cc_bool noData;
 
 	for (i = 0; i < chunksCount; i++) {
 		info = sortedChunks[i];
 		if (info->empty) continue;
-
 		distSqr = distances[i];
-		noData  = info->noData;
 		
 		/* Auto unload chunks far away chunks */
-		if (!noData && distSqr >= buildDistSqr + 32 * 16) {
+		if (!info->noData && distSqr >= buildDistSqr + 32 * 16) {
 			DeleteChunk(info); continue;
 		}
-		noData |= info->dirty;
-
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
-			BuildChunk(info, chunkUpdates);
-		}
 
-		info->visible = distSqr <= renderDistSqr &&
+		info->visible = distSqr <= renderDistSqr && reachedFaces[info - mapChunks] &&
 			FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
 		if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
 	}
 	return j;
 }
 
-static int UpdateChunksStill(int* chunkUpdates) {
-	int renderDistSqr = renderDistSquared;
-	int buildDistSqr  = buildDistSquared;
+static int UpdateChunksStill(void) {
+	int buildDistSqr = buildDistSquared;
 
 	struct ChunkInfo* info;
 	int i, j = 0, distSqr;
-	cc_bool noData;
 
 	for (i = 0; i < chunksCount; i++) {
 		info = sortedChunks[i];
 		if (info->empty) continue;
-
 		distSqr = distances[i];
-		noData  = info->noData;
 
 		/* Auto unload chunks far away chunks */
-		if (!noData && distSqr >= buildDistSqr + 32 * 16) {
+		if (!info->noData && distSqr >= buildDistSqr + 32 * 16) {
 			DeleteChunk(info); continue;
 		}
-		noData |= info->dirty;
-
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
-			BuildChunk(info, chunkUpdates);
-
-			/* only need to update the visibility of chunks in range. */
-			info->visible = distSqr <= renderDistSqr &&
-				FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
-			if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
-		} else if (info->visible) {
-			renderChunks[j] = info; j++;
-		}
+
+		/* visibility of newly built chunks was already updated by BuildChunks */
+		if (info->visible) { renderChunks[j] = info; j++; }
 	}
 	return j;
 }
@@ -614,7 +704,7 @@ static int UpdateChunksStill(int* chunkUpdates) {
 static void UpdateChunks(float delta) {
 	struct LocalPlayer* p;
 	cc_bool samePos;
-	int chunkUpdates = 0;
+	int chunkUpdates;
 
 	/* Build more chunks if 30 FPS or over, otherwise slowdown */
 	chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
@@ -624,9 +714,14 @@ static void UpdateChunks(float delta) {
 	samePos = Vec3_Equals(&Camera.CurrentPos, &lastCamPos)
 		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw;
 
-	renderChunksCount = samePos ?
-		UpdateChunksStill(&chunkUpdates) :
-		UpdateChunksAndVisibility(&chunkUpdates);
+	chunkUpdates = BuildChunks();
+	/* Newly built chunks may have changed which chunks can be seen */
+	if (samePos && !chunkUpdates) {
+		renderChunksCount = UpdateChunksStill();
+	} else {
+		CalcReachableChunks();
+		renderChunksCount = UpdateChunksAndVisibility();
+	}
 
 	lastCamPos = Camera.CurrentPos;
 	lastPitch  = p->Base.Pitch;
@@ -691,7 +786,6 @@ static void UpdateSortOrder(void) {
 
 	SortMapChunks(0, chunksCount - 1);
 	ResetPartFlags();
-	/*SimpleOcclusionCulling();*/
 }
 
 void MapRenderer_Update(float delta) {
@@ -714,14 +808,54 @@ void MapRenderer_RefreshChunk(int cx, int cy, int cz) {
 	info->dirty = true;
 }
 
-void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block) {
+static void MarkBlockPresent(int cx, int cy, int cz, BlockID block) {
+	if (cx < 0 || cy < 0 || cz < 0 || cx >= World.ChunksX || cy >= World.ChunksY || cz >= World.ChunksZ) return;
+	ChunkInfo_AddBlock(mapChunks[World_ChunkPack(cx, cy, cz)].blocksPresent, block);
+}
+
+/* Updates which blocks the chunk containing the given block and its neighbours have */
+static void MarkBlockChanged(int x, int y, int z, BlockID block) {
 	int cx = x >> CHUNK_SHIFT, cy = y >> CHUNK_SHIFT, cz = z >> CHUNK_SHIFT;
 	struct ChunkInfo* chunk;
 
 	chunk = &mapChunks[World_ChunkPack(cx, cy, cz)];
 	chunk->allAir &= Blocks.Draw[block] == DRAW_GAS;
+	ChunkInfo_AddBlock(chunk->blocksPresent, block);
+
+	/* Neighbouring chunks may not be rebuilt, but still need to know the block is around them */
+	if ((x & CHUNK_MASK) == 0)          MarkBlockPresent(cx - 1, cy, cz, block);
+	if ((x & CHUNK_MASK) == CHUNK_MAX)  MarkBlockPresent(cx + 1, cy, cz, block);
+	if ((y & CHUNK_MASK) == 0)          MarkBlockPresent(cx, cy - 1, cz, block);
+	if ((y & CHUNK_MASK) == CHUNK_MAX)  MarkBlockPresent(cx, cy + 1, cz, block);
+	if ((z & CHUNK_MASK) == 0)          MarkBlockPresent(cx, cy, cz - 1, block);
+	if ((z & CHUNK_MASK) == CHUNK_MAX)  MarkBlockPresent(cx, cy, cz + 1, block);
+}
+
+void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block) {
+	MarkBlockChanged(x, y, z, block);
 	/* TODO: Don't lookup twice, refresh directly using chunk pointer */
-	MapRenderer_RefreshChunk(cx, cy, cz);
+	MapRenderer_RefreshChunk(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+}
+
+void MapRenderer_OnBlocksChanged(const struct BlockChange* changes, int count) {
+	int i, cx, cy, cz, index, lastIndex = -1;
+
+	/* NOTE: All changes must be marked first, as a later change might make an all air chunk not be */
+	for (i = 0; i < count; i++) 
+	{
+		MarkBlockChanged(changes[i].x, changes[i].y, changes[i].z, changes[i].newBlock);
+	}
+
+	/* Changes are sorted by column and then Y, so changes in the same chunk are usually next to each other */
+	for (i = 0; i < count; i++) 
+	{
+		cx = changes[i].x >> CHUNK_SHIFT; cy = changes[i].y >> CHUNK_SHIFT; cz = changes[i].z >> CHUNK_SHIFT;
+		index = World_ChunkPack(cx, cy, cz);
+
+		if (index == lastIndex) continue;
+		MapRenderer_RefreshChunk(cx, cy, cz);
+		lastIndex = index;
+	}
 }
 
 static void OnEnvVariableChanged(void* obj, int envVar) {
@@ -749,12 +883,49 @@ static void OnTerrainAtlasChanged(void* obj) {
 	ResetPartFlags();
 }
 
+/* Refreshes all chunks which contain the given block or have it as a neighbour */
+static void RefreshChunksWith(BlockID block) {
+	struct ChunkInfo* info;
+	int i;
+	if (!mapChunks || !World.Blocks) return;
+
+	for (i = 0; i < chunksCount; i++) 
+	{
+		info = &mapChunks[i];
+		if (!ChunkInfo_HasBlock(info->blocksPresent, block)) continue;
+
+		/* Chunk may have been skipped as all air or all solid with the old definition */
+		info->allAir = false;
+		info->empty  = false;
+		info->dirty  = true;
+	}
+}
+
+/* Whether chunks were already refreshed by the BlockDefUpdated raised just before BlockDefChanged */
+static cc_bool blockDefUpdated;
+
 static void OnBlockDefinitionChanged(void* obj) {
+	if (blockDefUpdated) { blockDefUpdated = false; return; }
+
+	/* Raised on its own (e.g. by plugins), so any block might have changed */
 	MapRenderer_Refresh();
 	MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
 	ResetPartFlags();
 }
 
+static void OnBlockDefinitionUpdated(void* obj, int block) {
+	/* Parts arrays need to be reallocated when the number of used atlases changes */
+	if (MapRenderer_UsedAtlases() != MapRenderer_1DUsedCount) {
+		MapRenderer_Refresh();
+	} else {
+		RefreshChunksWith((BlockID)block);
+	}
+
+	MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
+	ResetPartFlags();
+	blockDefUpdated = true;
+}
+
 static void OnVisibilityChanged(void* obj) {
 	lastCamPos = Vec3_BigPos();
 	CalcViewDists();
@@ -791,6 +962,7 @@ static void OnInit(void) {
 	Event_Register_(&TextureEvents.AtlasChanged,  NULL, OnTerrainAtlasChanged);
 	Event_Register_(&WorldEvents.EnvVarChanged,   NULL, OnEnvVariableChanged);
 	Event_Register_(&BlockEvents.BlockDefChanged, NULL, OnBlockDefinitionChanged);
+	Event_Register_(&BlockEvents.BlockDefUpdated, NULL, OnBlockDefinitionUpdated);
 
 	Event_Register_(&GfxEvents.ViewDistanceChanged, NULL, OnVisibilityChanged);
 	Event_Register_(&GfxEvents.ProjectionChanged,   NULL, OnVisibilityChanged);
@@ -800,7 +972,8 @@ static void OnInit(void) {
 	/* This = 87 fixes map being invisible when no textures */
 	MapRenderer_1DUsedCount = 87; /* Atlas1D_UsedAtlasesCount(); */
 	chunkPos   = IVec3_MaxValue();
-	maxChunkUpdates = Options_GetInt(OPT_MAX_CHUNK_UPDATES, 4, 1024, 30);
+	maxChunkUpdates  = Options_GetInt(OPT_MAX_CHUNK_UPDATES, 4, MAX_CHUNK_UPDATES, 30);
+	occlusionCulling = Options_GetBool(OPT_OCCLUSION_CULLING, true);
 	CalcViewDists();
 }
 
@@ -2,6 +2,7 @@
 #define CC_MAPRENDERER_H
 #include "Core.h"
 #include "Constants.h"
+#include "BlockID.h"
 CC_BEGIN_HEADER
 
 /* Renders the blocks of the world by subdividing it into chunks.
@@ -10,6 +11,7 @@ CC_BEGIN_HEADER
    Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 */
 struct IGameComponent;
+struct BlockChange;
 extern struct IGameComponent MapRenderer_Component;
 
 /* Max used 1D atlases. (i.e. Atlas1D_Index(maxTextureLoc) + 1) */
@@ -50,10 +52,12 @@ struct ChunkInfo {
 	cc_uint8 drawYMin : 1;
 	cc_uint8 drawYMax : 1;
 	cc_uint8 : 0;          /* pad to next byte */
-#ifdef OCCLUSION
-	public cc_bool Visited = false, Occluded = false;
-	public byte OcclusionFlags, OccludedFlags, DistanceFlags;
-#endif
+	/* Bitset of the blocks in and around the chunk (see ChunkInfo_AddBlock) */
+	/* NOTE: Only valid after the chunk has been read by the builder */
+	cc_uint32* blocksPresent;
+	/* For each face, bitmask of the faces it is connected to through non-opaque blocks inside the chunk */
+	/* NOTE: All faces are assumed to be connected if the chunk hasn't been built yet */
+	cc_uint8 faceLinks[FACE_COUNT];
 #ifndef CC_BUILD_GL11
 	GfxResourceID vb;
 #endif
@@ -61,6 +65,13 @@ struct ChunkInfo {
 	struct ChunkPartInfo* translucentParts;
 };
 
+/* Number of 32 bit words in ChunkInfo's blocksPresent bitset */
+#define CHUNK_BLOCKS_WORDS ((BLOCK_COUNT + 31) / 32)
+/* Adds the given block to ChunkInfo's blocksPresent bitset */
+#define ChunkInfo_AddBlock(present, block) (present)[(block) >> 5] |= (1u << ((block) & 31))
+/* Whether the given block is in ChunkInfo's blocksPresent bitset */
+#define ChunkInfo_HasBlock(present, block) ((present)[(block) >> 5] & (1u << ((block) & 31)))
+
 /* Renders the meshes of non-translucent blocks in visible chunks. */
 void MapRenderer_RenderNormal(float delta);
 /* Renders the meshes of translucent blocks in visible chunks. */
@@ -75,6 +86,10 @@ void MapRenderer_Update(float delta);
 void MapRenderer_RefreshChunk(int cx, int cy, int cz);
 /* Called when a block is changed, to update internal state. */
 void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block);
+/* Called after a batch of blocks has been changed, to update internal state. */
+/* NOTE: Each chunk is only marked as needing to be rebuilt once, */
+/*  no matter how many blocks were changed in it */
+void MapRenderer_OnBlocksChanged(const struct BlockChange* changes, int count);
 /* Deletes all chunks and resets internal state. */
 void MapRenderer_Refresh(void);
 
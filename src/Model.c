@@ -23,6 +23,200 @@ struct _ModelsData Models;
 #define AABB_Width(bb)  ((bb)->Max.x - (bb)->Min.x)
 #define AABB_Height(bb) ((bb)->Max.y - (bb)->Min.y)
 #define AABB_Length(bb) ((bb)->Max.z - (bb)->Min.z)
+/* Whether the entity being drawn is far enough away to be drawn with a simplified model */
+static cc_bool model_lowDetail;
+
+
+/*########################################################################################################################*
+*--------------------------------------------------------Model batching---------------------------------------------------*
+*#########################################################################################################################*/
+/* With many entities in view, setting up state and uploading vertices for each entity is slow. */
+/* So between Model_BeginBatch and Model_EndBatch, models flagged with MODEL_FLAG_BATCHED are instead */
+/*  queued up, then drawn sorted by model and skin, with the vertices of entities that use the */
+/*  same skin being transformed into world space and then drawn together. */
+/* NOTE: Batched models must only draw using Model_DrawVertices, and not change any other graphics state */
+/* NOTE: Consoles use a separate dynamic VB for each entity, so batching is not used there */
+#if !defined CC_BUILD_CONSOLE && !defined CC_BUILD_LOWMEM
+#define MODEL_BATCH_MAX_VERTICES 4096
+struct ModelBatchEntry { struct Entity* e; struct Model* model; GfxResourceID tex; };
+
+static struct ModelBatchEntry batch_entries[ENTITIES_MAX_COUNT];
+static int batch_count;
+static cc_bool batch_queueing, batch_drawing;
+static float batch_lodDist;
+
+/* Vertices of the entity currently being drawn */
+static struct VertexTextured batch_entity[MODELS_MAX_VERTICES];
+static struct Matrix batch_transform;
+/* Transformed vertices drawn without alpha testing (0), or with alpha testing (1) */
+static struct VertexTextured batch_vertices[2][MODEL_BATCH_MAX_VERTICES];
+static int batch_verticesCount[2];
+static GfxResourceID batch_vb, batch_tex;
+static struct VertexTextured* batch_realVertices;
+
+static GfxResourceID ModelBatch_GetTexture(struct Model* model, struct Entity* e) {
+	GfxResourceID tex = model->usesHumanSkin ? e->TextureId : e->MobTextureId;
+	return tex ? tex : model->defaultTex->texID;
+}
+
+static cc_bool ModelBatch_Add(struct Model* model, struct Entity* e) {
+	struct ModelBatchEntry* entry;
+	if (!batch_queueing || !(model->flags & MODEL_FLAG_BATCHED)) return false;
+	if (batch_count == ENTITIES_MAX_COUNT) return false;
+
+	entry = &batch_entries[batch_count++];
+	entry->e     = e;
+	entry->model = model;
+	entry->tex   = ModelBatch_GetTexture(model, e);
+	return true;
+}
+
+static void ModelBatch_Flush(void) {
+	int opaque = batch_verticesCount[0], alpha = batch_verticesCount[1];
+	struct VertexTextured* data;
+	if (!opaque && !alpha) return;
+
+	if (!batch_vb) {
+		batch_vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, MODEL_BATCH_MAX_VERTICES * 2);
+	}
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_BindTexture(batch_tex);
+
+	data = (struct VertexTextured*)Gfx_LockDynamicVb(batch_vb, VERTEX_FORMAT_TEXTURED, opaque + alpha);
+	Mem_Copy(data,          batch_vertices[0], opaque * SIZEOF_VERTEX_TEXTURED);
+	Mem_Copy(data + opaque, batch_vertices[1], alpha  * SIZEOF_VERTEX_TEXTURED);
+	Gfx_UnlockDynamicVb(batch_vb);
+
+	if (opaque) {
+		Gfx_SetAlphaTest(false);
+		Gfx_DrawVb_IndexedTris_Range(opaque, 0);
+		Gfx_SetAlphaTest(true);
+	}
+	if (alpha) Gfx_DrawVb_IndexedTris_Range(alpha, opaque);
+
+	batch_verticesCount[0] = 0;
+	batch_verticesCount[1] = 0;
+}
+
+static void ModelBatch_BindTexture(GfxResourceID tex) {
+	if (!batch_drawing) { Gfx_BindTexture(tex); return; }
+	if (tex == batch_tex) return;
+
+	ModelBatch_Flush();
+	batch_tex = tex;
+}
+
+static cc_bool ModelBatch_Lock(void) {
+	if (!batch_drawing) return false;
+	batch_realVertices = Models.Vertices;
+	Models.Vertices    = batch_entity;
+	return true;
+}
+
+static cc_bool ModelBatch_Unlock(void) {
+	struct Matrix* m = &batch_transform;
+	struct VertexTextured* v;
+	float x, y, z;
+	int i;
+	if (!batch_drawing) return false;
+
+	/* Transform vertices into world space, so no per entity matrix needs to be loaded */
+	for (i = 0, v = batch_entity; i < Models.Active->index; i++, v++) 
+	{
+		x = v->x; y = v->y; z = v->z;
+		v->x = x * m->row1.x + y * m->row2.x + z * m->row3.x + m->row4.x;
+		v->y = x * m->row1.y + y * m->row2.y + z * m->row3.y + m->row4.y;
+		v->z = x * m->row1.z + y * m->row2.z + z * m->row3.z + m->row4.z;
+	}
+	Models.Vertices = batch_realVertices;
+	return true;
+}
+
+static cc_bool ModelBatch_Draw(int count, int offset, cc_bool alphaTest) {
+	int* dstCount = &batch_verticesCount[alphaTest ? 1 : 0];
+	if (!batch_drawing) return false;
+
+	if (*dstCount + count > MODEL_BATCH_MAX_VERTICES) ModelBatch_Flush();
+	Mem_Copy(&batch_vertices[alphaTest ? 1 : 0][*dstCount], &batch_entity[offset], count * SIZEOF_VERTEX_TEXTURED);
+	*dstCount += count;
+	return true;
+}
+
+/* Orders entries by model, then by skin texture */
+static int ModelBatch_Compare(const struct ModelBatchEntry* a, const struct ModelBatchEntry* b) {
+	if (a->model != b->model) return (cc_uintptr)a->model < (cc_uintptr)b->model ? -1 : 1;
+	if (a->tex   != b->tex)   return (cc_uintptr)a->tex   < (cc_uintptr)b->tex   ? -1 : 1;
+	return 0;
+}
+
+static void ModelBatch_QuickSort(int left, int right) {
+	struct ModelBatchEntry* keys = batch_entries; struct ModelBatchEntry key;
+
+	while (left < right) {
+		int i = left, j = right;
+		struct ModelBatchEntry pivot = keys[(i + j) >> 1];
+
+		/* partition the list */
+		while (i <= j) {
+			while (ModelBatch_Compare(&pivot, &keys[i]) > 0) i++;
+			while (ModelBatch_Compare(&pivot, &keys[j]) < 0) j--;
+			QuickSort_Swap_Maybe();
+		}
+		/* recurse into the smaller subset */
+		QuickSort_Recurse(ModelBatch_QuickSort)
+	}
+}
+
+void Model_BeginBatch(void) {
+	batch_queueing = true;
+	batch_count    = 0;
+}
+
+void Model_EndBatch(void) {
+	struct ModelBatchEntry* entry;
+	int i;
+	batch_queueing = false;
+	if (!batch_count) return;
+
+	ModelBatch_QuickSort(0, batch_count - 1);
+	batch_drawing = true;
+	batch_tex     = 0;
+
+	for (i = 0; i < batch_count; i++) 
+	{
+		entry = &batch_entries[i];
+		Model_SetupState(entry->model, entry->e);
+		Model_GetEntityTransform(entry->model, entry->e, &batch_transform);
+
+		model_lowDetail = batch_lodDist && Model_RenderDistance(entry->e) > batch_lodDist;
+		entry->model->Draw(entry->e);
+	}
+
+	ModelBatch_Flush();
+	batch_drawing   = false;
+	model_lowDetail = false;
+}
+
+static void ModelBatch_Init(void) {
+	int dist = Options_GetInt(OPT_MODEL_LOD_DISTANCE, 0, 4096, 0);
+	batch_lodDist = (float)dist * dist;
+}
+
+static void ModelBatch_ContextLost(void) {
+	Gfx_DeleteDynamicVb(&batch_vb);
+}
+#else
+static cc_bool ModelBatch_Add(struct Model* model, struct Entity* e) { return false; }
+static void ModelBatch_BindTexture(GfxResourceID tex) { Gfx_BindTexture(tex); }
+static cc_bool ModelBatch_Lock(void)   { return false; }
+static cc_bool ModelBatch_Unlock(void) { return false; }
+static cc_bool ModelBatch_Draw(int count, int offset, cc_bool alphaTest) { return false; }
+
+void Model_BeginBatch(void) { }
+void Model_EndBatch(void)   { }
+static void ModelBatch_Init(void) { }
+static void ModelBatch_ContextLost(void) { }
+#endif
 
 
 /*########################################################################################################################*
@@ -106,6 +300,8 @@ void Model_GetEntityTransform(struct Model* model, struct Entity* e, struct Matr
 
 void Model_Render(struct Model* model, struct Entity* e) {
 	struct Matrix m, transform;
+	if (ModelBatch_Add(model, e)) return;
+
 	Model_SetupState(model, e);
 	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
 
@@ -164,7 +360,7 @@ void Model_ApplyTexture(struct Entity* e) {
 		Models.skinType = data->skinType;
 	}
 
-	Gfx_BindTexture(tex);
+	ModelBatch_BindTexture(tex);
 	_64x64 = Models.skinType != SKIN_64x32;
 
 	Models.uScale = e->uScale * 0.015625f;
@@ -187,6 +383,7 @@ static struct VertexTextured* real_vertices;
 static GfxResourceID modelVB;
 
 void Model_LockVB(struct Entity* entity, int verticesCount) {
+	if (ModelBatch_Lock()) return;
 #ifdef CC_BUILD_CONSOLE
 	if (!entity->ModelVB) {
 		entity->ModelVB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, Models.Active->maxVertices);
@@ -204,10 +401,19 @@ void Model_LockVB(struct Entity* entity, int verticesCount) {
 }
 
 void Model_UnlockVB(void) {
+	if (ModelBatch_Unlock()) return;
 	Gfx_UnlockDynamicVb(modelVB);
 	Models.Vertices = real_vertices;
 }
 
+void Model_DrawVertices(int count, int offset, cc_bool alphaTest) {
+	if (ModelBatch_Draw(count, offset, alphaTest)) return;
+
+	if (!alphaTest) Gfx_SetAlphaTest(false);
+	Gfx_DrawVb_IndexedTris_Range(count, offset);
+	if (!alphaTest) Gfx_SetAlphaTest(true);
+}
+
 
 void Model_DrawPart(struct ModelPart* part) {
 	struct Model* model        = Models.Active;
@@ -819,7 +1025,7 @@ static void CustomModel_Draw(struct Entity* e) {
 	}
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(cm->numParts * MODEL_BOX_VERTICES);
+	Model_DrawVertices(cm->numParts * MODEL_BOX_VERTICES, 0, true);
 	Models.Rotation = ROTATE_ORDER_ZYX;
 }
 
@@ -885,6 +1091,7 @@ void CustomModel_Register(struct CustomModel* cm) {
 	cm->model.GetCollisionSize = CustomModel_GetCollisionSize;
 	cm->model.GetPickingBounds = CustomModel_GetPickingBounds;
 	cm->model.DrawArm          = CustomModel_DrawArm;
+	cm->model.flags           |= MODEL_FLAG_BATCHED;
 
 	/* add to front of models linked list to override original models */
 	if (!models_head) {
@@ -936,11 +1143,30 @@ struct ModelSet {
 #define HUMAN_HAT64_VERTICES (6 * MODEL_BOX_VERTICES)
 #define HUMAN_MAX_VERTICES   HUMAN_BASE_VERTICES + HUMAN_HAT64_VERTICES
 
+/* Draws the humanoid as just its base boxes, without skin layers or head/arm animation */
+/* NOTE: Legs are still rotated, as some models (e.g. sit) pose them to not go through the floor */
+static void HumanModel_DrawLowDetail(struct Entity* e, struct ModelSet* model, cc_bool opaqueBody) {
+	struct ModelLimbs* set = &model->limbs[Models.skinType & 0x3];
+	Model_LockVB(e, HUMAN_BASE_VERTICES);
+
+	Model_DrawPart(&model->head);
+	Model_DrawPart(&model->torso);
+	Model_DrawRotate(e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLeg,  false);
+	Model_DrawRotate(e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLeg, false);
+	Model_DrawPart(&set->leftArm);
+	Model_DrawPart(&set->rightArm);
+
+	Model_UnlockVB();
+	Model_DrawVertices(HUMAN_BASE_VERTICES, 0, !opaqueBody);
+}
+
 static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, cc_bool opaqueBody) {
 	struct ModelLimbs* set;
 	int type, num;
 	Model_ApplyTexture(e);
 
+	if (model_lowDetail) { HumanModel_DrawLowDetail(e, model, opaqueBody); return; }
+
 	type = Models.skinType;
 	set  = &model->limbs[type & 0x3];
 	num  = HUMAN_BASE_VERTICES + (type == SKIN_64x32 ? HUMAN_HAT32_VERTICES : HUMAN_HAT64_VERTICES);
@@ -971,12 +1197,10 @@ static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, cc_boo
 	Model_UnlockVB();
 	if (opaqueBody) {
 		/* human model draws the body opaque so players can't have invisible skins */
-		Gfx_SetAlphaTest(false);
-		Gfx_DrawVb_IndexedTris_Range(HUMAN_BASE_VERTICES, 0);
-		Gfx_SetAlphaTest(true);
-		Gfx_DrawVb_IndexedTris_Range(num - HUMAN_BASE_VERTICES, HUMAN_BASE_VERTICES);
+		Model_DrawVertices(HUMAN_BASE_VERTICES, 0, false);
+		Model_DrawVertices(num - HUMAN_BASE_VERTICES, HUMAN_BASE_VERTICES, true);
 	} else {
-		Gfx_DrawVb_IndexedTris(num);
+		Model_DrawVertices(num, 0, true);
 	}
 }
 
@@ -1170,7 +1394,7 @@ static void HumanoidModel_Register(void) {
 
 	human_model.calcHumanAnims = true;
 	human_model.usesHumanSkin  = true;
-	human_model.flags |= MODEL_FLAG_CLEAR_HAT;
+	human_model.flags |= MODEL_FLAG_CLEAR_HAT | MODEL_FLAG_BATCHED;
 	human_model.maxVertices    = HUMAN_MAX_VERTICES;
 
 	Model_Register(&human_model);
@@ -1265,7 +1489,7 @@ static void ChibiModel_Register(void) {
 
 	chibi_model.calcHumanAnims = true;
 	chibi_model.usesHumanSkin  = true;
-	chibi_model.flags |= MODEL_FLAG_CLEAR_HAT;
+	chibi_model.flags |= MODEL_FLAG_CLEAR_HAT | MODEL_FLAG_BATCHED;
 	chibi_model.maxVertices    = HUMAN_MAX_VERTICES;
 
 	chibi_model.maxScale    = 3.0f;
@@ -1306,7 +1530,7 @@ static void SittingModel_Register(void) {
 
 	sitting_model.calcHumanAnims = true;
 	sitting_model.usesHumanSkin  = true;
-	sitting_model.flags |= MODEL_FLAG_CLEAR_HAT;
+	sitting_model.flags |= MODEL_FLAG_CLEAR_HAT | MODEL_FLAG_BATCHED;
 	sitting_model.maxVertices    = HUMAN_MAX_VERTICES;
 
 	sitting_model.shadowScale  = 0.5f;
@@ -1358,7 +1582,7 @@ static void HeadModel_Draw(struct Entity* e) {
 	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &part, true);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(HEAD_MAX_VERTICES);
+	Model_DrawVertices(HEAD_MAX_VERTICES, 0, true);
 }
 
 static float HeadModel_GetEyeY(struct Entity* e)  { return 6.0f/16.0f; }
@@ -1374,7 +1598,7 @@ static struct Model head_model = { "head", human_vertices, &human_tex,
 static void HeadModel_Register(void) {
 	Model_Init(&head_model);
 	head_model.usesHumanSkin = true;
-	head_model.flags |= MODEL_FLAG_CLEAR_HAT;
+	head_model.flags |= MODEL_FLAG_CLEAR_HAT | MODEL_FLAG_BATCHED;
 
 	head_model.pushes        = false;
 	head_model.GetTransform  = HeadModel_GetTransform;
@@ -1472,7 +1696,7 @@ static void ChickenModel_Draw(struct Entity* e) {
 	Model_DrawRotate(e->Anim.RightLegX, 0, 0, &chicken_rightLeg, false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(CHICKEN_MAX_VERTICES);
+	Model_DrawVertices(CHICKEN_MAX_VERTICES, 0, true);
 }
 
 static float ChickenModel_GetNameY(struct Entity* e) { return 1.0125f; }
@@ -1491,6 +1715,7 @@ static struct Model chicken_model = { "chicken", chicken_vertices, &chicken_tex,
 static void ChickenModel_Register(void) {
 	Model_Init(&chicken_model);
 	chicken_model.maxVertices = CHICKEN_MAX_VERTICES;
+	chicken_model.flags |= MODEL_FLAG_BATCHED;
 	Model_Register(&chicken_model);
 }
 
@@ -1554,7 +1779,7 @@ static void CreeperModel_Draw(struct Entity* e) {
 	Model_DrawRotate(e->Anim.LeftLegX,  0, 0, &creeper_rightLegBack,  false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(CREEPER_MAX_VERTICES);
+	Model_DrawVertices(CREEPER_MAX_VERTICES, 0, true);
 }
 
 static float CreeperModel_GetNameY(struct Entity* e) { return 1.7f; }
@@ -1574,6 +1799,7 @@ static struct Model creeper_model  = {
 static void CreeperModel_Register(void) {
 	Model_Init(&creeper_model);
 	creeper_model.maxVertices = CREEPER_MAX_VERTICES;
+	creeper_model.flags |= MODEL_FLAG_BATCHED;
 	Model_Register(&creeper_model);
 }
 
@@ -1637,7 +1863,7 @@ static void PigModel_Draw(struct Entity* e) {
 	Model_DrawRotate(e->Anim.LeftLegX,  0, 0, &pig_rightLegBack,  false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(PIG_MAX_VERTICES);
+	Model_DrawVertices(PIG_MAX_VERTICES, 0, true);
 }
 
 static float PigModel_GetNameY(struct Entity* e) { return 1.075f; }
@@ -1656,6 +1882,7 @@ static struct Model pig_model  = { "pig", pig_vertices, &pig_tex,
 static void PigModel_Register(void) {
 	Model_Init(&pig_model);
 	pig_model.maxVertices = PIG_MAX_VERTICES;
+	pig_model.flags |= MODEL_FLAG_BATCHED;
 	Model_Register(&pig_model);
 }
 
@@ -1882,7 +2109,7 @@ static void SkeletonModel_Draw(struct Entity* e) {
 	Model_DrawRotate(90.0f * MATH_DEG2RAD,   0, e->Anim.RightArmZ, &skeleton_rightArm, false);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(SKELETON_MAX_VERTICES);
+	Model_DrawVertices(SKELETON_MAX_VERTICES, 0, true);
 }
 
 static void SkeletonModel_DrawArm(struct Entity* e) {
@@ -1911,6 +2138,7 @@ static void SkeletonModel_Register(void) {
 	skeleton_model.DrawArm     = SkeletonModel_DrawArm;
 	skeleton_model.armX        = 5;
 	skeleton_model.maxVertices = SKELETON_MAX_VERTICES;
+	skeleton_model.flags |= MODEL_FLAG_BATCHED;
 	Model_Register(&skeleton_model);
 }
 
@@ -1986,7 +2214,7 @@ static void SpiderModel_Draw(struct Entity* e) {
 	Models.Rotation = ROTATE_ORDER_ZYX;
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(SPIDER_MAX_VERTICES);
+	Model_DrawVertices(SPIDER_MAX_VERTICES, 0, true);
 }
 
 static float SpiderModel_GetNameY(struct Entity* e) { return 1.0125f; }
@@ -2005,6 +2233,7 @@ static struct Model spider_model  = { "spider", spider_vertices, &spider_tex,
 static void SpiderModel_Register(void) {
 	Model_Init(&spider_model);
 	spider_model.maxVertices = SPIDER_MAX_VERTICES;
+	spider_model.flags |= MODEL_FLAG_BATCHED;
 	Model_Register(&spider_model);
 }
 
@@ -2034,6 +2263,7 @@ static void ZombieModel_Register(void) {
 	Model_Init(&zombie_model);
 	zombie_model.DrawArm     = ZombieModel_DrawArm;
 	zombie_model.maxVertices = HUMAN_MAX_VERTICES;
+	zombie_model.flags |= MODEL_FLAG_BATCHED;
 	Model_Register(&zombie_model);
 }
 
@@ -2279,7 +2509,7 @@ static void SkinnedCubeModel_Draw(struct Entity* e) {
 	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &skinnedCube_head, true);
 
 	Model_UnlockVB();
-	Gfx_DrawVb_IndexedTris(SKINNEDCUBE_MAX_VERTICES);
+	Model_DrawVertices(SKINNEDCUBE_MAX_VERTICES, 0, true);
 }
 
 static float SkinnedCubeModel_GetNameY(struct Entity* e) { return 1.075f; }
@@ -2300,6 +2530,7 @@ static void SkinnedCubeModel_Register(void) {
 	skinnedCube_model.usesHumanSkin = true;
 	skinnedCube_model.pushes        = false;
 	skinnedCube_model.maxVertices   = SKINNEDCUBE_MAX_VERTICES;
+	skinnedCube_model.flags |= MODEL_FLAG_BATCHED;
 	Model_Register(&skinnedCube_model);
 }
 
@@ -2372,6 +2603,8 @@ static void HoldModel_Register(void) {
 	hold_model.MakeParts = Model_NoParts;
 	hold_model.Draw      = HoldModel_Draw;
 	hold_model.GetEyeY   = HoldModel_GetEyeY;
+	/* Draws a block model too, so can't be batched */
+	hold_model.flags    &= ~MODEL_FLAG_BATCHED;
 	Model_Register(&hold_model);
 }
 
@@ -2420,6 +2653,7 @@ static void RegisterDefaultModels(void) {
 static void OnContextLost(void* obj) {
 	struct ModelTex* tex;
 	Gfx_DeleteDynamicVb(&Models.Vb);
+	ModelBatch_ContextLost();
 	if (Gfx.ManagedTextures) return;
 
 	for (tex = textures_head; tex; tex = tex->next) 
@@ -2432,6 +2666,7 @@ static void OnInit(void) {
 	Models.MaxVertices = MODELS_MAX_VERTICES;
 	RegisterDefaultModels();
 	Models.ClassicArms = Options_GetBool(OPT_CLASSIC_ARM_MODEL, Game_ClassicMode);
+	ModelBatch_Init();
 
 	Event_Register_(&TextureEvents.FileChanged, NULL, Models_TextureChanged);
 	Event_Register_(&GfxEvents.ContextLost,     NULL, OnContextLost);
@@ -41,6 +41,7 @@ struct ModelTex { const char* name; cc_uint8 skinType; GfxResourceID texID; stru
 
 #define MODEL_FLAG_INITED    0x01
 #define MODEL_FLAG_CLEAR_HAT 0x02
+#define MODEL_FLAG_BATCHED   0x04 /* Model can be drawn in batches (see Model_BeginBatch) */
 
 struct Model;
 /* Contains a set of quads and/or boxes that describe a 3D object as well as
@@ -141,6 +142,15 @@ CC_API void Model_ApplyTexture(struct Entity* entity);
 CC_API void Model_UpdateVB(void);
 void Model_LockVB(struct Entity* entity, int verticesCount);
 void Model_UnlockVB(void);
+/* Draws the given range of the vertices written between Model_LockVB and Model_UnlockVB. */
+/* If alphaTest is false, the vertices are drawn with alpha testing disabled. */
+CC_API void Model_DrawVertices(int count, int offset, cc_bool alphaTest);
+
+/* Starts queueing up entities rendered using models that have MODEL_FLAG_BATCHED, */
+/*  so that entities with the same model and skin can be drawn together */
+void Model_BeginBatch(void);
+/* Draws all of the entities queued up since Model_BeginBatch */
+void Model_EndBatch(void);
 
 /* Draws the given part with no part-specific rotation (e.g. torso). */
 CC_API void Model_DrawPart(struct ModelPart* part);
@@ -28,6 +28,7 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_LIGHTING_MODE "gfx-lightingmode"
 #define OPT_MIPMAPS "gfx-mipmaps"
 #define OPT_CHAT_LOGGING "chat-logging"
+#define OPT_CHAT_LOG_MAX_SIZE "chat-logmaxsize"
 #define OPT_WINDOW_WIDTH "window-width"
 #define OPT_WINDOW_HEIGHT "window-height"
 
@@ -71,6 +72,13 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_CLASSIC_CHAT "nostalgia-classicchat"
 #define OPT_CLASSIC_INVENTORY "nostalgia-classicinventory"
 #define OPT_MAX_CHUNK_UPDATES "gfx-maxchunkupdates"
+#define OPT_BUILDER_THREADS "gfx-builderthreads"
+#define OPT_SOFTGPU_THREADS "gfx-softgputhreads"
+#define OPT_OCCLUSION_CULLING "gfx-occlusionculling"
+#define OPT_GREEDY_MESHING "gfx-greedymeshing"
+#define OPT_MODEL_LOD_DISTANCE "gfx-modellod"
+#define OPT_MAX_PARTICLES "gfx-maxparticles"
+#define OPT_GEN_THREADS "gen-threads"
 #define OPT_CAMERA_MASS "cameramass"
 #define OPT_CAMERA_SMOOTH "camera-smooth"
 #define OPT_GRAB_CURSOR "win-grab-cursor"
@@ -80,6 +88,9 @@ Copyright 2014-2023 ClassiCube | Licensed under BSD-3
 #define OPT_HTTP_ONLY "http-no-https"
 #define OPT_HTTPS_VERIFY "https-verify"
 #define OPT_SKIN_SERVER "http-skinserver"
+#define OPT_SKIN_ASYNC_DECODE "http-skindecode"
+#define OPT_HTTP_WORKERS "http-workers"
+#define OPT_HTTP_CACHE_SIZE "http-cachesize"
 #define OPT_RAW_INPUT "win-raw-input"
 #define OPT_DPI_SCALING "win-dpi-scaling"
 #define OPT_GAME_VERSION "game-version"
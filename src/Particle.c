@@ -9,12 +9,16 @@
 #include "Funcs.h"
 #include "Game.h"
 #include "Event.h"
+#include "Options.h"
+#include "Platform.h"
 
 #ifdef CC_BUILD_TINYMEM
-	#define PARTICLES_MAX 10
+	#define PARTICLES_DEF_MAX 30
 #else
-	#define PARTICLES_MAX 600
+	#define PARTICLES_DEF_MAX 1800
 #endif
+/* Each particle is drawn as a quad, so the vertices of all particles must fit in one dynamic VB */
+#define PARTICLES_MAX_LIMIT (GFX_MAX_VERTICES / 4)
 
 
 /*########################################################################################################################*
@@ -23,7 +27,6 @@
 static GfxResourceID particles_TexId, particles_VB;
 static RNGState rnd;
 static cc_bool hitTerrain;
-typedef cc_bool (*CanPassThroughFunc)(BlockID b);
 
 void Particle_DoRender(const Vec2* size, const Vec3* pos, const TextureRec* rec, PackedCol col, struct VertexTextured* v) {
 	struct Matrix* view;
@@ -44,7 +47,7 @@ void Particle_DoRender(const Vec2* size, const Vec3* pos, const TextureRec* rec,
 	v->x = centre.x + aX - bX; v->y = centre.y + aY - bY; v->z = centre.z + aZ - bZ; v->Col = col; v->U = rec->u2; v->V = rec->v2; v++;
 }
 
-static cc_bool CollidesHor(Vec3* nextPos, BlockID block) {
+static cc_bool CollidesHor(const Vec3* nextPos, BlockID block) {
 	Vec3 horPos = Vec3_Create3((float)Math_Floor(nextPos->x), 0.0f, (float)Math_Floor(nextPos->z));
 	Vec3 min, max;
 	Vec3_Add(&min, &Blocks.MinBB[block], &horPos);
@@ -52,167 +55,267 @@ static cc_bool CollidesHor(Vec3* nextPos, BlockID block) {
 	return nextPos->x >= min.x && nextPos->z >= min.z && nextPos->x < max.x && nextPos->z < max.z;
 }
 
-static BlockID GetBlock(int x, int y, int z) {
-	if (World_Contains(x, y, z)) return World_GetBlock(x, y, z);
+/*########################################################################################################################*
+*------------------------------------------------------Particles pool-----------------------------------------------------*
+*#########################################################################################################################*/
+enum ParticleKind { PARTICLE_RAIN, PARTICLE_TERRAIN, PARTICLE_CUSTOM };
+#define EXPIRES_UPON_TOUCHING_GROUND (1 << 0)
+#define SOLID_COLLIDES  (1 << 1)
+#define LIQUID_COLLIDES (1 << 2)
+#define LEAF_COLLIDES   (1 << 3)
+
+/* All particles are stored in one pool, with each field in its own array. */
+/* This way ticking and rendering only touches the fields that they use, */
+/*  and removing a particle just moves the last particle into its slot. */
+static Vec3* particles_velocity;
+static Vec3* particles_lastPos;
+static Vec3* particles_nextPos;
+static float* particles_lifetime;
+static float* particles_size;
+static TextureRec* particles_rec;   /* Terrain only */
+static float* particles_lifespan;   /* Custom only */
+static BlockID* particles_block;    /* Terrain only */
+static TextureLoc* particles_texLoc; /* Terrain only */
+static cc_uint8* particles_kind;
+static cc_uint8* particles_effect;  /* Custom only */
+
+static int particles_count, particles_capacity, particles_evict;
+#define PARTICLE_SIZE (3 * sizeof(Vec3) + 3 * sizeof(float) + sizeof(TextureRec) + sizeof(BlockID) + sizeof(TextureLoc) + 2)
+
+static void Particles_AllocPool(int capacity) {
+	cc_uint8* mem = (cc_uint8*)Mem_Alloc(capacity, PARTICLE_SIZE, "particles pool");
+	particles_capacity = capacity;
+
+	particles_velocity = (Vec3*)mem;       mem += capacity * sizeof(Vec3);
+	particles_lastPos  = (Vec3*)mem;       mem += capacity * sizeof(Vec3);
+	particles_nextPos  = (Vec3*)mem;       mem += capacity * sizeof(Vec3);
+	particles_lifetime = (float*)mem;      mem += capacity * sizeof(float);
+	particles_size     = (float*)mem;      mem += capacity * sizeof(float);
+	particles_rec      = (TextureRec*)mem; mem += capacity * sizeof(TextureRec);
+	particles_lifespan = (float*)mem;      mem += capacity * sizeof(float);
+	particles_block    = (BlockID*)mem;    mem += capacity * sizeof(BlockID);
+	particles_texLoc   = (TextureLoc*)mem; mem += capacity * sizeof(TextureLoc);
+	particles_kind     = mem;              mem += capacity;
+	particles_effect   = mem;
+}
+
+/* Returns the index of a slot for a new particle */
+/* If the pool is full, an existing particle is replaced instead */
+static int Particles_Add(int kind) {
+	int i;
+	if (particles_count < particles_capacity) {
+		i = particles_count++;
+	} else {
+		/* Particles are swapped around when removed, so the oldest particle is not known */
+		/*  exactly. Cycling through the slots still replaces older particles before newer ones */
+		i = particles_evict++;
+		if (particles_evict >= particles_count) particles_evict = 0;
+	}
+
+	particles_kind[i] = kind;
+	return i;
+}
+
+static void Particles_RemoveAt(int i) {
+	int last = --particles_count;
+	if (i == last) return;
+
+	particles_velocity[i] = particles_velocity[last];
+	particles_lastPos[i]  = particles_lastPos[last];
+	particles_nextPos[i]  = particles_nextPos[last];
+	particles_lifetime[i] = particles_lifetime[last];
+	particles_size[i]     = particles_size[last];
+	particles_rec[i]      = particles_rec[last];
+	particles_lifespan[i] = particles_lifespan[last];
+	particles_block[i]    = particles_block[last];
+	particles_texLoc[i]   = particles_texLoc[last];
+	particles_kind[i]     = particles_kind[last];
+	particles_effect[i]   = particles_effect[last];
+}
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Particle physics-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Bit 0 is set if rain collides with the block, bit 1 if terrain particles collide with the block, */
+/*  and bits 2 to 9 if custom particles collide with the block (one bit per combination of collide flags) */
+static cc_uint16 particles_collideMask[BLOCK_COUNT];
+#define RAIN_COLLIDE_MASK    (1 << 0)
+#define TERRAIN_COLLIDE_MASK (1 << 1)
+#define Custom_CollideMask(collideFlags) (1 << (2 + (((collideFlags) >> 1) & 0x07)))
+
+static cc_uint16 Particles_CalcCollideMask(BlockID block) {
+	cc_uint8 draw = Blocks.Draw[block], collide = Blocks.Collide[block];
+	cc_uint16 custom = 0, mask = 0;
+
+	if (draw != DRAW_GAS && draw != DRAW_SPRITE) {
+		mask |= RAIN_COLLIDE_MASK;
+		if (!Blocks.IsLiquid[block]) mask |= TERRAIN_COLLIDE_MASK;
+	}
+
+	/* Combination of collide flags bits: 0 = SOLID_COLLIDES, 1 = LIQUID_COLLIDES, 2 = LEAF_COLLIDES */
+	if (collide == COLLIDE_SOLID)  custom = 0xAA;
+	if (collide == COLLIDE_LIQUID) custom = 0xCC;
+	if (draw == DRAW_TRANSPARENT_THICK) custom &= 0xF0;
+	return mask | (custom << 2);
+}
+
+static void Particles_UpdateCollideMasks(void) {
+	int i;
+	for (i = 0; i < BLOCK_COUNT; i++) 
+	{
+		particles_collideMask[i] = Particles_CalcCollideMask((BlockID)i);
+	}
+}
+
+/* Particles usually stay within the same column of blocks between ticks, and particles */
+/*  spawned together are next to each other in the pool, so the column is reused across lookups */
+static int column_x, column_z, column_index;
+static cc_bool column_valid, column_inside;
+
+static void Particles_SetColumn(int x, int z) {
+	if (column_valid && x == column_x && z == column_z) return;
+	column_x = x; column_z = z; column_valid = true;
+
+	column_inside = World_ContainsXZ(x, z);
+	column_index  = column_inside ? World_Pack(x, 0, z) : 0;
+}
+
+static BlockID Particles_GetColumnBlock(int y) {
+	if (column_inside && (unsigned)y < (unsigned)World.Height) {
+		return (BlockID)World_GetRawBlock(column_index + y * World.OneY);
+	}
 
 	if (y >= Env.EdgeHeight)  return BLOCK_AIR;
 	if (y >= Env_SidesHeight) return Env.EdgeBlock;
 	return Env.SidesBlock;
 }
 
-static cc_bool ClipY(struct Particle* p, int y, cc_bool topFace, CanPassThroughFunc canPassThrough) {
+static cc_bool ClipY(int i, int y, cc_bool topFace, int mask) {
+	Vec3* nextPos = &particles_nextPos[i];
 	BlockID block;
 	Vec3 minBB, maxBB;
 	float collideY;
 	cc_bool collideVer;
 
 	if (y < 0) {
-		p->nextPos.y = ENTITY_ADJUSTMENT; 
-		p->lastPos.y = ENTITY_ADJUSTMENT;
+		nextPos->y = ENTITY_ADJUSTMENT; 
+		particles_lastPos[i].y = ENTITY_ADJUSTMENT;
 
-		Vec3_Set(p->velocity, 0,0,0);
+		Vec3_Set(particles_velocity[i], 0,0,0);
 		hitTerrain = true;
 		return false;
 	}
 
-	block = GetBlock((int)p->nextPos.x, y, (int)p->nextPos.z);
-	if (canPassThrough(block)) return true;
+	block = Particles_GetColumnBlock(y);
+	if (!(particles_collideMask[block] & mask)) return true;
 	minBB = Blocks.MinBB[block]; maxBB = Blocks.MaxBB[block];
 
 	collideY   = y + (topFace ? maxBB.y : minBB.y);
-	collideVer = topFace ? (p->nextPos.y < collideY) : (p->nextPos.y > collideY);
+	collideVer = topFace ? (nextPos->y < collideY) : (nextPos->y > collideY);
 
-	if (collideVer && CollidesHor(&p->nextPos, block)) {
+	if (collideVer && CollidesHor(nextPos, block)) {
 		float adjust = topFace ? ENTITY_ADJUSTMENT : -ENTITY_ADJUSTMENT;
-		p->lastPos.y = collideY + adjust;
-		p->nextPos.y = p->lastPos.y;
+		particles_lastPos[i].y = collideY + adjust;
+		nextPos->y = particles_lastPos[i].y;
 
-		Vec3_Set(p->velocity, 0,0,0);
+		Vec3_Set(particles_velocity[i], 0,0,0);
 		hitTerrain = true;
 		return false;
 	}
 	return true;
 }
 
-static cc_bool IntersectsBlock(struct Particle* p, CanPassThroughFunc canPassThrough) {
-	BlockID cur = GetBlock((int)p->nextPos.x, (int)p->nextPos.y, (int)p->nextPos.z);
-	float minY  = Math_Floor(p->nextPos.y) + Blocks.MinBB[cur].y;
-	float maxY  = Math_Floor(p->nextPos.y) + Blocks.MaxBB[cur].y;
+static BlockID Particles_GetBlockAt(const Vec3* pos) {
+	Particles_SetColumn((int)pos->x, (int)pos->z);
+	return Particles_GetColumnBlock((int)pos->y);
+}
 
-	return !canPassThrough(cur) && p->nextPos.y >= minY && p->nextPos.y < maxY && CollidesHor(&p->nextPos, cur);
+/* Returns whether the given position lies within the bounds of the given block at that position */
+static cc_bool InsideBlock(const Vec3* pos, BlockID block) {
+	float minY = Math_Floor(pos->y) + Blocks.MinBB[block].y;
+	float maxY = Math_Floor(pos->y) + Blocks.MaxBB[block].y;
+
+	return pos->y >= minY && pos->y < maxY && CollidesHor(pos, block);
 }
 
-static cc_bool PhysicsTick(struct Particle* p, float gravity, CanPassThroughFunc canPassThrough, float delta) {
+static cc_bool PhysicsTick(int i, float gravity, int mask, float delta) {
+	Vec3* nextPos = &particles_nextPos[i];
+	Vec3* vel     = &particles_velocity[i];
 	Vec3 velocity;
+	BlockID block;
 	int y, begY, endY;
 
-	p->lastPos = p->nextPos;
-	if (IntersectsBlock(p, canPassThrough)) return true;
+	particles_lastPos[i] = *nextPos;
+	block = Particles_GetBlockAt(nextPos);
+	if ((particles_collideMask[block] & mask) && InsideBlock(nextPos, block)) return true;
 
-	p->velocity.y -= gravity * delta;
-	begY = Math_Floor(p->nextPos.y);
+	vel->y -= gravity * delta;
+	begY = Math_Floor(nextPos->y);
 	
-	Vec3_Mul1(&velocity, &p->velocity, delta * 3.0f);
-	Vec3_Add(&p->nextPos, &p->nextPos, &velocity);
-	endY = Math_Floor(p->nextPos.y);
+	Vec3_Mul1(&velocity, vel, delta * 3.0f);
+	Vec3_Add(nextPos, nextPos, &velocity);
+	endY = Math_Floor(nextPos->y);
+	Particles_SetColumn((int)nextPos->x, (int)nextPos->z);
 
-	if (p->velocity.y > 0.0f) {
+	if (vel->y > 0.0f) {
 		/* don't test block we are already in */
-		for (y = begY + 1; y <= endY && ClipY(p, y, false, canPassThrough); y++) {}
+		for (y = begY + 1; y <= endY && ClipY(i, y, false, mask); y++) {}
 	} else {
-		for (y = begY; y >= endY && ClipY(p, y, true, canPassThrough); y--) {}
+		for (y = begY; y >= endY && ClipY(i, y, true, mask); y--) {}
 	}
 
-	p->lifetime -= delta;
-	return p->lifetime < 0.0f;
+	particles_lifetime[i] -= delta;
+	return particles_lifetime[i] < 0.0f;
 }
 
 
 /*########################################################################################################################*
 *-------------------------------------------------------Rain particle-----------------------------------------------------*
 *#########################################################################################################################*/
-static struct Particle rain_Particles[PARTICLES_MAX];
-static int rain_count;
 static TextureRec rain_rec = { 2.0f/128.0f, 14.0f/128.0f, 5.0f/128.0f, 16.0f/128.0f };
 
-static cc_bool RainParticle_CanPass(BlockID block) {
-	cc_uint8 draw = Blocks.Draw[block];
-	return draw == DRAW_GAS || draw == DRAW_SPRITE;
-}
-
-static cc_bool RainParticle_Tick(struct Particle* p, float delta) {
+static cc_bool RainParticle_Tick(int i, float delta) {
 	hitTerrain = false;
-	return PhysicsTick(p, 3.5f, RainParticle_CanPass, delta) || hitTerrain;
+	return PhysicsTick(i, 3.5f, RAIN_COLLIDE_MASK, delta) || hitTerrain;
 }
 
-static void RainParticle_Render(struct Particle* p, float t, struct VertexTextured* vertices) {
+static void RainParticle_Render(int i, float t, struct VertexTextured* vertices) {
 	Vec3 pos;
 	Vec2 size;
 	PackedCol col;
 	int x, y, z;
 
-	Vec3_Lerp(&pos, &p->lastPos, &p->nextPos, t);
-	size.x = p->size * 0.015625f; size.y = size.x;
+	Vec3_Lerp(&pos, &particles_lastPos[i], &particles_nextPos[i], t);
+	size.x = particles_size[i] * 0.015625f; size.y = size.x;
 
 	x = Math_Floor(pos.x); y = Math_Floor(pos.y); z = Math_Floor(pos.z);
 	col = Lighting.Color(x, y, z);
 	Particle_DoRender(&size, &pos, &rain_rec, col, vertices);
 }
 
-static void Rain_Render(float t) {
-	struct VertexTextured* data;
-	int i;
-	if (!rain_count) return;
-	
-	data = (struct VertexTextured*)Gfx_LockDynamicVb(particles_VB, 
-										VERTEX_FORMAT_TEXTURED, rain_count * 4);
-	for (i = 0; i < rain_count; i++) {
-		RainParticle_Render(&rain_Particles[i], t, data);
-		data += 4;
-	}
-
-	Gfx_BindTexture(particles_TexId);
-	Gfx_UnlockDynamicVb(particles_VB);
-	Gfx_DrawVb_IndexedTris(rain_count * 4);
-}
-
-static void Rain_RemoveAt(int i) {
-	for (; i < rain_count - 1; i++) {
-		rain_Particles[i] = rain_Particles[i + 1];
-	}
-	rain_count--;
-}
-
-static void Rain_Tick(float delta) {
-	int i;
-	for (i = 0; i < rain_count; i++) {
-		if (RainParticle_Tick(&rain_Particles[i], delta)) {
-			Rain_RemoveAt(i); i--;
-		}
-	}
-}
-
 void Particles_RainSnowEffect(float x, float y, float z) {
-	struct Particle* p;
-	int i, type;
+	Vec3* pos;
+	int i, j, type;
+	if (!particles_capacity) return;
 
-	for (i = 0; i < 2; i++) {
-		if (rain_count == PARTICLES_MAX) Rain_RemoveAt(0);
-		p = &rain_Particles[rain_count++];
+	for (j = 0; j < 2; j++) {
+		i = Particles_Add(PARTICLE_RAIN);
 
-		p->velocity.x = Random_Float(&rnd) * 0.8f - 0.4f; /* [-0.4, 0.4] */
-		p->velocity.z = Random_Float(&rnd) * 0.8f - 0.4f;
-		p->velocity.y = Random_Float(&rnd) + 0.4f;
+		particles_velocity[i].x = Random_Float(&rnd) * 0.8f - 0.4f; /* [-0.4, 0.4] */
+		particles_velocity[i].z = Random_Float(&rnd) * 0.8f - 0.4f;
+		particles_velocity[i].y = Random_Float(&rnd) + 0.4f;
 
-		p->lastPos.x = x + Random_Float(&rnd); /* [0.0, 1.0] */
-		p->lastPos.y = y + Random_Float(&rnd) * 0.1f + 0.01f;
-		p->lastPos.z = z + Random_Float(&rnd);
+		pos    = &particles_lastPos[i];
+		pos->x = x + Random_Float(&rnd); /* [0.0, 1.0] */
+		pos->y = y + Random_Float(&rnd) * 0.1f + 0.01f;
+		pos->z = z + Random_Float(&rnd);
 
-		p->nextPos  = p->lastPos;
-		p->lifetime = 40.0f;
+		particles_nextPos[i]  = *pos;
+		particles_lifetime[i] = 40.0f;
 
 		type = Random_Next(&rnd, 30);
-		p->size = type >= 28 ? 2 : (type >= 25 ? 4 : 3);
+		particles_size[i] = type >= 28 ? 2 : (type >= 25 ? 4 : 3);
 	}
 }
 
@@ -220,112 +323,30 @@ void Particles_RainSnowEffect(float x, float y, float z) {
 /*########################################################################################################################*
 *------------------------------------------------------Terrain particle---------------------------------------------------*
 *#########################################################################################################################*/
-struct TerrainParticle {
-	struct Particle base;
-	TextureRec rec;
-	TextureLoc texLoc;
-	BlockID block;
-};
-
-static struct TerrainParticle terrain_particles[PARTICLES_MAX];
-static int terrain_count;
-static cc_uint16 terrain_1DCount[ATLAS1D_MAX_ATLASES];
-static cc_uint16 terrain_1DIndices[ATLAS1D_MAX_ATLASES];
-
-static cc_bool TerrainParticle_CanPass(BlockID block) {
-	cc_uint8 draw = Blocks.Draw[block];
-	return draw == DRAW_GAS || draw == DRAW_SPRITE || Blocks.IsLiquid[block];
-}
-
-static cc_bool TerrainParticle_Tick(struct TerrainParticle* p, float delta) {
-	return PhysicsTick(&p->base, Blocks.ParticleGravity[p->block], TerrainParticle_CanPass, delta);
+static cc_bool TerrainParticle_Tick(int i, float delta) {
+	return PhysicsTick(i, Blocks.ParticleGravity[particles_block[i]], TERRAIN_COLLIDE_MASK, delta);
 }
 
-static void TerrainParticle_Render(struct TerrainParticle* p, float t, struct VertexTextured* vertices) {
+static void TerrainParticle_Render(int i, float t, struct VertexTextured* vertices) {
 	PackedCol col = PACKEDCOL_WHITE;
+	BlockID block = particles_block[i];
 	Vec3 pos;
 	Vec2 size;
 	int x, y, z;
 
-	Vec3_Lerp(&pos, &p->base.lastPos, &p->base.nextPos, t);
-	size.x = p->base.size * 0.015625f; size.y = size.x;
+	Vec3_Lerp(&pos, &particles_lastPos[i], &particles_nextPos[i], t);
+	size.x = particles_size[i] * 0.015625f; size.y = size.x;
 	
-	if (!Blocks.Brightness[p->block]) {
+	if (!Blocks.Brightness[block]) {
 		x = Math_Floor(pos.x); y = Math_Floor(pos.y); z = Math_Floor(pos.z);
 		col = Lighting.Color_XSide(x, y, z);
 	}
 
-	Block_Tint(col, p->block);
-	Particle_DoRender(&size, &pos, &p->rec, col, vertices);
-}
-
-static void Terrain_Update1DCounts(void) {
-	int i, index;
-
-	for (i = 0; i < ATLAS1D_MAX_ATLASES; i++) {
-		terrain_1DCount[i]   = 0;
-		terrain_1DIndices[i] = 0;
-	}
-	for (i = 0; i < terrain_count; i++) {
-		index = Atlas1D_Index(terrain_particles[i].texLoc);
-		terrain_1DCount[index] += 4;
-	}
-	for (i = 1; i < Atlas1D.Count; i++) {
-		terrain_1DIndices[i] = terrain_1DIndices[i - 1] + terrain_1DCount[i - 1];
-	}
-}
-
-static void Terrain_Render(float t) {
-	struct VertexTextured* data;
-	struct VertexTextured* ptr;
-	int offset = 0;
-	int i, index;
-	if (!terrain_count) return;
-
-	data = (struct VertexTextured*)Gfx_LockDynamicVb(particles_VB, 
-										VERTEX_FORMAT_TEXTURED, terrain_count * 4);
-	Terrain_Update1DCounts();
-	for (i = 0; i < terrain_count; i++) 
-	{
-		index = Atlas1D_Index(terrain_particles[i].texLoc);
-		ptr   = data + terrain_1DIndices[index];
-
-		TerrainParticle_Render(&terrain_particles[i], t, ptr);
-		terrain_1DIndices[index] += 4;
-	}
-
-	Gfx_UnlockDynamicVb(particles_VB);
-	for (i = 0; i < Atlas1D.Count; i++) 
-	{
-		int partCount = terrain_1DCount[i];
-		if (!partCount) continue;
-
-		Atlas1D_Bind(i);
-		Gfx_DrawVb_IndexedTris_Range(partCount, offset);
-		offset += partCount;
-	}
-}
-
-static void Terrain_RemoveAt(int i) {
-	for (; i < terrain_count - 1; i++) 
-	{
-		terrain_particles[i] = terrain_particles[i + 1];
-	}
-	terrain_count--;
-}
-
-static void Terrain_Tick(float delta) {
-	int i;
-	for (i = 0; i < terrain_count; i++) 
-	{
-		if (TerrainParticle_Tick(&terrain_particles[i], delta)) {
-			Terrain_RemoveAt(i); i--;
-		}
-	}
+	Block_Tint(col, block);
+	Particle_DoRender(&size, &pos, &particles_rec[i], col, vertices);
 }
 
 void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
-	struct TerrainParticle* p;
 	TextureLoc loc;
 	int texIndex;
 	TextureRec baseRec, rec;
@@ -340,9 +361,10 @@ void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
 	/* per-particle variables */
 	float cellX, cellY, cellZ;
 	Vec3 cell;
-	int x, y, z, type;
+	int x, y, z, i, type;
 
 	if (now != BLOCK_AIR || Blocks.Draw[old] == DRAW_GAS) return;
+	if (!particles_capacity) return;
 	IVec3_ToVec3(&origin, &coords);
 	loc = Block_Tex(old, FACE_XMIN);
 	
@@ -375,13 +397,12 @@ void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
 				if (cell.x < minBB.x || cell.x > maxBB.x || cell.y < minBB.y
 					|| cell.y > maxBB.y || cell.z < minBB.z || cell.z > maxBB.z) continue;
 
-				if (terrain_count == PARTICLES_MAX) Terrain_RemoveAt(0);
-				p = &terrain_particles[terrain_count++];
+				i = Particles_Add(PARTICLE_TERRAIN);
 
 				/* centre random offset around [-0.2, 0.2] */
-				p->base.velocity.x = CELL_CENTRE + (cellX - 0.5f) + (Random_Float(&rnd) * 0.4f - 0.2f);
-				p->base.velocity.y = CELL_CENTRE + (cellY - 0.0f) + (Random_Float(&rnd) * 0.4f - 0.2f);
-				p->base.velocity.z = CELL_CENTRE + (cellZ - 0.5f) + (Random_Float(&rnd) * 0.4f - 0.2f);
+				particles_velocity[i].x = CELL_CENTRE + (cellX - 0.5f) + (Random_Float(&rnd) * 0.4f - 0.2f);
+				particles_velocity[i].y = CELL_CENTRE + (cellY - 0.0f) + (Random_Float(&rnd) * 0.4f - 0.2f);
+				particles_velocity[i].z = CELL_CENTRE + (cellZ - 0.5f) + (Random_Float(&rnd) * 0.4f - 0.2f);
 
 				rec = baseRec;
 				rec.u1 = baseRec.u1 + Random_Range(&rnd, minU, maxUsedU) * uScale;
@@ -391,15 +412,15 @@ void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
 				rec.u2 = min(rec.u2, maxU2) - 0.01f * uScale;
 				rec.v2 = min(rec.v2, maxV2) - 0.01f * vScale;
 		
-				Vec3_Add(&p->base.lastPos, &origin, &cell);
-				p->base.nextPos  = p->base.lastPos;
-				p->base.lifetime = 0.3f + Random_Float(&rnd) * 1.2f;
+				Vec3_Add(&particles_lastPos[i], &origin, &cell);
+				particles_nextPos[i]  = particles_lastPos[i];
+				particles_lifetime[i] = 0.3f + Random_Float(&rnd) * 1.2f;
 
-				p->rec    = rec;
-				p->texLoc = loc;
-				p->block  = old;
+				particles_rec[i]    = rec;
+				particles_texLoc[i] = loc;
+				particles_block[i]  = old;
 				type = Random_Next(&rnd, 30);
-				p->base.size = type >= 28 ? 12 : (type >= 25 ? 10 : 8);
+				particles_size[i] = type >= 28 ? 12 : (type >= 25 ? 10 : 8);
 			}
 		}
 	}
@@ -410,59 +431,33 @@ void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
 *-------------------------------------------------------Custom particle---------------------------------------------------*
 *#########################################################################################################################*/
 #ifdef CC_BUILD_NETWORKING
-struct CustomParticle {
-	struct Particle base;
-	int effectId;
-	float totalLifespan;
-};
-
 struct CustomParticleEffect Particles_CustomEffects[256];
-static struct CustomParticle custom_particles[PARTICLES_MAX];
-static int custom_count;
-static cc_uint8 collideFlags;
-#define EXPIRES_UPON_TOUCHING_GROUND (1 << 0)
-#define SOLID_COLLIDES  (1 << 1)
-#define LIQUID_COLLIDES (1 << 2)
-#define LEAF_COLLIDES   (1 << 3)
-
-static cc_bool CustomParticle_CanPass(BlockID block) {
-	cc_uint8 draw, collide;
-	
-	draw = Blocks.Draw[block];
-	if (draw == DRAW_TRANSPARENT_THICK && !(collideFlags & LEAF_COLLIDES)) return true;
-
-	collide = Blocks.Collide[block];
-	if (collide == COLLIDE_SOLID  && (collideFlags & SOLID_COLLIDES))  return false;
-	if (collide == COLLIDE_LIQUID && (collideFlags & LIQUID_COLLIDES)) return false;
-	return true;
-}
 
-static cc_bool CustomParticle_Tick(struct CustomParticle* p, float delta) {
-	struct CustomParticleEffect* e = &Particles_CustomEffects[p->effectId];
-	hitTerrain   = false;
-	collideFlags = e->collideFlags;
+static cc_bool CustomParticle_Tick(int i, float delta) {
+	struct CustomParticleEffect* e = &Particles_CustomEffects[particles_effect[i]];
+	hitTerrain = false;
 
-	return PhysicsTick(&p->base, e->gravity, CustomParticle_CanPass, delta)
+	return PhysicsTick(i, e->gravity, Custom_CollideMask(e->collideFlags), delta)
 		|| (hitTerrain && (e->collideFlags & EXPIRES_UPON_TOUCHING_GROUND));
 }
 
-static void CustomParticle_Render(struct CustomParticle* p, float t, struct VertexTextured* vertices) {
-	struct CustomParticleEffect* e = &Particles_CustomEffects[p->effectId];
+static void CustomParticle_Render(int i, float t, struct VertexTextured* vertices) {
+	struct CustomParticleEffect* e = &Particles_CustomEffects[particles_effect[i]];
 	Vec3 pos;
 	Vec2 size;
 	PackedCol col;
 	TextureRec rec = e->rec;
 	int x, y, z;
 
-	float time_lived = p->totalLifespan - p->base.lifetime;
-	int curFrame = Math_Floor(e->frameCount * (time_lived / p->totalLifespan));
+	float time_lived = particles_lifespan[i] - particles_lifetime[i];
+	int curFrame = Math_Floor(e->frameCount * (time_lived / particles_lifespan[i]));
 	float shiftU = curFrame * (rec.u2 - rec.u1);
 
 	rec.u1 += shiftU;/* * 0.0078125f; */
 	rec.u2 += shiftU;/* * 0.0078125f; */
 
-	Vec3_Lerp(&pos, &p->base.lastPos, &p->base.nextPos, t);
-	size.x = p->base.size; size.y = size.x;
+	Vec3_Lerp(&pos, &particles_lastPos[i], &particles_nextPos[i], t);
+	size.x = particles_size[i]; size.y = size.x;
 
 	x = Math_Floor(pos.x); y = Math_Floor(pos.y); z = Math_Floor(pos.z);
 	col = e->fullBright ? PACKEDCOL_WHITE : Lighting.Color(x, y, z);
@@ -471,53 +466,24 @@ static void CustomParticle_Render(struct CustomParticle* p, float t, struct Vert
 	Particle_DoRender(&size, &pos, &rec, col, vertices);
 }
 
-static void Custom_Render(float t) {
-	struct VertexTextured* data;
-	int i;
-	if (!custom_count) return;
-
-	data = (struct VertexTextured*)Gfx_LockDynamicVb(particles_VB, 
-										VERTEX_FORMAT_TEXTURED, custom_count * 4);
-	for (i = 0; i < custom_count; i++) {
-		CustomParticle_Render(&custom_particles[i], t, data);
-		data += 4;
-	}
-
-	Gfx_BindTexture(particles_TexId);
-	Gfx_UnlockDynamicVb(particles_VB);
-	Gfx_DrawVb_IndexedTris(custom_count * 4);
-}
-
-static void Custom_RemoveAt(int i) {
-	for (; i < custom_count - 1; i++) {
-		custom_particles[i] = custom_particles[i + 1];
-	}
-	custom_count--;
-}
-
-static void Custom_Tick(float delta) {
-	int i;
-	for (i = 0; i < custom_count; i++) {
-		if (CustomParticle_Tick(&custom_particles[i], delta)) {
-			Custom_RemoveAt(i); i--;
-		}
-	}
-}
-
 void Particles_CustomEffect(int effectID, float x, float y, float z, float originX, float originY, float originZ) {
-	struct CustomParticle* p;
 	struct CustomParticleEffect* e = &Particles_CustomEffects[effectID];
-	int i, count = e->particleCount;
+	int i, j, mask, count = e->particleCount;
 	Vec3 offset, delta, origin;
+	Vec3* pos;
+	BlockID block;
 	float d;
 
+	if (!particles_capacity) return;
 	origin.x = originX; origin.y = originY; origin.z = originZ;
+	mask = Custom_CollideMask(e->collideFlags);
+	/* World may have changed since the last tick */
+	column_valid = false;
 
-	for (i = 0; i < count; i++) 
+	for (j = 0; j < count; j++) 
 	{
-		if (custom_count == PARTICLES_MAX) Custom_RemoveAt(0);
-		p = &custom_particles[custom_count++];
-		p->effectId = effectID;
+		i = Particles_Add(PARTICLE_CUSTOM);
+		particles_effect[i] = effectID;
 
 		offset.x = Random_Float(&rnd) - 0.5f;
 		offset.y = Random_Float(&rnd) - 0.5f;
@@ -530,62 +496,144 @@ void Particles_CustomEffect(int effectID, float x, float y, float z, float origi
 		d  = Math_Exp2(Math_Log2(d) / 3.0); /* d^1/3 for better distribution */
 		d *= e->spread;
 
-		p->base.lastPos.x = x + offset.x * d;
-		p->base.lastPos.y = y + offset.y * d;
-		p->base.lastPos.z = z + offset.z * d;
+		pos    = &particles_lastPos[i];
+		pos->x = x + offset.x * d;
+		pos->y = y + offset.y * d;
+		pos->z = z + offset.z * d;
 		
-		Vec3_Sub(&delta, &p->base.lastPos, &origin);
+		Vec3_Sub(&delta, pos, &origin);
 		Vec3_Normalise(&delta);
 
-		p->base.velocity.x = delta.x * e->speed;
-		p->base.velocity.y = delta.y * e->speed;
-		p->base.velocity.z = delta.z * e->speed;
+		particles_velocity[i].x = delta.x * e->speed;
+		particles_velocity[i].y = delta.y * e->speed;
+		particles_velocity[i].z = delta.z * e->speed;
 
-		p->base.nextPos  = p->base.lastPos;
-		p->base.lifetime = e->baseLifetime + (e->baseLifetime * e->lifetimeVariation) * ((Random_Float(&rnd) - 0.5f) * 2);
-		p->totalLifespan = p->base.lifetime;
+		particles_nextPos[i]  = *pos;
+		particles_lifetime[i] = e->baseLifetime + (e->baseLifetime * e->lifetimeVariation) * ((Random_Float(&rnd) - 0.5f) * 2);
+		particles_lifespan[i] = particles_lifetime[i];
 
-		p->base.size = e->size + (e->size * e->sizeVariation) * ((Random_Float(&rnd) - 0.5f) * 2);
+		particles_size[i] = e->size + (e->size * e->sizeVariation) * ((Random_Float(&rnd) - 0.5f) * 2);
 
 		/* Don't spawn custom particle inside a block (otherwise it appears */
 		/*   for a few frames, then disappears in first PhysicsTick call)*/
-		collideFlags = e->collideFlags;
-		if (IntersectsBlock(&p->base, CustomParticle_CanPass)) custom_count--;
+		/* NOTE: Collide masks are only updated each tick, so calculate directly here */
+		block = Particles_GetBlockAt(pos);
+		if ((Particles_CalcCollideMask(block) & mask) && InsideBlock(pos, block)) {
+			Particles_RemoveAt(i);
+		}
 	}
 }
 #else
-static int custom_count;
-
-static void Custom_Render(float t) { }
-static void Custom_Tick(float delta) { }
+static cc_bool CustomParticle_Tick(int i, float delta) { return true; }
+static void CustomParticle_Render(int i, float t, struct VertexTextured* vertices) { }
 #endif
 
 
 /*########################################################################################################################*
 *--------------------------------------------------------Particles--------------------------------------------------------*
 *#########################################################################################################################*/
+/* Vertices for particles using particles.png come first, followed by terrain particles grouped by 1D atlas */
+static int particles_groupCount[1 + ATLAS1D_MAX_ATLASES];
+static int particles_groupOffset[1 + ATLAS1D_MAX_ATLASES];
+
+static int Particles_Group(int i) {
+	if (particles_kind[i] != PARTICLE_TERRAIN) return 0;
+	return 1 + Atlas1D_Index(particles_texLoc[i]);
+}
+
+static void Particles_UpdateGroups(void) {
+	int i, groups = 1 + Atlas1D.Count;
+
+	for (i = 0; i < groups; i++) 
+	{
+		particles_groupCount[i] = 0;
+	}
+	for (i = 0; i < particles_count; i++) 
+	{
+		particles_groupCount[Particles_Group(i)] += 4;
+	}
+
+	particles_groupOffset[0] = 0;
+	for (i = 1; i < groups; i++) 
+	{
+		particles_groupOffset[i] = particles_groupOffset[i - 1] + particles_groupCount[i - 1];
+	}
+}
+
 void Particles_Render(float t) {
-	if (!terrain_count && !rain_count && !custom_count) return;
+	struct VertexTextured* data;
+	struct VertexTextured* ptr;
+	int i, group, offset = 0;
+	if (!particles_count) return;
 
 	if (Gfx.LostContext) return;
 	if (!particles_VB)
-		particles_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, PARTICLES_MAX * 4);
+		particles_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, particles_capacity * 4);
 
 	Gfx_SetAlphaTest(true);
-
 	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
-	Terrain_Render(t);
-	Rain_Render(t);
-	Custom_Render(t);
+
+	data = (struct VertexTextured*)Gfx_LockDynamicVb(particles_VB, 
+										VERTEX_FORMAT_TEXTURED, particles_count * 4);
+	Particles_UpdateGroups();
+	for (i = 0; i < particles_count; i++) 
+	{
+		group = Particles_Group(i);
+		ptr   = data + particles_groupOffset[group];
+		particles_groupOffset[group] += 4;
+
+		switch (particles_kind[i]) {
+		case PARTICLE_RAIN:
+			RainParticle_Render(i, t, ptr); break;
+		case PARTICLE_TERRAIN:
+			TerrainParticle_Render(i, t, ptr); break;
+		default:
+			CustomParticle_Render(i, t, ptr); break;
+		}
+	}
+	Gfx_UnlockDynamicVb(particles_VB);
+
+	for (group = 0; group < 1 + Atlas1D.Count; group++) 
+	{
+		int vertsCount = particles_groupCount[group];
+		if (!vertsCount) continue;
+
+		if (group == 0) {
+			Gfx_BindTexture(particles_TexId);
+		} else {
+			Atlas1D_Bind(group - 1);
+		}
+		Gfx_DrawVb_IndexedTris_Range(vertsCount, offset);
+		offset += vertsCount;
+	}
 
 	Gfx_SetAlphaTest(false);
 }
 
 static void Particles_Tick(struct ScheduledTask* task) {
 	float delta = task->interval;
-	Terrain_Tick(delta);
-	Rain_Tick(delta);
-	Custom_Tick(delta);
+	cc_bool expired;
+	int i;
+	if (!particles_count) return;
+
+	/* Block properties can be changed at any time, so just recalculate collide masks each tick */
+	Particles_UpdateCollideMasks();
+	column_valid = false;
+
+	for (i = 0; i < particles_count; ) 
+	{
+		switch (particles_kind[i]) {
+		case PARTICLE_RAIN:
+			expired = RainParticle_Tick(i, delta); break;
+		case PARTICLE_TERRAIN:
+			expired = TerrainParticle_Tick(i, delta); break;
+		default:
+			expired = CustomParticle_Tick(i, delta); break;
+		}
+
+		/* Last particle is moved into this slot, so tick this slot again */
+		if (expired) { Particles_RemoveAt(i); } else { i++; }
+	}
 }
 
 
@@ -610,6 +658,9 @@ static void OnBreakBlockEffect_Handler(void* obj, IVec3 coords, BlockID old, Blo
 }
 
 static void OnInit(void) {
+	int capacity = Options_GetInt(OPT_MAX_PARTICLES, 0, PARTICLES_MAX_LIMIT, PARTICLES_DEF_MAX);
+	if (capacity) Particles_AllocPool(capacity);
+
 	ScheduledTask_Add(GAME_DEF_TICKS, Particles_Tick);
 	Random_SeedFromCurrentTime(&rnd);
 	TextureEntry_Register(&particles_entry);
@@ -618,9 +669,20 @@ static void OnInit(void) {
 	Event_Register_(&GfxEvents.ContextLost,   NULL, OnContextLost);
 }
 
-static void OnFree(void) { OnContextLost(NULL); }
+static void OnFree(void) { 
+	OnContextLost(NULL);
+	Mem_Free(particles_velocity);
 
-static void OnReset(void) { rain_count = 0; terrain_count = 0; custom_count = 0; }
+	particles_velocity = NULL;
+	particles_count    = 0;
+	particles_capacity = 0;
+}
+
+static void OnReset(void) { 
+	particles_count = 0;
+	particles_evict = 0;
+	column_valid    = false;
+}
 
 struct IGameComponent Particles_Component = {
 	OnInit,  /* Init  */
@@ -126,10 +126,22 @@ cc_bool Intersection_RayIntersectsBox(Vec3 origin, Vec3 invDir, Vec3 min, Vec3 m
 /*########################################################################################################################*
 *----------------------------------------------------Collisions finder----------------------------------------------------*
 *#########################################################################################################################*/
-#define SEARCHER_STATES_MIN 64
-static struct SearcherState searcherDefaultStates[SEARCHER_STATES_MIN];
-static cc_uint32 searcherCapacity = SEARCHER_STATES_MIN;
-struct SearcherState* Searcher_States = searcherDefaultStates;
+/* Candidates are kept in a fixed arena. When more blocks are reachable than fit in the arena, */
+/*  the same search is later resumed from after the last returned block. */
+static struct SearcherState searcherStates[SEARCHER_STATES_MAX];
+struct SearcherState* Searcher_States = searcherStates;
+
+static struct SearcherSweep {
+	Vec3 vel;
+	struct AABB entityBB, extentBB;
+	IVec3 min, max;
+	/* Time and scan order of the last block returned */
+	float lastTime; int lastOrder;
+	cc_bool more;
+} sweep;
+
+/* Whether time a/order a is before time b/order b */
+#define Searcher_Before(aTime, aOrder, bTime, bOrder) ((aTime) < (bTime) || ((aTime) == (bTime) && (aOrder) < (bOrder)))
 
 static void Searcher_QuickSort(int left, int right) {
 	struct SearcherState* keys = Searcher_States; struct SearcherState key;
@@ -137,11 +149,12 @@ static void Searcher_QuickSort(int left, int right) {
 	while (left < right) {
 		int i = left, j = right;
 		float pivot = keys[(i + j) >> 1].tSquared;
+		int pivotOrder = keys[(i + j) >> 1].order;
 
 		/* partition the list */
 		while (i <= j) {
-			while (pivot > keys[i].tSquared) i++;
-			while (pivot < keys[j].tSquared) j--;
+			while (Searcher_Before(keys[i].tSquared, keys[i].order, pivot, pivotOrder)) i++;
+			while (Searcher_Before(pivot, pivotOrder, keys[j].tSquared, keys[j].order)) j--;
 			QuickSort_Swap_Maybe();
 		}
 		/* recurse into the smaller subset */
@@ -149,44 +162,122 @@ static void Searcher_QuickSort(int left, int right) {
 	}
 }
 
-int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, struct AABB* entityExtentBB) {
-	Vec3 vel = entity->Velocity;
-	IVec3 min, max;
-	cc_uint32 elements;
-	struct SearcherState* curState;
-	int count;
+/* Once the arena is full, candidates are kept as a max heap, */
+/*  so that the furthest candidate can be quickly replaced by a nearer one */
+static void Searcher_SiftDown(int i, int count) {
+	struct SearcherState* states = Searcher_States;
+	struct SearcherState tmp;
+	int child;
 
-	BlockID block;
-	struct AABB blockBB;
-	float xx, yy, zz, tx, ty, tz;
-	int x, y, z;
+	for (; (child = i * 2 + 1) < count; i = child)
+	{
+		if (child + 1 < count && Searcher_Before(states[child].tSquared, states[child].order,
+									states[child + 1].tSquared, states[child + 1].order)) child++;
+		if (!Searcher_Before(states[i].tSquared, states[i].order, states[child].tSquared, states[child].order)) return;
 
-	Entity_GetBounds(entity, entityBB);
-	/* Exact maximum extent the entity can reach, and the equivalent map coordinates. */
-	entityExtentBB->Min.x = entityBB->Min.x + (vel.x < 0.0f ? vel.x : 0.0f);
-	entityExtentBB->Min.y = entityBB->Min.y + (vel.y < 0.0f ? vel.y : 0.0f);
-	entityExtentBB->Min.z = entityBB->Min.z + (vel.z < 0.0f ? vel.z : 0.0f);
+		tmp = states[i]; states[i] = states[child]; states[child] = tmp;
+	}
+}
 
-	entityExtentBB->Max.x = entityBB->Max.x + (vel.x > 0.0f ? vel.x : 0.0f);
-	entityExtentBB->Max.y = entityBB->Max.y + (vel.y > 0.0f ? vel.y : 0.0f);
-	entityExtentBB->Max.z = entityBB->Max.z + (vel.z > 0.0f ? vel.z : 0.0f);
+static int Searcher_Insert(int count, int x, int y, int z, BlockID block, float tSquared, int order) {
+	struct SearcherState* states = Searcher_States;
+	struct SearcherState* state;
+	int i;
 
-	IVec3_Floor(&min, &entityExtentBB->Min);
-	IVec3_Floor(&max, &entityExtentBB->Max);
-	elements = (max.x - min.x + 1) * (max.y - min.y + 1) * (max.z - min.z + 1);
+	if (count == SEARCHER_STATES_MAX) {
+		/* Arena is full, so replace the furthest block if this block is nearer */
+		if (!Searcher_Before(tSquared, order, states[0].tSquared, states[0].order)) return count;
+		state = &states[0];
+	} else {
+		state = &states[count++];
+	}
 
-	if (elements > searcherCapacity) {
-		Searcher_Free();
-		searcherCapacity = elements;
-		Searcher_States  = (struct SearcherState*)Mem_Alloc(elements, sizeof(struct SearcherState), "collision search states");
+	state->x = (x << 3) | (block  & 0x007);
+	state->y = (y << 4) | ((block & 0x078) >> 3);
+	state->z = (z << 3) | ((block & 0x380) >> 7);
+	state->tSquared = tSquared;
+	state->order    = order;
+
+	if (state == &states[0] && count == SEARCHER_STATES_MAX) {
+		Searcher_SiftDown(0, count);
+	} else if (count == SEARCHER_STATES_MAX) {
+		/* Arena just became full */
+		for (i = count / 2 - 1; i >= 0; i--) Searcher_SiftDown(i, count);
 	}
-	curState = Searcher_States;
+	return count;
+}
+
+static void Searcher_Sort(int count) {
+	struct SearcherState* states = Searcher_States;
+	struct SearcherState tmp;
+	if (count < SEARCHER_STATES_MAX) { 
+		if (count) Searcher_QuickSort(0, count - 1);
+		return;
+	}
+
+	for (count--; count > 0; count--)
+	{
+		tmp = states[0]; states[0] = states[count]; states[count] = tmp;
+		Searcher_SiftDown(0, count);
+	}
+}
+
+/* Calculates the lowest time the entity could reach any block in the given slice of blocks */
+static float Searcher_MinTime(float vel, float entityMin, float entityMax, int coord) {
+	if (vel > 0.0f && coord > entityMax)         return (coord - entityMax) / vel;
+	if (vel < 0.0f && coord + 1.0f < entityMin)  return (entityMin - (coord + 1.0f)) / -vel;
+	return 0.0f;
+}
+
+static int Searcher_Scan(struct AABB* extentBB) {
+	Vec3 vel = sweep.vel;
+	struct AABB* entityBB = &sweep.entityBB;
+	IVec3 min, max, beg, end, dir;
+	int count = 0, order, sizeX, sizeXZ;
+
+	BlockID block;
+	struct AABB blockBB;
+	float xx, yy, zz, tx, ty, tz, tSquared;
+	float minTY, minTZ, minTX, maxTime = MATH_LARGENUM;
+	int x, y, z, orderY, orderZ;
+	cc_bool rowInside;
+
+	/* Blocks outside the current extent are ignored when colliding anyways */
+	IVec3_Floor(&min, &extentBB->Min); IVec3_Max(&min, &min, &sweep.min);
+	IVec3_Floor(&max, &extentBB->Max); IVec3_Min(&max, &max, &sweep.max);
+	sizeX  = sweep.max.x - sweep.min.x + 1;
+	sizeXZ = sweep.max.z - sweep.min.z + 1; sizeXZ *= sizeX;
+
+	/* Scan from the side the entity is moving away from, so nearer blocks are found first */
+	dir.x = vel.x < 0.0f ? -1 : 1; beg.x = vel.x < 0.0f ? max.x : min.x; end.x = vel.x < 0.0f ? min.x - 1 : max.x + 1;
+	dir.y = vel.y < 0.0f ? -1 : 1; beg.y = vel.y < 0.0f ? max.y : min.y; end.y = vel.y < 0.0f ? min.y - 1 : max.y + 1;
+	dir.z = vel.z < 0.0f ? -1 : 1; beg.z = vel.z < 0.0f ? max.z : min.z; end.z = vel.z < 0.0f ? min.z - 1 : max.z + 1;
 
 	/* Order loops so that we minimise cache misses */
-	for (y = min.y; y <= max.y; y++) {
-		for (z = min.z; z <= max.z; z++) {
-			for (x = min.x; x <= max.x; x++) {
-				block = World_GetPhysicsBlock(x, y, z);
+	/* Because blocks are scanned nearest first, time to reach them only increases along each axis. */
+	/*  So once the arena is full, can stop as soon as blocks are further away than the last block found */
+	for (y = beg.y; y != end.y; y += dir.y) {
+		minTY = Searcher_MinTime(vel.y, entityBB->Min.y, entityBB->Max.y, y);
+		minTY = minTY * minTY;
+		if (minTY > maxTime) break;
+		orderY = (vel.y < 0.0f ? sweep.max.y - y : y - sweep.min.y) * sizeXZ;
+		/* Can skip bounds checks when whole row of blocks lies inside the map */
+		rowInside = y >= 0 && y < World.Height && min.x >= 0 && max.x < World.Width;
+
+		for (z = beg.z; z != end.z; z += dir.z) {
+			minTZ = Searcher_MinTime(vel.z, entityBB->Min.z, entityBB->Max.z, z);
+			minTZ = minTZ * minTZ;
+			if (minTY + minTZ > maxTime) break;
+			orderZ = orderY + (vel.z < 0.0f ? sweep.max.z - z : z - sweep.min.z) * sizeX;
+
+			for (x = beg.x; x != end.x; x += dir.x) {
+				if (count == SEARCHER_STATES_MAX) {
+					minTX = Searcher_MinTime(vel.x, entityBB->Min.x, entityBB->Max.x, x);
+					/* NOTE: Summed in same order as tSquared below, so rounding can't make this larger */
+					if (minTX * minTX + minTY + minTZ > maxTime) break;
+				}
+
+				block = rowInside && z >= 0 && z < World.Length ? World_GetBlock(x, y, z) : World_GetPhysicsBlock(x, y, z);
 				if (Blocks.Collide[block] != COLLIDE_SOLID) continue;
 
 				xx = (float)x; yy = (float)y; zz = (float)z;
@@ -195,24 +286,59 @@ int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, s
 				blockBB.Max = Blocks.MaxBB[block];
 				blockBB.Max.x += xx; blockBB.Max.y += yy; blockBB.Max.z += zz;
 
-				if (!AABB_Intersects(entityExtentBB, &blockBB)) continue; /* necessary for non whole blocks. (slabs) */
+				if (!AABB_Intersects(&sweep.extentBB, &blockBB)) continue; /* necessary for non whole blocks. (slabs) */
+				if (!AABB_Intersects(extentBB, &blockBB))       continue;
 				Searcher_CalcTime(&vel, entityBB, &blockBB, &tx, &ty, &tz);
 				if (tx > 1.0f || ty > 1.0f || tz > 1.0f) continue;
 
-				curState->x = (x << 3) | (block  & 0x007);
-				curState->y = (y << 4) | ((block & 0x078) >> 3);
-				curState->z = (z << 3) | ((block & 0x380) >> 7);
-				curState->tSquared = tx * tx + ty * ty + tz * tz;
-				curState++;
+				tSquared = tx * tx + ty * ty + tz * tz;
+				order    = orderZ + (vel.x < 0.0f ? sweep.max.x - x : x - sweep.min.x);
+				/* Skip blocks already returned by an earlier search */
+				if (!Searcher_Before(sweep.lastTime, sweep.lastOrder, tSquared, order)) continue;
+
+				count = Searcher_Insert(count, x, y, z, block, tSquared, order);
+				if (count == SEARCHER_STATES_MAX) maxTime = Searcher_States[0].tSquared;
 			}
 		}
 	}
 
-	count = (int)(curState - Searcher_States);
-	if (count) Searcher_QuickSort(0, count - 1);
+	Searcher_Sort(count);
+	sweep.more = count == SEARCHER_STATES_MAX;
+	if (count) {
+		sweep.lastTime  = Searcher_States[count - 1].tSquared;
+		sweep.lastOrder = Searcher_States[count - 1].order;
+	}
 	return count;
 }
 
+int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, struct AABB* entityExtentBB) {
+	Vec3 vel = entity->Velocity;
+
+	Entity_GetBounds(entity, entityBB);
+	/* Exact maximum extent the entity can reach, and the equivalent map coordinates. */
+	entityExtentBB->Min.x = entityBB->Min.x + (vel.x < 0.0f ? vel.x : 0.0f);
+	entityExtentBB->Min.y = entityBB->Min.y + (vel.y < 0.0f ? vel.y : 0.0f);
+	entityExtentBB->Min.z = entityBB->Min.z + (vel.z < 0.0f ? vel.z : 0.0f);
+
+	entityExtentBB->Max.x = entityBB->Max.x + (vel.x > 0.0f ? vel.x : 0.0f);
+	entityExtentBB->Max.y = entityBB->Max.y + (vel.y > 0.0f ? vel.y : 0.0f);
+	entityExtentBB->Max.z = entityBB->Max.z + (vel.z > 0.0f ? vel.z : 0.0f);
+
+	sweep.vel      = vel;
+	sweep.entityBB = *entityBB;
+	sweep.extentBB = *entityExtentBB;
+	IVec3_Floor(&sweep.min, &entityExtentBB->Min);
+	IVec3_Floor(&sweep.max, &entityExtentBB->Max);
+
+	sweep.lastTime  = -1.0f;
+	sweep.lastOrder = 0;
+	return Searcher_Scan(entityExtentBB);
+}
+
+int Searcher_FindMoreBlocks(struct AABB* entityExtentBB) {
+	return sweep.more ? Searcher_Scan(entityExtentBB) : 0;
+}
+
 void Searcher_CalcTime(Vec3* vel, struct AABB *entityBB, struct AABB* blockBB, float* tx, float* ty, float* tz) {
 	float dx = vel->x > 0.0f ? blockBB->Min.x - entityBB->Max.x : entityBB->Min.x - blockBB->Max.x;
 	float dy = vel->y > 0.0f ? blockBB->Min.y - entityBB->Max.y : entityBB->Min.y - blockBB->Max.y;
@@ -236,9 +362,3 @@ void Searcher_CalcTime(Vec3* vel, struct AABB *entityBB, struct AABB* blockBB, f
 		*tz = vel->z == 0.0f ? MATH_LARGENUM : Math_AbsF(dz / vel->z);
 	}
 }
-
-void Searcher_Free(void) {
-	if (Searcher_States != searcherDefaultStates) Mem_Free(Searcher_States);
-	Searcher_States  = searcherDefaultStates;
-	searcherCapacity = SEARCHER_STATES_MIN;
-}
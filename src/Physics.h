@@ -35,11 +35,17 @@ Source: http://www.cs.utah.edu/~awilliam/box/box.pdf */
 /* NOTE: invDir is inverse of ray's direction (i.e. 1.0f / dir) */
 cc_bool Intersection_RayIntersectsBox(Vec3 origin, Vec3 invDir, Vec3 min, Vec3 max, float* t0, float* t1);
 
-struct SearcherState { int x, y, z; float tSquared; };
+#define SEARCHER_STATES_MAX 1024
+struct SearcherState { int x, y, z; float tSquared; int order; };
 extern struct SearcherState* Searcher_States;
+/* Finds the solid blocks the entity could reach this tick, sorted by time to reach them. */
+/* NOTE: At most SEARCHER_STATES_MAX blocks are found, use Searcher_FindMoreBlocks for the rest */
 int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, struct AABB* entityExtentBB);
+/* Continues the last search, finding the next blocks after those previously found */
+/*  which are still within the given (possibly since reduced) extent. */
+/* Returns 0 once all reachable blocks have been found */
+int Searcher_FindMoreBlocks(struct AABB* entityExtentBB);
 void Searcher_CalcTime(Vec3* vel, struct AABB *entityBB, struct AABB* blockBB, float* tx, float* ty, float* tz);
-void Searcher_Free(void);
 
 CC_END_HEADER
 #endif
@@ -33,6 +33,7 @@
 #include "InputHandler.h"
 #include "HeldBlockRenderer.h"
 #include "Options.h"
+#include "MapRenderer.h"
 
 struct _ProtocolData Protocol;
 
@@ -42,8 +43,6 @@ static cc_bool classic_receivedFirstPos;
 /* Map state */
 static cc_bool map_begunLoading;
 static cc_uint64 map_receiveBeg;
-static struct Stream map_part;
-static int map_volume;
 
 /*########################################################################################################################*
 *-----------------------------------------------------CPE extensions------------------------------------------------------*
@@ -346,12 +345,28 @@ static void WoM_Tick(void) {
 
 struct MapState {
 	struct InflateState inflateState;
-	struct Stream stream;
+	struct Stream stream, part;
 	BlockRaw* blocks;
 	struct GZipHeader gzHeader;
 	cc_uint8 size[MAP_SIZE_LEN];
-	int index, sizeIndex;
+	int index, sizeIndex, volume;
 	cc_bool allocFailed;
+#ifndef CC_BUILD_COOPTHREADED
+	/* Compressed data is inflated on a background thread as it arrives */
+	void* thread;
+	void* mutex;
+	void* waitable;
+	/* Compressed data received but not yet passed to the decoder thread */
+	cc_uint8* pending;
+	cc_uint32 pendingLen, pendingCapacity;
+	/* Compressed data currently being inflated by the decoder thread */
+	cc_uint8* working;
+	cc_uint32 workingCapacity;
+	cc_bool inputDone, cancelled;
+	/* Snapshot of decoder progress, readable by main thread */
+	int decodedIndex, decodedVolume;
+#endif
+	cc_result result;
 };
 static struct MapState map1;
 #ifdef EXTENDED_BLOCKS
@@ -367,28 +382,8 @@ static void DisconnectInvalidMap(cc_result res) {
 	Game_Disconnect(&title, &tmp); return;
 }
 
-static void MapState_Init(struct MapState* m) {
-	Inflate_MakeStream2(&m->stream, &m->inflateState, &map_part);
-	GZipHeader_Init(&m->gzHeader);
-
-	m->index       = 0;
-	m->blocks      = NULL;
-	m->sizeIndex   = 0;
-	m->allocFailed = false;
-}
-
-static CC_INLINE void MapState_SkipHeader(struct MapState* m) {
-	m->gzHeader.done = true;
-	m->sizeIndex     = MAP_SIZE_LEN;
-}
-
-static void FreeMapStates(void) {
-	Mem_Free(map1.blocks);
-	map1.blocks = NULL;
-#ifdef EXTENDED_BLOCKS
-	Mem_Free(map2.blocks);
-	map2.blocks = NULL;
-#endif
+static void WarnMapOutOfMemory(void) {
+	Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
 }
 
 static cc_result MapState_Read(struct MapState* m) {
@@ -407,25 +402,224 @@ static cc_result MapState_Read(struct MapState* m) {
 		if (m->sizeIndex < MAP_SIZE_LEN) return 0;
 	}
 
-	if (!map_volume) map_volume = Stream_GetU32_BE(m->size);
+	if (!m->volume) m->volume = Stream_GetU32_BE(m->size);
 
 	if (!m->blocks) {
-		m->blocks = (BlockRaw*)Mem_TryAlloc(map_volume, 1);
+		m->blocks = (BlockRaw*)Mem_TryAlloc(m->volume, 1);
 		/* unlikely but possible */
-		if (!m->blocks) {
-			Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
-			m->allocFailed = true;
-			return 0;
-		}
+		if (!m->blocks) { m->allocFailed = true; return 0; }
 	}
 
-	left = map_volume - m->index;
+	left = m->volume - m->index;
 	res  = m->stream.Read(&m->stream, &m->blocks[m->index], left, &read);
 
 	m->index += read;
 	return res;
 }
 
+/* Inflates a portion of the compressed map data into the blocks array */
+static cc_result MapState_Decode(struct MapState* m, cc_uint8* data, cc_uint32 len) {
+	cc_result res;
+	Stream_ReadonlyMemory(&m->part, data, len);
+
+	if (!m->gzHeader.done) {
+		res = GZipHeader_Read(&m->part, &m->gzHeader);
+		if (res && res != ERR_END_OF_STREAM) return res;
+	}
+
+	if (!m->gzHeader.done) return 0;
+	return MapState_Read(m);
+}
+
+#ifdef CC_BUILD_COOPTHREADED
+static void MapState_Cancel(struct MapState* m) { }
+static cc_result MapState_Finish(struct MapState* m) { return m->result; }
+
+static cc_result MapState_Append(struct MapState* m, cc_uint8* data, cc_uint32 len) {
+	if (!m->result) m->result = MapState_Decode(m, data, len);
+	return m->result;
+}
+
+static float MapState_Progress(struct MapState* m) {
+	return !m->volume ? 0.0f : (float)m->index / m->volume;
+}
+#else
+static void MapState_DecodeLoop(struct MapState* m) {
+	cc_uint8* data;
+	cc_uint32 len, capacity;
+	cc_result res;
+
+	for (;;)
+	{
+		Mutex_Lock(m->mutex);
+		while (!m->pendingLen && !m->inputDone && !m->cancelled) {
+			Mutex_Unlock(m->mutex);
+			Waitable_Wait(m->waitable);
+			Mutex_Lock(m->mutex);
+		}
+
+		if (m->cancelled || !m->pendingLen) { Mutex_Unlock(m->mutex); return; }
+
+		/* Swap buffers, so main thread can keep appending data while this batch is inflated */
+		data     = m->pending;
+		len      = m->pendingLen;
+		capacity = m->pendingCapacity;
+
+		m->pending         = m->working;
+		m->pendingCapacity = m->workingCapacity;
+		m->pendingLen      = 0;
+		m->working         = data;
+		m->workingCapacity = capacity;
+		Mutex_Unlock(m->mutex);
+
+		res = MapState_Decode(m, data, len);
+
+		Mutex_Lock(m->mutex);
+		{
+			m->decodedIndex  = m->index;
+			m->decodedVolume = m->volume;
+			m->result        = res;
+		}
+		Mutex_Unlock(m->mutex);
+		if (res) return;
+	}
+}
+
+static void MapState_DecodeMap1(void) { MapState_DecodeLoop(&map1); }
+#ifdef EXTENDED_BLOCKS
+static void MapState_DecodeMap2(void) { MapState_DecodeLoop(&map2); }
+#endif
+
+static void MapState_StartDecoder(struct MapState* m) {
+	m->mutex    = Mutex_Create("Map decoder");
+	m->waitable = Waitable_Create("Map decoder");
+
+#ifdef EXTENDED_BLOCKS
+	if (m == &map2) {
+		Thread_Run(&m->thread, MapState_DecodeMap2, 64 * 1024, "Map decoder");
+		return;
+	}
+#endif
+	Thread_Run(&m->thread, MapState_DecodeMap1, 64 * 1024, "Map decoder");
+}
+
+/* Waits for the decoder thread to exit, then frees its resources */
+static void MapState_StopDecoder(struct MapState* m, cc_bool cancel) {
+	if (!m->thread) return;
+
+	Mutex_Lock(m->mutex);
+	{
+		m->inputDone = true;
+		m->cancelled = cancel;
+	}
+	Mutex_Unlock(m->mutex);
+
+	Waitable_Signal(m->waitable);
+	Thread_Join(m->thread);
+	Mutex_Free(m->mutex);
+	Waitable_Free(m->waitable);
+
+	Mem_Free(m->pending);
+	Mem_Free(m->working);
+	m->thread  = NULL;
+	m->pending = NULL;
+	m->working = NULL;
+}
+
+static void MapState_Cancel(struct MapState* m) { MapState_StopDecoder(m, true); }
+
+static cc_result MapState_Finish(struct MapState* m) {
+	MapState_StopDecoder(m, false);
+	return m->result;
+}
+
+/* Queues compressed map data to be inflated by the decoder thread */
+static cc_result MapState_Append(struct MapState* m, cc_uint8* data, cc_uint32 len) {
+	cc_uint32 capacity;
+	cc_uint8* pending;
+	cc_result res = 0;
+	if (!m->thread) MapState_StartDecoder(m);
+
+	Mutex_Lock(m->mutex);
+	{
+		if (m->pendingLen + len > m->pendingCapacity) {
+			capacity = max(m->pendingCapacity * 2, m->pendingLen + len);
+			capacity = max(capacity, 16 * 1024);
+			pending  = (cc_uint8*)Mem_TryRealloc(m->pending, capacity, 1);
+
+			if (pending) {
+				m->pending         = pending;
+				m->pendingCapacity = capacity;
+			} else {
+				res = ERR_OUT_OF_MEMORY;
+			}
+		}
+
+		if (!res) {
+			Mem_Copy(m->pending + m->pendingLen, data, len);
+			m->pendingLen += len;
+		}
+		if (m->result) res = m->result;
+	}
+	Mutex_Unlock(m->mutex);
+
+	Waitable_Signal(m->waitable);
+	return res;
+}
+
+static float MapState_Progress(struct MapState* m) {
+	int index, volume;
+	if (!m->thread) return 0.0f;
+
+	Mutex_Lock(m->mutex);
+	{
+		index  = m->decodedIndex;
+		volume = m->decodedVolume;
+	}
+	Mutex_Unlock(m->mutex);
+	return !volume ? 0.0f : (float)index / volume;
+}
+#endif
+
+static void MapState_Init(struct MapState* m) {
+	MapState_Cancel(m);
+	Inflate_MakeStream2(&m->stream, &m->inflateState, &m->part);
+	GZipHeader_Init(&m->gzHeader);
+
+	m->index       = 0;
+	m->blocks      = NULL;
+	m->sizeIndex   = 0;
+	m->volume      = 0;
+	m->allocFailed = false;
+	m->result      = 0;
+#ifndef CC_BUILD_COOPTHREADED
+	m->pendingLen      = 0;
+	m->pendingCapacity = 0;
+	m->workingCapacity = 0;
+	m->inputDone       = false;
+	m->cancelled       = false;
+	m->decodedIndex    = 0;
+	m->decodedVolume   = 0;
+#endif
+}
+
+static CC_INLINE void MapState_SkipHeader(struct MapState* m, int volume) {
+	m->gzHeader.done = true;
+	m->sizeIndex     = MAP_SIZE_LEN;
+	m->volume        = volume;
+}
+
+static void FreeMapStates(void) {
+	MapState_Cancel(&map1);
+	Mem_Free(map1.blocks);
+	map1.blocks = NULL;
+#ifdef EXTENDED_BLOCKS
+	MapState_Cancel(&map2);
+	Mem_Free(map2.blocks);
+	map2.blocks = NULL;
+#endif
+}
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Classic protocol-----------------------------------------------------*
@@ -534,7 +728,6 @@ static void Classic_StartLoading(void) {
 
 	map_begunLoading = true;
 	map_receiveBeg   = Stopwatch_Measure();
-	map_volume       = 0;
 
 	MapState_Init(&map1);
 #ifdef EXTENDED_BLOCKS
@@ -543,6 +736,7 @@ static void Classic_StartLoading(void) {
 }
 
 static void Classic_LevelInit(cc_uint8* data) {
+	int volume;
 	/* in case server is buggy and sends LevelInit multiple times */
 	if (map_begunLoading) return;
 
@@ -550,28 +744,22 @@ static void Classic_LevelInit(cc_uint8* data) {
 	if (!IsSupported(fastMap_Ext)) return;
 
 	/* Fast map puts volume in header, and uses raw DEFLATE without GZIP header/footer */
-	map_volume = Stream_GetU32_BE(data);
-	MapState_SkipHeader(&map1);
+	volume = Stream_GetU32_BE(data);
+	MapState_SkipHeader(&map1, volume);
 #ifdef EXTENDED_BLOCKS
-	MapState_SkipHeader(&map2);
+	MapState_SkipHeader(&map2, volume);
 #endif
 }
 
 static void Classic_LevelDataChunk(cc_uint8* data) {
 	struct MapState* m;
 	int usedLength;
-	float progress;
 	cc_result res;
 
 	/* Workaround for some servers that send LevelDataChunk before LevelInit due to their async sending behaviour */
 	if (!map_begunLoading) Classic_StartLoading();
 	usedLength = Stream_GetU16_BE(data);
 
-	map_part.meta.mem.cur    = data + 2;
-	map_part.meta.mem.base   = data + 2;
-	map_part.meta.mem.left   = usedLength;
-	map_part.meta.mem.length = usedLength;
-
 #ifndef EXTENDED_BLOCKS
 	m = &map1;
 #else
@@ -583,33 +771,34 @@ static void Classic_LevelDataChunk(cc_uint8* data) {
 	}
 #endif
 
-	if (!m->gzHeader.done) {
-		res = GZipHeader_Read(&map_part, &m->gzHeader);
-		if (res && res != ERR_END_OF_STREAM) { DisconnectInvalidMap(res); return; }
-	}
-
-	if (m->gzHeader.done) {
-		res = MapState_Read(m);
-		if (res) { DisconnectInvalidMap(res); return; }
-	}
+	/* Map data is inflated in the background, so only need to copy the compressed data here */
+	res = MapState_Append(m, data + 2, usedLength);
+	if (res) { DisconnectInvalidMap(res); return; }
 
-	progress = !map_volume ? 0.0f : (float)map1.index / map_volume;
-	Event_RaiseFloat(&WorldEvents.Loading, progress);
+	Event_RaiseFloat(&WorldEvents.Loading, MapState_Progress(&map1));
 }
 
 static void Classic_LevelFinalise(cc_uint8* data) {
 	int width, height, length, volume;
 	cc_uint64 end;
+	cc_result res;
 	int delta;
 
+	/* Wait for any remaining compressed map data to be inflated */
+	res = MapState_Finish(&map1);
+#ifdef EXTENDED_BLOCKS
+	if (!res) res = MapState_Finish(&map2);
+#endif
+
 	end   = Stopwatch_Measure();
 	delta = Stopwatch_ElapsedMS(map_receiveBeg, end);
 	Platform_Log1("map loading took: %i", &delta);
 	map_begunLoading = false;
 	WoM_CheckSendWomID();
 
+	if (res) { DisconnectInvalidMap(res); return; }
 #ifdef EXTENDED_BLOCKS
-	if (map2.allocFailed) FreeMapStates();
+	if (map2.allocFailed) { WarnMapOutOfMemory(); FreeMapStates(); }
 #endif
 
 	width  = Stream_GetU16_BE(data + 0);
@@ -618,14 +807,15 @@ static void Classic_LevelFinalise(cc_uint8* data) {
 	volume = width * height * length;
 
 	if (map1.allocFailed) {
+		WarnMapOutOfMemory();
 		Chat_AddRaw("&cFailed to load map, try joining a different map");
 		Chat_AddRaw("   &cNot enough free memory to load the map");
 	} else if (!map1.blocks) {
 		Chat_AddRaw("&cFailed to load map, try joining a different map");
 		Chat_AddRaw("   &cAttempted to load map without a Blocks array");
-	} else if (map_volume != volume) {
+	} else if (map1.volume != volume) {
 		Chat_AddRaw("&cFailed to load map, try joining a different map");
-		Chat_Add2(  "   &cBlocks array size (%i) does not match volume of map (%i)", &map_volume, &volume);
+		Chat_Add2(  "   &cBlocks array size (%i) does not match volume of map (%i)", &map1.volume, &volume);
 		FreeMapStates();
 	}
 	
@@ -794,7 +984,6 @@ static void Classic_ReadAbsoluteLocation(cc_uint8* data, EntityID id, cc_uint8 f
 
 #define Classic_HandshakeSize() (Game_Version.Protocol > PROTOCOL_0019 ? 131 : 130)
 static void Classic_Reset(void) {
-	Stream_ReadonlyMemory(&map_part, NULL, 0);
 	map_begunLoading = false;
 	classic_receivedFirstPos = false;
 
@@ -1278,6 +1467,7 @@ static void CPE_BulkBlockUpdate(cc_uint8* data) {
 		data += BULK_MAX_BLOCKS / 4;
 	}
 
+	Game_BeginBlockBatch();
 	for (i = 0; i < count; i++) {
 		index = indices[i];
 		if (index < 0 || index >= World.Volume) continue;
@@ -1289,6 +1479,7 @@ static void CPE_BulkBlockUpdate(cc_uint8* data) {
 		Game_UpdateBlock(x, y, z, blocks[i]);
 #endif
 	}
+	Game_EndBlockBatch();
 }
 
 static void CPE_SetTextColor(cc_uint8* data) {
@@ -1766,15 +1957,23 @@ static void CustomModels_Reset(void) { }
 *#########################################################################################################################*/
 static void BlockDefs_OnBlocksLightPropertyUpdated(BlockID block, cc_bool oldProp) {
 	if (!World.Loaded) return;
+	if (Blocks.BlocksLight[block] == oldProp) return;
+
 	/* Need to refresh lighting when a block's light blocking state changes */
-	if (Blocks.BlocksLight[block] != oldProp) Lighting.Refresh();
+	/* Shadows cast by the block can reach chunks which do not contain it */
+	Lighting.Refresh();
+	MapRenderer_Refresh();
 }
 
 static void BlockDefs_OnBrightnessPropertyUpdated(BlockID block, cc_uint8 oldProp) {
 	if (!World.Loaded) return;
 	if (Lighting_Mode == LIGHTING_MODE_CLASSIC) return;
+	if (Blocks.Brightness[block] == oldProp) return;
+
 	/* Need to refresh fancy lighting when a block's brightness changes */
-	if (Blocks.Brightness[block] != oldProp) Lighting.Refresh();
+	/* Light emitted by the block can reach chunks which do not contain it */
+	Lighting.Refresh();
+	MapRenderer_Refresh();
 }
 
 static TextureLoc BlockDefs_Tex(cc_uint8** ptr) {
@@ -175,7 +175,7 @@ static cc_result ZipWriter_FixupLocalFile(struct Stream* s, struct ResourceZipEn
 	int filenameLen = String_Length(e->filename);
 	cc_uint8 tmp[2048];
 	cc_uint32 dataBeg, dataEnd;
-	cc_uint32 i, crc, toRead, read;
+	cc_uint32 crc, toRead, read;
 	cc_result res;
 
 	dataBeg = e->offset + 30 + filenameLen;
@@ -193,9 +193,7 @@ static cc_result ZipWriter_FixupLocalFile(struct Stream* s, struct ResourceZipEn
 		if ((res = s->Read(s, tmp, toRead, &read))) return res;
 		if (!read) return ERR_END_OF_STREAM;
 
-		for (i = 0; i < read; i++) {
-			crc = Utils_Crc32Table[(crc ^ tmp[i]) & 0xFF] ^ (crc >> 8);
-		}
+		crc = Utils_UpdateCRC32(crc, tmp, read);
 	}
 	e->crc32 = crc ^ 0xffffffffUL;
 
@@ -41,6 +41,7 @@ static void Server_ResetState(void) {
 	Server.SupportsPlayerClick     = false;
 	Server.SupportsPartialMessages = false;
 	Server.SupportsFullCP437       = false;
+	Server.SendStalls              = 0;
 }
 
 void Server_RetrieveTexturePack(const cc_string* url) {
@@ -243,6 +244,15 @@ static cc_bool net_connecting;
 static double net_connectTimeout;
 #define NET_TIMEOUT_SECS 15
 
+/* Outbound data that couldn't be sent immediately, stored as a growable ring buffer */
+static cc_uint8* net_sendBuffer;
+static cc_uint32 net_sendCapacity, net_sendHead;
+static double net_lastSend;
+#define NET_SEND_MIN_SIZE (16 * 1024)
+#define NET_SEND_MAX_SIZE (16 * 1024 * 1024)
+/* Server is considered unreachable if no queued data can be sent for this long */
+#define NET_SEND_TIMEOUT_SECS 10
+
 static void MPConnection_FinishConnect(void) {
 	net_connecting = false;
 	Event_RaiseVoid(&NetEvents.Connected);
@@ -331,6 +341,108 @@ static void MPConnection_BeginConnect(void) {
 	}
 }
 
+static cc_bool SendQueue_Grow(cc_uint32 required) {
+	cc_uint32 capacity = net_sendCapacity ? net_sendCapacity : NET_SEND_MIN_SIZE;
+	cc_uint32 count    = Server.SendQueued;
+	cc_uint32 first;
+	cc_uint8* buffer;
+
+	if (required > NET_SEND_MAX_SIZE) return false;
+	while (capacity < required) capacity *= 2;
+	buffer = (cc_uint8*)Mem_TryAlloc(capacity, 1);
+	if (!buffer) return false;
+
+	/* Unwrap the queued data to the start of the new buffer */
+	if (count) {
+		first = min(count, net_sendCapacity - net_sendHead);
+		Mem_Copy(buffer,         net_sendBuffer + net_sendHead, first);
+		Mem_Copy(buffer + first, net_sendBuffer,                count - first);
+	}
+
+	Mem_Free(net_sendBuffer);
+	net_sendBuffer   = buffer;
+	net_sendCapacity = capacity;
+	net_sendHead     = 0;
+	return true;
+}
+
+static void SendQueue_Append(const cc_uint8* data, cc_uint32 len) {
+	cc_uint32 tail, first;
+	if (Server.SendQueued + len > net_sendCapacity && !SendQueue_Grow(Server.SendQueued + len)) {
+		net_writeFailure = ERR_OUT_OF_MEMORY; return;
+	}
+
+	tail  = (net_sendHead + Server.SendQueued) % net_sendCapacity;
+	first = min(len, net_sendCapacity - tail);
+	Mem_Copy(net_sendBuffer + tail, data, first);
+	Mem_Copy(net_sendBuffer, data + first, len - first);
+	Server.SendQueued += len;
+}
+
+/* Sends as much queued data as possible without blocking */
+static void SendQueue_Flush(void) {
+	cc_uint32 len, wrote;
+	cc_bool writable;
+	cc_result res;
+	if (!Server.SendQueued || net_writeFailure) return;
+
+	res = Socket_CheckWritable(net_socket, &writable);
+	if (res) { net_writeFailure = res; return; }
+
+	while (writable && Server.SendQueued) {
+		len = min(Server.SendQueued, net_sendCapacity - net_sendHead);
+		res = Socket_Write(net_socket, net_sendBuffer + net_sendHead, len, &wrote);
+
+		if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) break;
+		if (res)    { net_writeFailure = res;                  return; }
+		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
+
+		net_sendHead       = (net_sendHead + wrote) % net_sendCapacity;
+		Server.SendQueued -= wrote;
+		net_lastSend       = Game.Time;
+	}
+
+	if (!Server.SendQueued) {
+		net_sendHead = 0;
+	} else if (net_lastSend + NET_SEND_TIMEOUT_SECS < Game.Time) {
+		net_writeFailure = ReturnCode_SocketWouldBlock;
+	}
+}
+
+static void SendQueue_Reset(void) {
+	Mem_Free(net_sendBuffer);
+	net_sendBuffer    = NULL;
+	net_sendCapacity  = 0;
+	net_sendHead      = 0;
+	Server.SendQueued = 0;
+}
+
+static void MPConnection_SendData(const cc_uint8* data, cc_uint32 len) {
+	cc_uint32 wrote;
+	cc_result res;
+	if (Server.Disconnected) return;
+
+	/* Data must be sent in order, so once anything is queued, all further data has to be queued too */
+	if (!Server.SendQueued) {
+		while (len) {
+			res = Socket_Write(net_socket, data, len, &wrote);
+			/* Send buffer is full, so queue up remaining data to send later in MPConnection_Tick */
+			if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) break;
+
+			/* NOTE: Not immediately disconnecting here, as otherwise we sometimes miss out on kick messages */
+			if (res)    { net_writeFailure = res;                  return; }
+			if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
+
+			data += wrote; len -= wrote;
+		}
+
+		if (!len) return;
+		Server.SendStalls++;
+		net_lastSend = Game.Time;
+	}
+	SendQueue_Append(data, len);
+}
+
 static void MPConnection_SendBlock(int x, int y, int z, BlockID old, BlockID now) {
 	if (now == BLOCK_AIR) {
 		now = Inventory_SelectedBlock;
@@ -437,6 +549,7 @@ static void MPConnection_Tick(struct ScheduledTask* task) {
 		net_readCurrent = net_readBuffer + remaining;
 	}
 
+	SendQueue_Flush();
 	if (net_writeFailure) {
 		Platform_Log1("Error from send: %e", &net_writeFailure);
 		MPConnection_Disconnect(); return;
@@ -449,30 +562,6 @@ static void MPConnection_Tick(struct ScheduledTask* task) {
 	Protocol_Tick();
 }
 
-static void MPConnection_SendData(const cc_uint8* data, cc_uint32 len) {
-	cc_uint32 wrote;
-	cc_result res;
-	int tries = 0;
-	if (Server.Disconnected) return;
-
-	while (len) {
-		res = Socket_Write(net_socket, data, len, &wrote);
-		/* If sending would block (send buffer full), retry for a bit up to 10 seconds */
-		/* TODO: Avoid doing this and manually buffer data when this happens */
-		if (res && tries < 1000 && (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock)) {
-			Thread_Sleep(10);
-			tries++;
-			continue;
-		}
-
-		/* NOTE: Not immediately disconnecting here, as otherwise we sometimes miss out on kick messages */
-		if (res)    { net_writeFailure = res;                  return; }
-		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
-
-		data += wrote; len -= wrote;
-	}
-}
-
 static void MPConnection_Init(void) {
 	Server_ResetState();
 	Server.IsSinglePlayer = false;
@@ -545,6 +634,9 @@ static void OnClose(void) {
 
 		Socket_Close(net_socket);
 		Server.Disconnected = true;
+#ifdef CC_BUILD_NETWORKING
+		SendQueue_Reset();
+#endif
 	}
 }
 
@@ -65,6 +65,12 @@ CC_VAR extern struct _ServerConnectionData {
 	cc_string Address;
 	/* Port of the server if multiplayer, 0 if singleplayer */
 	int Port;
+
+	/* Number of bytes queued up waiting to be sent to the server */
+	/* NOTE: Data is queued when the socket's send buffer is full */
+	cc_uint32 SendQueued;
+	/* Number of times data had to be queued because sending would have blocked */
+	cc_uint32 SendStalls;
 } Server;
 
 /* If user hasn't previously accepted url, displays a dialog asking to confirm downloading it */
@@ -373,13 +373,7 @@ void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, void* data
 *#########################################################################################################################*/
 static cc_result Stream_Crc32Write(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
 	struct Stream* source;
-	cc_uint32 i, crc32 = stream->meta.crc32.crc32;
-
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
-	}
-	stream->meta.crc32.crc32 = crc32;
+	stream->meta.crc32.crc32 = Utils_UpdateCRC32(stream->meta.crc32.crc32, data, count);
 
 	source = stream->meta.crc32.source;
 	return source->Write(source, data, count, modified);
@@ -16,6 +16,7 @@
 #include "Utils.h"
 #include "Chat.h" /* TODO avoid this include */
 #include "Errors.h"
+#include "Builder.h"
 
 /* Simple fallback terrain for when no texture packs are available at all */
 static BitmapCol fallback_terrain[16 * 8] = {
@@ -158,6 +159,8 @@ static void Atlas_Update1D(void) {
 
 	maxAtlasHeight   = min(4096, maxTexHeight);
 	maxTilesPerAtlas = maxAtlasHeight / Atlas2D.TileSize;
+	/* Greedy meshed faces repeat the texture vertically too */
+	if (Builder_GreedyMeshing) maxTilesPerAtlas = 1;
 	maxTiles         = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
 
 	Atlas1D.TilesPerAtlas = min(maxTilesPerAtlas, maxTiles);
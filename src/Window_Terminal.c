@@ -15,6 +15,7 @@
 #ifdef CC_BUILD_WIN
 #include <windows.h>
 #else
+#include <errno.h>
 #include <unistd.h>
 #include <termios.h>
 #include <poll.h>
@@ -48,7 +49,8 @@
 #endif
 
 static void SetMousePosition(int x, int y);
-static cc_bool pendingResize, pendingClose;
+static void FreeOutput(void);
+static cc_bool pendingResize, pendingClose, redrawAll;
 static int supportsTruecolor;
 #define CHARS_PER_CELL 2
 #define CSI "\x1B["
@@ -424,6 +426,7 @@ void Window_Init(void) {
 
 void Window_Free(void) {
 	UnhookTerminal();
+	FreeOutput();
 }
 
 static void DoCreateWindow(int width, int height) {
@@ -477,6 +480,8 @@ void Window_ProcessEvents(float delta) {
 	if (pendingResize) {
 		pendingResize = false;
 		UpdateDimensions();
+		/* Terminal contents may have been cleared or reflowed */
+		redrawAll = true;
 		Event_RaiseVoid(&WindowEvents.Resized);
 	}
 	
@@ -539,6 +544,8 @@ void Window_AllocFramebuffer(struct Bitmap* bmp, int width, int height) {
 
 void Window_FreeFramebuffer(struct Bitmap* bmp) {
 	Mem_Free(bmp->scan0);
+	/* Framebuffer contents are no longer what was last drawn */
+	redrawAll = true;
 }
 
 void OnscreenKeyboard_Open(struct OpenKeyboardArgs* args) { }
@@ -561,15 +568,52 @@ void Window_DisableRawMouse(void) {
 /*########################################################################################################################*
 *-------------------------------------------------------Console output-----------------------------------------------------*
 *#########################################################################################################################*/
-// TODO still wrong
-static void AppendByteFast(cc_string* str, int value) {
-	if (value >= 100) { 
-		String_Append(str, '0' + (value / 100)); value %= 100;
-		String_Append(str, '0' + (value /  10)); value %=  10;
-	} else if (value >=  10) { 
-		String_Append(str, '0' + (value /  10)); value %=  10; 
+/* Colour of the top and bottom half of each cell, as last written to the terminal */
+/* (i.e. 0xRRGGBB in truecolor mode, 256 colour palette index otherwise) */
+struct TermCell { cc_uint32 top, bot; };
+static struct TermCell* cells;
+static int cellsWidth, cellsHeight;
+
+/* Output for the current frame is accumulated here, then written all at once */
+static char* outBuf;
+static int outLen, outCapacity;
+/* Worst case output for one cell is cursor move + 2 truecolor SGRs + BOX_CHAR */
+#define MAX_CELL_OUTPUT 64
+
+static void ResetCells(void) {
+	Mem_Free(cells);
+	cells       = NULL;
+	cellsWidth  = 0;
+	cellsHeight = 0;
+}
+
+static void EnsureCells(int width, int height) {
+	int i;
+	if (cells && width == cellsWidth && height == cellsHeight) return;
+
+	Mem_Free(cells);
+	cells       = (struct TermCell*)Mem_Alloc(width * height, sizeof(struct TermCell), "terminal cells");
+	cellsWidth  = width;
+	cellsHeight = height;
+
+	/* Use an impossible colour so every cell gets drawn the next frame */
+	for (i = 0; i < width * height; i++) 
+	{
+		cells[i].top = 0xFFFFFFFFU;
+		cells[i].bot = 0xFFFFFFFFU;
 	}
-	String_Append(str, '0' + value);
+}
+
+static char* AppendNum(char* dst, int value) {
+	char digits[10];
+	int i = 0;
+
+	do {
+		digits[i++] = '0' + (value % 10); value /= 10;
+	} while (value);
+
+	while (i) *dst++ = digits[--i];
+	return dst;
 }
 
 static int Index256(int value) {
@@ -578,77 +622,142 @@ static int Index256(int value) {
 	return (value - 0x5F + 20) / 40;
 }
 
-static int CalcIndex(BitmapCol rgb) {
-	int r = Index256(BitmapCol_R(rgb));
-	int g = Index256(BitmapCol_G(rgb));
-	int b = Index256(BitmapCol_B(rgb));
+static cc_uint32 CalcColor(BitmapCol rgb) {
+	int r, g, b;
+	if (supportsTruecolor) {
+		return (BitmapCol_R(rgb) << 16) | (BitmapCol_G(rgb) << 8) | BitmapCol_B(rgb);
+	}
 
+	r = Index256(BitmapCol_R(rgb));
+	g = Index256(BitmapCol_G(rgb));
+	b = Index256(BitmapCol_B(rgb));
 	return 16 + 36 * r + 6 * g + b;
 }
 
+/* https://en.wikipedia.org/wiki/ANSI_escape_code#Colors */
+static char* AppendColor(char* dst, char type, cc_uint32 color) {
+	*dst++ = '\x1B'; *dst++ = '['; 
+	*dst++ = type;   *dst++ = '8'; *dst++ = SEP_CHAR;
+
+	if (supportsTruecolor) {
+		*dst++ = '2'; *dst++ = SEP_CHAR;
+		dst    = AppendNum(dst, (color >> 16) & 0xFF);
+		*dst++ = SEP_CHAR;
+		dst    = AppendNum(dst, (color >>  8) & 0xFF);
+		*dst++ = SEP_CHAR;
+		dst    = AppendNum(dst,  color        & 0xFF);
+	} else {
+		*dst++ = '5'; *dst++ = SEP_CHAR;
+		dst    = AppendNum(dst, color);
+	}
+
+	*dst++ = 'm';
+	return dst;
+}
+
+static void EnsureOutput(int required) {
+	if (outLen + required <= outCapacity) return;
+
+	outCapacity = max(outCapacity * 2, outLen + required);
+	outBuf      = (char*)Mem_Realloc(outBuf, outCapacity, 1, "terminal output");
+}
+
+static void FlushOutput(void) {
+#ifdef CC_BUILD_WIN
+	if (!OutputConsole(outBuf, outLen)) redrawAll = true;
+#else
+	struct pollfd pfd;
+	int written, offset = 0;
+	
+	// write() may only write part of the data when stdout is a pipe or socket
+	while (offset < outLen)
+	{
+		written = OutputConsole(outBuf + offset, outLen - offset);
+		if (written > 0) { offset += written; continue; }
+
+		if (written < 0 && errno == EINTR) continue;
+		// Non-blocking stdout, so wait until more data can be written
+		if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			pfd.fd = STDOUT_FILENO; pfd.events = POLLOUT;
+			if (poll(&pfd, 1, -1) >= 0 || errno == EINTR) continue;
+		}
+
+		// Rest of the frame was lost, so cells no longer match what the terminal shows
+		redrawAll = true;
+		break;
+	}
+#endif
+	outLen = 0;
+}
+
+static void FreeOutput(void) {
+	ResetCells();
+	Mem_Free(outBuf);
+	outBuf      = NULL;
+	outLen      = 0;
+	outCapacity = 0;
+}
+
 void Window_DrawFramebuffer(Rect2D r, struct Bitmap* bmp) {
-	char buf[256];
-	cc_string str;
-	int len;
-	String_InitArray(str, buf);
+	int rowBeg = r.y / CHARS_PER_CELL;
+	int rowEnd = (r.y + r.height + 1) / CHARS_PER_CELL;
+	int colBeg = r.x;
+	int colEnd = r.x + r.width;
+	int curRow = -1, curCol = -1;
+	cc_uint32 curTop = 0, curBot = 0;
+	cc_bool hasColor = false;
+	struct TermCell* cell;
+	cc_uint32 top, bot;
+	int row, col, y;
+	char* dst;
+
+	if (redrawAll) { ResetCells(); redrawAll = false; }
+	EnsureCells(bmp->width, (bmp->height + 1) / CHARS_PER_CELL);
+	rowEnd = min(rowEnd, cellsHeight);
+	colEnd = min(colEnd, cellsWidth);
 	
-	for (int y = r.y & ~0x01; y < r.y + r.height; y += 2)
+	for (row = rowBeg; row < rowEnd; row++)
 	{
-		//len = sprintf(buf, CSI "%i;%iH", y / 2, r.x); // move cursor to start
-		//OutputConsole(buf, len);
-		str.length = 0;
-		String_AppendConst(&str, CSI);
-		String_AppendInt(  &str, y / CHARS_PER_CELL);
-		String_Append(     &str, ';');
-		String_AppendInt(  &str, r.x);
-		String_Append(     &str, 'H');
-		OutputConsole(buf, str.length);
-		
-		for (int x = r.x; x < r.x + r.width; x++)
+		y    = row * CHARS_PER_CELL;
+		cell = &cells[row * cellsWidth + colBeg];
+
+		for (col = colBeg; col < colEnd; col++, cell++)
 		{
-			BitmapCol top = Bitmap_GetPixel(bmp, x, y + 0);
-			BitmapCol bot = Bitmap_GetPixel(bmp, x, y + 1);
-	
 			// Use '▄' so each cell can use a background and foreground colour
 			// This essentially doubles the vertical resolution of the displayed image
-			//printf(CSI "48;2;%i;%i;%im", BitmapCol_R(top), BitmapCol_G(top), BitmapCol_B(top));
-			//printf(CSI "38;2;%i;%i;%im", BitmapCol_R(bot), BitmapCol_G(bot), BitmapCol_B(bot));
-			//printf("\xE2\x96\x84");
-			//len = sprintf(buf, CSI "48;2;%i;%i;%im" CSI "38;2;%i;%i;%im" BOX_CHAR, 
-			//				BitmapCol_R(top), BitmapCol_G(top), BitmapCol_B(top),
-			//				BitmapCol_R(bot), BitmapCol_G(bot), BitmapCol_B(bot));
-			
-			// https://en.wikipedia.org/wiki/ANSI_escape_code#Colors
-			str.length = 0;
-			if (supportsTruecolor) {
-				String_AppendConst(&str, CSI "48" SEP_STR "2" SEP_STR);
-				String_AppendInt(  &str, BitmapCol_R(top));
-				String_Append(     &str, SEP_CHAR);
-				String_AppendInt(  &str, BitmapCol_G(top));
-				String_Append(     &str, SEP_CHAR);
-				String_AppendInt(  &str, BitmapCol_B(top));
-				String_Append(     &str, 'm');
-				
-				String_AppendConst(&str, CSI "38" SEP_STR "2" SEP_STR);
-				String_AppendInt(  &str, BitmapCol_R(bot));
-				String_Append(     &str, SEP_CHAR);
-				String_AppendInt(  &str, BitmapCol_G(bot));
-				String_Append(     &str, SEP_CHAR);
-				String_AppendInt(  &str, BitmapCol_B(bot));
-				String_Append(     &str, 'm');
-			} else {
-				String_AppendConst(&str, CSI "48" SEP_STR "5" SEP_STR);
-				String_AppendInt(  &str, CalcIndex(top));
-				String_Append(     &str, 'm');
-				
-				String_AppendConst(&str, CSI "38" SEP_STR "5" SEP_STR);
-				String_AppendInt(  &str, CalcIndex(bot));
-				String_Append(     &str, 'm');
+			top = CalcColor(Bitmap_GetPixel(bmp, col, y));
+			bot = y + 1 < bmp->height ? CalcColor(Bitmap_GetPixel(bmp, col, y + 1)) : top;
+			if (cell->top == top && cell->bot == bot) continue;
+
+			cell->top = top;
+			cell->bot = bot;
+			EnsureOutput(MAX_CELL_OUTPUT);
+			dst = outBuf + outLen;
+
+			// Only need to move cursor when unchanged cells were skipped over
+			if (row != curRow || col != curCol) {
+				*dst++ = '\x1B'; *dst++ = '[';
+				dst    = AppendNum(dst, row + 1);
+				*dst++ = ';';
+				dst    = AppendNum(dst, col + 1);
+				*dst++ = 'H';
 			}
-			
-			String_AppendConst(&str, BOX_CHAR);
-			OutputConsole(buf, str.length);
-		}		
+
+			// Only need to change colour when different from the previously written cell
+			if (!hasColor || top != curTop) dst = AppendColor(dst, '4', top);
+			if (!hasColor || bot != curBot) dst = AppendColor(dst, '3', bot);
+
+			Mem_Copy(dst, BOX_CHAR, sizeof(BOX_CHAR) - 1);
+			dst += sizeof(BOX_CHAR) - 1;
+
+			outLen   = (int)(dst - outBuf);
+			curRow   = row;
+			curCol   = col + 1;
+			curTop   = top;
+			curBot   = bot;
+			hasColor = true;
+		}
 	}
+	FlushOutput();
 }
 #endif
@@ -120,7 +120,7 @@ static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags);
 
 /* Adds a req to the list of pending requests, waking up worker thread if needed. */
 static int Http_Add(const cc_string* url, cc_uint8 flags, cc_uint8 type, const cc_string* lastModified,
-					const cc_string* etag, const void* data, cc_uint32 size, struct StringsBuffer* cookies) {
+					const cc_string* etag, const void* data, cc_uint32 size, struct StringsBuffer* cookies, Http_ProcessFunc process) {
 	static const cc_string https = String_FromConst("https://");
 	static const cc_string http  = String_FromConst("http://");
 	struct HttpRequest req = { 0 };
@@ -130,6 +130,7 @@ static int Http_Add(const cc_string* url, cc_uint8 flags, cc_uint8 type, const c
 
 	req.id = ++nextReqID;
 	req.requestType = type;
+	req.flags       = flags;
 
 	/* Change http:// to https:// if required */
 	if (httpsOnly) {
@@ -155,7 +156,9 @@ static int Http_Add(const cc_string* url, cc_uint8 flags, cc_uint8 type, const c
 		req.size = size;
 	}
 	req.cookies  = cookies;
+	req.process  = process;
 	req.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	req.timeAdded = Stopwatch_Measure();
 
 	HttpBackend_Add(&req, flags);
 	return req.id;
@@ -187,6 +190,7 @@ static void Http_GetUrl(struct HttpRequest* req, cc_string* dst) {
 /* Updates state after a completed http request */
 static void Http_FinishRequest(struct HttpRequest* req) {
 	req->success = !req->result && req->statusCode == 200 && req->data && req->size;
+	if (req->success && req->process) req->processResult = req->process(req);
 
 	if (!req->success) {
 		char* error = req->error; req->error = NULL;
@@ -228,7 +232,7 @@ static void Http_CleanCacheTask(struct ScheduledTask* task) {
 /*########################################################################################################################*
 *----------------------------------------------------Http public api------------------------------------------------------*
 *#########################################################################################################################*/
-int Http_AsyncGetSkin(const cc_string* skinName, cc_uint8 flags) {
+int Http_AsyncGetSkin(const cc_string* skinName, cc_uint8 flags, Http_ProcessFunc process) {
 	cc_string url; char urlBuffer[URL_MAX_SIZE];
 	String_InitArray(url, urlBuffer);
 
@@ -237,20 +241,20 @@ int Http_AsyncGetSkin(const cc_string* skinName, cc_uint8 flags) {
 	} else {
 		String_Format2(&url, "%s/%s.png", &skinServer, skinName);
 	}
-	return Http_AsyncGetData(&url, flags);
+	return Http_Add(&url, flags, REQUEST_TYPE_GET, NULL, NULL, NULL, 0, NULL, process);
 }
 
 int Http_AsyncGetData(const cc_string* url, cc_uint8 flags) {
-	return Http_Add(url, flags, REQUEST_TYPE_GET, NULL, NULL, NULL, 0, NULL);
+	return Http_Add(url, flags, REQUEST_TYPE_GET, NULL, NULL, NULL, 0, NULL, NULL);
 }
 int Http_AsyncGetHeaders(const cc_string* url, cc_uint8 flags) {
-	return Http_Add(url, flags, REQUEST_TYPE_HEAD, NULL, NULL, NULL, 0, NULL);
+	return Http_Add(url, flags, REQUEST_TYPE_HEAD, NULL, NULL, NULL, 0, NULL, NULL);
 }
 int Http_AsyncPostData(const cc_string* url, cc_uint8 flags, const void* data, cc_uint32 size, struct StringsBuffer* cookies) {
-	return Http_Add(url, flags, REQUEST_TYPE_POST, NULL, NULL, data, size, cookies);
+	return Http_Add(url, flags, REQUEST_TYPE_POST, NULL, NULL, data, size, cookies, NULL);
 }
 int Http_AsyncGetDataEx(const cc_string* url, cc_uint8 flags, const cc_string* lastModified, const cc_string* etag, struct StringsBuffer* cookies) {
-	return Http_Add(url, flags, REQUEST_TYPE_GET, lastModified, etag, NULL, 0, cookies);
+	return Http_Add(url, flags, REQUEST_TYPE_GET, lastModified, etag, NULL, 0, cookies, NULL);
 }
 
 static cc_bool Http_UrlDirect(cc_uint8 c) {